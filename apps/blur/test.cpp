@@ -14,14 +14,14 @@ using namespace Halide::Tools;
 
 // typedef CImg<uint16_t> Image;
 
-double t;
+BenchmarkResult t;
 
 
 Image<uint16_t> blur(Image<uint16_t> in) {
     Image<uint16_t> tmp(in.width()-8, in.height());
     Image<uint16_t> out(in.width()-8, in.height()-2);
 
-    t = benchmark(10, 1, [&]() {
+    t = benchmark([&]() {
         for (int y = 0; y < tmp.height(); y++)
             for (int x = 0; x < tmp.width(); x++)
                 tmp(x, y) = (in(x, y) + in(x+1, y) + in(x+2, y))/3;
@@ -38,7 +38,7 @@ Image<uint16_t> blur(Image<uint16_t> in) {
 Image<uint16_t> blur_fast(Image<uint16_t> in) {
     Image<uint16_t> out(in.width()-8, in.height()-2);
 
-    t = benchmark(10, 1, [&]() {
+    t = benchmark([&]() {
         __m128i one_third = _mm_set1_epi16(21846);
 #pragma omp parallel for
         for (int yTile = 0; yTile < out.height(); yTile += 32) {
@@ -127,7 +127,7 @@ Image<uint16_t> blur_fast2(const Image<uint16_t> &in) {
         return out;
     }
 
-    t = benchmark(10, 1, [&]() {
+    t = benchmark([&]() {
         // multiplying by 21846 then taking the top 16 bits is equivalent to
         // dividing by three
         __m128i one_third = _mm_set1_epi16(21846);
@@ -181,7 +181,7 @@ Image<uint16_t> blur_halide(Image<uint16_t> in) {
     // Call it once to initialize the halide runtime stuff
     halide_blur(in, out);
 
-    t = benchmark(10, 1, [&]() {
+    t = benchmark([&]() {
         // Compute the same region of the output as blur_fast (i.e., we're
         // still being sloppy with boundary conditions)
         halide_blur(in, out);
@@ -200,20 +200,19 @@ int main(int argc, char **argv) {
         }
     }
 
+    const double pixels = (input.width() - 8) * (input.height() - 2);
+
     Image<uint16_t> blurry = blur(input);
-    double slow_time = t;
+    benchmark_report("blur_naive", t, pixels, "pixels");
 
     Image<uint16_t> speedy = blur_fast(input);
-    double fast_time = t;
+    benchmark_report("blur_fast", t, pixels, "pixels");
 
+    // blur_fast2 is always slower than blur_fast, so skip it
     //Image<uint16_t> speedy2 = blur_fast2(input);
-    //float fast_time2 = t;
 
     Image<uint16_t> halide = blur_halide(input);
-    double halide_time = t;
-
-    // fast_time2 is always slower than fast_time, so skip printing it
-    printf("times: %f %f %f\n", slow_time, fast_time, halide_time);
+    benchmark_report("blur_halide", t, pixels, "pixels");
 
     for (int y = 64; y < input.height() - 64; y++) {
         for (int x = 64; x < input.width() - 64; x++) {
@@ -6,20 +6,28 @@ using namespace Halide;
 HalideExtern_2(int, an_extern_func, int, int);
 
 int main(int argc, char **argv) {
-    Func f, g, h;
+    Func f, g, h, tile;
     ImageParam input(UInt(16), 2);
-    Var x, y;
+    Var x, y, yo, yi;
 
     f(x, y) = (input(clamp(x+2, 0, input.width()-1), clamp(y-2, 0, input.height()-1)) * 17)/13;
 
     h.define_extern("an_extern_stage", {f}, Int(16), 0);
 
-    g(x, y) = f(y, x) + f(x, y) + cast<uint16_t>(an_extern_func(x, y)) + h();
+    tile(x, y) = f(y, x) + f(x, y);
+
+    g(x, y) = tile(x, y) + cast<uint16_t>(an_extern_func(x, y)) + h();
 
     h.compute_root();
     f.compute_root();
     f.debug_to_file("f.tiff");
 
+    // tile is as wide as the output, so it goes on the heap, and is
+    // computed inside a parallel loop, so it comes from a scratch
+    // arena.
+    g.split(y, yo, yi, 16).parallel(yo);
+    tile.compute_at(g, yo);
+
     std::vector<Argument> args;
     args.push_back(input);
 
@@ -1,12 +1,16 @@
 #ifndef BENCHMARK_H
 #define BENCHMARK_H
 
+#include <algorithm>
+#include <cmath>
 #include <limits>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string>
+#include <vector>
 
-// Benchmark the operation 'op'. The number of iterations refers to
-// how many times the operation is run for each time measurement, the
-// result is the minimum over a number of samples runs. The result is the
-// amount of time in seconds for one iteration.
+// The current time in seconds, from an arbitrary starting point.
 #ifdef _WIN32
 
 union _LARGE_INTEGER;
@@ -14,45 +18,174 @@ typedef union _LARGE_INTEGER LARGE_INTEGER;
 extern "C" int __stdcall QueryPerformanceCounter(LARGE_INTEGER*);
 extern "C" int __stdcall QueryPerformanceFrequency(LARGE_INTEGER*);
 
-template <typename F>
-double benchmark(int samples, int iterations, F op) {
-    int64_t freq;
+inline double benchmark_now() {
+    int64_t freq, t;
     QueryPerformanceFrequency((LARGE_INTEGER*)&freq);
+    QueryPerformanceCounter((LARGE_INTEGER*)&t);
+    return t / static_cast<double>(freq);
+}
+
+#else
+
+#include <chrono>
+
+inline double benchmark_now() {
+    auto t = std::chrono::steady_clock::now().time_since_epoch();
+    return std::chrono::duration_cast<std::chrono::duration<double>>(t).count();
+}
 
+#endif
+
+// Benchmark the operation 'op'. The number of iterations refers to
+// how many times the operation is run for each time measurement, the
+// result is the minimum over a number of samples runs. The result is the
+// amount of time in seconds for one iteration.
+template <typename F>
+double benchmark(int samples, int iterations, F op) {
     double best = std::numeric_limits<double>::infinity();
     for (int i = 0; i < samples; i++) {
-        int64_t t1;
-        QueryPerformanceCounter((LARGE_INTEGER*)&t1);
+        double t1 = benchmark_now();
         for (int j = 0; j < iterations; j++) {
             op();
         }
-        int64_t t2;
-        QueryPerformanceCounter((LARGE_INTEGER*)&t2);
-        double dt = (t2 - t1) / static_cast<double>(freq);
+        double t2 = benchmark_now();
+        double dt = t2 - t1;
         if (dt < best) best = dt;
     }
     return best / iterations;
 }
 
-#else
+// How long to spend benchmarking something. All times are in seconds.
+struct BenchmarkConfig {
+    // The number of runs before timing starts, to warm up caches and
+    // lazily-initialized state.
+    int warmup = 1;
 
-#include <chrono>
+    // Each sample runs the operation enough times to take at least
+    // this long, so that it's well above the resolution of the timer.
+    // If zero, each sample is a single run, and no runs are spent
+    // working out how many to do.
+    double min_sample_time = 1e-3;
+
+    // Keep taking samples until there are at least min_samples of
+    // them and they took at least min_time in total, but stop at
+    // max_samples or once max_time has passed.
+    int min_samples = 10, max_samples = 1000;
+    double min_time = 0.1, max_time = 10;
+};
+
+// The distribution of the time taken by one run of the operation,
+// in seconds.
+struct BenchmarkResult {
+    double min = 0, max = 0, mean = 0, stddev = 0;
+    double median = 0, p10 = 0, p90 = 0;
+    int samples = 0;
+    // The number of runs per sample.
+    int iterations = 0;
+};
 
+// Benchmark the operation 'op', choosing the number of runs per
+// sample and the number of samples as described by 'config'.
 template <typename F>
-double benchmark(int samples, int iterations, F op) {
-    double best = std::numeric_limits<double>::infinity();
-    for (int i = 0; i < samples; i++) {
-        auto t1 = std::chrono::high_resolution_clock::now();
+BenchmarkResult benchmark(F op, const BenchmarkConfig &config = BenchmarkConfig()) {
+    for (int i = 0; i < config.warmup; i++) {
+        op();
+    }
+
+    // Double the iterations per sample until a sample is long enough.
+    int iterations = 1;
+    double start = benchmark_now();
+    while (config.min_sample_time > 0) {
+        double t1 = benchmark_now();
         for (int j = 0; j < iterations; j++) {
             op();
         }
-        auto t2 = std::chrono::high_resolution_clock::now();
-        double dt = std::chrono::duration_cast<std::chrono::microseconds>(t2 - t1).count() / 1e6;
-        if (dt < best) best = dt;
+        double dt = benchmark_now() - t1;
+        if (dt >= config.min_sample_time || benchmark_now() - start > config.max_time) break;
+        iterations *= 2;
     }
-    return best / iterations;
+
+    std::vector<double> times;
+    start = benchmark_now();
+    while ((int)times.size() < config.max_samples) {
+        double elapsed = benchmark_now() - start;
+        if ((int)times.size() >= config.min_samples && elapsed >= config.min_time) break;
+        if (!times.empty() && elapsed >= config.max_time) break;
+        double t1 = benchmark_now();
+        for (int j = 0; j < iterations; j++) {
+            op();
+        }
+        times.push_back((benchmark_now() - t1) / iterations);
+    }
+
+    BenchmarkResult r;
+    std::sort(times.begin(), times.end());
+    r.samples = (int)times.size();
+    r.iterations = iterations;
+    r.min = times.front();
+    r.max = times.back();
+    r.median = times[times.size() / 2];
+    r.p10 = times[times.size() / 10];
+    r.p90 = times[times.size() * 9 / 10];
+    for (double t : times) {
+        r.mean += t;
+    }
+    r.mean /= times.size();
+    for (double t : times) {
+        r.stddev += (t - r.mean) * (t - r.mean);
+    }
+    r.stddev = std::sqrt(r.stddev / times.size());
+    return r;
 }
 
-#endif
+// Escape a string for use inside a json string.
+inline std::string benchmark_json_escape(const std::string &s) {
+    std::string result;
+    for (char c : s) {
+        if (c == '"' || c == '\\') {
+            result += '\\';
+            result += c;
+        } else if ((unsigned char)c < 0x20) {
+            char buf[8];
+            snprintf(buf, sizeof(buf), "\\u%04x", (unsigned char)c);
+            result += buf;
+        } else {
+            result += c;
+        }
+    }
+    return result;
+}
+
+// Print a benchmark result. If items is non-zero it's the number of
+// items (e.g. pixels or flops) processed by one run, and the
+// throughput is printed in those units per second. If the environment
+// variable HL_BENCHMARK_JSON names a file, the result is also
+// appended to it as a line of json, which is what the benchmark
+// build targets compare against a baseline.
+inline void benchmark_report(const std::string &name, const BenchmarkResult &r,
+                             double items = 0, const std::string &units = "items") {
+    double throughput = items > 0 ? items / r.median : 0;
+    printf("%s: %1.4g ms (min %1.4g, p10 %1.4g, p90 %1.4g, stddev %1.3g, %d samples of %d)",
+           name.c_str(), r.median * 1e3, r.min * 1e3, r.p10 * 1e3, r.p90 * 1e3, r.stddev * 1e3,
+           r.samples, r.iterations);
+    if (throughput > 0) {
+        printf(" %1.4g M%s/s", throughput * 1e-6, units.c_str());
+    }
+    printf("\n");
+
+    const char *filename = getenv("HL_BENCHMARK_JSON");
+    if (!filename || !filename[0]) return;
+    FILE *f = fopen(filename, "a");
+    if (!f) {
+        printf("Could not open %s to append benchmark results\n", filename);
+        return;
+    }
+    fprintf(f, "{\"name\": \"%s\", \"median\": %.9g, \"min\": %.9g, \"max\": %.9g, "
+            "\"mean\": %.9g, \"stddev\": %.9g, \"p10\": %.9g, \"p90\": %.9g, "
+            "\"samples\": %d, \"iterations\": %d, \"throughput\": %.9g, \"units\": \"%s/s\"}\n",
+            benchmark_json_escape(name).c_str(), r.median, r.min, r.max, r.mean, r.stddev, r.p10, r.p90,
+            r.samples, r.iterations, throughput, benchmark_json_escape(units).c_str());
+    fclose(f);
+}
 
 #endif
@@ -10,10 +10,12 @@
 #include "../../src/Buffer.h"
 #include "Type.h" // for the repr function
 
+#include <algorithm>
 #include <vector>
 #include <string>
 
 namespace h = Halide;
+namespace p = boost::python;
 
 /// helper function to access &(Buffer::operator Argument)
 h::Argument buffer_to_argument(h::Buffer &that)
@@ -113,6 +115,140 @@ std::string buffer_repr(const h::Buffer &that)
 }
 
 
+namespace
+{
+
+// The struct module format character of the elements of a buffer of
+// type t, or NULL if there isn't one.
+const char *buffer_format(const h::Type &t)
+{
+    if (t.is_float())
+    {
+        return t.bits() == 32 ? "f" : t.bits() == 64 ? "d" : NULL;
+    }
+    else if (t.is_bool())
+    {
+        return "?";
+    }
+    else if (t.is_uint())
+    {
+        return t.bits() == 8 ? "B" : t.bits() == 16 ? "H" : t.bits() == 32 ? "I" : t.bits() == 64 ? "Q" : NULL;
+    }
+    else if (t.is_int())
+    {
+        return t.bits() == 8 ? "b" : t.bits() == 16 ? "h" : t.bits() == 32 ? "i" : t.bits() == 64 ? "q" : NULL;
+    }
+    return NULL;
+}
+
+int buffer_get_buffer_error(Py_buffer *view, const char *message)
+{
+    PyErr_SetString(PyExc_BufferError, message);
+    view->obj = NULL;
+    return -1;
+}
+
+// The shape and strides are in Halide's order, so the first dimension
+// of the view is x. The view shares the memory of the buffer, and
+// holds a reference to the Python object so that it stays alive.
+int buffer_get_buffer(PyObject *self, Py_buffer *view, int flags)
+{
+    p::extract<h::Buffer> extract_buffer(self);
+    if (!extract_buffer.check())
+    {
+        return buffer_get_buffer_error(view, "Object does not hold a Halide Buffer");
+    }
+
+    h::Buffer b = extract_buffer();
+    if (!b.defined() || b.host_ptr() == NULL)
+    {
+        return buffer_get_buffer_error(view, "Halide Buffer has no host memory");
+    }
+    const char *format = buffer_format(b.type());
+    if (format == NULL)
+    {
+        return buffer_get_buffer_error(view, "Halide Buffer has a type with no buffer format");
+    }
+    if (b.device_dirty() && b.copy_to_host() != 0)
+    {
+        return buffer_get_buffer_error(view, "Could not copy the Halide Buffer back from the device");
+    }
+
+    const int dims = b.dimensions();
+    const Py_ssize_t itemsize = b.raw_buffer()->elem_size;
+    Py_ssize_t *shape = new Py_ssize_t[2 * std::max(dims, 1)];
+    Py_ssize_t *strides = shape + std::max(dims, 1);
+    Py_ssize_t len = itemsize;
+    for (int i = 0; i < dims; i += 1)
+    {
+        shape[i] = b.extent(i);
+        strides[i] = b.stride(i) * itemsize;
+        len *= shape[i];
+    }
+
+    // Without strides the consumer assumes the memory is C-contiguous,
+    // i.e. the last dimension is dense, which Halide buffers usually
+    // aren't.
+    bool c_contiguous = true;
+    Py_ssize_t expected_stride = itemsize;
+    for (int i = dims - 1; i >= 0; i -= 1)
+    {
+        if (shape[i] > 1 && strides[i] != expected_stride)
+        {
+            c_contiguous = false;
+        }
+        expected_stride *= shape[i];
+    }
+    if ((flags & PyBUF_STRIDES) != PyBUF_STRIDES && !c_contiguous)
+    {
+        delete[] shape;
+        return buffer_get_buffer_error(view, "Halide Buffer is not C-contiguous, so views of it need strides");
+    }
+
+    if ((flags & PyBUF_WRITABLE) == PyBUF_WRITABLE)
+    {
+        b.set_host_dirty();
+    }
+
+    view->buf = b.host_ptr();
+    view->obj = self;
+    Py_INCREF(self);
+    view->len = len;
+    view->itemsize = itemsize;
+    view->readonly = 0;
+    view->format = (flags & PyBUF_FORMAT) ? const_cast<char *>(format) : NULL;
+    view->ndim = dims;
+    view->shape = (flags & PyBUF_ND) == PyBUF_ND ? shape : NULL;
+    view->strides = (flags & PyBUF_STRIDES) == PyBUF_STRIDES ? strides : NULL;
+    view->suboffsets = NULL;
+    view->internal = shape;
+    return 0;
+}
+
+void buffer_release_buffer(PyObject *, Py_buffer *view)
+{
+    delete[] static_cast<Py_ssize_t *>(view->internal);
+}
+
+} // namespace
+
+
+void add_buffer_protocol(const p::object &class_object)
+{
+    static PyBufferProcs buffer_procs;
+    buffer_procs.bf_getbuffer = &buffer_get_buffer;
+    buffer_procs.bf_releasebuffer = &buffer_release_buffer;
+
+    PyTypeObject *type = reinterpret_cast<PyTypeObject *>(class_object.ptr());
+    type->tp_as_buffer = &buffer_procs;
+#if PY_MAJOR_VERSION < 3
+    type->tp_flags |= Py_TPFLAGS_HAVE_NEWBUFFER;
+#endif
+    PyType_Modified(type);
+    return;
+}
+
+
 void defineBuffer()
 {
 
@@ -188,7 +324,7 @@ void defineBuffer()
             .def("min", &Buffer::min, p::args("self", "dim"),
                  "Get the coordinate in the function that this buffer represents "
                  "that corresponds to the base address of the buffer.")
-            .def("set_min", &Buffer::set_min,
+            .def("set_min", static_cast<void (Buffer::*)(int, int, int, int)>(&Buffer::set_min),
                  (p::arg("self"), p::arg("m0"), p::arg("m1")=0, p::arg("m2")=0, p::arg("m3")=0),
                  "Set the coordinate in the function that this buffer represents "
                  "that corresponds to the base address of the buffer.")
@@ -228,6 +364,9 @@ void defineBuffer()
             .def("__repr__", &buffer_repr, p::arg("self"))
             ;
 
+    // e.g. numpy.asarray(buffer) makes an array that uses the buffer's memory
+    add_buffer_protocol(p::scope().attr("Buffer"));
+
     p::implicitly_convertible<Buffer, h::Argument>();
 
     p::class_< std::vector<Buffer> >("BuffersVector")
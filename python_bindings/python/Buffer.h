@@ -2,6 +2,13 @@
 #define BUFFER_H
 
 
+namespace boost { namespace python { namespace api { class object; } } }
+
 void defineBuffer();
 
+/// Let other Python libraries view the memory of the objects of a
+/// class that converts to Halide::Buffer, without copying it, through
+/// the buffer protocol (PEP 3118).
+void add_buffer_protocol(const boost::python::api::object &class_object);
+
 #endif // BUFFER_H
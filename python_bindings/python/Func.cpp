@@ -19,9 +19,23 @@
 namespace h = Halide;
 namespace p = boost::python;
 
+// Releases the GIL for as long as it is in scope, so that other Python
+// threads can run while Halide compiles or runs a pipeline. Nothing
+// may touch a Python object while it is in scope. Halide errors are
+// C++ exceptions, so the GIL is taken back before they are translated
+// into Python ones.
+class ScopedGILRelease
+{
+    PyThreadState *state;
+public:
+    ScopedGILRelease() : state(PyEval_SaveThread()) {}
+    ~ScopedGILRelease() { PyEval_RestoreThread(state); }
+};
+
 
 h::Realization func_realize0(h::Func &that, std::vector<int32_t> sizes, const h::Target &target = h::Target())
 {
+    ScopedGILRelease release;
     return that.realize(sizes, target);
 }
 
@@ -31,6 +45,7 @@ BOOST_PYTHON_FUNCTION_OVERLOADS( func_realize0_overloads, func_realize0, 2, 3)
 h::Realization func_realize1(h::Func &that, int x_size=0, int y_size=0, int z_size=0, int w_size=0,
                              const h::Target &target = h::Target())
 {
+    ScopedGILRelease release;
     return that.realize(x_size, y_size, z_size, w_size, target);
 }
 
@@ -39,6 +54,7 @@ BOOST_PYTHON_FUNCTION_OVERLOADS(func_realize1_overloads, func_realize1, 1, 6)
 
 void func_realize2(h::Func &that, h::Realization dst, const h::Target &target = h::Target())
 {
+    ScopedGILRelease release;
     that.realize(dst, target);
     return;
 }
@@ -48,6 +64,7 @@ BOOST_PYTHON_FUNCTION_OVERLOADS(func_realize2_overloads, func_realize2, 2, 3)
 
 void func_realize3(h::Func &that, h::Buffer dst, const h::Target &target = h::Target())
 {
+    ScopedGILRelease release;
     that.realize(dst, target);
     return;
 }
@@ -57,12 +74,14 @@ BOOST_PYTHON_FUNCTION_OVERLOADS(func_realize3_overloads, func_realize3, 2, 3)
 
 void func_compile_jit0(h::Func &that)
 {
+    ScopedGILRelease release;
     that.compile_jit();
     return;
 }
 
 void func_compile_jit1(h::Func &that, const h::Target &target = h::get_target_from_environment())
 {
+    ScopedGILRelease release;
     that.compile_jit(target);
     return;
 }
@@ -73,6 +92,7 @@ void func_compile_to_bitcode0(h::Func &that, const std::string &filename,
                               const std::string fn_name = "",
                               const h::Target &target = h::get_target_from_environment())
 {
+    ScopedGILRelease release;
     that.compile_to_bitcode(filename, args, fn_name, target);
     return;
 }
@@ -85,6 +105,7 @@ void func_compile_to_object0(h::Func &that, const std::string &filename,
                               const std::string fn_name = "",
                               const h::Target &target = h::get_target_from_environment())
 {
+    ScopedGILRelease release;
     that.compile_to_object(filename, args, fn_name, target);
     return;
 }
@@ -97,6 +118,7 @@ void func_compile_to_header0(h::Func &that, const std::string &filename,
                               const std::string fn_name = "",
                               const h::Target &target = h::get_target_from_environment())
 {
+    ScopedGILRelease release;
     that.compile_to_header(filename, args, fn_name, target);
     return;
 }
@@ -109,6 +131,7 @@ void func_compile_to_assembly0(h::Func &that, const std::string &filename,
                               const std::string fn_name = "",
                               const h::Target &target = h::get_target_from_environment())
 {
+    ScopedGILRelease release;
     that.compile_to_assembly(filename, args, fn_name, target);
     return;
 }
@@ -121,6 +144,7 @@ void func_compile_to_c0(h::Func &that, const std::string &filename,
                         const std::string fn_name = "",
                         const h::Target &target = h::get_target_from_environment())
 {
+    ScopedGILRelease release;
     that.compile_to_c(filename, args, fn_name, target);
     return;
 }
@@ -132,6 +156,7 @@ void func_compile_to_file0(h::Func &that, const std::string &filename_prefix,
                            const std::vector<h::Argument> &args,
                            const h::Target &target = h::get_target_from_environment())
 {
+    ScopedGILRelease release;
     that.compile_to_file(filename_prefix, args, target);
     return;
 }
@@ -145,12 +170,37 @@ void func_compile_to_lowered_stmt0(h::Func &that,
                                    h::StmtOutputFormat fmt = h::Text,
                                    const h::Target &target = h::get_target_from_environment())
 {
+    ScopedGILRelease release;
     that.compile_to_lowered_stmt(filename, args, fmt, target);
     return;
 }
 
 BOOST_PYTHON_FUNCTION_OVERLOADS(func_compile_to_lowered_stmt0_overloads, func_compile_to_lowered_stmt0, 3, 5)
 
+
+void func_infer_input_bounds0(h::Func &that, int x_size=0, int y_size=0, int z_size=0, int w_size=0)
+{
+    ScopedGILRelease release;
+    that.infer_input_bounds(x_size, y_size, z_size, w_size);
+    return;
+}
+
+BOOST_PYTHON_FUNCTION_OVERLOADS(func_infer_input_bounds0_overloads, func_infer_input_bounds0, 1, 5)
+
+void func_infer_input_bounds1(h::Func &that, h::Realization dst)
+{
+    ScopedGILRelease release;
+    that.infer_input_bounds(dst);
+    return;
+}
+
+void func_infer_input_bounds2(h::Func &that, h::Buffer dst)
+{
+    ScopedGILRelease release;
+    that.infer_input_bounds(dst);
+    return;
+}
+
 // parallel, vectorize, unroll, tile, and reorder methods are shared with Stage class
 // and thus defined as template functions in the header
 
@@ -493,6 +543,17 @@ void defineFunc()
                    "If filename ends in \".tif\" or \".tiff\" (case insensitive) the file "
                    "is in TIFF format and can be read by standard tools.");
 
+    func_class.def("infer_input_bounds", &func_infer_input_bounds0,
+                   func_infer_input_bounds0_overloads(
+                       p::args("self", "x_size", "y_size", "z_size", "w_size"),
+                       "For a given size of output, or a given output buffer, "
+                       "determine the bounds required of all unbound ImageParams "
+                       "referenced. Communicates the result by allocating new buffers "
+                       "of the appropriate size and binding them to the unbound "
+                       "ImageParams."))
+            .def("infer_input_bounds", &func_infer_input_bounds2, p::args("self", "dst"))
+            .def("infer_input_bounds", &func_infer_input_bounds1, p::args("self", "dst"));
+
     func_class.def("compile_to_lowered_stmt", &func_compile_to_lowered_stmt0,
                    func_compile_to_lowered_stmt0_overloads(
                        p::args("self", "filename", "args", "fmt", "target"),
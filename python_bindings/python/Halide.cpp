@@ -44,6 +44,10 @@ BOOST_PYTHON_MODULE(halide)
 {
     using namespace boost::python;
 
+    // Func.realize and the compile methods release the GIL while
+    // Halide works, which needs the GIL to exist.
+    PyEval_InitThreads();
+
     // we include all the pieces and bits from the Halide API
     defineArgument();
     defineBoundaryConditions();
@@ -20,9 +20,12 @@
 #include <boost/functional/hash/hash.hpp>
 
 #include "../../src/Image.h"
+#include "Buffer.h"
 #include "Type.h"
 #include "Func.h"
 
+#include <algorithm>
+#include <cstring>
 #include <vector>
 #include <unordered_map>
 #include <string>
@@ -415,6 +418,9 @@ void defineImage_impl(const std::string suffix, const h::Type type)
                  "Cast to Halide::buffer")
             ;
 
+    // e.g. numpy.asarray(image) makes an array that uses the image's memory
+    add_buffer_protocol(image_class);
+
 
     //        "Get a handle on the Buffer that this image holds"
     //        operator Buffer() const {
@@ -458,7 +464,7 @@ void defineImage_impl(const std::string suffix, const h::Type type)
 
 // To be used with care, since return object uses a  C++ pointer to data,
 // use p::with_custodian_and_ward_postcall to link the objects lifetime
-p::object raw_buffer_to_image(bn::ndarray &array, buffer_t &raw_buffer, const std::string &name)
+p::object raw_buffer_to_image(bn::ndarray &array, halide_buffer_nd_t &raw_buffer, const std::string &name)
 {
     PyObject* obj = NULL;
 
@@ -551,8 +557,8 @@ p::object raw_buffer_to_image(bn::ndarray &array, buffer_t &raw_buffer, const st
         printf("raw_buffer_to_image array of type '%s'. "
                "extent (%i, %i, %i, %i); stride (%i, %i, %i, %i)\n",
                type_repr.c_str(),
-               raw_buffer.extent[0], raw_buffer.extent[1], raw_buffer.extent[2], raw_buffer.extent[3],
-                raw_buffer.stride[0], raw_buffer.stride[1], raw_buffer.stride[2], raw_buffer.stride[3]);
+               raw_buffer.buf.extent[0], raw_buffer.buf.extent[1], raw_buffer.buf.extent[2], raw_buffer.buf.extent[3],
+                raw_buffer.buf.stride[0], raw_buffer.buf.stride[1], raw_buffer.buf.stride[2], raw_buffer.buf.stride[3]);
     }
 
 
@@ -561,7 +567,7 @@ p::object raw_buffer_to_image(bn::ndarray &array, buffer_t &raw_buffer, const st
 }
 
 
-buffer_t ndarray_to_buffer_t(bn::ndarray &array)
+halide_buffer_nd_t ndarray_to_buffer_t(bn::ndarray &array)
 {
     size_t num_elements = 0;
     for (size_t i = 0; i < (size_t)array.get_nd(); i += 1)
@@ -581,44 +587,37 @@ buffer_t ndarray_to_buffer_t(bn::ndarray &array)
         throw std::invalid_argument("numpy_to_image recieved an empty array");
     }
 
-    if (array.get_nd() > 4)
+    if (array.get_nd() > HALIDE_BUFFER_MAX_DIMENSIONS)
     {
-        throw std::invalid_argument("numpy_to_image received array with more than 4 dimensions. "
-                                    "Halide only supports 4 or less dimensions");
+        boost::format f("numpy_to_image received array with %i dimensions. "
+                        "Halide only supports up to %i dimensions");
+        throw std::invalid_argument(boost::str(f % array.get_nd() % HALIDE_BUFFER_MAX_DIMENSIONS));
     }
 
     // buffer_t initialization based on BufferContents::BufferContents
-    buffer_t raw_buffer;
-    raw_buffer.dev = 0;
+    halide_buffer_nd_t nd_buffer;
+    memset(&nd_buffer, 0, sizeof(nd_buffer));
+    buffer_t &raw_buffer = nd_buffer.buf;
     raw_buffer.host = reinterpret_cast<boost::uint8_t *>(array.get_data());
     raw_buffer.elem_size = array.get_dtype().get_itemsize(); // in bytes
-    raw_buffer.host_dirty = false;
-    raw_buffer.dev_dirty = false;
 
-    for (int c=0; c < 4; c += 1)
+    for (int c = 0; c < array.get_nd(); c += 1)
     {
-        if (c < array.get_nd())
-        {
-            raw_buffer.extent[c] = array.shape(c);
-            // numpy counts stride in bytes, while Halide counts in number of elements
-            user_assert((array.strides(c) % raw_buffer.elem_size) == 0);
-            raw_buffer.stride[c] = array.strides(c) / raw_buffer.elem_size;
-        }
-        else
-        {
-            raw_buffer.extent[c] = 0;
-            raw_buffer.stride[c] = 0;
-        }
-        raw_buffer.min[c] = 0;
+        int32_t &extent = c < 4 ? raw_buffer.extent[c] : nd_buffer.extent[c - 4];
+        int32_t &stride = c < 4 ? raw_buffer.stride[c] : nd_buffer.stride[c - 4];
+        extent = array.shape(c);
+        // numpy counts stride in bytes, while Halide counts in number of elements
+        user_assert((array.strides(c) % raw_buffer.elem_size) == 0);
+        stride = array.strides(c) / raw_buffer.elem_size;
     }
 
-    return raw_buffer;
+    return nd_buffer;
 }
 
 /// Will create a Halide::Image object pointing to the array data
 p::object ndarray_to_image(bn::ndarray &array, const std::string name="")
 {
-    buffer_t raw_buffer = ndarray_to_buffer_t(array);
+    halide_buffer_nd_t raw_buffer = ndarray_to_buffer_t(array);
     return raw_buffer_to_image(array, raw_buffer, name);
 }
 
@@ -671,6 +670,55 @@ bn::dtype type_to_dtype(const h::Type &t)
 }
 
 
+h::Type dtype_to_type(const bn::dtype &dt)
+{
+    const h::Type types[] = {h::UInt(8), h::UInt(16), h::UInt(32),
+                             h::Int(8), h::Int(16), h::Int(32),
+                             h::Float(32), h::Float(64)};
+    for (const h::Type &t : types)
+    {
+        if (type_to_dtype(t) == dt)
+        {
+            return t;
+        }
+    }
+
+    const std::string type_repr = p::extract<std::string>(p::str(dt));
+    throw std::invalid_argument("dtype_to_type received numpy dtype " + type_repr +
+                                ", which has no Halide::Type equivalent");
+}
+
+
+/// Lets a numpy array be passed wherever a Halide::Buffer is expected,
+/// e.g. to Func.realize, so that the pipeline writes straight into the
+/// array's memory. Read-only arrays are refused, since a Buffer can
+/// always be written to. The Buffer does not keep the array alive, so
+/// the array must outlive any use of it (e.g. by an ImageParam it was
+/// bound to).
+struct ndarray_to_buffer_converter
+{
+    static void *convertible(PyObject *obj)
+    {
+        return p::extract<bn::ndarray>(obj).check() ? obj : NULL;
+    }
+
+    static void construct(PyObject *obj, p::converter::rvalue_from_python_stage1_data *data)
+    {
+        bn::ndarray array = p::extract<bn::ndarray>(obj);
+        if (!(array.get_flags() & bn::ndarray::WRITEABLE))
+        {
+            throw std::invalid_argument("Cannot use a read-only numpy array as a Halide::Buffer");
+        }
+        halide_buffer_nd_t raw_buffer = ndarray_to_buffer_t(array);
+        h::Type t = dtype_to_type(array.get_dtype());
+
+        void *storage = reinterpret_cast<p::converter::rvalue_from_python_storage<h::Buffer> *>(data)->storage.bytes;
+        new (storage) h::Buffer(t, &raw_buffer);
+        data->convertible = storage;
+    }
+};
+
+
 bn::ndarray image_to_ndarray(p::object image_object)
 {
     p::extract<h::ImageBase &> image_base_extract(image_object);
@@ -685,27 +733,15 @@ bn::ndarray image_to_ndarray(p::object image_object)
 
     const h::Type& t = p::extract<h::Type &>(image_object.attr("type")());
 
-    buffer_t &raw_buffer = *b.raw_buffer();
-    std::vector<std::int32_t> shape_array(4), stride_array(4);
-    std::copy(raw_buffer.extent, raw_buffer.extent + 4, shape_array.begin());
-    std::copy(raw_buffer.stride, raw_buffer.stride + 4, stride_array.begin());
-
-
     // we make sure the array shape does not include the "0 extent" dimensions
     // we always keep at least one dimension (even if zero size)
-    for(size_t i = 3; i > 0; i -= 1)
-    {
-        if(shape_array[i] == 0)
-        {
-            shape_array.pop_back();
-            stride_array.pop_back();
-        }
-    }
-
-    // numpy counts stride in bytes, while Halide counts in number of elements
-    for(size_t i = 0; i < 4; i += 1)
+    const int dims = std::max(b.dimensions(), 1);
+    std::vector<std::int32_t> shape_array(dims), stride_array(dims);
+    for(int i = 0; i < dims; i += 1)
     {
-        stride_array[i] *= raw_buffer.elem_size;
+        shape_array[i] = b.extent(i);
+        // numpy counts stride in bytes, while Halide counts in number of elements
+        stride_array[i] = b.stride(i) * b.raw_buffer()->elem_size;
     }
 
     return bn::from_data(
@@ -898,6 +934,10 @@ void defineImage()
            "Creates a numpy array from a Halide::Image."
            "Will take into account the Image size, dimensions, and type."
            "Created ndarray refers to the Image data (no copy).");
+
+    p::converter::registry::push_back(&ndarray_to_buffer_converter::convertible,
+                                      &ndarray_to_buffer_converter::construct,
+                                      p::type_id<h::Buffer>());
 #endif
 
     return;
@@ -88,6 +88,9 @@ void defineTarget()
             .value("NoAsserts", Target::Feature::NoAsserts)
             .value("NoBoundsQuery", Target::Feature::NoBoundsQuery)
             .value("Profile", Target::Feature::Profile)
+            .value("ProfileCounters", Target::Feature::ProfileCounters)
+            .value("ProfileRoofline", Target::Feature::ProfileRoofline)
+            .value("PersistentAllocations", Target::Feature::PersistentAllocations)
 
             .value("SSE41", Target::Feature::SSE41)
             .value("AVX", Target::Feature::AVX)
@@ -270,6 +270,64 @@ def test_image_to_ndarray():
 
     return
 
+def test_realize_into_ndarray():
+
+    if "ndarray_to_image" not in globals():
+        print("Skipping test_realize_into_ndarray")
+        return
+
+    import numpy
+
+    x, y = Var("x"), Var("y")
+    f = Func("f")
+    f[x, y] = cast(Float(32), x + 10 * y)
+
+    # The pipeline writes straight into the array, with x along the
+    # first axis.
+    a = numpy.zeros((20, 30), dtype=numpy.float32)
+    f.realize(a)
+    assert a[3, 5] == 53
+
+    # A read-only array can't be written to, so it isn't a Buffer.
+    a.flags.writeable = False
+    try:
+        f.realize(a)
+    except ValueError as e:
+        assert "read-only" in str(e)
+    else:
+        assert False, "realize wrote into a read-only array"
+
+    return
+
+def test_buffer_protocol():
+
+    import numpy
+
+    i0 = Image(Int(16), 20, 30)
+    i0[3, 5] = 42
+
+    # The array shares the image's memory.
+    a0 = numpy.asarray(i0)
+    assert a0.dtype == numpy.int16
+    assert a0.shape == (20, 30)
+    assert a0[3, 5] == 42
+    a0[4, 6] = 7
+    assert i0(4, 6) == 7
+
+    m0 = memoryview(i0)
+    assert m0.format == "h"
+    assert m0.shape == (20, 30)
+    assert m0.strides == (2, 40)
+
+    x, y = Var("x"), Var("y")
+    f = Func("f")
+    f[x, y] = x + y
+    b = f.realize(20, 30)[0]
+    a1 = numpy.asarray(b)
+    assert a1[3, 5] == 8
+
+    return
+
 def test_param_bug():
     "see https://github.com/rodrigob/Halide/issues/1"
 
@@ -297,6 +355,8 @@ if __name__ == "__main__":
     test_float_or_int()
     test_ndarray_to_image()
     test_image_to_ndarray()
+    test_realize_into_ndarray()
+    test_buffer_protocol()
     test_types()
     test_operator_order()
     test_basics()
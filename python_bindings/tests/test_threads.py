@@ -0,0 +1,91 @@
+#!/usr/bin/python3
+
+# to be called via nose, for example
+# nosetests-3.4 -v path_to/tests/test_threads.py
+
+from halide import *
+import multiprocessing
+import threading
+import time
+
+
+def make_pipeline(i):
+    "A pipeline that does enough arithmetic per pixel to take a while"
+
+    x, y = Var("x"), Var("y")
+    f = Func("f_%d" % i)
+    e = cast(Float(32), x + y + i)
+    for k in range(40):
+        e = e * 0.999 + 1.0
+    f[x, y] = e
+    return f
+
+
+def run_threads(count, work):
+    threads = [threading.Thread(target=work, args=(i,)) for i in range(count)]
+    start = time.time()
+    for t in threads:
+        t.start()
+    for t in threads:
+        t.join()
+    return time.time() - start
+
+
+def test_concurrent_compile_and_realize():
+    "Compiling and realizing from several Python threads gives the right answers"
+
+    count = 4
+    funcs = [make_pipeline(i) for i in range(count)]
+    results = [None] * count
+
+    def work(i):
+        funcs[i].compile_jit()
+        results[i] = Image(Float(32), funcs[i].realize(64, 64))
+
+    run_threads(count, work)
+
+    for i in range(count):
+        expected = Image(Float(32), funcs[i].realize(64, 64))
+        assert results[i](3, 5) == expected(3, 5)
+
+    return
+
+
+def test_concurrent_throughput():
+    "Realize releases the GIL, so pipelines on several Python threads overlap"
+
+    count = min(4, multiprocessing.cpu_count())
+    if count < 2:
+        print("Skipping test_concurrent_throughput on a single core")
+        return
+
+    size = 1024
+    funcs = [make_pipeline(i) for i in range(count)]
+    for f in funcs:
+        f.compile_jit()
+        f.realize(size, size)
+
+    def work(i):
+        funcs[i].realize(size, size)
+
+    start = time.time()
+    for i in range(count):
+        work(i)
+    serial = time.time() - start
+
+    threaded = run_threads(count, work)
+
+    print("%d pipelines: %f s one after another, %f s on %d threads" %
+          (count, serial, threaded, count))
+
+    # With the GIL held the threads would take as long as running one
+    # after another. Leave plenty of slack for noisy machines.
+    assert threaded < 0.8 * serial
+
+    return
+
+
+if __name__ == "__main__":
+
+    test_concurrent_compile_and_realize()
+    test_concurrent_throughput()
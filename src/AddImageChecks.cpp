@@ -76,11 +76,12 @@ Stmt add_image_checks(Stmt s,
     // Add the output buffer(s).
     for (Function f : outputs) {
         // Check that their dimensionality
-        // doesn't exceed what buffer_t can handle.
-        user_assert(f.dimensions() <= 4)
+        // doesn't exceed what halide_buffer_nd_t can handle.
+        user_assert(f.dimensions() <= HALIDE_BUFFER_MAX_DIMENSIONS)
             << "Output Func " << f.name()
             << " has " << f.dimensions()
-            << " dimensions. Output buffers may not currently have more than four dimensions.\n";
+            << " dimensions. Output buffers may not currently have more than "
+            << HALIDE_BUFFER_MAX_DIMENSIONS << " dimensions.\n";
 
         for (size_t i = 0; i < f.values().size(); i++) {
             FindBuffers::Result output_buffer;
@@ -124,7 +125,13 @@ Stmt add_image_checks(Stmt s,
     for (const pair<string, FindBuffers::Result> &buf : bufs) {
         const string &name = buf.first;
 
-        for (int i = 0; i < 4; i++) {
+        user_assert(buf.second.dimensions <= HALIDE_BUFFER_MAX_DIMENSIONS)
+            << "Buffer " << name
+            << " has " << buf.second.dimensions
+            << " dimensions. Buffers may not currently have more than "
+            << HALIDE_BUFFER_MAX_DIMENSIONS << " dimensions.\n";
+
+        for (int i = 0; i < std::max(buf.second.dimensions, 4); i++) {
             string dim = std::to_string(i);
 
             Expr min_required = Variable::make(Int(32), name + ".min." + dim + ".required");
@@ -351,7 +351,8 @@ public:
 
                     // Copy the input buffer into a query buffer to mutate.
                     string query_name = name + ".bounds_query." + func.name();
-                    Expr query_buf = Call::make(type_of<struct buffer_t *>(), Call::copy_buffer_t, {in_buf}, Call::Intrinsic);
+                    int dims = args[j].is_image_param() ? p.dimensions() : b.dimensions();
+                    Expr query_buf = Call::make(type_of<struct buffer_t *>(), Call::copy_buffer_t, {in_buf, dims}, Call::Intrinsic);
                     lets.push_back(make_pair(query_name, query_buf));
                     Expr buf = Variable::make(type_of<struct buffer_t *>(), query_name, b, p, ReductionDomain());
                     bounds_inference_args.push_back(buf);
@@ -655,7 +656,7 @@ public:
             }
 
             body = let->body;
-            lets.push_back(make_pair(let->name, let->value));
+            lets.push_back(std::make_pair(let->name, let->value));
         }
 
         // If there are no pipelines at this loop level, we can skip most of the work.
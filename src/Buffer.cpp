@@ -1,3 +1,13 @@
+#include <algorithm>
+#include <mutex>
+#include <string.h>
+#include <thread>
+#include <vector>
+
+#ifdef __linux__
+#include <sys/mman.h>
+#endif
+
 #include "Buffer.h"
 #include "Debug.h"
 #include "Error.h"
@@ -11,12 +21,80 @@ namespace {
 void check_buffer_size(uint64_t bytes, const std::string &name) {
     user_assert(bytes < (1UL << 31)) << "Total size of buffer " << name << " exceeds 2^31 - 1\n";
 }
+
+std::mutex allocation_policy_mutex;
+halide_allocation_policy_t allocation_policy = {0, false, false, false};
+
+// Allocate zeroed memory for a buffer of the given size directly
+// from the OS, following the allocation policy. Returns nullptr if
+// the policy says to use calloc instead.
+uint8_t *map_allocation(size_t size) {
+#ifdef __linux__
+    halide_allocation_policy_t policy = get_allocation_policy();
+    if (!policy.large_allocation_size || size < policy.large_allocation_size) {
+        return nullptr;
+    }
+
+    void *p = MAP_FAILED;
+#ifdef MAP_HUGETLB
+    if (policy.explicit_huge_pages) {
+        p = mmap(nullptr, size, PROT_READ | PROT_WRITE,
+                 MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+    }
+#endif
+    if (p == MAP_FAILED) {
+        p = mmap(nullptr, size, PROT_READ | PROT_WRITE,
+                 MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (p == MAP_FAILED) {
+            return nullptr;
+        }
+#ifdef MADV_HUGEPAGE
+        if (policy.transparent_huge_pages) {
+            madvise(p, size, MADV_HUGEPAGE);
+        }
+#endif
+    }
+
+    if (policy.parallel_first_touch) {
+        // Touch the pages in slabs from up to as many threads as
+        // there are cores, so that they're spread across the NUMA
+        // nodes the way a parallel loop over the buffer would spread
+        // them. Starting a thread costs about as much as touching a
+        // few MB, so slabs are at least min_slab, and the calling
+        // thread touches the first one itself. Allocations smaller
+        // than two slabs don't start any threads.
+        const size_t page_size = 4096;
+        const size_t min_slab = 16 << 20;
+        size_t threads = std::max(1u, std::thread::hardware_concurrency());
+        size_t slab = ((size / threads) + page_size - 1) & ~(page_size - 1);
+        slab = std::max(slab, min_slab);
+        auto touch = [=](size_t begin) {
+            size_t end = std::min(size, begin + slab);
+            for (size_t i = begin; i < end; i += page_size) {
+                ((volatile uint8_t *)p)[i] = 0;
+            }
+        };
+        std::vector<std::thread> touchers;
+        for (size_t begin = slab; begin < size; begin += slab) {
+            touchers.emplace_back(touch, begin);
+        }
+        touch(0);
+        for (std::thread &t : touchers) {
+            t.join();
+        }
+    }
+    return (uint8_t *)p;
+#else
+    return nullptr;
+#endif
+}
 }
 
 
 struct BufferContents {
-    /** The buffer_t object we're wrapping. */
-    buffer_t buf;
+    /** The buffer we're wrapping. Buffers with up to four dimensions
+     * only use the buffer_t at the start. */
+    halide_buffer_nd_t nd_buf;
 
     /** The type of the allocation. buffer_t's don't currently track this so we do it here. */
     Type type;
@@ -27,33 +105,45 @@ struct BufferContents {
      * nullptr. */
     uint8_t *allocation;
 
+    /** If the allocation was mapped directly from the OS because of
+     * the allocation policy, the size of the mapping. Zero if it
+     * came from calloc. */
+    size_t mapped_size;
+
     /** How many Buffer objects point to this BufferContents */
     mutable RefCount ref_count;
 
     /** What is the name of the buffer? Useful for debugging symbols. */
     std::string name;
 
-    BufferContents(Type t, int x_size, int y_size, int z_size, int w_size,
+    int32_t &extent(int i) {
+        return i < 4 ? nd_buf.buf.extent[i] : nd_buf.extent[i - 4];
+    }
+
+    int32_t &stride(int i) {
+        return i < 4 ? nd_buf.buf.stride[i] : nd_buf.stride[i - 4];
+    }
+
+    int32_t &min(int i) {
+        return i < 4 ? nd_buf.buf.min[i] : nd_buf.min[i - 4];
+    }
+
+    BufferContents(Type t, const std::vector<int32_t> &sizes,
                    uint8_t* data, const std::string &n) :
-        type(t), allocation(nullptr), name(n.empty() ? unique_name('b') : n) {
+        type(t), allocation(nullptr), mapped_size(0), name(n.empty() ? unique_name('b') : n) {
         user_assert(t.lanes() == 1) << "Can't create of a buffer of a vector type";
+        user_assert(sizes.size() <= HALIDE_BUFFER_MAX_DIMENSIONS)
+            << "Buffer " << name << " has " << sizes.size() << " dimensions, but buffers may have at most "
+            << HALIDE_BUFFER_MAX_DIMENSIONS << "\n";
+        memset(&nd_buf, 0, sizeof(nd_buf));
+        buffer_t &buf = nd_buf.buf;
         buf.elem_size = t.bytes();
         uint64_t size = 1;
-        if (x_size) {
-            size *= x_size;
-            check_buffer_size(size, name);
-        }
-        if (y_size) {
-            size *= y_size;
-            check_buffer_size(size, name);
-        }
-        if (z_size) {
-            size *= z_size;
-            check_buffer_size(size, name);
-        }
-        if (w_size) {
-            size *= w_size;
-            check_buffer_size(size, name);
+        for (int32_t s : sizes) {
+            if (s) {
+                size *= s;
+                check_buffer_size(size, name);
+            }
         }
         size *= buf.elem_size;
         check_buffer_size(size, name);
@@ -61,33 +151,38 @@ struct BufferContents {
         if (!data) {
             size = size + 32;
             check_buffer_size(size, name);
-            allocation = (uint8_t *)calloc(1, (size_t)size);
+            allocation = map_allocation((size_t)size);
+            if (allocation) {
+                mapped_size = (size_t)size;
+            } else {
+                allocation = (uint8_t *)calloc(1, (size_t)size);
+            }
             user_assert(allocation) << "Out of memory allocating buffer " << name << " of size " << size << "\n";
             buf.host = allocation;
             while ((size_t)(buf.host) & 0x1f) buf.host++;
         } else {
             buf.host = data;
         }
-        buf.dev = 0;
-        buf.host_dirty = false;
-        buf.dev_dirty = false;
-        buf.extent[0] = x_size;
-        buf.extent[1] = y_size;
-        buf.extent[2] = z_size;
-        buf.extent[3] = w_size;
-        buf.stride[0] = 1;
-        buf.stride[1] = x_size;
-        buf.stride[2] = x_size*y_size;
-        buf.stride[3] = x_size*y_size*z_size;
-        buf.min[0] = 0;
-        buf.min[1] = 0;
-        buf.min[2] = 0;
-        buf.min[3] = 0;
+        // Dense strides, with the first dimension innermost.
+        int32_t s = 1;
+        for (size_t i = 0; i < std::max(sizes.size(), (size_t)4); i++) {
+            int32_t e = i < sizes.size() ? sizes[i] : 0;
+            extent(i) = e;
+            stride(i) = s;
+            s *= e;
+        }
     }
 
     BufferContents(Type t, const buffer_t *b, const std::string &n) :
-        type(t), allocation(nullptr), name(n.empty() ? unique_name('b') : n) {
-        buf = *b;
+        type(t), allocation(nullptr), mapped_size(0), name(n.empty() ? unique_name('b') : n) {
+        memset(&nd_buf, 0, sizeof(nd_buf));
+        nd_buf.buf = *b;
+        user_assert(t.lanes() == 1) << "Can't create of a buffer of a vector type";
+    }
+
+    BufferContents(Type t, const halide_buffer_nd_t *b, const std::string &n) :
+        type(t), allocation(nullptr), mapped_size(0), name(n.empty() ? unique_name('b') : n) {
+        nd_buf = *b;
         user_assert(t.lanes() == 1) << "Can't create of a buffer of a vector type";
     }
 };
@@ -99,8 +194,13 @@ EXPORT RefCount &ref_count<BufferContents>(const BufferContents *p) {
 
 template<>
 EXPORT void destroy<BufferContents>(const BufferContents *p) {
-    int error = halide_device_free(nullptr, const_cast<buffer_t *>(&p->buf));
+    int error = halide_device_free(nullptr, const_cast<buffer_t *>(&p->nd_buf.buf));
     user_assert(!error) << "Failed to free device buffer\n";
+#ifdef __linux__
+    if (p->mapped_size) {
+        munmap(p->allocation, p->mapped_size);
+    } else
+#endif
     free(p->allocation);
 
     delete p;
@@ -108,11 +208,20 @@ EXPORT void destroy<BufferContents>(const BufferContents *p) {
 
 }
 
-namespace {
-int32_t size_or_zero(const std::vector<int32_t> &sizes, size_t index) {
-    return (index < sizes.size()) ? sizes[index] : 0;
+void set_allocation_policy(const halide_allocation_policy_t &policy) {
+    {
+        std::lock_guard<std::mutex> lock(Internal::allocation_policy_mutex);
+        Internal::allocation_policy = policy;
+    }
+    Internal::JITSharedRuntime::set_allocation_policy(policy);
+}
+
+halide_allocation_policy_t get_allocation_policy() {
+    std::lock_guard<std::mutex> lock(Internal::allocation_policy_mutex);
+    return Internal::allocation_policy;
 }
 
+namespace {
 std::string make_buffer_name(const std::string &n, Buffer *b) {
     if (n.empty()) {
         return Internal::make_entity_name(b, "Halide::Buffer", 'b');
@@ -124,20 +233,14 @@ std::string make_buffer_name(const std::string &n, Buffer *b) {
 
 Buffer::Buffer(Type t, int x_size, int y_size, int z_size, int w_size,
                uint8_t* data, const std::string &name) :
-    contents(new Internal::BufferContents(t, x_size, y_size, z_size, w_size, data,
+    contents(new Internal::BufferContents(t, {x_size, y_size, z_size, w_size}, data,
                                           make_buffer_name(name, this))) {
 }
 
 Buffer::Buffer(Type t, const std::vector<int32_t> &sizes,
                uint8_t* data, const std::string &name) :
-    contents(new Internal::BufferContents(t,
-                                          size_or_zero(sizes, 0),
-                                          size_or_zero(sizes, 1),
-                                          size_or_zero(sizes, 2),
-                                          size_or_zero(sizes, 3),
-                                          data,
+    contents(new Internal::BufferContents(t, sizes, data,
                                           make_buffer_name(name, this))) {
-    user_assert(sizes.size() <= 4) << "Buffer dimensions greater than 4 are not supported.";
 }
 
 Buffer::Buffer(Type t, const buffer_t *buf, const std::string &name) :
@@ -145,72 +248,94 @@ Buffer::Buffer(Type t, const buffer_t *buf, const std::string &name) :
                                           make_buffer_name(name, this))) {
 }
 
+Buffer::Buffer(Type t, const halide_buffer_nd_t *buf, const std::string &name) :
+    contents(new Internal::BufferContents(t, buf,
+                                          make_buffer_name(name, this))) {
+}
+
 void *Buffer::host_ptr() const {
     user_assert(defined()) << "Buffer is undefined\n";
-    return (void *)contents.ptr->buf.host;
+    return (void *)contents.ptr->nd_buf.buf.host;
 }
 
 buffer_t *Buffer::raw_buffer() const {
     user_assert(defined()) << "Buffer is undefined\n";
-    return &(contents.ptr->buf);
+    return &(contents.ptr->nd_buf.buf);
+}
+
+halide_buffer_nd_t *Buffer::raw_nd_buffer() const {
+    user_assert(defined()) << "Buffer is undefined\n";
+    return &(contents.ptr->nd_buf);
 }
 
 uint64_t Buffer::device_handle() const {
     user_assert(defined()) << "Buffer is undefined\n";
-    return contents.ptr->buf.dev;
+    return contents.ptr->nd_buf.buf.dev;
 }
 
 bool Buffer::host_dirty() const {
     user_assert(defined()) << "Buffer is undefined\n";
-    return contents.ptr->buf.host_dirty;
+    return contents.ptr->nd_buf.buf.host_dirty;
 }
 
 void Buffer::set_host_dirty(bool dirty) {
     user_assert(defined()) << "Buffer is undefined\n";
-    contents.ptr->buf.host_dirty = dirty;
+    contents.ptr->nd_buf.buf.host_dirty = dirty;
 }
 
 bool Buffer::device_dirty() const {
     user_assert(defined()) << "Buffer is undefined\n";
-    return contents.ptr->buf.dev_dirty;
+    return contents.ptr->nd_buf.buf.dev_dirty;
 }
 
 void Buffer::set_device_dirty(bool dirty) {
     user_assert(defined()) << "Buffer is undefined\n";
-    contents.ptr->buf.dev_dirty = dirty;
+    contents.ptr->nd_buf.buf.dev_dirty = dirty;
 }
 
 int Buffer::dimensions() const {
-    for (int i = 0; i < 4; i++) {
+    for (int i = 0; i < HALIDE_BUFFER_MAX_DIMENSIONS; i++) {
         if (extent(i) == 0) return i;
     }
-    return 4;
+    return HALIDE_BUFFER_MAX_DIMENSIONS;
 }
 
 int Buffer::extent(int dim) const {
     user_assert(defined()) << "Buffer is undefined\n";
-    user_assert(dim >= 0 && dim < 4) << "We only support 4-dimensional buffers for now";
-    return contents.ptr->buf.extent[dim];
+    user_assert(dim >= 0 && dim < HALIDE_BUFFER_MAX_DIMENSIONS)
+        << "Buffers may have at most " << HALIDE_BUFFER_MAX_DIMENSIONS << " dimensions\n";
+    return contents.ptr->extent(dim);
 }
 
 int Buffer::stride(int dim) const {
     user_assert(defined());
-    user_assert(dim >= 0 && dim < 4) << "We only support 4-dimensional buffers for now";
-    return contents.ptr->buf.stride[dim];
+    user_assert(dim >= 0 && dim < HALIDE_BUFFER_MAX_DIMENSIONS)
+        << "Buffers may have at most " << HALIDE_BUFFER_MAX_DIMENSIONS << " dimensions\n";
+    return contents.ptr->stride(dim);
 }
 
 int Buffer::min(int dim) const {
     user_assert(defined()) << "Buffer is undefined\n";
-    user_assert(dim >= 0 && dim < 4) << "We only support 4-dimensional buffers for now";
-    return contents.ptr->buf.min[dim];
+    user_assert(dim >= 0 && dim < HALIDE_BUFFER_MAX_DIMENSIONS)
+        << "Buffers may have at most " << HALIDE_BUFFER_MAX_DIMENSIONS << " dimensions\n";
+    return contents.ptr->min(dim);
 }
 
 void Buffer::set_min(int m0, int m1, int m2, int m3) {
     user_assert(defined()) << "Buffer is undefined\n";
-    contents.ptr->buf.min[0] = m0;
-    contents.ptr->buf.min[1] = m1;
-    contents.ptr->buf.min[2] = m2;
-    contents.ptr->buf.min[3] = m3;
+    contents.ptr->min(0) = m0;
+    contents.ptr->min(1) = m1;
+    contents.ptr->min(2) = m2;
+    contents.ptr->min(3) = m3;
+}
+
+void Buffer::set_min(const std::vector<int> &mins) {
+    user_assert(defined()) << "Buffer is undefined\n";
+    user_assert(mins.size() <= HALIDE_BUFFER_MAX_DIMENSIONS)
+        << "Buffers may have at most " << HALIDE_BUFFER_MAX_DIMENSIONS << " dimensions\n";
+    for (size_t i = 0; i < mins.size(); i++) {
+        contents.ptr->min(i) = mins[i];
+    }
 }
 
 Type Buffer::type() const {
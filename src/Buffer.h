@@ -43,12 +43,20 @@ public:
 
     EXPORT Buffer(Type t, const buffer_t *buf, const std::string &name = "");
 
+    /** Wrap a buffer with more than four dimensions. */
+    EXPORT Buffer(Type t, const halide_buffer_nd_t *buf, const std::string &name = "");
+
     /** Get a pointer to the host-side memory. */
     EXPORT void *host_ptr() const;
 
     /** Get a pointer to the raw buffer_t struct that this class wraps. */
     EXPORT buffer_t *raw_buffer() const;
 
+    /** Get a pointer to the raw buffer_t struct that this class
+     * wraps, along with the dimensions beyond the fourth. This is the
+     * same address as raw_buffer(). */
+    EXPORT halide_buffer_nd_t *raw_nd_buffer() const;
+
     /** Get the device-side pointer/handle for this buffer. Will be
      * zero if no device was involved in the creation of this
      * buffer. */
@@ -95,7 +103,10 @@ public:
 
     /** Set the coordinate in the function that this buffer represents
      * that corresponds to the base address of the buffer. */
+    // @{
     EXPORT void set_min(int m0, int m1 = 0, int m2 = 0, int m3 = 0);
+    EXPORT void set_min(const std::vector<int> &mins);
+    // @}
 
     /** Get the Halide type of the contents of this buffer. */
     EXPORT Type type() const;
@@ -141,6 +152,16 @@ public:
 
 };
 
+/** Set the policy for how host memory is allocated for large Buffers
+ * and Images, and inside jit-compiled pipelines. See
+ * halide_allocation_policy_t in HalideRuntime.h. Only used on
+ * Linux. Pipelines compiled ahead of time should call
+ * halide_set_allocation_policy instead. */
+EXPORT void set_allocation_policy(const halide_allocation_policy_t &policy);
+
+/** Get the current allocation policy. */
+EXPORT halide_allocation_policy_t get_allocation_policy();
+
 }
 
 #endif
@@ -44,8 +44,27 @@ const string buffer_t_definition =
     "    HALIDE_ATTRIBUTE_ALIGN(1) bool dev_dirty;\n"
     "    HALIDE_ATTRIBUTE_ALIGN(1) uint8_t _padding[10 - sizeof(void *)];\n"
     "} buffer_t;\n"
+    "#endif\n"
+    "#ifndef HALIDE_BUFFER_ND_T_DEFINED\n"
+    "#define HALIDE_BUFFER_ND_T_DEFINED\n"
+    "typedef struct halide_buffer_nd_t {\n"
+    "    buffer_t buf;\n"
+    "    int32_t extent[" + std::to_string(HALIDE_BUFFER_MAX_DIMENSIONS - 4) + "];\n"
+    "    int32_t stride[" + std::to_string(HALIDE_BUFFER_MAX_DIMENSIONS - 4) + "];\n"
+    "    int32_t min[" + std::to_string(HALIDE_BUFFER_MAX_DIMENSIONS - 4) + "];\n"
+    "} halide_buffer_nd_t;\n"
     "#endif\n";
 
+// A field of dimension i of the buffer_t pointed to by buf. Buffers
+// with more than four dimensions are halide_buffer_nd_t.
+string buffer_field(const string &buf, const string &field, int i) {
+    if (i < 4) {
+        return buf + "->" + field + "[" + std::to_string(i) + "]";
+    } else {
+        return "((halide_buffer_nd_t *)" + buf + ")->" + field + "[" + std::to_string(i - 4) + "]";
+    }
+}
+
 const string headers =
     "#include <iostream>\n"
     "#include <math.h>\n"
@@ -59,12 +78,16 @@ const string globals =
     "extern \"C\" {\n"
     "void *halide_malloc(void *ctx, size_t);\n"
     "void halide_free(void *ctx, void *ptr);\n"
+    "void halide_scratch_arena_release(void *ctx, void *arena);\n"
+    "void halide_scratch_arena_free(void *ctx, void *ptr);\n"
+    "void halide_persistent_free(void *ctx, void *ptr);\n"
     "void *halide_print(void *ctx, const void *str);\n"
     "void *halide_error(void *ctx, const void *str);\n"
     "int halide_debug_to_file(void *ctx, const char *filename, int, struct buffer_t *buf);\n"
     "int halide_start_clock(void *ctx);\n"
     "int64_t halide_current_time_ns(void *ctx);\n"
     "void halide_profiler_pipeline_end(void *, void *);\n"
+    "void halide_profiler_release_slot(void *, void *);\n"
     "}\n"
     "\n"
 
@@ -544,7 +567,7 @@ void CodeGen_C::compile(const LoweredFunc &f) {
         // Unpack the buffer_t's
         for (size_t i = 0; i < args.size(); i++) {
             if (args[i].is_buffer()) {
-                push_buffer(args[i].type, args[i].name);
+                push_buffer(args[i].type, args[i].name, args[i].dimensions);
             }
         }
         // Emit the body
@@ -633,7 +656,7 @@ void CodeGen_C::compile(const Buffer &buffer) {
     stream << "static buffer_t *" << name << " = &" << name << "_buffer;\n";
 }
 
-void CodeGen_C::push_buffer(Type t, const std::string &buffer_name) {
+void CodeGen_C::push_buffer(Type t, const std::string &buffer_name, int dimensions) {
     string name = print_name(buffer_name);
     string buf_name = name + "_buffer";
     string type = print_type(t);
@@ -661,34 +684,32 @@ void CodeGen_C::push_buffer(Type t, const std::string &buffer_name) {
     do_indent();
     stream << "(void)" << name << "_host_and_dev_are_null;\n";
 
-    for (int j = 0; j < 4; j++) {
+    int dims = std::max(dimensions, 4);
+    for (int j = 0; j < dims; j++) {
         do_indent();
         stream << "const int32_t "
                << name
                << "_min_" << j << " = "
-               << buf_name
-               << "->min[" << j << "];\n";
+               << buffer_field(buf_name, "min", j) << ";\n";
         // emit a void cast to suppress "unused variable" warnings
         do_indent();
         stream << "(void)" << name << "_min_" << j << ";\n";
     }
-    for (int j = 0; j < 4; j++) {
+    for (int j = 0; j < dims; j++) {
         do_indent();
         stream << "const int32_t "
                << name
                << "_extent_" << j << " = "
-               << buf_name
-               << "->extent[" << j << "];\n";
+               << buffer_field(buf_name, "extent", j) << ";\n";
         do_indent();
         stream << "(void)" << name << "_extent_" << j << ";\n";
     }
-    for (int j = 0; j < 4; j++) {
+    for (int j = 0; j < dims; j++) {
         do_indent();
         stream << "const int32_t "
                << name
                << "_stride_" << j << " = "
-               << buf_name
-               << "->stride[" << j << "];\n";
+               << buffer_field(buf_name, "stride", j) << ";\n";
         do_indent();
         stream << "(void)" << name << "_stride_" << j << ";\n";
     }
@@ -960,7 +981,7 @@ void CodeGen_C::visit(const Call *op) {
         int dims = ((int)(op->args.size())-2)/3;
         (void)dims; // In case internal_assert is ifdef'd to do nothing
         internal_assert((int)(op->args.size()) == dims*3 + 2);
-        internal_assert(dims <= 4);
+        internal_assert(dims <= HALIDE_BUFFER_MAX_DIMENSIONS);
         vector<string> args(op->args.size());
         const Variable *v = op->args[0].as<Variable>();
         internal_assert(v);
@@ -968,6 +989,16 @@ void CodeGen_C::visit(const Call *op) {
         for (size_t i = 1; i < op->args.size(); i++) {
             args[i] = print_expr(op->args[i]);
         }
+        // halide_rewrite_buffer does the first four dimensions.
+        for (int i = 4; i < dims; i++) {
+            do_indent();
+            stream << buffer_field(args[0], "min", i) << " = " << args[i*3+2] << ";\n";
+            do_indent();
+            stream << buffer_field(args[0], "extent", i) << " = " << args[i*3+3] << ";\n";
+            do_indent();
+            stream << buffer_field(args[0], "stride", i) << " = " << args[i*3+4] << ";\n";
+        }
+        args.resize(std::min((int)args.size(), 14));
         rhs << "halide_rewrite_buffer(";
         for (size_t i = 0; i < 14; i++) {
             if (i > 0) rhs << ", ";
@@ -1033,11 +1064,22 @@ void CodeGen_C::visit(const Call *op) {
 
         rhs << result_id;
     } else if (op->is_intrinsic(Call::copy_buffer_t)) {
-        internal_assert(op->args.size() == 1);
+        // The optional second argument is the dimensionality of the
+        // source. Only sources with more than four dimensions are a
+        // full halide_buffer_nd_t.
+        internal_assert(op->args.size() == 1 || op->args.size() == 2);
         string arg = print_expr(op->args[0]);
+        const IntImm *dims = op->args.size() > 1 ? op->args[1].as<IntImm>() : nullptr;
         string buf_id = unique_name('B');
-        stream << "buffer_t " << buf_id << " = *((buffer_t *)(" << arg << "))\n";
-        rhs << "(&" << buf_id << ")";
+        do_indent();
+        stream << "halide_buffer_nd_t " << buf_id << " = {};\n";
+        do_indent();
+        if (dims && dims->value > 4) {
+            stream << buf_id << " = *((halide_buffer_nd_t *)(" << arg << "));\n";
+        } else {
+            stream << buf_id << ".buf = *((buffer_t *)(" << arg << "));\n";
+        }
+        rhs << "(&" << buf_id << ".buf)";
     } else if (op->is_intrinsic(Call::create_buffer_t)) {
         internal_assert(op->args.size() >= 2);
         vector<string> args;
@@ -1046,34 +1088,42 @@ void CodeGen_C::visit(const Call *op) {
         for (size_t i = 2; i < op->args.size(); i++) {
             args.push_back(print_expr(op->args[i]));
         }
+        // Make room for more than four dimensions, in case this is
+        // passed to something that expects them.
         string buf_id = unique_name('B');
+        string buf = "(&" + buf_id + ".buf)";
         do_indent();
-        stream << "buffer_t " << buf_id << " = {0};\n";
+        stream << "halide_buffer_nd_t " << buf_id << " = {};\n";
         do_indent();
-        stream << buf_id << ".host = const_cast<uint8_t *>((const uint8_t *)(" << args[0] << "));\n";
+        stream << buf_id << ".buf.host = const_cast<uint8_t *>((const uint8_t *)(" << args[0] << "));\n";
         do_indent();
-        stream << buf_id << ".elem_size = " << args[1] << ";\n";
+        stream << buf_id << ".buf.elem_size = " << args[1] << ";\n";
         int dims = ((int)op->args.size() - 2)/3;
+        user_assert(dims <= HALIDE_BUFFER_MAX_DIMENSIONS)
+            << "Halide currently has a limit of " << HALIDE_BUFFER_MAX_DIMENSIONS
+            << " dimensions on Funcs used on the GPU or passed to extern stages.\n";
         for (int i = 0; i < dims; i++) {
             do_indent();
-            stream << buf_id << ".min[" << i << "] = " << args[i*3+2] << ";\n";
+            stream << buffer_field(buf, "min", i) << " = " << args[i*3+2] << ";\n";
             do_indent();
-            stream << buf_id << ".extent[" << i << "] = " << args[i*3+3] << ";\n";
+            stream << buffer_field(buf, "extent", i) << " = " << args[i*3+3] << ";\n";
             do_indent();
-            stream << buf_id << ".stride[" << i << "] = " << args[i*3+4] << ";\n";
+            stream << buffer_field(buf, "stride", i) << " = " << args[i*3+4] << ";\n";
         }
-        rhs << "(&" + buf_id + ")";
+        rhs << buf;
     } else if (op->is_intrinsic(Call::extract_buffer_max)) {
         internal_assert(op->args.size() == 2);
-        string a0 = print_expr(op->args[0]);
-        string a1 = print_expr(op->args[1]);
-        rhs << "(((buffer_t *)(" << a0 << "))->min[" << a1 << "] + " <<
-            "((buffer_t *)(" << a0 << "))->extent[" << a1 << "] - 1)";
+        const IntImm *idx = op->args[1].as<IntImm>();
+        internal_assert(idx);
+        string buf = "((buffer_t *)(" + print_expr(op->args[0]) + "))";
+        rhs << "(" << buffer_field(buf, "min", idx->value) << " + "
+            << buffer_field(buf, "extent", idx->value) << " - 1)";
     } else if (op->is_intrinsic(Call::extract_buffer_min)) {
         internal_assert(op->args.size() == 2);
-        string a0 = print_expr(op->args[0]);
-        string a1 = print_expr(op->args[1]);
-        rhs << "((buffer_t *)(" << a0 << "))->min[" << a1 << "]";
+        const IntImm *idx = op->args[1].as<IntImm>();
+        internal_assert(idx);
+        string buf = "((buffer_t *)(" + print_expr(op->args[0]) + "))";
+        rhs << buffer_field(buf, "min", idx->value);
     } else if (op->is_intrinsic(Call::extract_buffer_host)) {
         internal_assert(op->args.size() == 1);
         string a0 = print_expr(op->args[0]);
@@ -1392,7 +1442,9 @@ void CodeGen_C::visit(const Allocate *op) {
         alloc.free_function = op->free_function;
         allocations.push(op->name, alloc);
         heap_allocations.push(op->name, 0);
-        stream << print_type(op->type) << "*" << print_name(op->name) << " = (" << print_expr(op->new_expr) << ");\n";
+        string new_expr = print_expr(op->new_expr);
+        stream << print_type(op->type) << "*" << print_name(op->name)
+               << " = (" << print_type(op->type) << " *)(" << new_expr << ");\n";
     } else {
         constant_size = op->constant_allocation_size();
         if (constant_size > 0) {
@@ -108,7 +108,7 @@ protected:
     void close_scope(const std::string &comment);
 
     /** Unpack a buffer into its constituent parts and push it on the allocations stack. */
-    void push_buffer(Type t, const std::string &buffer_name);
+    void push_buffer(Type t, const std::string &buffer_name, int dimensions = 4);
 
     /** Pop a buffer from the stack. */
     void pop_buffer(const std::string &buffer_name);
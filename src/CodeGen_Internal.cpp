@@ -147,14 +147,22 @@ bool function_takes_user_context(const std::string &name) {
         "halide_profiler_memory_free",
         "halide_profiler_pipeline_start",
         "halide_profiler_pipeline_end",
+        "halide_profiler_release_slot",
         "halide_profiler_stack_peak_update",
         "halide_spawn_thread",
         "halide_device_release",
         "halide_start_clock",
         "halide_trace",
+        "halide_trace_func_enabled",
         "halide_memoization_cache_lookup",
         "halide_memoization_cache_store",
         "halide_memoization_cache_release",
+        "halide_scratch_arena_acquire",
+        "halide_scratch_arena_release",
+        "halide_scratch_arena_malloc",
+        "halide_scratch_arena_free",
+        "halide_persistent_malloc",
+        "halide_persistent_free",
         "halide_cuda_run",
         "halide_opencl_run",
         "halide_opengl_run",
@@ -185,6 +193,24 @@ bool can_allocation_fit_on_stack(int32_t size) {
     return (size <= 1024 * 16);
 }
 
+Expr heap_allocation_bytes(const Allocate *op) {
+    int64_t constant_bytes = (int64_t)op->constant_allocation_size() * op->type.bytes();
+    if (constant_bytes > 0 && constant_bytes <= ((int64_t(1) << 31) - 1) &&
+        can_allocation_fit_on_stack((int32_t)constant_bytes)) {
+        return Expr();
+    }
+
+    Expr size = make_const(Int(64), op->type.bytes());
+    for (Expr e : op->extents) {
+        size = size * cast<int64_t>(e);
+    }
+    size = size + op->type.bytes();
+    if (!is_one(op->condition)) {
+        size = select(op->condition, size, make_zero(Int(64)));
+    }
+    return size;
+}
+
 Expr lower_euclidean_div(Expr a, Expr b) {
     internal_assert(a.type() == b.type());
     // IROperator's div_round_to_zero will replace this with a / b for
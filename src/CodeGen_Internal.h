@@ -48,6 +48,13 @@ bool function_takes_user_context(const std::string &name);
  * non-positive. */
 bool can_allocation_fit_on_stack(int32_t size);
 
+/** The number of bytes (as an Int(64)) to ask a heap allocator for
+ * to back an allocation, padded by one scalar because we may load one
+ * element past the end, and zero if the allocation's condition is
+ * false. Returns an undefined Expr if the allocation has a constant
+ * size small enough to go on the stack. */
+Expr heap_allocation_bytes(const Allocate *op);
+
 /** Given a Halide Euclidean division/mod operation, define it in terms of
  * div_round_to_zero or mod_round_to_zero. */
 ///@{
@@ -2,6 +2,9 @@
 #include <limits>
 #include <sstream>
 #include <mutex>
+#include <atomic>
+#include <cstdlib>
+#include <thread>
 
 #include "IRPrinter.h"
 #include "CodeGen_LLVM.h"
@@ -148,6 +151,7 @@ CodeGen_LLVM::CodeGen_LLVM(Target t) :
     metadata_t_type(nullptr),
     argument_t_type(nullptr),
     scalar_value_t_type(nullptr),
+    buffer_nd_t_type(nullptr),
 
     // Vector types. These need an LLVMContext before they can be initialized.
     i8x8(nullptr),
@@ -515,6 +519,9 @@ std::unique_ptr<llvm::Module> CodeGen_LLVM::compile(const Module &input) {
     buffer_t_type = module->getTypeByName("struct.buffer_t");
     internal_assert(buffer_t_type) << "Did not find buffer_t in initial module";
 
+    llvm::ArrayType *extra_dims_t = ArrayType::get(i32, HALIDE_BUFFER_MAX_DIMENSIONS - 4);
+    buffer_nd_t_type = StructType::get(*context, {buffer_t_type, extra_dims_t, extra_dims_t, extra_dims_t});
+
     metadata_t_type = module->getTypeByName("struct.halide_filter_metadata_t");
     internal_assert(metadata_t_type) << "Did not find halide_filter_metadata_t in initial module";
 
@@ -608,7 +615,7 @@ void CodeGen_LLVM::begin_func(LoweredFunc::LinkageType linkage, const std::strin
         for (auto &arg : function->args()) {
             sym_push(args[i].name, &arg);
             if (args[i].is_buffer()) {
-                push_buffer(args[i].name, &arg);
+                push_buffer(args[i].name, &arg, args[i].dimensions);
             }
 
             i++;
@@ -623,7 +630,7 @@ void CodeGen_LLVM::end_func(const std::vector<Argument>& args) {
     for (size_t i = 0; i < args.size(); i++) {
         sym_pop(args[i].name);
         if (args[i].is_buffer()) {
-            pop_buffer(args[i].name);
+            pop_buffer(args[i].name, args[i].dimensions);
         }
     }
 
@@ -738,6 +745,8 @@ void CodeGen_LLVM::compile_buffer(const Buffer &buf) {
     // Embed the buffer declaration as a global.
     internal_assert(buf.defined());
 
+    user_assert(buf.dimensions() <= 4)
+        << "Can't embed buffer " << buf.name() << " because it has more than four dimensions.\n";
     buffer_t b = *(buf.raw_buffer());
     user_assert(b.host)
         << "Can't embed buffer " << buf.name() << " because it has a null host pointer.\n";
@@ -904,23 +913,20 @@ llvm::Type *CodeGen_LLVM::llvm_type_of(Type t) {
     return Internal::llvm_type_of(context, t);
 }
 
-void CodeGen_LLVM::optimize_module() {
-    debug(3) << "Optimizing module\n";
-
-    if (debug::debug_level >= 3) {
-        module->dump();
-    }
+namespace {
 
+// Run the standard -O3 pipeline over a module.
+void run_optimization_passes(llvm::Module &m) {
     #if LLVM_VERSION < 37
-    FunctionPassManager function_pass_manager(module.get());
+    FunctionPassManager function_pass_manager(&m);
     PassManager module_pass_manager;
     #else
-    legacy::FunctionPassManager function_pass_manager(module.get());
+    legacy::FunctionPassManager function_pass_manager(&m);
     legacy::PassManager module_pass_manager;
     #endif
 
     #if (LLVM_VERSION >= 36) && (LLVM_VERSION < 37)
-    internal_assert(module->getDataLayout()) << "Optimizing module with no data layout, probably will crash in LLVM.\n";
+    internal_assert(m.getDataLayout()) << "Optimizing module with no data layout, probably will crash in LLVM.\n";
     module_pass_manager.add(new DataLayoutPass());
     #endif
 
@@ -933,12 +939,248 @@ void CodeGen_LLVM::optimize_module() {
     b.populateModulePassManager(module_pass_manager);
 
     // Run optimization passes
-    module_pass_manager.run(*module);
+    module_pass_manager.run(m);
     function_pass_manager.doInitialization();
-    for (llvm::Module::iterator i = module->begin(); i != module->end(); i++) {
+    for (llvm::Module::iterator i = m.begin(); i != m.end(); i++) {
         function_pass_manager.run(*i);
     }
     function_pass_manager.doFinalization();
+}
+
+#if LLVM_VERSION >= 37
+
+// The number of threads to optimize large modules with, set by
+// HL_LLVM_THREADS. Zero means optimize the whole module at once on the
+// calling thread. Any other value splits the module the same way, so
+// the output doesn't depend on it.
+int llvm_optimization_threads() {
+    size_t defined = 0;
+    std::string threads = get_env_variable("HL_LLVM_THREADS", defined);
+    return defined ? std::atoi(threads.c_str()) : 0;
+}
+
+// Functions are packed into partitions in module order until a
+// partition holds about this many instructions. The split depends only
+// on the module, not on the number of threads, so the output is the
+// same however many threads are used. Calls between partitions can't
+// be inlined, apart from the always-inline ones, which are inlined
+// before splitting.
+const size_t partition_size = 2000;
+
+std::string module_to_bitcode(const llvm::Module &m) {
+    std::string bitcode;
+    llvm::raw_string_ostream stream(bitcode);
+    WriteBitcodeToFile(&m, stream);
+    stream.flush();
+    return bitcode;
+}
+
+std::unique_ptr<llvm::Module> bitcode_to_module(const std::string &bitcode, llvm::LLVMContext &context) {
+    llvm::MemoryBufferRef buffer(bitcode, "partition");
+    auto result = llvm::parseBitcodeFile(buffer, context);
+    if (!result) {
+        internal_error << "Could not parse a module partition: " << result.getError().message() << "\n";
+    }
+    return std::unique_ptr<llvm::Module>(std::move(*result));
+}
+
+// Reduce a copy of the whole module to the functions in one
+// partition. Everything else becomes a declaration. Only the first
+// partition keeps the global variables and the module-level metadata,
+// but constant globals stay visible to the others so that loads from
+// them can still be folded.
+void keep_only_partition(llvm::Module &m, const std::map<std::string, int> &partition_of, int partition) {
+    for (auto &f : m) {
+        if (f.isDeclaration()) continue;
+        auto iter = partition_of.find(f.getName().str());
+        if (iter == partition_of.end() || iter->second != partition) {
+            f.deleteBody();
+            f.setComdat(nullptr);
+        }
+    }
+
+    if (partition == 0) return;
+
+    vector<llvm::GlobalVariable *> appending;
+    for (auto &gv : m.globals()) {
+        if (gv.isDeclaration()) continue;
+        if (gv.hasAppendingLinkage()) {
+            appending.push_back(&gv);
+        } else if (gv.isConstant()) {
+            gv.setLinkage(llvm::GlobalValue::AvailableExternallyLinkage);
+            gv.setComdat(nullptr);
+        } else {
+            gv.setInitializer(nullptr);
+            gv.setLinkage(llvm::GlobalValue::ExternalLinkage);
+            gv.setComdat(nullptr);
+        }
+    }
+    for (llvm::GlobalVariable *gv : appending) {
+        gv->eraseFromParent();
+    }
+
+    vector<llvm::NamedMDNode *> named_metadata;
+    for (auto &md : m.named_metadata()) {
+        if (&md != m.getModuleFlagsMetadata()) {
+            named_metadata.push_back(&md);
+        }
+    }
+    for (llvm::NamedMDNode *md : named_metadata) {
+        m.eraseNamedMetadata(md);
+    }
+}
+
+// Optimize a module by splitting it into partitions of whole
+// functions, optimizing each in its own llvm context on a pool of
+// threads, and linking the results back together in partition
+// order. Returns false if the module can't be split, in which case it
+// is left untouched.
+bool optimize_module_in_parallel(std::unique_ptr<llvm::Module> &module, int num_threads) {
+    if (!module->alias_empty() || module->getNamedMetadata("llvm.dbg.cu")) {
+        // Debug info and aliases would need more care to split up.
+        return false;
+    }
+
+    // Inline everything marked always-inline while the callees are
+    // still in the same module as their callers.
+    {
+        legacy::PassManager pass_manager;
+        pass_manager.add(createAlwaysInlinerPass());
+        pass_manager.add(createGlobalDCEPass());
+        pass_manager.run(*module);
+    }
+
+    std::map<std::string, int> partition_of;
+    int num_partitions = 0;
+    size_t current_size = 0;
+    for (auto &f : *module) {
+        if (f.isDeclaration()) continue;
+        if (num_partitions == 0 || current_size >= partition_size) {
+            num_partitions++;
+            current_size = 0;
+        }
+        for (auto &bb : f) {
+            current_size += bb.size();
+        }
+        if (!f.hasName()) {
+            f.setName("halide.partitioned_function");
+        }
+        partition_of[f.getName().str()] = num_partitions - 1;
+    }
+
+    if (num_partitions < 2) {
+        return false;
+    }
+
+    // Functions in one partition may refer to values defined in
+    // another, so for now everything must be external. Remember the
+    // real linkage to restore once the partitions are back together.
+    struct SavedLinkage {
+        std::string name;
+        llvm::GlobalValue::LinkageTypes linkage;
+        llvm::GlobalValue::VisibilityTypes visibility;
+    };
+    vector<SavedLinkage> saved;
+    auto externalize = [&](llvm::GlobalValue &gv) {
+        if (gv.isDeclaration() ||
+            gv.hasAppendingLinkage() ||
+            gv.hasExternalLinkage()) {
+            return;
+        }
+        if (!gv.hasName()) {
+            gv.setName("halide.partitioned_global");
+        }
+        saved.push_back({gv.getName().str(), gv.getLinkage(), gv.getVisibility()});
+        bool was_local = gv.hasLocalLinkage();
+        gv.setLinkage(llvm::GlobalValue::ExternalLinkage);
+        if (was_local) {
+            gv.setVisibility(llvm::GlobalValue::HiddenVisibility);
+        }
+    };
+    for (auto &f : *module) {
+        externalize(f);
+    }
+    for (auto &gv : module->globals()) {
+        externalize(gv);
+    }
+
+    debug(1) << "Optimizing module in " << num_partitions << " partitions on "
+             << std::min(num_threads, num_partitions) << " threads\n";
+
+    const std::string whole_module = module_to_bitcode(*module);
+
+    vector<std::string> optimized(num_partitions);
+    std::atomic<int> next_partition(0);
+    auto worker = [&]() {
+        for (int p = next_partition++; p < num_partitions; p = next_partition++) {
+            llvm::LLVMContext context;
+            std::unique_ptr<llvm::Module> m = bitcode_to_module(whole_module, context);
+            keep_only_partition(*m, partition_of, p);
+            run_optimization_passes(*m);
+            optimized[p] = module_to_bitcode(*m);
+        }
+    };
+    vector<std::thread> threads;
+    for (int i = 0; i < std::min(num_threads, num_partitions); i++) {
+        threads.emplace_back(worker);
+    }
+    for (std::thread &t : threads) {
+        t.join();
+    }
+
+    llvm::LLVMContext &context = module->getContext();
+    std::unique_ptr<llvm::Module> result = bitcode_to_module(optimized[0], context);
+    for (int p = 1; p < num_partitions; p++) {
+        std::unique_ptr<llvm::Module> m = bitcode_to_module(optimized[p], context);
+        #if LLVM_VERSION >= 38
+        bool failed = llvm::Linker::linkModules(*result, std::move(m));
+        #else
+        bool failed = llvm::Linker::LinkModules(result.get(), m.release());
+        #endif
+        internal_assert(!failed) << "Failure linking optimized module partitions\n";
+    }
+
+    for (const SavedLinkage &s : saved) {
+        llvm::GlobalValue *gv = result->getNamedValue(s.name);
+        if (gv) {
+            gv->setLinkage(s.linkage);
+            gv->setVisibility(s.visibility);
+        }
+    }
+
+    // Drop anything that only stayed alive because it was external.
+    {
+        legacy::PassManager pass_manager;
+        pass_manager.add(createGlobalDCEPass());
+        pass_manager.run(*result);
+    }
+
+    verifyModule(*result);
+    module = std::move(result);
+    return true;
+}
+
+#endif
+
+}
+
+void CodeGen_LLVM::optimize_module() {
+    debug(3) << "Optimizing module\n";
+
+    if (debug::debug_level >= 3) {
+        module->dump();
+    }
+
+    bool optimized = false;
+    #if LLVM_VERSION >= 37
+    int num_threads = llvm_optimization_threads();
+    if (num_threads > 0) {
+        optimized = optimize_module_in_parallel(module, num_threads);
+    }
+    #endif
+    if (!optimized) {
+        run_optimization_passes(*module);
+    }
 
     debug(3) << "After LLVM optimizations:\n";
     if (debug::debug_level >= 2) {
@@ -983,7 +1225,7 @@ bool CodeGen_LLVM::sym_exists(const string &name) const {
 
 // Take an llvm Value representing a pointer to a buffer_t,
 // and populate the symbol table with its constituent parts
-void CodeGen_LLVM::push_buffer(const string &name, llvm::Value *buffer) {
+void CodeGen_LLVM::push_buffer(const string &name, llvm::Value *buffer, int dimensions) {
     // Make sure the buffer object itself is not null
     create_assertion(builder->CreateIsNotNull(buffer),
                      Call::make(Int(32), "halide_error_buffer_argument_is_null",
@@ -1018,10 +1260,16 @@ void CodeGen_LLVM::push_buffer(const string &name, llvm::Value *buffer) {
     sym_push(name + ".min.1", buffer_min(buffer, 1));
     sym_push(name + ".min.2", buffer_min(buffer, 2));
     sym_push(name + ".min.3", buffer_min(buffer, 3));
+    for (int i = 4; i < dimensions; i++) {
+        string dim = std::to_string(i);
+        sym_push(name + ".extent." + dim, buffer_extent(buffer, i));
+        sym_push(name + ".stride." + dim, buffer_stride(buffer, i));
+        sym_push(name + ".min." + dim, buffer_min(buffer, i));
+    }
     sym_push(name + ".elem_size", buffer_elem_size(buffer));
 }
 
-void CodeGen_LLVM::pop_buffer(const string &name) {
+void CodeGen_LLVM::pop_buffer(const string &name, int dimensions) {
     sym_pop(name + ".buffer");
     sym_pop(name + ".host");
     sym_pop(name + ".dev");
@@ -1040,6 +1288,12 @@ void CodeGen_LLVM::pop_buffer(const string &name) {
     sym_pop(name + ".min.1");
     sym_pop(name + ".min.2");
     sym_pop(name + ".min.3");
+    for (int i = 4; i < dimensions; i++) {
+        string dim = std::to_string(i);
+        sym_pop(name + ".extent." + dim);
+        sym_pop(name + ".stride." + dim);
+        sym_pop(name + ".min." + dim);
+    }
     sym_pop(name + ".elem_size");
 }
 
@@ -1121,6 +1375,9 @@ Value *CodeGen_LLVM::buffer_dev_dirty_ptr(Value *buffer) {
 }
 
 Value *CodeGen_LLVM::buffer_extent_ptr(Value *buffer, int i) {
+    if (i >= 4) {
+        return buffer_nd_field_ptr(buffer, 1, i - 4, "buf_extent");
+    }
     llvm::Value *zero = ConstantInt::get(i32, 0);
     llvm::Value *field = ConstantInt::get(i32, 2);
     llvm::Value *idx = ConstantInt::get(i32, i);
@@ -1135,6 +1392,9 @@ Value *CodeGen_LLVM::buffer_extent_ptr(Value *buffer, int i) {
 }
 
 Value *CodeGen_LLVM::buffer_stride_ptr(Value *buffer, int i) {
+    if (i >= 4) {
+        return buffer_nd_field_ptr(buffer, 2, i - 4, "buf_stride");
+    }
     llvm::Value *zero = ConstantInt::get(i32, 0);
     llvm::Value *field = ConstantInt::get(i32, 3);
     llvm::Value *idx = ConstantInt::get(i32, i);
@@ -1149,6 +1409,9 @@ Value *CodeGen_LLVM::buffer_stride_ptr(Value *buffer, int i) {
 }
 
 Value *CodeGen_LLVM::buffer_min_ptr(Value *buffer, int i) {
+    if (i >= 4) {
+        return buffer_nd_field_ptr(buffer, 3, i - 4, "buf_min");
+    }
     llvm::Value *zero = ConstantInt::get(i32, 0);
     llvm::Value *field = ConstantInt::get(i32, 4);
     llvm::Value *idx = ConstantInt::get(i32, i);
@@ -1162,6 +1425,25 @@ Value *CodeGen_LLVM::buffer_min_ptr(Value *buffer, int i) {
         "buf_min");
 }
 
+// The dimensions beyond the fourth come after the buffer_t in a
+// halide_buffer_nd_t, with the extents, strides, and mins in fields
+// 1, 2, and 3.
+Value *CodeGen_LLVM::buffer_nd_field_ptr(Value *buffer, int field, int i, const char *name) {
+    internal_assert(i < HALIDE_BUFFER_MAX_DIMENSIONS - 4)
+        << "Buffers may have at most " << HALIDE_BUFFER_MAX_DIMENSIONS << " dimensions\n";
+    buffer = builder->CreatePointerCast(buffer, buffer_nd_t_type->getPointerTo());
+    vector<llvm::Value *> args = {ConstantInt::get(i32, 0),
+                                  ConstantInt::get(i32, field),
+                                  ConstantInt::get(i32, i)};
+    return builder->CreateInBoundsGEP(
+#if LLVM_VERSION >= 37
+        buffer_nd_t_type,
+#endif
+        buffer,
+        args,
+        name);
+}
+
 Value *CodeGen_LLVM::buffer_elem_size_ptr(Value *buffer) {
     return builder->CreateConstInBoundsGEP2_32(
 #if LLVM_VERSION >= 37
@@ -2191,16 +2473,29 @@ void CodeGen_LLVM::visit(const Call *op) {
             internal_error << "mod_round_to_zero of non-integer type.\n";
         }
     } else if (op->is_intrinsic(Call::copy_buffer_t)) {
-        // Make some memory for this buffer_t
-        Value *dst = create_alloca_at_entry(buffer_t_type, 1);
+        // Make some memory for this buffer_t, with room for more than
+        // four dimensions. The optional second argument is the
+        // dimensionality of the source. If it's more than four, the
+        // source is a halide_buffer_nd_t, and all of it is copied.
+        // Otherwise the extra dimensions are zeroed.
+        Value *dst = create_alloca_at_entry(buffer_nd_t_type, 1);
         Value *src = codegen(op->args[0]);
-        src = builder->CreatePointerCast(src, buffer_t_type->getPointerTo());
-        src = builder->CreateLoad(src);
-        builder->CreateStore(src, dst);
-        value = dst;
+        const IntImm *dims = op->args.size() > 1 ? op->args[1].as<IntImm>() : nullptr;
+        if (dims && dims->value > 4) {
+            src = builder->CreatePointerCast(src, buffer_nd_t_type->getPointerTo());
+            builder->CreateStore(builder->CreateLoad(src), dst);
+        } else {
+            builder->CreateStore(Constant::getNullValue(buffer_nd_t_type), dst);
+            src = builder->CreatePointerCast(src, buffer_t_type->getPointerTo());
+            Value *buf_dst = builder->CreatePointerCast(dst, buffer_t_type->getPointerTo());
+            builder->CreateStore(builder->CreateLoad(src), buf_dst);
+        }
+        value = builder->CreatePointerCast(dst, buffer_t_type->getPointerTo());
     } else if (op->is_intrinsic(Call::create_buffer_t)) {
-        // Make some memory for this buffer_t
-        Value *buffer = create_alloca_at_entry(buffer_t_type, 1);
+        // Make some memory for this buffer_t, with room for more than
+        // four dimensions. The unused dimensions are zeroed below.
+        Value *buffer = create_alloca_at_entry(buffer_nd_t_type, 1);
+        buffer = builder->CreatePointerCast(buffer, buffer_t_type->getPointerTo());
 
         // Populate the fields
         internal_assert(op->args[0].type().is_handle())
@@ -2222,10 +2517,10 @@ void CodeGen_LLVM::visit(const Call *op) {
         builder->CreateStore(elem_size, buffer_elem_size_ptr(buffer));
 
         int dims = (op->args.size() - 2) / 3;
-        user_assert(dims <= 4)
-            << "Halide currently has a limit of four dimensions on "
-            << "Funcs used on the GPU or passed to extern stages.\n";
-        for (int i = 0; i < 4; i++) {
+        user_assert(dims <= HALIDE_BUFFER_MAX_DIMENSIONS)
+            << "Halide currently has a limit of " << HALIDE_BUFFER_MAX_DIMENSIONS
+            << " dimensions on Funcs used on the GPU or passed to extern stages.\n";
+        for (int i = 0; i < HALIDE_BUFFER_MAX_DIMENSIONS; i++) {
             Value *min, *extent, *stride;
             if (i < dims) {
                 min    = codegen(op->args[i*3+2]);
@@ -2269,7 +2564,7 @@ void CodeGen_LLVM::visit(const Call *op) {
     } else if (op->is_intrinsic(Call::rewrite_buffer)) {
         int dims = ((int)(op->args.size())-2)/3;
         internal_assert((int)(op->args.size()) == dims*3 + 2);
-        internal_assert(dims <= 4);
+        internal_assert(dims <= HALIDE_BUFFER_MAX_DIMENSIONS);
 
         Value *buffer = codegen(op->args[0]);
 
@@ -2966,7 +3261,7 @@ void CodeGen_LLVM::visit(const For *op) {
         FunctionType *func_t = FunctionType::get(i32, args_t, false);
         llvm::Function *containing_function = function;
         function = llvm::Function::Create(func_t, llvm::Function::InternalLinkage,
-                                          "par_for_" + function->getName() + "_" + op->name, module.get());
+                                          "par_for_" + function->getName() + "_" + op->name.str(), module.get());
         function->setDoesNotAlias(3);
 
         // Make the initial basic block and jump the builder into the new function
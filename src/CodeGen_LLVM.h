@@ -176,6 +176,10 @@ protected:
     llvm::StructType *buffer_t_type, *metadata_t_type, *argument_t_type, *scalar_value_t_type;
     // @}
 
+    /** A buffer_t followed by the extents, strides, and mins of the
+     * dimensions beyond the fourth, as in halide_buffer_nd_t. */
+    llvm::StructType *buffer_nd_t_type;
+
     /** Some useful llvm types for subclasses */
     // @{
     llvm::Type *i8x8, *i8x16, *i8x32;
@@ -224,9 +228,11 @@ protected:
 
     /** Take an llvm Value representing a pointer to a buffer_t,
      * and populate the symbol table with its constituent parts.
+     * Buffers with more than four dimensions are pointers to a
+     * halide_buffer_nd_t.
      */
-    void push_buffer(const std::string &name, llvm::Value *buffer);
-    void pop_buffer(const std::string &name);
+    void push_buffer(const std::string &name, llvm::Value *buffer, int dimensions = 4);
+    void pop_buffer(const std::string &name, int dimensions = 4);
 
     /** Some destructors should always be called. Others should only
      * be called if the pipeline is exiting with an error code. */
@@ -292,6 +298,7 @@ protected:
     llvm::Value *buffer_extent_ptr(llvm::Value *, int);
     llvm::Value *buffer_stride_ptr(llvm::Value *, int);
     llvm::Value *buffer_elem_size_ptr(llvm::Value *);
+    llvm::Value *buffer_nd_field_ptr(llvm::Value *, int field, int i, const char *name);
     // @}
 
     /** Generate a pointer into a named buffer at a given index, of a
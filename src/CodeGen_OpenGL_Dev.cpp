@@ -277,7 +277,7 @@ void CodeGen_GLSL::visit(const Cast *op) {
 
 void CodeGen_GLSL::visit(const Let *op) {
 
-    if (op->name.find(".varying") != std::string::npos) {
+    if (op->name.str().find(".varying") != std::string::npos) {
 
         // Skip let statements for varying attributes
         op->body.accept(this);
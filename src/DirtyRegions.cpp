@@ -0,0 +1,311 @@
+#include "DirtyRegions.h"
+#include "ExprUsesVar.h"
+#include "FindCalls.h"
+#include "IREquality.h"
+#include "IRMutator.h"
+#include "IRVisitor.h"
+#include "RealizationOrder.h"
+#include "Simplify.h"
+#include "Solve.h"
+
+namespace Halide {
+namespace Internal {
+
+using std::map;
+using std::string;
+using std::vector;
+
+namespace {
+
+// Replace params, and the bounds of ImageParams bound to a Buffer,
+// with their current values. Also strips likely intrinsics (from
+// boundary conditions), which the solver can't see through.
+class SubstituteParamValues : public IRMutator {
+    using IRMutator::visit;
+
+    void visit(const Call *op) {
+        if (op->is_intrinsic(Call::likely)) {
+            expr = mutate(op->args[0]);
+        } else {
+            IRMutator::visit(op);
+        }
+    }
+
+    void visit(const Variable *op) {
+        if (!op->param.defined()) {
+            expr = op;
+        } else if (!op->param.is_buffer()) {
+            expr = op->param.get_scalar_expr();
+        } else {
+            expr = op;
+            Buffer b = op->param.get_buffer();
+            const string &param_name = op->param.name();
+            const string &name = op->name;
+            if (!b.defined() ||
+                name.size() <= param_name.size() + 1 ||
+                name.compare(0, param_name.size() + 1, param_name + ".") != 0) {
+                return;
+            }
+            // The rest of the name is e.g. "extent.0"
+            string field = name.substr(param_name.size() + 1);
+            size_t dot = field.find('.');
+            if (dot == string::npos) {
+                return;
+            }
+            int dim = atoi(field.c_str() + dot + 1);
+            if (dim < 0 || dim >= b.dimensions()) {
+                return;
+            }
+            field = field.substr(0, dot);
+            if (field == "min") {
+                expr = b.min(dim);
+            } else if (field == "extent") {
+                expr = b.extent(dim);
+            } else if (field == "stride") {
+                expr = b.stride(dim);
+            }
+        }
+    }
+};
+
+Expr substitute_param_values(Expr e) {
+    return simplify(SubstituteParamValues().mutate(e));
+}
+
+// Find the calls to Funcs and images in a definition.
+class FindInputCalls : public IRVisitor {
+    using IRVisitor::visit;
+
+    void visit(const Call *op) {
+        IRVisitor::visit(op);
+        if (op->call_type == Call::Halide || op->call_type == Call::Image) {
+            calls.push_back(op);
+        }
+    }
+
+public:
+    vector<const Call *> calls;
+};
+
+// Find the sites of a definition with the given pure vars, and the
+// given reduction domain, at which the call may read from the dirty
+// box of what it calls. Each dimension of the result is narrowed by
+// the arguments of the call that depend only on that dimension's var
+// (and the reduction domain), and is unbounded otherwise.
+Box sites_reading(const Call *call, const Box &dirty,
+                  const vector<string> &vars, const Scope<Interval> &rdom) {
+    internal_assert(call->args.size() == dirty.size())
+        << "Dirty region of " << call->name << " has " << dirty.size()
+        << " dimensions, but it is called with " << call->args.size() << " arguments\n";
+
+    vector<Expr> args;
+    for (Expr arg : call->args) {
+        args.push_back(substitute_param_values(arg));
+    }
+
+    Box result(vars.size());
+    for (size_t i = 0; i < vars.size(); i++) {
+        for (size_t j = 0; j < args.size(); j++) {
+            if (!expr_uses_var(args[j], vars[i])) {
+                continue;
+            }
+            bool uses_other_vars = false;
+            for (size_t k = 0; k < vars.size(); k++) {
+                if (k != i && expr_uses_var(args[j], vars[k])) {
+                    uses_other_vars = true;
+                }
+            }
+            if (uses_other_vars) {
+                continue;
+            }
+
+            Expr cond;
+            if (dirty[j].min.defined()) {
+                cond = args[j] >= dirty[j].min;
+            }
+            if (dirty[j].max.defined()) {
+                Expr le = args[j] <= dirty[j].max;
+                cond = cond.defined() ? (cond && le) : le;
+            }
+            if (!cond.defined()) {
+                continue;
+            }
+
+            Interval in = solve_for_outer_interval(simplify(cond), vars[i]);
+            if (interval_has_lower_bound(in)) {
+                Expr m = bounds_of_expr_in_scope(in.min, rdom).min;
+                if (m.defined()) {
+                    result[i].min = result[i].min.defined() ? max(result[i].min, m) : m;
+                }
+            }
+            if (interval_has_upper_bound(in)) {
+                Expr m = bounds_of_expr_in_scope(in.max, rdom).max;
+                if (m.defined()) {
+                    result[i].max = result[i].max.defined() ? min(result[i].max, m) : m;
+                }
+            }
+        }
+    }
+    return result;
+}
+
+// Find the sites an update definition may write to, given the sites
+// of its pure vars that may be dirty.
+Box sites_written(const UpdateDefinition &u, const vector<string> &vars,
+                  const Scope<Interval> &rdom, const Box &dirty_sites) {
+    Box result(vars.size());
+    for (size_t i = 0; i < vars.size(); i++) {
+        Expr arg = substitute_param_values(u.args[i]);
+        const Variable *v = arg.as<Variable>();
+        if (v && v->name == vars[i]) {
+            result[i] = dirty_sites[i];
+            continue;
+        }
+        bool uses_vars = false;
+        for (const string &var : vars) {
+            uses_vars = uses_vars || expr_uses_var(arg, var);
+        }
+        if (!uses_vars) {
+            result[i] = bounds_of_expr_in_scope(arg, rdom);
+        }
+    }
+    return result;
+}
+
+void merge_dirty(map<string, Box> &dirty, const string &name, const Box &b) {
+    auto it = dirty.find(name);
+    if (it == dirty.end()) {
+        dirty[name] = b;
+    } else {
+        merge_boxes(it->second, b);
+    }
+}
+
+}
+
+map<string, Box> dirty_regions(const vector<Function> &outputs,
+                               const map<string, Box> &dirty_inputs) {
+    map<string, Function> env;
+    for (Function f : outputs) {
+        map<string, Function> more = find_transitive_calls(f);
+        env.insert(more.begin(), more.end());
+    }
+    vector<string> order = realization_order(outputs, env);
+
+    map<string, Box> dirty;
+    for (const auto &it : dirty_inputs) {
+        Box b = it.second;
+        for (Interval &i : b.bounds) {
+            if (i.min.defined()) i.min = substitute_param_values(i.min);
+            if (i.max.defined()) i.max = substitute_param_values(i.max);
+        }
+        dirty[it.first] = b;
+    }
+
+    for (const string &name : order) {
+        Function f = env.find(name)->second;
+        const vector<string> &vars = f.args();
+
+        if (f.has_extern_definition()) {
+            // We can't see inside extern stages, so if anything they
+            // use has changed, they may have changed everywhere.
+            bool reads_dirty = false;
+            for (const ExternFuncArgument &arg : f.extern_arguments()) {
+                if (arg.is_func()) {
+                    reads_dirty = reads_dirty || dirty.count(Function(arg.func).name());
+                } else if (arg.is_buffer()) {
+                    reads_dirty = reads_dirty || dirty.count(arg.buffer.name());
+                } else if (arg.is_image_param()) {
+                    reads_dirty = reads_dirty || dirty.count(arg.image_param.name());
+                } else if (arg.is_expr()) {
+                    FindInputCalls calls;
+                    arg.expr.accept(&calls);
+                    for (const Call *c : calls.calls) {
+                        reads_dirty = reads_dirty || dirty.count(c->name);
+                    }
+                }
+            }
+            if (reads_dirty) {
+                dirty[name] = Box(vars.size());
+            }
+            continue;
+        }
+
+        FindInputCalls pure_calls;
+        for (Expr v : f.values()) {
+            v.accept(&pure_calls);
+        }
+        for (const Call *c : pure_calls.calls) {
+            auto it = dirty.find(c->name);
+            if (it != dirty.end()) {
+                merge_dirty(dirty, name, sites_reading(c, it->second, vars, Scope<Interval>()));
+            }
+        }
+
+        for (const UpdateDefinition &u : f.updates()) {
+            Scope<Interval> rdom;
+            if (u.domain.defined()) {
+                for (const ReductionVariable &rv : u.domain.domain()) {
+                    Expr min = substitute_param_values(rv.min);
+                    Expr extent = substitute_param_values(rv.extent);
+                    rdom.push(rv.var, Interval(min, simplify(min + extent - 1)));
+                }
+            }
+
+            FindInputCalls calls;
+            for (Expr e : u.values) {
+                e.accept(&calls);
+            }
+            for (Expr e : u.args) {
+                e.accept(&calls);
+            }
+
+            Box written;
+            bool writes_dirty = false;
+            for (const Call *c : calls.calls) {
+                auto it = dirty.find(c->name);
+                if (it == dirty.end()) {
+                    continue;
+                }
+                if (c->name == name) {
+                    // A read of the sites being updated doesn't spread
+                    // the changes anywhere new, but any other read of
+                    // this function (e.g. a scan) might carry them
+                    // anywhere the update writes.
+                    bool same_site = c->args.size() == u.args.size();
+                    for (size_t i = 0; same_site && i < u.args.size(); i++) {
+                        same_site = equal(c->args[i], u.args[i]);
+                    }
+                    if (!same_site) {
+                        merge_boxes(written, sites_written(u, vars, rdom, Box(vars.size())));
+                        writes_dirty = true;
+                    }
+                } else {
+                    Box sites = sites_reading(c, it->second, vars, rdom);
+                    merge_boxes(written, sites_written(u, vars, rdom, sites));
+                    writes_dirty = true;
+                }
+            }
+            if (writes_dirty) {
+                merge_dirty(dirty, name, written);
+            }
+        }
+    }
+
+    // Only return the functions.
+    map<string, Box> result;
+    for (const auto &it : dirty) {
+        if (env.count(it.first)) {
+            Box b = it.second;
+            for (Interval &i : b.bounds) {
+                if (i.min.defined()) i.min = simplify(i.min);
+                if (i.max.defined()) i.max = simplify(i.max);
+            }
+            result[it.first] = b;
+        }
+    }
+    return result;
+}
+
+}
+}
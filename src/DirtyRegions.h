@@ -0,0 +1,32 @@
+#ifndef HALIDE_DIRTY_REGIONS_H
+#define HALIDE_DIRTY_REGIONS_H
+
+/** \file
+ * Defines the analysis that finds the parts of each function in a
+ * pipeline that depend on changed regions of its inputs.
+ */
+
+#include <map>
+
+#include "Bounds.h"
+#include "Function.h"
+
+namespace Halide {
+namespace Internal {
+
+/** Given boxes of some of the input images of a pipeline that have
+ * changed, by the name of the Image or ImageParam, find a box of each
+ * function in the pipeline that covers every site whose value may
+ * have changed as a result. Functions that can't have changed are
+ * left out of the result. An undefined min or max means the function
+ * may have changed all the way to that end of the dimension. Params,
+ * and the bounds of ImageParams that are bound to a Buffer, are
+ * replaced with their current values, so the boxes of a pipeline with
+ * a boundary condition are still constant. */
+std::map<std::string, Box> dirty_regions(const std::vector<Function> &outputs,
+                                         const std::map<std::string, Box> &dirty_inputs);
+
+}
+}
+
+#endif
@@ -1649,6 +1649,13 @@ void Func::compile_to(const Outputs &output_files,
     pipeline().compile_to(output_files, args, fn_name, target);
 }
 
+void Func::compile_to(const Outputs &output_files,
+                      const vector<Argument> &args,
+                      const string &fn_name,
+                      const vector<Target> &targets) {
+    pipeline().compile_to(output_files, args, fn_name, targets);
+}
+
 void Func::compile_to_bitcode(const string &filename, const vector<Argument> &args, const string &fn_name,
                               const Target &target) {
     pipeline().compile_to_bitcode(filename, args, fn_name, target);
@@ -1692,8 +1699,9 @@ void Func::compile_to_c(const string &filename, const vector<Argument> &args,
 void Func::compile_to_lowered_stmt(const string &filename,
                                    const vector<Argument> &args,
                                    StmtOutputFormat fmt,
-                                   const Target &target) {
-    pipeline().compile_to_lowered_stmt(filename, args, fmt, target);
+                                   const Target &target,
+                                   const halide_profiler_pipeline_stats *profile) {
+    pipeline().compile_to_lowered_stmt(filename, args, fmt, target, profile);
 }
 
 void Func::print_loop_nest() {
@@ -1774,6 +1782,25 @@ void Func::infer_input_bounds(Realization dst) {
     pipeline().infer_input_bounds(dst);
 }
 
+void Func::realize_tiled(vector<int32_t> sizes, vector<int32_t> tile_sizes,
+                         TileReader reader, TileWriter writer, const Target &target) {
+    pipeline().realize_tiled(sizes, tile_sizes, reader, writer, target);
+}
+
+void Func::realize_batch(const vector<BatchItem> &items, const Target &target) {
+    pipeline().realize_batch(items, target);
+}
+
+DirtyRegion Func::realize_dirty(Realization dst, const std::map<string, DirtyRegion> &dirty,
+                                const Target &target) {
+    return pipeline().realize_dirty(dst, dirty, target);
+}
+
+DirtyRegion Func::realize_dirty(Buffer dst, const std::map<string, DirtyRegion> &dirty,
+                                const Target &target) {
+    return pipeline().realize_dirty(dst, dirty, target);
+}
+
 void *Func::compile_jit(const Target &target) {
     return pipeline().compile_jit(target);
 }
@@ -414,6 +414,32 @@ public:
     EXPORT void infer_input_bounds(Buffer dst);
     // @}
 
+    /** Realize this function one tile at a time, reading the regions
+     * of the unbound ImageParams each tile needs with reader, and
+     * passing each finished tile to writer. See
+     * Pipeline::realize_tiled. */
+    EXPORT void realize_tiled(std::vector<int32_t> sizes,
+                              std::vector<int32_t> tile_sizes,
+                              TileReader reader, TileWriter writer,
+                              const Target &target = Target());
+
+    /** Evaluate this function for many independent items at once, as
+     * a single parallel job. See Pipeline::realize_batch. */
+    EXPORT void realize_batch(const std::vector<BatchItem> &items,
+                              const Target &target = Target());
+
+    /** Recompute the part of outputs previously computed by this
+     * function that depends on the given changed regions of its
+     * inputs. See Pipeline::realize_dirty. */
+    // @{
+    EXPORT DirtyRegion realize_dirty(Realization dst,
+                                     const std::map<std::string, DirtyRegion> &dirty,
+                                     const Target &target = Target());
+    EXPORT DirtyRegion realize_dirty(Buffer dst,
+                                     const std::map<std::string, DirtyRegion> &dirty,
+                                     const Target &target = Target());
+    // @}
+
     /** Statically compile this function to llvm bitcode, with the
      * given filename (which should probably end in .bc), type
      * signature, and C function name (which defaults to the same name
@@ -481,11 +507,16 @@ public:
 
     /** Write out an internal representation of lowered code. Useful
      * for analyzing and debugging scheduling. Can emit html or plain
-     * text. */
+     * text. When emitting html, profile may be what the profiler
+     * measured for a run of this pipeline (e.g. from
+     * Pipeline::last_profile), and each produce and loop is then
+     * annotated with the numbers of its Func and colored by how hot
+     * it is. */
     EXPORT void compile_to_lowered_stmt(const std::string &filename,
                                         const std::vector<Argument> &args,
                                         StmtOutputFormat fmt = Text,
-                                        const Target &target = get_target_from_environment());
+                                        const Target &target = get_target_from_environment(),
+                                        const halide_profiler_pipeline_stats *profile = nullptr);
 
     /** Write out the loop nests specified by the schedule for this
      * Function. Helpful for understanding what a schedule is
@@ -513,6 +544,15 @@ public:
                            const std::string &fn_name,
                            const Target &target = get_target_from_environment());
 
+    /** Compile a variant of this Func for each of the given targets
+     * into a single set of output files, along with a dispatcher that
+     * picks the best variant for the host cpu. See
+     * Pipeline::compile_to. */
+    EXPORT void compile_to(const Outputs &output_files,
+                           const std::vector<Argument> &args,
+                           const std::string &fn_name,
+                           const std::vector<Target> &targets);
+
     /** Eagerly jit compile the function to machine code. This
      * normally happens on the first call to realize. If you're
      * running your halide pipeline inside time-sensitive code and
@@ -82,7 +82,7 @@ struct FunctionContents {
         }
 
         for (Parameter i : output_buffers) {
-            for (size_t j = 0; j < args.size() && j < 4; j++) {
+            for (size_t j = 0; j < args.size() && j < HALIDE_BUFFER_MAX_DIMENSIONS; j++) {
                 if (i.min_constraint(j).defined()) {
                     i.min_constraint(j).accept(visitor);
                 }
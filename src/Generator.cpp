@@ -48,7 +48,10 @@ const std::map<std::string, Halide::Type> &get_halide_type_enum_map() {
 
 int generate_filter_main(int argc, char **argv, std::ostream &cerr) {
     const char kUsage[] = "gengen [-g GENERATOR_NAME] [-f FUNCTION_NAME] [-o OUTPUT_DIR] [-r RUNTIME_NAME] [-e EMIT_OPTIONS] [-x EXTENSION_OPTIONS] "
-                          "target=target-string [generator_arg=value [...]]\n\n"
+                          "target=target-string[,target-string...] [generator_arg=value [...]]\n\n"
+                          "  If several comma separated targets are given, the object file contains a variant for each, "
+                          "in order of preference, and dispatches to the best one the host cpu supports. "
+                          "The last target is the fallback.\n"
                           "  -e  A comma separated list of optional files to emit. Accepted values are "
                           "[assembly, bitcode, stmt, html, cpp]\n"
                           "  -x  A comma separated list of file extension pairs to substitute during file naming, "
@@ -144,6 +147,15 @@ int generate_filter_main(int argc, char **argv, std::ostream &cerr) {
         }
     }
 
+    std::vector<std::string> target_strings = split_string(generator_args["target"], ",");
+    if (target_strings.size() > 1) {
+        for (const std::string &t : target_strings) {
+            emit_options.targets.push_back(parse_target_string(t));
+        }
+        // Everything but the object file is built for the fallback.
+        generator_args["target"] = target_strings.back();
+    }
+
     auto extension_flags = split_string(flags_info["-x"], ",");
     for (const std::string &x : extension_flags) {
         if (x.empty()) {
@@ -360,7 +372,11 @@ void GeneratorBase::emit_filter(const std::string &output_dir,
             // and passed to LLVM, for both the pnacl and ordinary archs
             output_files.bitcode_name = base_path + get_extension(".bc", options);
         }
-        pipeline.compile_to(output_files, inputs, function_name, target);
+        if (options.targets.size() > 1) {
+            pipeline.compile_to(output_files, inputs, function_name, options.targets);
+        } else {
+            pipeline.compile_to(output_files, inputs, function_name, target);
+        }
     }
     if (options.emit_h) {
         pipeline.compile_to_header(base_path + get_extension(".h", options), inputs, function_name, target);
@@ -545,6 +545,13 @@ public:
         // extensions are problematic, and avoids the need to rename output files
         // after the fact.
         std::map<std::string, std::string> extensions;
+        // If this holds more than one target, the object, assembly and
+        // bitcode outputs contain a variant of the pipeline for each
+        // of them, plus a dispatcher that picks one based on the host
+        // cpu (see Pipeline::compile_to). The last target is the
+        // fallback, and should match the Generator's target param,
+        // which is used for everything else.
+        std::vector<Target> targets;
         EmitOptions()
             : emit_o(true), emit_h(true), emit_cpp(false), emit_assembly(false),
               emit_bitcode(false), emit_stmt(false), emit_stmt_html(false) {}
@@ -301,7 +301,7 @@ Expr Broadcast::make(Expr value, int lanes) {
     return node;
 }
 
-Expr Let::make(std::string name, Expr value, Expr body) {
+Expr Let::make(Name name, Expr value, Expr body) {
     internal_assert(value.defined()) << "Let of undefined\n";
     internal_assert(body.defined()) << "Let of undefined\n";
 
@@ -313,7 +313,7 @@ Expr Let::make(std::string name, Expr value, Expr body) {
     return node;
 }
 
-Stmt LetStmt::make(std::string name, Expr value, Stmt body) {
+Stmt LetStmt::make(Name name, Expr value, Stmt body) {
     internal_assert(value.defined()) << "Let of undefined\n";
     internal_assert(body.defined()) << "Let of undefined\n";
 
@@ -347,7 +347,7 @@ Stmt ProducerConsumer::make(std::string name, Stmt produce, Stmt update, Stmt co
     return node;
 }
 
-Stmt For::make(std::string name, Expr min, Expr extent, ForType for_type, DeviceAPI device_api, Stmt body) {
+Stmt For::make(Name name, Expr min, Expr extent, ForType for_type, DeviceAPI device_api, Stmt body) {
     internal_assert(min.defined()) << "For of undefined\n";
     internal_assert(extent.defined()) << "For of undefined\n";
     internal_assert(min.type().is_scalar()) << "For with vector min\n";
@@ -455,7 +455,7 @@ Stmt Free::make(std::string name) {
     return node;
 }
 
-Stmt Realize::make(const std::string &name, const std::vector<Type> &types, const Region &bounds, Expr condition, Stmt body) {
+Stmt Realize::make(Name name, const std::vector<Type> &types, const Region &bounds, Expr condition, Stmt body) {
     for (size_t i = 0; i < bounds.size(); i++) {
         internal_assert(bounds[i].min.defined()) << "Realize of undefined\n";
         internal_assert(bounds[i].extent.defined()) << "Realize of undefined\n";
@@ -544,7 +544,7 @@ Expr Call::make(Type type, std::string name, const std::vector<Expr> &args, Call
     return node;
 }
 
-Expr Variable::make(Type type, std::string name, Buffer image, Parameter param, ReductionDomain reduction_domain) {
+Expr Variable::make(Type type, Name name, Buffer image, Parameter param, ReductionDomain reduction_domain) {
     internal_assert(!name.empty());
     Variable *node = new Variable;
     node->type = type;
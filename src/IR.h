@@ -14,6 +14,7 @@
 #include "Expr.h"
 #include "Function.h"
 #include "IntrusivePtr.h"
+#include "Name.h"
 #include "Parameter.h"
 #include "Type.h"
 #include "Util.h"
@@ -198,20 +199,20 @@ struct Broadcast : public ExprNode<Broadcast> {
  * language. Within the expression \ref Let::body, instances of the Var
  * node \ref Let::name refer to \ref Let::value. */
 struct Let : public ExprNode<Let> {
-    std::string name;
+    Name name;
     Expr value, body;
 
-    EXPORT static Expr make(std::string name, Expr value, Expr body);
+    EXPORT static Expr make(Name name, Expr value, Expr body);
 };
 
 /** The statement form of a let node. Within the statement 'body',
  * instances of the Var named 'name' refer to 'value' */
 struct LetStmt : public StmtNode<LetStmt> {
-    std::string name;
+    Name name;
     Expr value;
     Stmt body;
 
-    EXPORT static Stmt make(std::string name, Expr value, Stmt body);
+    EXPORT static Stmt make(Name name, Expr value, Stmt body);
 };
 
 /** If the 'condition' is false, then evaluate and return the message,
@@ -323,13 +324,13 @@ typedef std::vector<Range> Region;
  * (min, extent) pairs for each dimension. Allocation only occurs if
  * the condition evaluates to true. */
 struct Realize : public StmtNode<Realize> {
-    std::string name;
+    Name name;
     std::vector<Type> types;
     Region bounds;
     Expr condition;
     Stmt body;
 
-    EXPORT static Stmt make(const std::string &name, const std::vector<Type> &types, const Region &bounds, Expr condition, Stmt body);
+    EXPORT static Stmt make(Name name, const std::vector<Type> &types, const Region &bounds, Expr condition, Stmt body);
 };
 
 /** A sequence of statements to be executed in-order. 'rest' may be
@@ -493,7 +494,7 @@ struct Call : public ExprNode<Call> {
  * parameter, reduction variable, or something defined by a Let or
  * LetStmt node. */
 struct Variable : public ExprNode<Variable> {
-    std::string name;
+    Name name;
 
     /** References to scalar parameters, or to the dimensions of buffer
      * parameters hang onto those expressions. */
@@ -505,23 +506,23 @@ struct Variable : public ExprNode<Variable> {
     /** Reduction variables hang onto their domains */
     ReductionDomain reduction_domain;
 
-    static Expr make(Type type, std::string name) {
+    static Expr make(Type type, Name name) {
         return make(type, name, Buffer(), Parameter(), ReductionDomain());
     }
 
-    static Expr make(Type type, std::string name, Parameter param) {
+    static Expr make(Type type, Name name, Parameter param) {
         return make(type, name, Buffer(), param, ReductionDomain());
     }
 
-    static Expr make(Type type, std::string name, Buffer image) {
+    static Expr make(Type type, Name name, Buffer image) {
         return make(type, name, image, Parameter(), ReductionDomain());
     }
 
-    static Expr make(Type type, std::string name, ReductionDomain reduction_domain) {
+    static Expr make(Type type, Name name, ReductionDomain reduction_domain) {
         return make(type, name, Buffer(), Parameter(), reduction_domain);
     }
 
-    EXPORT static Expr make(Type type, std::string name, Buffer image, Parameter param, ReductionDomain reduction_domain);
+    EXPORT static Expr make(Type type, Name name, Buffer image, Parameter param, ReductionDomain reduction_domain);
 };
 
 /** A for loop. Execute the 'body' statement for all values of the
@@ -537,13 +538,13 @@ struct Variable : public ExprNode<Variable> {
  * statement. Again in this case, 'extent' should be a small
  * integer constant. */
 struct For : public StmtNode<For> {
-    std::string name;
+    Name name;
     Expr min, extent;
     ForType for_type;
     DeviceAPI device_api;
     Stmt body;
 
-    EXPORT static Stmt make(std::string name, Expr min, Expr extent, ForType for_type, DeviceAPI device_api, Stmt body);
+    EXPORT static Stmt make(Name name, Expr min, Expr extent, ForType for_type, DeviceAPI device_api, Stmt body);
 };
 
 }
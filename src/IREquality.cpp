@@ -41,6 +41,7 @@ private:
     IRCompareCache *cache;
 
     CmpResult compare_names(const std::string &a, const std::string &b);
+    CmpResult compare_names(const Name &a, const Name &b);
     CmpResult compare_types(Type a, Type b);
     CmpResult compare_expr_vector(const std::vector<Expr> &a, const std::vector<Expr> &b);
 
@@ -216,6 +217,12 @@ IRComparer::CmpResult IRComparer::compare_names(const string &a, const string &b
     return result;
 }
 
+IRComparer::CmpResult IRComparer::compare_names(const Name &a, const Name &b) {
+    // Interned names with the same spelling are the same object.
+    if (result != Equal || a.same_as(b)) return result;
+    return compare_names(a.str(), b.str());
+}
+
 
 IRComparer::CmpResult IRComparer::compare_expr_vector(const vector<Expr> &a, const vector<Expr> &b) {
     if (result != Equal) return result;
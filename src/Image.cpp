@@ -27,12 +27,19 @@ void ImageBase::prepare_for_direct_pixel_access() {
                          buffer.min(1) * stride_1 +
                          buffer.min(2) * stride_2 +
                          buffer.min(3) * stride_3);
+        dims = buffer.dimensions();
+        for (int i = 4; i < HALIDE_BUFFER_MAX_DIMENSIONS; i++) {
+            stride_n[i - 4] = i < dims ? buffer.stride(i) : 0;
+            offset += buffer.min(i) * stride_n[i - 4];
+        }
         offset *= elem_size;
         origin = (void *)((uint8_t *)origin - offset);
-        dims = buffer.dimensions();
     } else {
         origin = nullptr;
         stride_0 = stride_1 = stride_2 = stride_3 = 0;
+        for (int i = 4; i < HALIDE_BUFFER_MAX_DIMENSIONS; i++) {
+            stride_n[i - 4] = 0;
+        }
         dims = 0;
     }
 }
@@ -81,6 +88,11 @@ ImageBase::ImageBase(Type t, int x, int y, int z, int w, const std::string &name
     prepare_for_direct_pixel_access();
 }
 
+ImageBase::ImageBase(Type t, const std::vector<int> &sizes, const std::string &name) :
+    buffer(Buffer(t, sizes, nullptr, make_image_name(name, this))) {
+    prepare_for_direct_pixel_access();
+}
+
 ImageBase::ImageBase(Type t, const Buffer &buf) : buffer(buf) {
     if (t != buffer.type()) {
         user_error << "Can't construct Image of type " << t
@@ -104,6 +116,11 @@ ImageBase::ImageBase(Type t, const buffer_t *b, const std::string &name) :
     prepare_for_direct_pixel_access();
 }
 
+ImageBase::ImageBase(Type t, const halide_buffer_nd_t *b, const std::string &name) :
+    buffer(t, b, make_image_name(name, this)) {
+    prepare_for_direct_pixel_access();
+}
+
 const std::string &ImageBase::name() const {
     return buffer.name();
 }
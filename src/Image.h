@@ -31,6 +31,9 @@ protected:
      */
     int stride_0, stride_1, stride_2, stride_3;
 
+    /** The strides of the dimensions beyond the fourth. */
+    int stride_n[HALIDE_BUFFER_MAX_DIMENSIONS - 4];
+
     /** The dimensionality. */
     int dims;
 
@@ -48,10 +51,13 @@ protected:
                                           bool placeholder_seen) const;
 public:
     /** Construct an undefined image handle */
-    ImageBase() : origin(nullptr), stride_0(0), stride_1(0), stride_2(0), stride_3(0), dims(0) {}
+    ImageBase() : origin(nullptr), stride_0(0), stride_1(0), stride_2(0), stride_3(0), stride_n(), dims(0) {}
 
     /** Allocate an image with the given dimensions. */
+    // @{
     EXPORT ImageBase(Type t, int x, int y = 0, int z = 0, int w = 0, const std::string &name = "");
+    EXPORT ImageBase(Type t, const std::vector<int> &sizes, const std::string &name = "");
+    // @}
 
     /** Wrap a buffer in an Image object, so that we can directly
      * access its pixels in a type-safe way. */
@@ -64,6 +70,10 @@ public:
      * pixels. */
     EXPORT ImageBase(Type t, const buffer_t *b, const std::string &name = "");
 
+    /** Wrap a buffer with more than four dimensions in an Image
+     * object. */
+    EXPORT ImageBase(Type t, const halide_buffer_nd_t *b, const std::string &name = "");
+
     /** Get the name of this image. */
     EXPORT const std::string &name() const;
 
@@ -149,6 +159,13 @@ public:
     EXPORT Expr operator()(Expr x, Expr y, Expr z, Expr w) const;
     EXPORT Expr operator()(std::vector<Expr>) const;
     EXPORT Expr operator()(std::vector<Var>) const;
+
+    template <typename... Args>
+    NO_INLINE typename std::enable_if<Internal::all_are_convertible<Expr, Args...>::value, Expr>::type
+    operator()(Expr x, Expr y, Expr z, Expr w, Expr v, Args... rest) const {
+        std::vector<Expr> args = {x, y, z, w, v, rest...};
+        return (*this)(args);
+    }
     // @}
 
     /** Get a pointer to the raw buffer_t that this image holds */
@@ -160,11 +177,23 @@ public:
         size_t offset = x*stride_0 + y*stride_1 + z*stride_2 + w*stride_3;
         return (void *)(ptr + offset * elem_size);
     }
+
+    /** Get the address of a pixel in an image with any number of
+     * dimensions. */
+    void *address_of(const int *pos, int n) const {
+        uint8_t *ptr = (uint8_t *)origin;
+        size_t offset = pos[0]*stride_0 + pos[1]*stride_1 + pos[2]*stride_2 + pos[3]*stride_3;
+        for (int i = 4; i < n; i++) {
+            offset += pos[i]*stride_n[i - 4];
+        }
+        return (void *)(ptr + offset * elem_size);
+    }
 };
 
 /** A reference-counted handle on a dense multidimensional array
  * containing scalar values of type T. Can be directly accessed and
- * modified. May have up to four dimensions. Color images are
+ * modified. May have up to HALIDE_BUFFER_MAX_DIMENSIONS
+ * dimensions. Color images are
  * represented as three-dimensional, with the third dimension being
  * the color channel. In general we store color images in
  * color-planes, as opposed to packed RGB, because this tends to
@@ -190,6 +219,9 @@ public:
 
     NO_INLINE Image(int x, const std::string &name) :
         ImageBase(type_of<T>(), x, 0, 0, 0, name) {}
+
+    NO_INLINE Image(const std::vector<int> &sizes, const std::string &name = "") :
+        ImageBase(type_of<T>(), sizes, name) {}
     // @}
 
     /** Wrap a buffer in an Image object, so that we can directly
@@ -204,6 +236,11 @@ public:
     NO_INLINE Image(const buffer_t *b, const std::string &name = "") :
         ImageBase(type_of<T>(), b, name) {}
 
+    /** Wrap a buffer with more than four dimensions in an Image
+     * object. */
+    NO_INLINE Image(const halide_buffer_nd_t *b, const std::string &name = "") :
+        ImageBase(type_of<T>(), b, name) {}
+
     /** Get a pointer to the element at the min location. */
     NO_INLINE T *data() const {
         user_assert(defined()) << "data of undefined Image\n";
@@ -260,6 +297,24 @@ public:
         return *((T *)(address_of(x, y, z, w)));
     }
 
+    /** Get the value of the element at a position in an image of
+     * five or more dimensions. */
+    template<typename... Args>
+    typename std::enable_if<Internal::all_are_convertible<int, Args...>::value, const T &>::type
+    operator()(int x, int y, int z, int w, int v, Args... rest) const {
+        const int pos[] = {x, y, z, w, v, rest...};
+        return *((T *)(address_of(pos, 5 + sizeof...(rest))));
+    }
+
+    /** Get a reference to the element at a position in an image of
+     * five or more dimensions. */
+    template<typename... Args>
+    typename std::enable_if<Internal::all_are_convertible<int, Args...>::value, T &>::type
+    operator()(int x, int y, int z, int w, int v, Args... rest) {
+        const int pos[] = {x, y, z, w, v, rest...};
+        return *((T *)(address_of(pos, 5 + sizeof...(rest))));
+    }
+
     /** Get a handle on the Buffer that this image holds */
     operator Buffer() const {
         return buffer;
@@ -82,7 +82,7 @@ class FindBuffersToTrack : public IRVisitor {
         const Call *c = op->value.as<Call>();
         if (ends_with(op->name, ".buffer") &&
             c && c->name == Call::create_buffer_t) {
-            buffers_to_track.erase(op->name.substr(0, op->name.size() - 7));
+            buffers_to_track.erase(op->name.str().substr(0, op->name.size() - 7));
         }
 
         IRVisitor::visit(op);
@@ -106,7 +106,7 @@ class FindBuffersToTrack : public IRVisitor {
 
     void visit(const Variable *op) {
         if (op->type.is_handle() && ends_with(op->name, ".buffer")) {
-            buffers_to_track.insert(op->name.substr(0, op->name.size() - 7));
+            buffers_to_track.insert(op->name.str().substr(0, op->name.size() - 7));
         }
     }
 
@@ -358,6 +358,14 @@ class InjectBufferCopies : public IRMutator {
         return buffers_to_track.count(buf) != 0;
     }
 
+    // The device runtimes only understand the first four dimensions
+    // of a buffer.
+    void check_device_dimensions(const string &buf, int dims) {
+        user_assert(dims <= 4)
+            << "Buffer " << buf << " has " << dims
+            << " dimensions, but buffers used on a device may have at most four.\n";
+    }
+
     void visit(const Store *op) {
         IRMutator::visit(op);
 
@@ -365,6 +373,10 @@ class InjectBufferCopies : public IRMutator {
             return;
         }
 
+        if (device_api != DeviceAPI::Host && op->param.defined()) {
+            check_device_dimensions(op->name, op->param.dimensions());
+        }
+
         debug(4) << "Device " << static_cast<int>(device_api) << " writes buffer " << op->name << "\n";
         state[op->name].devices_writing.insert(device_api);
     }
@@ -376,6 +388,14 @@ class InjectBufferCopies : public IRMutator {
             return;
         }
 
+        if (device_api != DeviceAPI::Host) {
+            if (op->param.defined()) {
+                check_device_dimensions(op->name, op->param.dimensions());
+            } else if (op->image.defined()) {
+                check_device_dimensions(op->name, op->image.dimensions());
+            }
+        }
+
         debug(4) << "Device " << static_cast<int>(device_api) << " reads buffer " << op->name << "\n";
         state[op->name].devices_reading.insert(device_api);
     }
@@ -399,7 +419,7 @@ class InjectBufferCopies : public IRMutator {
             internal_assert(op->args.size() >= 2);
             const Variable *buffer_var = op->args[1].as<Variable>();
             internal_assert(buffer_var && ends_with(buffer_var->name, ".buffer"));
-            string buf_name = buffer_var->name.substr(0, buffer_var->name.size() - 7);
+            string buf_name = buffer_var->name.str().substr(0, buffer_var->name.size() - 7);
             debug(4) << "Adding image read via image_load for " << buffer_var->name << "\n";
             state[buf_name].devices_reading.insert(device_api);
             IRMutator::visit(op);
@@ -409,7 +429,7 @@ class InjectBufferCopies : public IRMutator {
             internal_assert(op->args.size() >= 2);
             const Variable *buffer_var = op->args[1].as<Variable>();
             internal_assert(buffer_var && ends_with(buffer_var->name, ".buffer"));
-            string buf_name = buffer_var->name.substr(0, buffer_var->name.size() - 7);
+            string buf_name = buffer_var->name.str().substr(0, buffer_var->name.size() - 7);
             debug(4) << "Adding image write via image_store for " << buffer_var->name << "\n";
             state[buf_name].devices_writing.insert(device_api);
             IRMutator::visit(op);
@@ -481,7 +501,7 @@ class InjectBufferCopies : public IRMutator {
         // allocate node is just bounds inference to an input or
         // output.
         if (ends_with(op->name, ".buffer")) {
-            string buf_name = op->name.substr(0, op->name.size() - 7);
+            string buf_name = op->name.str().substr(0, op->name.size() - 7);
             if (state.find(buf_name) != state.end()) {
                 state[buf_name].host_touched = true;
             }
@@ -523,10 +543,14 @@ class InjectBufferCopies : public IRMutator {
         internal_assert(op);
 
         if (ends_with(op->name, ".buffer")) {
-            string buf_name = op->name.substr(0, op->name.size() - 7);
+            string buf_name = op->name.str().substr(0, op->name.size() - 7);
             if (!should_track(buf_name)) {
                 return;
             }
+            const Call *c = op->value.as<Call>();
+            if (c && c->name == Call::create_buffer_t) {
+                check_device_dimensions(buf_name, ((int)c->args.size() - 2) / 3);
+            }
             if (!state[buf_name].host_touched) {
                 // Use null as a host pointer if there's no host allocation
                 const Call *create_buffer_t = op->value.as<Call>();
@@ -19,6 +19,9 @@ class Inliner : public IRMutator {
 
     Function func;
 
+    // The values of func, qualified by its name
+    vector<Expr> values;
+
     // Sanity check that this is a reasonable function to inline
     void check(Function f) {
 
@@ -94,7 +97,7 @@ class Inliner : public IRMutator {
                 args[i] = mutate(op->args[i]);
             }
             // Grab the body
-            Expr body = qualify(func.name() + ".", func.values()[op->value_index]);
+            Expr body = values[op->value_index];
 
             // Bind the args using Let nodes
             internal_assert(args.size() == func.args().size());
@@ -128,20 +131,32 @@ class Inliner : public IRMutator {
 public:
     bool found;
 
-    Inliner(Function f) : func(f), found(false) {
+    Inliner(Function f, const vector<Expr> &v) : func(f), values(v), found(false) {
         check(func);
     }
 
 };
 
-Stmt inline_function(Stmt s, Function f) {
-    Inliner i(f);
+vector<Expr> qualified_values(Function f) {
+    vector<Expr> values(f.values().size());
+    for (size_t i = 0; i < values.size(); i++) {
+        values[i] = qualify(f.name() + ".", f.values()[i]);
+    }
+    return values;
+}
+
+Stmt inline_function(Stmt s, Function f, const vector<Expr> &values) {
+    Inliner i(f, values);
     s = i.mutate(s);
     return s;
 }
 
+Stmt inline_function(Stmt s, Function f) {
+    return inline_function(s, f, qualified_values(f));
+}
+
 Expr inline_function(Expr e, Function f) {
-    Inliner i(f);
+    Inliner i(f, qualified_values(f));
     e = i.mutate(e);
     if (i.found) {
         e = common_subexpression_elimination(e);
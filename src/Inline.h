@@ -16,6 +16,16 @@ Stmt inline_function(Stmt, Function);
 Expr inline_function(Expr, Function);
 // @}
 
+/** The values of a function with their variable names qualified by
+ * the function name, which is the form in which they are substituted
+ * in at each call site when the function is inlined. */
+std::vector<Expr> qualified_values(Function);
+
+/** Inline a single named function, given its values as returned by
+ * qualified_values. Useful when inlining the same function
+ * repeatedly. */
+Stmt inline_function(Stmt, Function, const std::vector<Expr> &qualified_values);
+
 }
 }
 
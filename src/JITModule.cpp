@@ -456,6 +456,14 @@ void JITModule::memoization_cache_set_size(int64_t size) const {
     }
 }
 
+void JITModule::set_allocation_policy(const halide_allocation_policy_t &policy) const {
+    std::map<std::string, Symbol>::const_iterator f =
+        exports().find("halide_set_allocation_policy");
+    if (f != exports().end()) {
+        (reinterpret_bits<void (*)(const halide_allocation_policy_t *)>(f->second.address))(&policy);
+    }
+}
+
 bool JITModule::compiled() const {
   return jit_module.ptr->execution_engine != nullptr;
 }
@@ -466,6 +474,7 @@ JITHandlers runtime_internal_handlers;
 JITHandlers default_handlers;
 JITHandlers active_handlers;
 int64_t default_cache_size;
+halide_allocation_policy_t default_allocation_policy;
 
 void merge_handlers(JITHandlers &base, const JITHandlers &addins) {
     if (addins.custom_print) {
@@ -705,6 +714,10 @@ JITModule &make_module(llvm::Module *for_module, Target target,
                 shared_runtimes(MainShared).memoization_cache_set_size(default_cache_size);
             }
 
+            if (default_allocation_policy.large_allocation_size != 0) {
+                shared_runtimes(MainShared).set_allocation_policy(default_allocation_policy);
+            }
+
             runtime.jit_module.ptr->name = "MainShared";
         } else {
             runtime.jit_module.ptr->name = "GPU";
@@ -810,5 +823,12 @@ void JITSharedRuntime::memoization_cache_set_size(int64_t size) {
     }
 }
 
+void JITSharedRuntime::set_allocation_policy(const halide_allocation_policy_t &policy) {
+    std::lock_guard<std::mutex> lock(shared_runtimes_mutex);
+
+    default_allocation_policy = policy;
+    shared_runtimes(MainShared).set_allocation_policy(policy);
+}
+
 }
 }
@@ -133,6 +133,7 @@ struct JITModule {
     EXPORT int copy_to_host(struct buffer_t *buf) const;
     EXPORT int device_free(struct buffer_t *buf) const;
     EXPORT void memoization_cache_set_size(int64_t size) const;
+    EXPORT void set_allocation_policy(const halide_allocation_policy_t &policy) const;
 
     /** Return true if compile_module has been called on this module. */
     EXPORT bool compiled() const;
@@ -172,6 +173,13 @@ public:
      */
     EXPORT static void memoization_cache_set_size(int64_t size);
 
+    /** Set the policy the shared runtime uses to allocate large
+     * blocks of host memory. If you are compiling statically, you
+     * should include HalideRuntime.h and call
+     * halide_set_allocation_policy() instead.
+     */
+    EXPORT static void set_allocation_policy(const halide_allocation_policy_t &policy);
+
     EXPORT static void release_all();
 };
 
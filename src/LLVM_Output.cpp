@@ -250,6 +250,182 @@ std::unique_ptr<llvm::Module> compile_module_to_llvm_module(const Module &module
     return codegen_llvm(module, context);
 }
 
+namespace {
+
+// The runtime's halide_cpu_feature_t flags that a target requires of
+// the host CPU.
+uint64_t required_cpu_features(const Target &t) {
+    uint64_t features = 0;
+    if (t.has_feature(Target::SSE41)) features |= halide_cpu_feature_sse41;
+    if (t.has_feature(Target::AVX)) features |= halide_cpu_feature_avx;
+    if (t.has_feature(Target::AVX2)) features |= halide_cpu_feature_avx2;
+    if (t.has_feature(Target::FMA)) features |= halide_cpu_feature_fma;
+    if (t.has_feature(Target::FMA4)) features |= halide_cpu_feature_fma4;
+    if (t.has_feature(Target::F16C)) features |= halide_cpu_feature_f16c;
+    return features;
+}
+
+// Add a function with the same signature as the variants that, on its
+// first call, asks the runtime which CPU features are available and
+// caches a pointer to the first variant that can be used. Every call
+// then jumps through the cached pointer. The last variant is used if
+// none of the others can be.
+llvm::Function *add_dispatcher(llvm::Module *m, const std::string &name,
+                               const std::vector<llvm::Function *> &variants,
+                               const std::vector<uint64_t> &features) {
+    llvm::LLVMContext &context = m->getContext();
+    llvm::Type *i32 = llvm::Type::getInt32Ty(context);
+    llvm::Type *i64 = llvm::Type::getInt64Ty(context);
+
+    llvm::FunctionType *func_t = variants.back()->getFunctionType();
+    llvm::PointerType *func_ptr_t = func_t->getPointerTo();
+
+    llvm::Function *can_use = m->getFunction("halide_can_use_cpu_features");
+    if (!can_use) {
+        llvm::Type *args_t[] = {i64};
+        can_use = llvm::Function::Create(llvm::FunctionType::get(i32, args_t, false),
+                                         llvm::GlobalValue::ExternalLinkage,
+                                         "halide_can_use_cpu_features", m);
+    }
+
+    // Pointer-sized stores are atomic on x86, so racing first calls
+    // can only ever store the same value.
+    llvm::GlobalVariable *selected =
+        new llvm::GlobalVariable(*m, func_ptr_t, false, llvm::GlobalValue::InternalLinkage,
+                                 llvm::ConstantPointerNull::get(func_ptr_t),
+                                 name + ".selected_variant");
+
+    llvm::Function *dispatcher = llvm::Function::Create(func_t, llvm::GlobalValue::ExternalLinkage, name, m);
+    llvm::BasicBlock *entry_block = llvm::BasicBlock::Create(context, "entry", dispatcher);
+    llvm::BasicBlock *select_block = llvm::BasicBlock::Create(context, "select_variant", dispatcher);
+    llvm::BasicBlock *store_block = llvm::BasicBlock::Create(context, "store_variant", dispatcher);
+    llvm::BasicBlock *call_block = llvm::BasicBlock::Create(context, "call_variant", dispatcher);
+    llvm::IRBuilder<> builder(context);
+
+    builder.SetInsertPoint(entry_block);
+    llvm::Value *cached = builder.CreateLoad(selected);
+    builder.CreateCondBr(builder.CreateIsNull(cached), select_block, call_block);
+
+    // Try the variants in order of preference, stopping at the first
+    // one that can be used, and falling back to the last.
+    builder.SetInsertPoint(store_block);
+    llvm::PHINode *chosen = builder.CreatePHI(func_ptr_t, variants.size());
+    builder.CreateStore(chosen, selected);
+    builder.CreateBr(call_block);
+
+    llvm::BasicBlock *try_block = select_block;
+    for (size_t i = 0; i + 1 < variants.size(); i++) {
+        builder.SetInsertPoint(try_block);
+        llvm::Value *usable = builder.CreateCall(can_use, llvm::ConstantInt::get(i64, features[i]));
+        llvm::BasicBlock *next_block = llvm::BasicBlock::Create(context, "try_variant", dispatcher, store_block);
+        builder.CreateCondBr(builder.CreateIsNotNull(usable), store_block, next_block);
+        chosen->addIncoming(variants[i], try_block);
+        try_block = next_block;
+    }
+    builder.SetInsertPoint(try_block);
+    builder.CreateBr(store_block);
+    chosen->addIncoming(variants.back(), try_block);
+
+    builder.SetInsertPoint(call_block);
+    llvm::PHINode *callee = builder.CreatePHI(func_ptr_t, 2);
+    callee->addIncoming(cached, entry_block);
+    callee->addIncoming(chosen, store_block);
+    std::vector<llvm::Value *> args;
+    for (auto &arg : dispatcher->args()) {
+        args.push_back(&arg);
+    }
+    llvm::CallInst *result = builder.CreateCall(callee, args);
+    result->setTailCall();
+    builder.CreateRet(result);
+
+    llvm::verifyFunction(*dispatcher);
+    return dispatcher;
+}
+
+}
+
+std::unique_ptr<llvm::Module> link_multitarget_llvm_modules(std::vector<std::unique_ptr<llvm::Module>> &modules,
+                                                            const std::vector<Target> &targets,
+                                                            const std::vector<std::string> &variant_names,
+                                                            const std::string &fn_name) {
+    internal_assert(!modules.empty() &&
+                    modules.size() == targets.size() &&
+                    modules.size() == variant_names.size());
+
+    #if LLVM_VERSION < 37
+    user_error << "Compiling for multiple targets requires llvm 3.7 or later.\n";
+    return nullptr;
+    #else
+    std::unique_ptr<llvm::Module> result = std::move(modules.back());
+    modules.pop_back();
+
+    for (size_t i = 0; i < modules.size(); i++) {
+        llvm::Module &m = *modules[i];
+
+        // Each variant is compiled for different cpu features. Record
+        // them on its functions, so that they override the ones the
+        // target machine is created with.
+        std::string mcpu, mattrs;
+        Internal::get_md_string(m.getModuleFlag("halide_mcpu"), mcpu);
+        Internal::get_md_string(m.getModuleFlag("halide_mattrs"), mattrs);
+
+        // Keep this variant's copies of any helpers to itself, so that
+        // code for one set of cpu features never calls into another's.
+        const std::string &entry = variant_names[i];
+        for (auto &f : m) {
+            if (f.isDeclaration()) continue;
+            f.addFnAttr("target-cpu", mcpu);
+            f.addFnAttr("target-features", mattrs);
+            if (f.getName() != entry && f.getName() != entry + "_argv") {
+                f.setLinkage(llvm::GlobalValue::InternalLinkage);
+            }
+        }
+        for (auto &gv : m.globals()) {
+            if (!gv.isDeclaration() && !gv.hasAppendingLinkage()) {
+                gv.setLinkage(llvm::GlobalValue::InternalLinkage);
+            }
+        }
+
+        // The flags only differ in the cpu features, and those have
+        // been recorded above. Drop them so the linker doesn't
+        // complain about conflicting values.
+        if (llvm::NamedMDNode *flags = m.getModuleFlagsMetadata()) {
+            m.eraseNamedMetadata(flags);
+        }
+
+        #if LLVM_VERSION >= 38
+        bool failed = llvm::Linker::linkModules(*result, std::move(modules[i]));
+        #else
+        bool failed = llvm::Linker::LinkModules(result.get(), modules[i].release());
+        #endif
+        internal_assert(!failed) << "Failure linking the variant for " << targets[i].to_string() << "\n";
+    }
+    modules.clear();
+
+    std::vector<llvm::Function *> entry_points, argv_entry_points;
+    std::vector<uint64_t> features;
+    for (size_t i = 0; i < targets.size(); i++) {
+        llvm::Function *f = result->getFunction(variant_names[i]);
+        llvm::Function *argv_f = result->getFunction(variant_names[i] + "_argv");
+        internal_assert(f && argv_f) << "Could not find the variant " << variant_names[i] << "\n";
+        entry_points.push_back(f);
+        argv_entry_points.push_back(argv_f);
+        features.push_back(required_cpu_features(targets[i]));
+    }
+
+    add_dispatcher(result.get(), fn_name, entry_points, features);
+    add_dispatcher(result.get(), fn_name + "_argv", argv_entry_points, features);
+
+    // The fallback's metadata describes the arguments, which are the
+    // same for every variant, and the least capable target.
+    llvm::GlobalVariable *metadata = result->getNamedGlobal(variant_names.back() + "_metadata");
+    internal_assert(metadata) << "Could not find the metadata for " << variant_names.back() << "\n";
+    metadata->setName(fn_name + "_metadata");
+
+    return result;
+    #endif
+}
+
 void compile_llvm_module_to_object(llvm::Module &module, const std::string &filename) {
     emit_file(module, filename, llvm::TargetMachine::CGFT_ObjectFile);
 }
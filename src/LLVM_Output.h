@@ -22,6 +22,19 @@ EXPORT void clone_target_options(const llvm::Module &from, llvm::Module &to);
 /** Generate an LLVM module. */
 EXPORT std::unique_ptr<llvm::Module> compile_module_to_llvm_module(const Module &module, llvm::LLVMContext &context);
 
+/** Combine llvm modules that each hold a variant of the same pipeline,
+ * compiled for a different x86 target, into one. The entry point of
+ * the i'th variant must be named variant_names[i]. Adds functions
+ * fn_name and fn_name_argv that check the host cpu's features on their
+ * first call, and thereafter jump straight to the first variant whose
+ * target the cpu supports. The last variant is the fallback, used when
+ * no other applies; it is also the only one that should contain the
+ * runtime. The input modules are consumed. */
+EXPORT std::unique_ptr<llvm::Module> link_multitarget_llvm_modules(std::vector<std::unique_ptr<llvm::Module>> &modules,
+                                                                   const std::vector<Target> &targets,
+                                                                   const std::vector<std::string> &variant_names,
+                                                                   const std::string &fn_name);
+
 /** Compile an LLVM module to native targets (objects, native assembly). */
 // @{
 EXPORT void compile_llvm_module_to_object(llvm::Module &module, const std::string &filename);
@@ -1,5 +1,9 @@
+#include <map>
+#include <mutex>
+
 #include "LLVM_Runtime_Linker.h"
 #include "LLVM_Headers.h"
+#include "Debug.h"
 
 namespace Halide {
 
@@ -82,15 +86,18 @@ DECLARE_CPP_INITMOD(windows_cuda)
 DECLARE_CPP_INITMOD(fake_thread_pool)
 DECLARE_CPP_INITMOD(float16_t)
 DECLARE_CPP_INITMOD(gcd_thread_pool)
+DECLARE_CPP_INITMOD(linux_allocator)
 DECLARE_CPP_INITMOD(linux_clock)
 DECLARE_CPP_INITMOD(linux_host_cpu_count)
 DECLARE_CPP_INITMOD(linux_opengl_context)
+DECLARE_CPP_INITMOD(linux_perf_counters)
 DECLARE_CPP_INITMOD(osx_opengl_context)
 DECLARE_CPP_INITMOD(opencl)
 DECLARE_CPP_INITMOD(windows_opencl)
 DECLARE_CPP_INITMOD(opengl)
 DECLARE_CPP_INITMOD(openglcompute)
 DECLARE_CPP_INITMOD(osx_host_cpu_count)
+DECLARE_CPP_INITMOD(persistent_allocations)
 DECLARE_CPP_INITMOD(posix_allocator)
 DECLARE_CPP_INITMOD(posix_clock)
 DECLARE_CPP_INITMOD(windows_clock)
@@ -122,6 +129,7 @@ DECLARE_CPP_INITMOD(renderscript)
 DECLARE_CPP_INITMOD(profiler)
 DECLARE_CPP_INITMOD(profiler_inlined)
 DECLARE_CPP_INITMOD(runtime_api)
+DECLARE_CPP_INITMOD(scratch_arena)
 #ifdef WITH_METAL
 DECLARE_CPP_INITMOD(metal)
 #ifdef WITH_ARM
@@ -166,10 +174,13 @@ DECLARE_LL_INITMOD(ptx_compute_35)
 DECLARE_LL_INITMOD(x86_avx)
 DECLARE_LL_INITMOD(x86)
 DECLARE_LL_INITMOD(x86_sse41)
+DECLARE_CPP_INITMOD(x86_cpu_features)
+DECLARE_LL_INITMOD(x86_cpu_features)
 #else
 DECLARE_NO_INITMOD(x86_avx)
 DECLARE_NO_INITMOD(x86)
 DECLARE_NO_INITMOD(x86_sse41)
+DECLARE_NO_INITMOD(x86_cpu_features)
 #endif
 #ifdef WITH_MIPS
 DECLARE_LL_INITMOD(mips)
@@ -593,8 +604,11 @@ void add_underscores_to_posix_calls_on_windows(llvm::Module *m) {
     }
 }
 
-/** Create an llvm module containing the support code for a given target. */
-std::unique_ptr<llvm::Module> get_initial_module_for_target(Target t, llvm::LLVMContext *c, bool for_shared_jit_runtime, bool just_gpu) {
+namespace {
+
+/** Parse, link, and fix up all of the runtime modules needed for a
+ * given target. */
+std::unique_ptr<llvm::Module> assemble_initial_module_for_target(Target t, llvm::LLVMContext *c, bool for_shared_jit_runtime, bool just_gpu) {
     enum InitialModuleType {
         ModuleAOT,
         ModuleAOTNoRuntime,
@@ -701,16 +715,30 @@ std::unique_ptr<llvm::Module> get_initial_module_for_target(Target t, llvm::LLVM
             modules.push_back(get_initmod_gpu_device_selection(c, bits_64, debug));
             modules.push_back(get_initmod_tracing(c, bits_64, debug));
             modules.push_back(get_initmod_write_debug_image(c, bits_64, debug));
-            modules.push_back(get_initmod_posix_allocator(c, bits_64, debug));
+            if (t.os == Target::Linux) {
+                // Also supports huge pages for large allocations
+                modules.push_back(get_initmod_linux_allocator(c, bits_64, debug));
+            } else {
+                modules.push_back(get_initmod_posix_allocator(c, bits_64, debug));
+            }
             modules.push_back(get_initmod_posix_error_handler(c, bits_64, debug));
             modules.push_back(get_initmod_posix_print(c, bits_64, debug));
             modules.push_back(get_initmod_cache(c, bits_64, debug));
+            modules.push_back(get_initmod_scratch_arena(c, bits_64, debug));
+            modules.push_back(get_initmod_persistent_allocations(c, bits_64, debug));
             modules.push_back(get_initmod_to_string(c, bits_64, debug));
             modules.push_back(get_initmod_device_interface(c, bits_64, debug));
             modules.push_back(get_initmod_metadata(c, bits_64, debug));
             modules.push_back(get_initmod_profiler(c, bits_64, debug));
             modules.push_back(get_initmod_float16_t(c, bits_64, debug));
             modules.push_back(get_initmod_errors(c, bits_64, debug));
+            if (t.arch == Target::X86) {
+                modules.push_back(get_initmod_x86_cpu_features(c, bits_64, debug));
+                modules.push_back(get_initmod_x86_cpu_features_ll(c));
+                if (t.os == Target::Linux && t.bits == 64) {
+                    modules.push_back(get_initmod_linux_perf_counters(c, bits_64, debug));
+                }
+            }
         }
 
         if (module_type != ModuleJITShared) {
@@ -741,7 +769,7 @@ std::unique_ptr<llvm::Module> get_initial_module_for_target(Target t, llvm::LLVM
             if (t.has_feature(Target::AVX)) {
                 modules.push_back(get_initmod_x86_avx_ll(c));
             }
-            if (t.has_feature(Target::Profile)) {
+            if (t.features_any_of({Target::Profile, Target::ProfileCounters, Target::ProfileRoofline})) {
                 modules.push_back(get_initmod_profiler_inlined(c, bits_64, debug));
             }
         }
@@ -828,6 +856,55 @@ std::unique_ptr<llvm::Module> get_initial_module_for_target(Target t, llvm::LLVM
     return std::move(modules[0]);
 }
 
+// Assembled runtime modules, serialized as bitcode, keyed on the
+// target string and the flavor of runtime requested. llvm modules
+// can't be shared across contexts, and every compilation uses a
+// fresh context, so we keep the bitcode rather than the module.
+std::mutex initial_module_cache_lock;
+std::map<std::string, std::string> initial_module_cache;
+
+}
+
+/** Create an llvm module containing the support code for a given target. */
+std::unique_ptr<llvm::Module> get_initial_module_for_target(Target t, llvm::LLVMContext *c, bool for_shared_jit_runtime, bool just_gpu) {
+    // Parsing and linking the dozens of runtime modules is a fixed
+    // cost paid by every compilation, but the result depends only on
+    // the target and on the flavor of runtime requested. Assemble
+    // each one once, and thereafter just parse the single linked
+    // module into the caller's context.
+    std::string key = t.to_string();
+    if (for_shared_jit_runtime) {
+        key += "/shared";
+    }
+    if (just_gpu) {
+        key += "/gpu";
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(initial_module_cache_lock);
+        std::map<std::string, std::string>::const_iterator iter = initial_module_cache.find(key);
+        if (iter != initial_module_cache.end()) {
+            debug(2) << "Using cached initial module for " << key << "\n";
+            return parse_bitcode_file(iter->second, c, "halide_runtime");
+        }
+    }
+
+    std::unique_ptr<llvm::Module> module =
+        assemble_initial_module_for_target(t, c, for_shared_jit_runtime, just_gpu);
+
+    std::string bitcode;
+    {
+        llvm::raw_string_ostream stream(bitcode);
+        WriteBitcodeToFile(module.get(), stream);
+        stream.flush();
+    }
+
+    std::lock_guard<std::mutex> lock(initial_module_cache_lock);
+    initial_module_cache[key] = std::move(bitcode);
+
+    return module;
+}
+
 #ifdef WITH_PTX
 std::unique_ptr<llvm::Module> get_initial_module_for_ptx_device(Target target, llvm::LLVMContext *c) {
     std::vector<std::unique_ptr<llvm::Module>> modules;
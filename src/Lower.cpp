@@ -27,6 +27,7 @@
 #include "IRPrinter.h"
 #include "Memoization.h"
 #include "PartitionLoops.h"
+#include "PersistentAllocations.h"
 #include "Profiling.h"
 #include "Qualify.h"
 #include "RealizationOrder.h"
@@ -34,6 +35,7 @@
 #include "RemoveTrivialForLoops.h"
 #include "RemoveUndef.h"
 #include "ScheduleFunctions.h"
+#include "ScratchArenas.h"
 #include "SelectGPUAPI.h"
 #include "SkipStages.h"
 #include "SlidingWindow.h"
@@ -59,22 +61,55 @@ using std::map;
 using std::pair;
 using std::make_pair;
 
-Stmt lower(const vector<Function> &outputs, const string &pipeline_name, const Target &t, const vector<IRMutator *> &custom_passes) {
-
-    // Compute an environment
-    map<string, Function> env;
-    for (Function f : outputs) {
-        map<string, Function> more_funcs = find_transitive_calls(f);
-        env.insert(more_funcs.begin(), more_funcs.end());
+bool LoweringCache::valid_for(const vector<Function> &o) const {
+    if (outputs.empty() || outputs.size() != o.size()) {
+        return false;
+    }
+    for (size_t i = 0; i < o.size(); i++) {
+        if (!outputs[i].same_as(o[i])) {
+            return false;
+        }
+    }
+    // An unfrozen function could still have been given another
+    // update definition.
+    for (const pair<string, Function> &i : env) {
+        if (!i.second.frozen()) {
+            return false;
+        }
     }
+    return true;
+}
+
+Stmt lower(const vector<Function> &outputs, const string &pipeline_name, const Target &t,
+           const vector<IRMutator *> &custom_passes, LoweringCache *cache) {
+
+    LoweringCache fresh;
+    bool reuse = cache && cache->valid_for(outputs);
+    if (reuse) {
+        debug(1) << "Reusing the cached environment, realization order, and function value bounds\n";
+    } else {
+        if (!cache) {
+            cache = &fresh;
+        }
+        *cache = LoweringCache();
+        cache->outputs = outputs;
 
-    // Compute a realization order
-    vector<string> order = realization_order(outputs, env);
+        // Compute an environment
+        for (Function f : outputs) {
+            map<string, Function> more_funcs = find_transitive_calls(f);
+            cache->env.insert(more_funcs.begin(), more_funcs.end());
+        }
+
+        // Compute a realization order
+        cache->order = realization_order(outputs, cache->env);
+    }
+    const map<string, Function> &env = cache->env;
+    const vector<string> &order = cache->order;
 
     bool any_memoized = false;
 
     debug(1) << "Creating initial loop nests...\n";
-    Stmt s = schedule_functions(outputs, order, env, t, any_memoized);
+    Stmt s = schedule_functions(outputs, order, env, t, any_memoized, &cache->inlined_values);
     debug(2) << "Lowering after creating initial loop nests:\n" << s << '\n';
 
     if (any_memoized) {
@@ -95,8 +130,11 @@ Stmt lower(const vector<Function> &outputs, const string &pipeline_name, const T
 
     // Compute the maximum and minimum possible value of each
     // function. Used in later bounds inference passes.
-    debug(1) << "Computing bounds of each function's value\n";
-    FuncValueBounds func_bounds = compute_function_value_bounds(order, env);
+    if (!reuse) {
+        debug(1) << "Computing bounds of each function's value\n";
+        cache->func_bounds = compute_function_value_bounds(order, env);
+    }
+    const FuncValueBounds &func_bounds = cache->func_bounds;
 
     // The checks will be in terms of the symbols defined by bounds
     // inference.
@@ -221,9 +259,13 @@ Stmt lower(const vector<Function> &outputs, const string &pipeline_name, const T
     s = inject_early_frees(s);
     debug(2) << "Lowering after injecting early frees:\n" << s << "\n\n";
 
-    if (t.has_feature(Target::Profile)) {
+    if (t.features_any_of({Target::Profile, Target::ProfileCounters, Target::ProfileRoofline})) {
+        bool use_counters = t.has_feature(Target::ProfileCounters);
+        user_assert(!use_counters || (t.os == Target::Linux && t.arch == Target::X86 && t.bits == 64))
+            << "The profile_counters target feature is only supported on x86-64 Linux.\n";
+        bool count_ops = t.has_feature(Target::ProfileRoofline);
         debug(1) << "Injecting profiling...\n";
-        s = inject_profiling(s, pipeline_name);
+        s = inject_profiling(s, pipeline_name, use_counters, count_ops);
         debug(2) << "Lowering after injecting profiling:\n" << s << '\n';
     }
 
@@ -242,6 +284,15 @@ Stmt lower(const vector<Function> &outputs, const string &pipeline_name, const T
 
     s = remove_dead_allocations(s);
     s = remove_trivial_for_loops(s);
+
+    debug(1) << "Moving allocations in parallel loops into scratch arenas...\n";
+    s = use_scratch_arenas(s);
+
+    if (t.has_feature(Target::PersistentAllocations)) {
+        debug(1) << "Making allocations persistent...\n";
+        s = use_persistent_allocations(s, pipeline_name);
+    }
+
     s = simplify(s);
     debug(1) << "Lowering after final simplification:\n" << s << "\n\n";
 
@@ -7,6 +7,9 @@
  * Halide function using its schedule.
  */
 
+#include <map>
+
+#include "Bounds.h"
 #include "IR.h"
 #include "Target.h"
 
@@ -15,11 +18,42 @@ namespace Internal {
 
 class IRMutator;
 
+/** The results of the stages of lowering that depend only on the
+ * definitions of the functions in a pipeline, and not on their
+ * schedules. A function can't be redefined once it has been used by
+ * another function or by a pipeline, so these stay valid while the
+ * schedules are changed between calls to lower. */
+struct LoweringCache {
+    /** The outputs the rest of the cache was computed for. Empty if
+     * nothing has been cached yet. */
+    std::vector<Function> outputs;
+
+    /** All the functions called by the outputs, and the order in
+     * which they must be realized. */
+    std::map<std::string, Function> env;
+    std::vector<std::string> order;
+
+    /** The bounds of the values of each function. */
+    FuncValueBounds func_bounds;
+
+    /** The values of each function, with variable names qualified by
+     * the function name, as they are substituted in when the function
+     * is inlined. Filled in lazily as functions get inlined. */
+    std::map<std::string, std::vector<Expr>> inlined_values;
+
+    /** Check whether the contents of the cache may be used to lower
+     * the given outputs. */
+    EXPORT bool valid_for(const std::vector<Function> &outputs) const;
+};
+
 /** Given a halide function with a schedule, create a statement that
  * evaluates it. Automatically pulls in all the functions f depends
- * on. Some stages of lowering may be target-specific. */
+ * on. Some stages of lowering may be target-specific. If a cache is
+ * given, the schedule-independent results are taken from it when
+ * possible, and stored in it otherwise. */
 EXPORT Stmt lower(const std::vector<Function> &outputs, const std::string &pipeline_name, const Target &t,
-                  const std::vector<IRMutator *> &custom_passes = std::vector<IRMutator *>());
+                  const std::vector<IRMutator *> &custom_passes = std::vector<IRMutator *>(),
+                  LoweringCache *cache = nullptr);
 
 void lower_test();
 
@@ -425,6 +425,12 @@ private:
                                               key_info.generate_lookup(cache_key_name, computed_bounds_name, f.outputs(), op->name),
                                               cache_lookup_check);
 
+            // The cache in the runtime only understands the first
+            // four dimensions of a buffer.
+            user_assert(f.dimensions() <= 4)
+                << "Func " << f.name() << " has " << f.dimensions()
+                << " dimensions, but memoized Funcs may have at most four.\n";
+
             std::vector<Expr> computed_bounds_args;
             Expr null_handle = Call::make(Handle(), Call::null_handle, std::vector<Expr>(), Call::PureIntrinsic);
             computed_bounds_args.push_back(null_handle);
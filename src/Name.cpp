@@ -0,0 +1,109 @@
+#include <mutex>
+#include <tuple>
+#include <unordered_map>
+
+#include "Name.h"
+#include "Debug.h"
+#include "Error.h"
+
+namespace Halide {
+namespace Internal {
+
+namespace {
+
+// The table of interned names, split into shards by hash so that
+// threads lowering or compiling different pipelines at once rarely
+// contend for the same lock. Elements of an unordered_map never
+// move, so each entry can safely point back at its own key. The
+// shards are leaked so that Names held in static objects can still be
+// destroyed during exit.
+typedef std::unordered_map<std::string, NameContents> NameTable;
+
+struct NameTableShard {
+    std::mutex lock;
+    NameTable table;
+};
+
+const size_t name_table_shards = 64;
+
+NameTableShard &name_table_shard(size_t hash) {
+    static NameTableShard *shards = new NameTableShard[name_table_shards];
+    return shards[hash % name_table_shards];
+}
+
+}
+
+/* static */
+const NameContents *Name::intern(const std::string &s) {
+    if (s.empty()) {
+        return nullptr;
+    }
+
+    size_t hash = hash_of(s);
+    NameTableShard &shard = name_table_shard(hash);
+    std::lock_guard<std::mutex> lock(shard.lock);
+    NameTable::iterator iter = shard.table.find(s);
+    if (iter == shard.table.end()) {
+        iter = shard.table.emplace(std::piecewise_construct,
+                                   std::forward_as_tuple(s),
+                                   std::forward_as_tuple()).first;
+        iter->second.str = &(iter->first);
+        iter->second.hash = hash;
+    }
+    iter->second.ref_count++;
+    return &(iter->second);
+}
+
+/* static */
+void Name::release(const NameContents *c) {
+    // Dropping a reference that isn't the last one doesn't need the
+    // lock. The final reference is only ever dropped with the shard's
+    // lock held, which is also the only place a reference can be
+    // acquired through the table, so an entry can't be revived while
+    // it is being erased.
+    int count = c->ref_count;
+    while (count > 1) {
+        if (c->ref_count.compare_exchange_weak(count, count - 1)) {
+            return;
+        }
+    }
+
+    NameTableShard &shard = name_table_shard(c->hash);
+    std::lock_guard<std::mutex> lock(shard.lock);
+    if (--(c->ref_count) == 0) {
+        shard.table.erase(*(c->str));
+    }
+}
+
+/* static */
+const std::string &Name::empty_string() {
+    static std::string *empty = new std::string;
+    return *empty;
+}
+
+void name_test() {
+    Name a("f.s0.x.x_inner"), b(std::string("f.s0.x.x_inner")), c("f.s0.x.x_outer");
+    internal_assert(a == b && a.same_as(b)) << "Names with the same spelling should be identical\n";
+    internal_assert(a != c) << "Names with different spellings should differ\n";
+    internal_assert(a.hash() == b.hash()) << "Equal names should hash equally\n";
+    internal_assert(a < c && !(c < a) && !(a < b)) << "Names should be ordered by spelling\n";
+    internal_assert(a == "f.s0.x.x_inner" && a == std::string("f.s0.x.x_inner"));
+    internal_assert(a + ".min" == "f.s0.x.x_inner.min");
+
+    Name empty, also_empty("");
+    internal_assert(empty.empty() && empty == also_empty && empty.str() == "");
+
+    {
+        // An entry dropped by all of its Names is interned afresh.
+        Name d("name_test_temporary");
+        Name e = d;
+        internal_assert(d.same_as(e));
+    }
+    Name f("name_test_temporary");
+    internal_assert(f.str() == "name_test_temporary");
+
+    debug(0) << "Name test passed\n";
+}
+
+}
+}
@@ -0,0 +1,180 @@
+#ifndef HALIDE_NAME_H
+#define HALIDE_NAME_H
+
+/** \file
+ * Defines Name, an interned string used to identify variables, lets,
+ * loops and realizations in the IR.
+ */
+
+#include <atomic>
+#include <functional>
+#include <iostream>
+#include <string>
+
+#include "Util.h"
+
+namespace Halide {
+namespace Internal {
+
+/** The shared, reference-counted entry in the global name table that
+ * every Name with the same spelling points to. */
+struct NameContents {
+    mutable std::atomic<int> ref_count;
+    size_t hash;
+    const std::string *str;
+    NameContents() : ref_count(0), hash(0), str(nullptr) {}
+};
+
+/** An interned string. All Names with the same spelling share a
+ * single entry in a global table, so comparing two Names for equality
+ * or hashing one is a pointer operation rather than a walk over the
+ * characters. Loop and let names like "f.s0.x.x_inner.__block_id_x"
+ * get long and share long prefixes, so this matters for the symbol
+ * tables (see \ref Scope) that lowering consults at every Variable.
+ *
+ * A Name converts implicitly to and from std::string, so it can be
+ * used anywhere a const std::string & is expected. Constructing one
+ * from a string takes the lock on one shard of the global table,
+ * chosen by the hash of the spelling; copying one takes no lock. Entries are freed when the last Name referring to them goes
+ * away. The empty string is represented without a table entry. */
+class Name {
+    const NameContents *contents;
+
+    EXPORT static const NameContents *intern(const std::string &s);
+    EXPORT static void release(const NameContents *c);
+    EXPORT static const std::string &empty_string();
+
+public:
+    Name() : contents(nullptr) {}
+
+    Name(const std::string &s) : contents(intern(s)) {}
+
+    Name(const char *s) : contents(s ? intern(std::string(s)) : nullptr) {}
+
+    Name(const Name &other) : contents(other.contents) {
+        if (contents) {
+            contents->ref_count++;
+        }
+    }
+
+    Name(Name &&other) : contents(other.contents) {
+        other.contents = nullptr;
+    }
+
+    ~Name() {
+        if (contents) {
+            release(contents);
+        }
+    }
+
+    Name &operator=(const Name &other) {
+        if (other.contents == contents) return *this;
+        if (other.contents) {
+            other.contents->ref_count++;
+        }
+        if (contents) {
+            release(contents);
+        }
+        contents = other.contents;
+        return *this;
+    }
+
+    Name &operator=(Name &&other) {
+        std::swap(contents, other.contents);
+        return *this;
+    }
+
+    /** The spelling of this name. */
+    const std::string &str() const {
+        return contents ? *(contents->str) : empty_string();
+    }
+
+    operator const std::string &() const {
+        return str();
+    }
+
+    const char *c_str() const {
+        return str().c_str();
+    }
+
+    size_t size() const {
+        return str().size();
+    }
+
+    bool empty() const {
+        return contents == nullptr;
+    }
+
+    /** A hash of the spelling, computed once when the name was
+     * interned. It depends only on the characters, so containers
+     * keyed on Names iterate in the same order from run to run. */
+    size_t hash() const {
+        return contents ? contents->hash : 0;
+    }
+
+    /** The hash a Name with the given (non-empty) spelling has, for
+     * looking names up by a string without interning it. */
+    static size_t hash_of(const std::string &s) {
+        return std::hash<std::string>()(s);
+    }
+
+    /** Two names are equal iff they refer to the same table entry. */
+    bool same_as(const Name &other) const {
+        return contents == other.contents;
+    }
+};
+
+inline bool operator==(const Name &a, const Name &b) {
+    return a.same_as(b);
+}
+
+inline bool operator!=(const Name &a, const Name &b) {
+    return !a.same_as(b);
+}
+
+/** Names are ordered by their spelling, so that sorted containers of
+ * Names behave the same as sorted containers of strings. */
+inline bool operator<(const Name &a, const Name &b) {
+    return !a.same_as(b) && a.str() < b.str();
+}
+
+/** Comparisons against strings that have not been interned. */
+// @{
+inline bool operator==(const Name &a, const std::string &b) {return a.str() == b;}
+inline bool operator==(const std::string &a, const Name &b) {return a == b.str();}
+inline bool operator==(const Name &a, const char *b) {return a.str() == b;}
+inline bool operator==(const char *a, const Name &b) {return a == b.str();}
+inline bool operator!=(const Name &a, const std::string &b) {return a.str() != b;}
+inline bool operator!=(const std::string &a, const Name &b) {return a != b.str();}
+inline bool operator!=(const Name &a, const char *b) {return a.str() != b;}
+inline bool operator!=(const char *a, const Name &b) {return a != b.str();}
+// @}
+
+/** Concatenation produces a plain (uninterned) string. */
+// @{
+inline std::string operator+(const Name &a, const Name &b) {return a.str() + b.str();}
+inline std::string operator+(const Name &a, const std::string &b) {return a.str() + b;}
+inline std::string operator+(const std::string &a, const Name &b) {return a + b.str();}
+inline std::string operator+(const Name &a, const char *b) {return a.str() + b;}
+inline std::string operator+(const char *a, const Name &b) {return a + b.str();}
+inline std::string operator+(const Name &a, char b) {return a.str() + b;}
+// @}
+
+inline std::ostream &operator<<(std::ostream &stream, const Name &name) {
+    return stream << name.str();
+}
+
+/** A hash functor for using Names as keys in unordered containers. */
+struct NameHash {
+    size_t operator()(const Name &name) const {
+        return name.hash();
+    }
+};
+
+/** Check the interning and comparison semantics of Name. */
+EXPORT void name_test();
+
+}
+}
+
+#endif
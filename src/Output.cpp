@@ -81,10 +81,11 @@ void compile_module_to_llvm(const Module &module,
     compile_llvm_module_to_llvm_assembly(*llvm, llvm_assembly_filename);
 }
 
-void compile_module_to_html(const Module &module, std::string filename) {
+void compile_module_to_html(const Module &module, std::string filename,
+                            const halide_profiler_pipeline_stats *profile) {
     if (filename.empty()) filename = module.name() + ".html";
 
-    Internal::print_to_html(filename, module);
+    Internal::print_to_html(filename, module, profile);
 }
 
 void compile_module_to_text(const Module &module, std::string filename) {
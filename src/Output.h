@@ -48,8 +48,11 @@ EXPORT void compile_module_to_c(const Module &module,
 // @}
 
 /** Output the module to HTML. The default filename is the name of the
- * module with the extension .html. */
-EXPORT void compile_module_to_html(const Module &module, std::string filename = "");
+ * module with the extension .html. If profile is what the profiler
+ * measured for a run of this module, the HTML is annotated with the
+ * time and memory of each Func. */
+EXPORT void compile_module_to_html(const Module &module, std::string filename = "",
+                                   const halide_profiler_pipeline_stats *profile = nullptr);
 
 /** Output the module to a text statement file. The default filename
  * is the name of the module with the extension .stmt. */
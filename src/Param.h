@@ -354,6 +354,13 @@ public:
     EXPORT Expr operator()(Expr x, Expr y, Expr z, Expr w) const;
     EXPORT Expr operator()(std::vector<Expr>) const;
     EXPORT Expr operator()(std::vector<Var>) const;
+
+    template <typename... Args>
+    NO_INLINE typename std::enable_if<Internal::all_are_convertible<Expr, Args...>::value, Expr>::type
+    operator()(Expr x, Expr y, Expr z, Expr w, Expr v, Args... rest) const {
+        std::vector<Expr> args = {x, y, z, w, v, rest...};
+        return (*this)(args);
+    }
     // @}
 
     /** Treating the image parameter as an Expr is equivalent to call
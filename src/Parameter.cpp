@@ -21,9 +21,9 @@ struct ParameterContents {
     uint64_t data;
     uint64_t default_val;
     int host_alignment;
-    Expr min_constraint[4];
-    Expr extent_constraint[4];
-    Expr stride_constraint[4];
+    Expr min_constraint[HALIDE_BUFFER_MAX_DIMENSIONS];
+    Expr extent_constraint[HALIDE_BUFFER_MAX_DIMENSIONS];
+    Expr stride_constraint[HALIDE_BUFFER_MAX_DIMENSIONS];
     Expr min_value, max_value;
     ParameterContents(Type t, bool b, int d, const std::string &n, bool e, bool r)
         : type(t), is_buffer(b), dimensions(d), is_explicit_name(e), is_registered(r),
@@ -59,6 +59,8 @@ void Parameter::check_is_scalar() const {
 void Parameter::check_dim_ok(int dim) const {
     user_assert(dim >= 0 && dim < dimensions())
         << "Dimension " << dim << " is not in the range [0, " << dimensions() - 1 << "]\n";
+    user_assert(dim < HALIDE_BUFFER_MAX_DIMENSIONS)
+        << "Buffers may have at most " << HALIDE_BUFFER_MAX_DIMENSIONS << " dimensions\n";
 }
 
 Parameter::Parameter() : contents(nullptr) {
@@ -0,0 +1,60 @@
+#include "PersistentAllocations.h"
+#include "CodeGen_Internal.h"
+#include "IRMutator.h"
+#include "IROperator.h"
+
+namespace Halide {
+namespace Internal {
+
+using std::string;
+
+class UsePersistentAllocations : public IRMutator {
+    using IRMutator::visit;
+
+    const string &pipeline_name;
+
+    void visit(const For *op) {
+        if (op->for_type == ForType::Parallel ||
+            (op->device_api != DeviceAPI::Host &&
+             op->device_api != DeviceAPI::Parent)) {
+            // Allocations in here may be live in several tasks at
+            // once, or aren't on the heap.
+            stmt = op;
+        } else {
+            IRMutator::visit(op);
+        }
+    }
+
+    void visit(const Allocate *op) {
+        IRMutator::visit(op);
+
+        if (op->new_expr.defined()) {
+            return;
+        }
+
+        const Allocate *alloc = stmt.as<Allocate>();
+        internal_assert(alloc);
+
+        // Leave the allocations that will go on the stack alone.
+        Expr size = heap_allocation_bytes(alloc);
+        if (!size.defined()) {
+            return;
+        }
+
+        Expr site = StringImm::make(pipeline_name + "." + alloc->name);
+        Expr new_expr = Call::make(type_of<uint8_t *>(), "halide_persistent_malloc",
+                                   {site, size}, Call::Extern);
+        stmt = Allocate::make(alloc->name, alloc->type, alloc->extents, alloc->condition,
+                              alloc->body, new_expr, "halide_persistent_free");
+    }
+
+public:
+    UsePersistentAllocations(const string &p) : pipeline_name(p) {}
+};
+
+Stmt use_persistent_allocations(Stmt s, const string &pipeline_name) {
+    return UsePersistentAllocations(pipeline_name).mutate(s);
+}
+
+}
+}
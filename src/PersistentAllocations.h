@@ -0,0 +1,26 @@
+#ifndef HALIDE_PERSISTENT_ALLOCATIONS_H
+#define HALIDE_PERSISTENT_ALLOCATIONS_H
+
+/** \file
+ * Defines the lowering pass that lets heap allocations persist
+ * between calls to a pipeline.
+ */
+
+#include "IR.h"
+
+namespace Halide {
+namespace Internal {
+
+/** Make the heap allocations outside of parallel loops call
+ * halide_persistent_malloc and halide_persistent_free, naming each
+ * allocation site after the pipeline and the buffer. If the caller
+ * attached its user_context with halide_persistent_allocations_attach,
+ * the runtime keeps the memory between calls. Allocations in parallel
+ * loops may be live several times at once, and use scratch arenas
+ * instead. Must be called after use_scratch_arenas. */
+Stmt use_persistent_allocations(Stmt s, const std::string &pipeline_name);
+
+}
+}
+
+#endif
@@ -1,7 +1,12 @@
 #include <algorithm>
+#include <exception>
+#include <map>
+#include <mutex>
+#include <thread>
 
 #include "Pipeline.h"
 #include "Argument.h"
+#include "DirtyRegions.h"
 #include "Func.h"
 #include "IRVisitor.h"
 #include "LLVM_Headers.h"
@@ -49,7 +54,12 @@ struct PipelineContents {
     JITModule jit_module;
     Target jit_target;
 
-    /** Clear all cached state */
+    // Cached results of lowering that don't depend on the
+    // schedule. Schedule changes don't invalidate these, so they are
+    // not cleared by invalidate_cache.
+    LoweringCache lowering_cache;
+
+    /** Clear all cached state that depends on the schedule */
     void invalidate_cache() {
         module = Module("", Target());
         jit_module = JITModule();
@@ -63,6 +73,62 @@ struct PipelineContents {
     // JIT custom overrides
     JITHandlers jit_handlers;
 
+    // A copy of what the profiler measured for the last run of the
+    // jit-compiled pipeline, if it was compiled for profiling. The
+    // copies of the names are what the stats point to.
+    bool has_last_profile = false;
+    halide_profiler_pipeline_stats last_profile;
+    vector<halide_profiler_func_stats> last_profile_funcs;
+    vector<string> last_profile_names;
+
+    // Copy what the profiler measured for this pipeline out of its
+    // state, before the state is reset. The profiler names a pipeline
+    // after the function it was lowered for. If there's no such
+    // pipeline, but only one ran, it's assumed to be this one.
+    void save_last_profile(halide_profiler_state *state,
+                           void (*lock)(halide_mutex *), void (*unlock)(halide_mutex *)) {
+        has_last_profile = false;
+        lock(&state->lock);
+        const halide_profiler_pipeline_stats *found = nullptr;
+        int ran = 0;
+        for (halide_profiler_pipeline_stats *p = state->pipelines; p;
+             p = (halide_profiler_pipeline_stats *)(p->next)) {
+            if (!p->runs) continue;
+            ran++;
+            for (const LoweredFunc &f : module.functions) {
+                if (f.name == p->name) found = p;
+            }
+        }
+        if (!found && ran == 1) {
+            for (halide_profiler_pipeline_stats *p = state->pipelines; p;
+                 p = (halide_profiler_pipeline_stats *)(p->next)) {
+                if (p->runs) found = p;
+            }
+        }
+        if (found) {
+            has_last_profile = true;
+            last_profile = *found;
+            last_profile_funcs.assign(found->funcs, found->funcs + found->num_funcs);
+            last_profile_names.clear();
+            last_profile_names.reserve(found->num_funcs + 1);
+            last_profile_names.push_back(found->name ? found->name : "");
+            for (int i = 0; i < found->num_funcs; i++) {
+                const char *name = found->funcs[i].name;
+                last_profile_names.push_back(name ? name : "");
+            }
+        }
+        unlock(&state->lock);
+
+        if (has_last_profile) {
+            last_profile.name = last_profile_names[0].c_str();
+            last_profile.funcs = last_profile_funcs.data();
+            last_profile.next = nullptr;
+            for (size_t i = 0; i < last_profile_funcs.size(); i++) {
+                last_profile_funcs[i].name = last_profile_names[i + 1].c_str();
+            }
+        }
+    }
+
     /** The user context that's used when jitting. This is not
      * settable by user code, but is reserved for internal use.  Note
      * that this is an Argument + Parameter (rather than a
@@ -143,6 +209,38 @@ vector<Func> Pipeline::outputs() const {
     return funcs;
 }
 
+namespace {
+
+void emit_llvm_module(llvm::Module &llvm_module, const Outputs &output_files, const Target &target) {
+    if (!output_files.object_name.empty()) {
+        if (target.arch == Target::PNaCl) {
+            compile_llvm_module_to_llvm_bitcode(llvm_module, output_files.object_name);
+        } else {
+            compile_llvm_module_to_object(llvm_module, output_files.object_name);
+        }
+    }
+    if (!output_files.assembly_name.empty()) {
+        if (target.arch == Target::PNaCl) {
+            compile_llvm_module_to_llvm_assembly(llvm_module, output_files.assembly_name);
+        } else {
+            compile_llvm_module_to_assembly(llvm_module, output_files.assembly_name);
+        }
+    }
+    if (!output_files.bitcode_name.empty()) {
+        compile_llvm_module_to_llvm_bitcode(llvm_module, output_files.bitcode_name);
+    }
+}
+
+// Targets that differ only in the x86 instruction set features can be
+// combined into one object.
+Target without_cpu_features(Target t) {
+    t.set_features({Target::SSE41, Target::AVX, Target::AVX2,
+                    Target::FMA, Target::FMA4, Target::F16C}, false);
+    return t;
+}
+
+}
+
 void Pipeline::compile_to(const Outputs &output_files,
                           const vector<Argument> &args,
                           const string &fn_name,
@@ -159,25 +257,73 @@ void Pipeline::compile_to(const Outputs &output_files,
     llvm::LLVMContext context;
     std::unique_ptr<llvm::Module> llvm_module(compile_module_to_llvm_module(m, context));
 
-    if (!output_files.object_name.empty()) {
-        if (target.arch == Target::PNaCl) {
-            compile_llvm_module_to_llvm_bitcode(*llvm_module, output_files.object_name);
-        } else {
-            compile_llvm_module_to_object(*llvm_module, output_files.object_name);
-        }
+    emit_llvm_module(*llvm_module, output_files, target);
+}
+
+void Pipeline::compile_to(const Outputs &output_files,
+                          const vector<Argument> &args,
+                          const string &fn_name,
+                          const vector<Target> &targets) {
+    user_assert(!targets.empty()) << "Must specify at least one target.\n";
+    if (targets.size() == 1) {
+        compile_to(output_files, args, fn_name, targets[0]);
+        return;
     }
-    if (!output_files.assembly_name.empty()) {
-        if (target.arch == Target::PNaCl) {
-            compile_llvm_module_to_llvm_assembly(*llvm_module, output_files.assembly_name);
-        } else {
-            compile_llvm_module_to_assembly(*llvm_module, output_files.assembly_name);
+
+    user_assert(defined()) << "Can't compile undefined Pipeline.\n";
+
+    for (Function f : contents.ptr->outputs) {
+        user_assert(f.has_pure_definition() || f.has_extern_definition())
+            << "Can't compile undefined Func.\n";
+    }
+
+    const Target &fallback = targets.back();
+    user_assert(fallback.arch == Target::X86)
+        << "Compiling for multiple targets is only supported on x86.\n";
+    user_assert(!fallback.has_feature(Target::JIT))
+        << "Can't compile for multiple targets when jitting.\n";
+    user_assert(!fallback.has_feature(Target::CPlusPlusMangling))
+        << "Compiling for multiple targets does not support C++ name mangling.\n";
+    for (const Target &t : targets) {
+        user_assert(without_cpu_features(t) == without_cpu_features(fallback))
+            << "When compiling for multiple targets, the targets may only differ in "
+            << "their x86 instruction set features, but " << t.to_string()
+            << " and " << fallback.to_string() << " differ in other ways.\n";
+    }
+
+    // The object exports the dispatcher under the given name, so the
+    // variants get the target appended to theirs.
+    vector<string> namespaces;
+    string simple_name = extract_namespaces(fn_name, namespaces);
+    vector<string> variant_names;
+    for (const Target &t : targets) {
+        string suffix = t.to_string();
+        replace_all(suffix, "-", "_");
+        variant_names.push_back(simple_name + "_" + suffix);
+        for (size_t i = 0; i + 1 < variant_names.size(); i++) {
+            user_assert(variant_names[i] != variant_names.back())
+                << "Target " << t.to_string() << " was specified more than once.\n";
         }
     }
-    if (!output_files.bitcode_name.empty()) {
-        compile_llvm_module_to_llvm_bitcode(*llvm_module, output_files.bitcode_name);
+
+    llvm::LLVMContext context;
+    vector<std::unique_ptr<llvm::Module>> llvm_modules;
+    for (size_t i = 0; i < targets.size(); i++) {
+        // Only the fallback carries a copy of the runtime.
+        Target t = targets[i];
+        if (i + 1 < targets.size()) {
+            t.set_feature(Target::NoRuntime);
+        }
+        string variant_fn_name = fn_name.substr(0, fn_name.size() - simple_name.size()) + variant_names[i];
+        Module m = compile_to_module(args, variant_fn_name, t);
+        llvm_modules.push_back(compile_module_to_llvm_module(m, context));
     }
-}
 
+    std::unique_ptr<llvm::Module> llvm_module =
+        link_multitarget_llvm_modules(llvm_modules, targets, variant_names, simple_name);
+
+    emit_llvm_module(*llvm_module, output_files, fallback);
+}
 
 void Pipeline::compile_to_bitcode(const string &filename,
                                   const vector<Argument> &args,
@@ -227,13 +373,19 @@ void Pipeline::print_loop_nest() {
     std::cerr << Halide::Internal::print_loop_nest(contents.ptr->outputs);
 }
 
+const halide_profiler_pipeline_stats *Pipeline::last_profile() const {
+    user_assert(defined()) << "Can't get the profile of an undefined Pipeline.\n";
+    return contents.ptr->has_last_profile ? &contents.ptr->last_profile : nullptr;
+}
+
 void Pipeline::compile_to_lowered_stmt(const string &filename,
                                        const vector<Argument> &args,
                                        StmtOutputFormat fmt,
-                                       const Target &target) {
+                                       const Target &target,
+                                       const halide_profiler_pipeline_stats *profile) {
     Module m = compile_to_module(args, "", target);
     if (fmt == HTML) {
-        compile_module_to_html(m, filename);
+        compile_module_to_html(m, filename, profile);
     } else {
         compile_module_to_text(m, filename);
     }
@@ -500,7 +652,8 @@ Module Pipeline::compile_to_module(const vector<Argument> &args,
             custom_passes.push_back(p.pass);
         }
 
-        private_body = lower(contents.ptr->outputs, fn_name, target, custom_passes);
+        private_body = lower(contents.ptr->outputs, fn_name, target, custom_passes,
+                             &contents.ptr->lowering_cache);
     }
 
     std::vector<std::string> namespaces;
@@ -1087,11 +1240,23 @@ void Pipeline::realize(Realization dst, const Target &t) {
     debug(2) << "Back from jitted function. Exit status was " << exit_status << "\n";
 
     // If we're profiling, report runtimes and reset profiler stats.
-    if (target.has_feature(Target::Profile)) {
+    if (target.features_any_of({Target::Profile, Target::ProfileCounters, Target::ProfileRoofline})) {
         JITModule::Symbol report_sym =
             contents.ptr->jit_module.find_symbol_by_name("halide_profiler_report");
         JITModule::Symbol reset_sym =
             contents.ptr->jit_module.find_symbol_by_name("halide_profiler_reset");
+        JITModule::Symbol state_sym =
+            contents.ptr->jit_module.find_symbol_by_name("halide_profiler_get_state");
+        JITModule::Symbol lock_sym =
+            contents.ptr->jit_module.find_symbol_by_name("halide_mutex_lock");
+        JITModule::Symbol unlock_sym =
+            contents.ptr->jit_module.find_symbol_by_name("halide_mutex_unlock");
+        if (state_sym.address && lock_sym.address && unlock_sym.address) {
+            halide_profiler_state *(*state_fn_ptr)() = (halide_profiler_state *(*)())(state_sym.address);
+            contents.ptr->save_last_profile(state_fn_ptr(),
+                                            (void (*)(halide_mutex *))(lock_sym.address),
+                                            (void (*)(halide_mutex *))(unlock_sym.address));
+        }
         if (report_sym.address && reset_sym.address) {
             void *uc = jit_context.user_context_param.get_scalar<void *>();
             void (*report_fn_ptr)(void *) = (void (*)(void *))(report_sym.address);
@@ -1105,17 +1270,15 @@ void Pipeline::realize(Realization dst, const Target &t) {
     jit_context.finalize(exit_status);
 }
 
-void Pipeline::infer_input_bounds(Realization dst) {
-
-    Target target = get_jit_target_from_environment();
-
+vector<Buffer> Pipeline::infer_input_buffers(Realization dst, const Target &target) {
     vector<const void *> args = prepare_jit_call_arguments(dst, target);
 
     struct TrackedBuffer {
-        // The query buffer.
-        buffer_t query;
+        // The query buffer. It has room for every dimension, in case
+        // the input has more than four.
+        halide_buffer_nd_t query;
         // A backup copy of it to test if it changed.
-        buffer_t orig;
+        halide_buffer_nd_t orig;
     };
     vector<TrackedBuffer> tracked_buffers(args.size());
 
@@ -1124,14 +1287,16 @@ void Pipeline::infer_input_bounds(Realization dst) {
         if (args[i] == nullptr) {
             query_indices.push_back(i);
             memset(&tracked_buffers[i], 0, sizeof(TrackedBuffer));
-            args[i] = &tracked_buffers[i].query;
+            args[i] = &tracked_buffers[i].query.buf;
         }
     }
 
+    vector<Buffer> result(contents.ptr->inferred_args.size());
+
     // No need to query if all the inputs are bound already.
     if (query_indices.empty()) {
         debug(1) << "All inputs are bound. No need for bounds inference\n";
-        return;
+        return result;
     }
 
     JITFuncCallContext jit_context(jit_handlers(), contents.ptr->user_context_arg.param);
@@ -1152,7 +1317,7 @@ void Pipeline::infer_input_bounds(Realization dst) {
 
         // Check if there were any changed
         for (TrackedBuffer &tb : tracked_buffers) {
-            if (memcmp(&tb.query, &tb.orig, sizeof(buffer_t))) {
+            if (memcmp(&tb.query, &tb.orig, sizeof(halide_buffer_nd_t))) {
                 changed = true;
             }
         }
@@ -1174,7 +1339,8 @@ void Pipeline::infer_input_bounds(Realization dst) {
     for (size_t i : query_indices) {
         InferredArgument ia = contents.ptr->inferred_args[i];
         internal_assert(!ia.param.get_buffer().defined());
-        buffer_t buf = tracked_buffers[i].query;
+        halide_buffer_nd_t nd_buf = tracked_buffers[i].query;
+        const buffer_t &buf = nd_buf.buf;
 
         Internal::debug(1) << "Inferred bounds for " << ia.param.name() << ": ("
                            << buf.min[0] << ","
@@ -1186,34 +1352,471 @@ void Pipeline::infer_input_bounds(Realization dst) {
                            << buf.min[2] + buf.extent[2] << ","
                            << buf.min[3] + buf.extent[3] << ")\n";
 
+        auto min = [&](int d) {return d < 4 ? buf.min[d] : nd_buf.min[d - 4];};
+        auto extent = [&](int d) {return d < 4 ? buf.extent[d] : nd_buf.extent[d - 4];};
+        auto stride = [&](int d) {return d < 4 ? buf.stride[d] : nd_buf.stride[d - 4];};
+
         // Figure out how much memory to allocate for this buffer
         size_t min_idx = 0, max_idx = 0;
-        for (int d = 0; d < 4; d++) {
-            if (buf.stride[d] > 0) {
-                min_idx += buf.min[d] * buf.stride[d];
-                max_idx += (buf.min[d] + buf.extent[d] - 1) * buf.stride[d];
+        for (int d = 0; d < HALIDE_BUFFER_MAX_DIMENSIONS; d++) {
+            if (stride(d) > 0) {
+                min_idx += min(d) * stride(d);
+                max_idx += (min(d) + extent(d) - 1) * stride(d);
             } else {
-                max_idx += buf.min[d] * buf.stride[d];
-                min_idx += (buf.min[d] + buf.extent[d] - 1) * buf.stride[d];
+                max_idx += min(d) * stride(d);
+                min_idx += (min(d) + extent(d) - 1) * stride(d);
             }
         }
         size_t total_size = (max_idx - min_idx);
         while (total_size & 0x1f) total_size++;
 
         // Allocate enough memory with the right dimensionality.
-        Buffer buffer(ia.param.type(), total_size,
-                      buf.extent[1] > 0 ? 1 : 0,
-                      buf.extent[2] > 0 ? 1 : 0,
-                      buf.extent[3] > 0 ? 1 : 0);
+        vector<int32_t> sizes(1, (int32_t)total_size);
+        for (int d = 1; d < HALIDE_BUFFER_MAX_DIMENSIONS && extent(d) > 0; d++) {
+            sizes.push_back(1);
+        }
+        Buffer buffer(ia.param.type(), sizes);
 
         // Rewrite the buffer fields to match the ones returned
-        for (int d = 0; d < 4; d++) {
-            buffer.raw_buffer()->min[d] = buf.min[d];
-            buffer.raw_buffer()->stride[d] = buf.stride[d];
-            buffer.raw_buffer()->extent[d] = buf.extent[d];
+        halide_buffer_nd_t *dst = buffer.raw_nd_buffer();
+        for (int d = 0; d < HALIDE_BUFFER_MAX_DIMENSIONS; d++) {
+            if (d < 4) {
+                dst->buf.min[d] = buf.min[d];
+                dst->buf.stride[d] = buf.stride[d];
+                dst->buf.extent[d] = buf.extent[d];
+            } else {
+                dst->min[d - 4] = nd_buf.min[d - 4];
+                dst->stride[d - 4] = nd_buf.stride[d - 4];
+                dst->extent[d - 4] = nd_buf.extent[d - 4];
+            }
+        }
+        result[i] = buffer;
+    }
+
+    return result;
+}
+
+namespace {
+// Keeps the blocks freed by the items of realize_batch, by size, to
+// hand to later items asking for the same size. They're released
+// once no batch is running.
+struct BatchAllocations {
+    std::mutex mutex;
+    std::multimap<size_t, void *> free_blocks;
+    int active_batches = 0;
+
+    static BatchAllocations &get() {
+        static BatchAllocations allocations;
+        return allocations;
+    }
+
+    // Aligned like the runtime's default allocator, with the size
+    // stored before the block so it can be filed when it's freed.
+    static void *batch_malloc(void *, size_t x) {
+        BatchAllocations &a = get();
+        {
+            std::lock_guard<std::mutex> lock(a.mutex);
+            auto it = a.free_blocks.find(x);
+            if (it != a.free_blocks.end()) {
+                void *ptr = it->second;
+                a.free_blocks.erase(it);
+                return ptr;
+            }
+        }
+        const size_t alignment = 128;
+        void *orig = malloc(x + alignment + 2 * sizeof(void *));
+        if (orig == nullptr) {
+            return nullptr;
+        }
+        void *ptr = (void *)(((size_t)orig + alignment + 2 * sizeof(void *) - 1) & ~(alignment - 1));
+        ((void **)ptr)[-1] = orig;
+        ((size_t *)ptr)[-2] = x;
+        return ptr;
+    }
+
+    static void batch_free(void *, void *ptr) {
+        BatchAllocations &a = get();
+        std::lock_guard<std::mutex> lock(a.mutex);
+        a.free_blocks.insert({((size_t *)ptr)[-2], ptr});
+    }
+
+    void begin_batch() {
+        std::lock_guard<std::mutex> lock(mutex);
+        active_batches++;
+    }
+
+    void end_batch() {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (--active_batches == 0) {
+            for (auto it : free_blocks) {
+                free(((void **)it.second)[-1]);
+            }
+            free_blocks.clear();
         }
-        ia.param.set_buffer(buffer);
     }
+};
+
+struct BatchClosure {
+    int (*argv_function)(const void **);
+    vector<vector<const void *>> *args;
+    vector<int> *exit_status;
+};
+
+int run_batch_item(void *user_context, int idx, uint8_t *closure) {
+    BatchClosure *c = (BatchClosure *)closure;
+    (*c->exit_status)[idx] = c->argv_function(&((*c->args)[idx][0]));
+    return 0;
+}
+}
+
+void Pipeline::realize_batch(const vector<BatchItem> &items, const Target &t) {
+    Target target = t;
+    user_assert(defined()) << "Can't realize an undefined Pipeline\n";
+    if (items.empty()) return;
+
+    if (target.os == Target::OSUnknown) {
+        if (contents.ptr->jit_module.compiled()) {
+            target = contents.ptr->jit_target;
+        } else {
+            target = get_jit_target_from_environment();
+        }
+    }
+
+    // Marshal the arguments of every item up front.
+    vector<vector<const void *>> args(items.size());
+    for (size_t i = 0; i < items.size(); i++) {
+        args[i] = prepare_jit_call_arguments(Realization(items[i].outputs), target);
+        for (const auto &input : items[i].inputs) {
+            bool found = false;
+            for (size_t j = 0; j < contents.ptr->inferred_args.size(); j++) {
+                const InferredArgument &arg = contents.ptr->inferred_args[j];
+                if (arg.param.defined() && arg.param.is_buffer() &&
+                    arg.param.name() == input.first) {
+                    user_assert(input.second.type() == arg.param.type())
+                        << "Can't bind ImageParam " << input.first
+                        << " of type " << arg.param.type()
+                        << " to Buffer " << input.second.name()
+                        << " of type " << input.second.type() << "\n";
+                    args[i][j] = input.second.raw_buffer();
+                    found = true;
+                }
+            }
+            user_assert(found)
+                << "Item " << i << " of a batch has a Buffer for " << input.first
+                << ", which is not an ImageParam of the Pipeline\n";
+        }
+        for (size_t j = 0; j < contents.ptr->inferred_args.size(); j++) {
+            const InferredArgument &arg = contents.ptr->inferred_args[j];
+            if (arg.param.defined()) {
+                user_assert(args[i][j] != nullptr)
+                    << "Can't realize item " << i << " of a batch because ImageParam "
+                    << arg.param.name() << " is not bound to a Buffer\n";
+            }
+        }
+    }
+
+    // Reuse allocations between items, unless there's a custom
+    // allocator.
+    JITHandlers handlers = jit_handlers();
+    bool reuse_allocations = !handlers.custom_malloc && !handlers.custom_free;
+    if (reuse_allocations) {
+        handlers.custom_malloc = BatchAllocations::batch_malloc;
+        handlers.custom_free = BatchAllocations::batch_free;
+        BatchAllocations::get().begin_batch();
+    }
+
+    JITFuncCallContext jit_context(handlers, contents.ptr->user_context_arg.param);
+
+    // Run all the items as one parallel job, which is a serial loop
+    // if the thread pool can't be found.
+    vector<int> exit_status(items.size(), 0);
+    BatchClosure closure = {contents.ptr->jit_module.argv_function(), &args, &exit_status};
+    JITModule::Symbol do_par_for_sym =
+        contents.ptr->jit_module.find_symbol_by_name("halide_do_par_for");
+    if (do_par_for_sym.address) {
+        int (*do_par_for)(void *, halide_task, int, int, uint8_t *) =
+            (int (*)(void *, halide_task, int, int, uint8_t *))(do_par_for_sym.address);
+        do_par_for(&jit_context.jit_context, run_batch_item, 0, (int)items.size(), (uint8_t *)&closure);
+    } else {
+        for (size_t i = 0; i < items.size(); i++) {
+            run_batch_item(&jit_context.jit_context, (int)i, (uint8_t *)&closure);
+        }
+    }
+
+    if (reuse_allocations) {
+        BatchAllocations::get().end_batch();
+    }
+
+    int first_error = 0;
+    for (int status : exit_status) {
+        if (status) {
+            first_error = status;
+            break;
+        }
+    }
+    jit_context.finalize(first_error);
+}
+
+void Pipeline::infer_input_bounds(Realization dst) {
+    Target target = get_jit_target_from_environment();
+
+    vector<Buffer> buffers = infer_input_buffers(dst, target);
+    for (size_t i = 0; i < buffers.size(); i++) {
+        if (buffers[i].defined()) {
+            contents.ptr->inferred_args[i].param.set_buffer(buffers[i]);
+        }
+    }
+}
+
+void Pipeline::realize_tiled(vector<int32_t> sizes, vector<int32_t> tile_sizes,
+                             TileReader reader, TileWriter writer, const Target &t) {
+    user_assert(defined()) << "Can't realize an undefined Pipeline\n";
+    user_assert(sizes.size() == tile_sizes.size())
+        << "realize_tiled was given " << sizes.size() << " output sizes but "
+        << tile_sizes.size() << " tile sizes\n";
+    user_assert(sizes.size() <= 4)
+        << "realize_tiled only supports outputs of up to four dimensions\n";
+
+    Target target = t;
+    if (target.os == Target::OSUnknown) {
+        if (contents.ptr->jit_module.compiled()) {
+            target = contents.ptr->jit_target;
+        } else {
+            target = get_jit_target_from_environment();
+        }
+    }
+
+    // The min and extent of every tile of the output, in order with
+    // the innermost dimension changing fastest.
+    vector<vector<int32_t>> tile_mins, tile_extents;
+    vector<int32_t> m(sizes.size(), 0);
+    while (true) {
+        vector<int32_t> e(sizes.size());
+        for (size_t d = 0; d < sizes.size(); d++) {
+            int32_t tile = tile_sizes[d] > 0 ? tile_sizes[d] : sizes[d];
+            e[d] = std::min(tile, sizes[d] - m[d]);
+        }
+        tile_mins.push_back(m);
+        tile_extents.push_back(e);
+        size_t d = 0;
+        for (; d < sizes.size(); d++) {
+            m[d] += e[d];
+            if (m[d] < sizes[d]) break;
+            m[d] = 0;
+        }
+        if (d == sizes.size()) break;
+    }
+
+    auto make_tile = [&](size_t i) {
+        vector<Buffer> bufs;
+        for (Function f : contents.ptr->outputs) {
+            for (Type type : f.output_types()) {
+                Buffer b(type, tile_extents[i]);
+                const vector<int32_t> &mins = tile_mins[i];
+                b.set_min(mins.size() > 0 ? mins[0] : 0,
+                          mins.size() > 1 ? mins[1] : 0,
+                          mins.size() > 2 ? mins[2] : 0,
+                          mins.size() > 3 ? mins[3] : 0);
+                bufs.push_back(b);
+            }
+        }
+        return Realization(bufs);
+    };
+
+    // Fill in the inputs of a tile. Runs on a separate thread, so
+    // any exception is kept to rethrow on this one.
+    std::exception_ptr read_error;
+    auto read_inputs = [&](const vector<Buffer> &inputs) {
+        try {
+            for (size_t j = 0; j < inputs.size(); j++) {
+                if (inputs[j].defined()) {
+                    reader(contents.ptr->inferred_args[j].param.name(), inputs[j]);
+                }
+            }
+        } catch (...) {
+            read_error = std::current_exception();
+        }
+    };
+
+    // Bounds inference for each tile runs on this thread, while the
+    // ImageParams are unbound, just before the previous tile is
+    // computed. It needs the tile's output buffers, so two tiles of
+    // the output are allocated while the previous one is computed.
+    Realization tile = make_tile(0);
+    vector<Buffer> inputs = infer_input_buffers(tile, target);
+    std::thread reading(read_inputs, inputs);
+
+    try {
+        for (size_t i = 0; i < tile_mins.size(); i++) {
+            Realization next_tile = tile;
+            vector<Buffer> next_inputs;
+            if (i + 1 < tile_mins.size()) {
+                next_tile = make_tile(i + 1);
+                next_inputs = infer_input_buffers(next_tile, target);
+            }
+
+            reading.join();
+            if (read_error) {
+                std::rethrow_exception(read_error);
+            }
+            if (!next_inputs.empty()) {
+                reading = std::thread(read_inputs, next_inputs);
+            }
+
+            for (size_t j = 0; j < inputs.size(); j++) {
+                if (inputs[j].defined()) {
+                    contents.ptr->inferred_args[j].param.set_buffer(inputs[j]);
+                }
+            }
+            realize(tile, target);
+            for (size_t j = 0; j < inputs.size(); j++) {
+                if (inputs[j].defined()) {
+                    contents.ptr->inferred_args[j].param.set_buffer(Buffer());
+                }
+            }
+            writer(tile);
+
+            tile = next_tile;
+            inputs.swap(next_inputs);
+        }
+    } catch (...) {
+        // Don't leave a read running, or the streamed ImageParams
+        // bound to a tile.
+        if (reading.joinable()) {
+            reading.join();
+        }
+        for (size_t j = 0; j < inputs.size(); j++) {
+            if (inputs[j].defined()) {
+                contents.ptr->inferred_args[j].param.set_buffer(Buffer());
+            }
+        }
+        throw;
+    }
+}
+
+DirtyRegion Pipeline::realize_dirty(Realization dst, const std::map<string, DirtyRegion> &dirty,
+                                    const Target &target) {
+    user_assert(defined()) << "Can't realize an undefined Pipeline\n";
+    user_assert(dst.size() > 0) << "realize_dirty needs somewhere to put the outputs\n";
+
+    Buffer first = dst[0];
+    for (size_t i = 1; i < dst.size(); i++) {
+        bool same_bounds = dst[i].dimensions() == first.dimensions();
+        for (int d = 0; same_bounds && d < first.dimensions(); d++) {
+            same_bounds = (dst[i].min(d) == first.min(d) &&
+                           dst[i].extent(d) == first.extent(d));
+        }
+        user_assert(same_bounds)
+            << "realize_dirty requires all the outputs to have the same bounds\n";
+    }
+    for (size_t i = 0; i < dst.size(); i++) {
+        user_assert(!dst[i].device_handle())
+            << "realize_dirty requires outputs that only live on the host\n";
+    }
+
+    // The Images and ImageParams the pipeline reads, and their
+    // dimensionality.
+    infer_arguments();
+    std::map<string, int> input_dimensions;
+    for (const InferredArgument &arg : contents.ptr->inferred_args) {
+        if (arg.arg.is_buffer()) {
+            input_dimensions[arg.arg.name] = arg.arg.dimensions;
+        }
+    }
+
+    std::map<string, Box> dirty_inputs;
+    for (const auto &it : dirty) {
+        auto input = input_dimensions.find(it.first);
+        user_assert(input != input_dimensions.end())
+            << "realize_dirty was given a dirty region of " << it.first
+            << ", which is not an Image or ImageParam used by the pipeline\n";
+        user_assert((int)it.second.size() == input->second)
+            << "Dirty region of " << it.first << " has " << it.second.size()
+            << " dimensions, but " << it.first << " has " << input->second << "\n";
+
+        Box b;
+        bool empty = false;
+        for (const std::pair<int32_t, int32_t> &r : it.second) {
+            user_assert(r.second >= 0)
+                << "Dirty region of " << it.first << " has a negative extent\n";
+            empty = empty || r.second == 0;
+            b.push_back(Interval(r.first, r.first + r.second - 1));
+        }
+        if (!empty) {
+            dirty_inputs[it.first] = b;
+        }
+    }
+
+    std::map<string, Box> dirty_funcs = dirty_regions(contents.ptr->outputs, dirty_inputs);
+
+    Box box;
+    bool changed = false;
+    for (Function f : contents.ptr->outputs) {
+        auto it = dirty_funcs.find(f.name());
+        if (it != dirty_funcs.end()) {
+            merge_boxes(box, it->second);
+            changed = true;
+        }
+    }
+    if (!changed) {
+        return DirtyRegion();
+    }
+    internal_assert(box.size() == (size_t)first.dimensions());
+
+    // Clamp the box to the outputs. Bounds that aren't constant, or
+    // are missing, cover the whole output.
+    DirtyRegion region;
+    for (int d = 0; d < first.dimensions(); d++) {
+        int64_t lo = first.min(d), hi = lo + first.extent(d) - 1;
+        const int64_t *c = box[d].min.defined() ? as_const_int(box[d].min) : nullptr;
+        if (c) {
+            lo = std::max(lo, *c);
+        }
+        c = box[d].max.defined() ? as_const_int(box[d].max) : nullptr;
+        if (c) {
+            hi = std::min(hi, *c);
+        }
+        if (lo > hi) {
+            return DirtyRegion();
+        }
+        region.push_back(std::make_pair((int32_t)lo, (int32_t)(hi - lo + 1)));
+    }
+
+    debug(1) << "realize_dirty recomputing";
+    for (const std::pair<int32_t, int32_t> &r : region) {
+        debug(1) << " [" << r.first << ", " << r.first + r.second - 1 << "]";
+    }
+    debug(1) << "\n";
+
+    // Make buffers that alias the dirty region of each output.
+    vector<Buffer> crops;
+    for (size_t i = 0; i < dst.size(); i++) {
+        halide_buffer_nd_t nd = *dst[i].raw_nd_buffer();
+        int64_t offset = 0;
+        for (int d = 0; d < (int)region.size(); d++) {
+            offset += (int64_t)(region[d].first - dst[i].min(d)) * dst[i].stride(d);
+            if (d < 4) {
+                nd.buf.min[d] = region[d].first;
+                nd.buf.extent[d] = region[d].second;
+            } else {
+                nd.min[d - 4] = region[d].first;
+                nd.extent[d - 4] = region[d].second;
+            }
+        }
+        nd.buf.host += offset * nd.buf.elem_size;
+        crops.push_back(Buffer(dst[i].type(), &nd));
+    }
+
+    realize(Realization(crops), target);
+    for (Buffer b : crops) {
+        b.copy_to_host();
+    }
+    return region;
+}
+
+DirtyRegion Pipeline::realize_dirty(Buffer dst, const std::map<string, DirtyRegion> &dirty,
+                                    const Target &target) {
+    return realize_dirty(Realization({dst}), dirty, target);
 }
 
 void Pipeline::infer_input_bounds(int x_size, int y_size, int z_size, int w_size) {
@@ -7,6 +7,7 @@
  * pipeline.
  */
 
+#include <functional>
 #include <vector>
 
 #include "Buffer.h"
@@ -44,6 +45,32 @@ void delete_lowering_pass(T *pass) {
 }
 }
 
+/** A function that fills in a region of an input for
+ * Pipeline::realize_tiled. It's given the name of the ImageParam and
+ * a Buffer already allocated to cover the region of it that a tile of
+ * the output needs. */
+typedef std::function<void(const std::string &input, Buffer region)> TileReader;
+
+/** A function that receives each tile of the output from
+ * Pipeline::realize_tiled. The min of each Buffer is the position of
+ * the tile in the output. */
+typedef std::function<void(Realization tile)> TileWriter;
+
+/** A region of an input or output of Pipeline::realize_dirty, as the
+ * min and extent of each dimension. */
+typedef std::vector<std::pair<int32_t, int32_t>> DirtyRegion;
+
+/** The buffers for one item of Pipeline::realize_batch. */
+struct BatchItem {
+    /** A Buffer for each ImageParam that differs between items, by
+     * the name of the ImageParam. ImageParams not named here use the
+     * Buffer they're bound to. */
+    std::map<std::string, Buffer> inputs;
+
+    /** The Buffers to realize the outputs into. */
+    std::vector<Buffer> outputs;
+};
+
 /** A custom lowering pass. See Pipeline::add_custom_lowering_pass. */
 struct CustomLoweringPass {
     Internal::IRMutator *pass;
@@ -100,6 +127,12 @@ class Pipeline {
     std::vector<Buffer> validate_arguments(const std::vector<Argument> &args);
     std::vector<const void *> prepare_jit_call_arguments(Realization dst, const Target &target);
 
+    /** Run bounds inference for the outputs dst, and allocate a Buffer
+     * of the required size for each unbound ImageParam. The result has
+     * one entry per inferred argument, which is undefined for all but
+     * the unbound ImageParams. */
+    std::vector<Buffer> infer_input_buffers(Realization dst, const Target &target);
+
     static std::vector<Internal::JITModule> make_externs_jit_module(const Target &target,
                                                                     std::map<std::string, JITExtern> &externs_in_out);
 
@@ -127,6 +160,22 @@ public:
                            const std::string &fn_name,
                            const Target &target);
 
+    /** Compile a variant of the pipeline for each of the given
+     * targets into a single set of output files. The targets must be
+     * x86, and may differ only in their instruction set features
+     * (e.g. x86-64-linux-avx-avx2-fma, x86-64-linux-sse41,
+     * x86-64-linux). They are listed in order of preference. The
+     * function fn_name checks the host cpu on its first call, and from
+     * then on jumps directly to the first variant the cpu can run. The
+     * last target is the fallback, used if the cpu supports none of the
+     * others. Only the fallback's variant contains the runtime. Each
+     * variant is also exported under fn_name with its target string
+     * appended (with dashes replaced by underscores). */
+    EXPORT void compile_to(const Outputs &output_files,
+                           const std::vector<Argument> &args,
+                           const std::string &fn_name,
+                           const std::vector<Target> &targets);
+
     /** Statically compile a pipeline to llvm bitcode, with the given
      * filename (which should probably end in .bc), type signature,
      * and C function name. If you're compiling a pipeline with a
@@ -187,17 +236,28 @@ public:
 
     /** Write out an internal representation of lowered code. Useful
      * for analyzing and debugging scheduling. Can emit html or plain
-     * text. */
+     * text. When emitting html, profile may be what the profiler
+     * measured for a run of this pipeline (e.g. from
+     * Pipeline::last_profile), and each produce and loop is then
+     * annotated with the numbers of its Func and colored by how hot
+     * it is. */
     EXPORT void compile_to_lowered_stmt(const std::string &filename,
                                         const std::vector<Argument> &args,
                                         StmtOutputFormat fmt = Text,
-                                        const Target &target = get_target_from_environment());
+                                        const Target &target = get_target_from_environment(),
+                                        const halide_profiler_pipeline_stats *profile = nullptr);
 
     /** Write out the loop nests specified by the schedule for this
      * Pipeline's Funcs. Helpful for understanding what a schedule is
      * doing. */
     EXPORT void print_loop_nest();
 
+    /** What the profiler measured during the last call to realize, if
+     * this pipeline was jit-compiled for a target with one of the
+     * profiling features, or null otherwise. Valid until the next call
+     * to realize. */
+    EXPORT const halide_profiler_pipeline_stats *last_profile() const;
+
     /** Compile to object file and header pair, with the given
      * arguments. Also names the C function to match the filename
      * argument. */
@@ -390,6 +450,17 @@ public:
     }
     // @}
 
+    /** Evaluate this pipeline for many independent items at once,
+     * e.g. a batch of small images too small to be worth
+     * parallelizing individually. The items run as a single parallel
+     * job on the Halide thread pool, and (unless a custom allocator
+     * is set) the memory allocated within the pipeline for one item
+     * is reused by later items of the same batch. No bounds inference
+     * is done, so every input must be large enough for its
+     * outputs. */
+    EXPORT void realize_batch(const std::vector<BatchItem> &items,
+                              const Target &target = Target());
+
     /** For a given size of output, or a given set of output buffers,
      * determine the bounds required of all unbound ImageParams
      * referenced. Communicates the result by allocating new buffers
@@ -401,6 +472,48 @@ public:
     EXPORT void infer_input_bounds(Buffer dst);
     // @}
 
+    /** Realize an output of the given size one tile at a time, for
+     * when the output and the inputs are too large to fit in
+     * memory. Each dimension of the output is split into tiles of the
+     * given size (or not split, if the tile size is zero), with
+     * smaller tiles at the end if it doesn't divide evenly. For each
+     * tile, bounds inference finds the region needed of each unbound
+     * ImageParam, which is allocated and passed to reader to fill in,
+     * and the finished tile is passed to writer. The inputs of the
+     * next tile are read on another thread while the current one is
+     * computed. Bounds inference for the next tile needs its output
+     * buffers, so at most two tiles of the inputs and two of the
+     * output are in memory at once. ImageParams that are already
+     * bound are used as they are. */
+    EXPORT void realize_tiled(std::vector<int32_t> sizes,
+                              std::vector<int32_t> tile_sizes,
+                              TileReader reader, TileWriter writer,
+                              const Target &target = Target());
+
+    /** Bring outputs previously computed by this pipeline up to date
+     * after some regions of its inputs have changed, e.g. under a
+     * brush stroke, recomputing only the part of the outputs that
+     * depends on them. dirty gives the region that changed of each
+     * Image or ImageParam, by name. The dirty regions are propagated
+     * through the definition of each Func with the same bounds
+     * machinery as bounds inference, and the outputs are realized
+     * again over the smallest box that covers every site that may
+     * have changed, so every intermediate is only computed as much as
+     * that box needs. Anything the propagation can't bound, such as a
+     * data-dependent index, makes the whole of that dimension
+     * dirty. All the outputs must have the same bounds, and the
+     * Params and other inputs must be the same as when dst was
+     * computed. Returns the region of the outputs that was
+     * recomputed, which is empty if nothing needed to be. */
+    // @{
+    EXPORT DirtyRegion realize_dirty(Realization dst,
+                                     const std::map<std::string, DirtyRegion> &dirty,
+                                     const Target &target = Target());
+    EXPORT DirtyRegion realize_dirty(Buffer dst,
+                                     const std::map<std::string, DirtyRegion> &dirty,
+                                     const Target &target = Target());
+    // @}
+
     /** Infer the arguments to the Pipeline, sorted into a canonical order:
      * all buffers (sorted alphabetically by name), followed by all non-buffers
      * (sorted alphabetically by name).
@@ -5,8 +5,10 @@
 
 #include "Profiling.h"
 #include "CodeGen_Internal.h"
+#include "ExprUsesVar.h"
 #include "IRMutator.h"
 #include "IROperator.h"
+#include "IRVisitor.h"
 #include "Scope.h"
 #include "Simplify.h"
 #include "Util.h"
@@ -18,6 +20,81 @@ using std::map;
 using std::string;
 using std::vector;
 
+// Statically count the bytes loaded and stored and the arithmetic
+// operations done by a statement. Loops, conditionals and the
+// productions of other Funcs inside it are left out, because they are
+// counted separately. The arithmetic that computes the index of a load
+// or store is addressing, not work, so it isn't counted, but loads
+// inside an index still move bytes. Both sides of a select are
+// counted, because a vectorized select computes both of them.
+class CountOps : public IRVisitor {
+public:
+    int64_t bytes = 0, ops = 0;
+
+private:
+    using IRVisitor::visit;
+
+    // How many load or store indices we are inside of.
+    int in_index = 0;
+
+    template<typename T>
+    void count_op(const T *op) {
+        IRVisitor::visit(op);
+        if (!in_index) {
+            ops += op->type.lanes();
+        }
+    }
+
+    void visit(const Add *op) {count_op(op);}
+    void visit(const Sub *op) {count_op(op);}
+    void visit(const Mul *op) {count_op(op);}
+    void visit(const Div *op) {count_op(op);}
+    void visit(const Mod *op) {count_op(op);}
+    void visit(const Min *op) {count_op(op);}
+    void visit(const Max *op) {count_op(op);}
+    void visit(const EQ *op) {count_op(op);}
+    void visit(const NE *op) {count_op(op);}
+    void visit(const LT *op) {count_op(op);}
+    void visit(const LE *op) {count_op(op);}
+    void visit(const GT *op) {count_op(op);}
+    void visit(const GE *op) {count_op(op);}
+    void visit(const And *op) {count_op(op);}
+    void visit(const Or *op) {count_op(op);}
+    void visit(const Not *op) {count_op(op);}
+    void visit(const Select *op) {count_op(op);}
+
+    void visit(const Call *op) {
+        IRVisitor::visit(op);
+        // Math library functions count as one op each.
+        if (op->call_type == Call::PureExtern && !in_index) {
+            ops += op->type.lanes();
+        }
+    }
+
+    void visit(const Load *op) {
+        in_index++;
+        op->index.accept(this);
+        in_index--;
+        bytes += op->type.bytes() * op->type.lanes();
+    }
+
+    void visit(const Store *op) {
+        op->value.accept(this);
+        in_index++;
+        op->index.accept(this);
+        in_index--;
+        bytes += op->value.type().bytes() * op->value.type().lanes();
+    }
+
+    void visit(const For *op) {}
+
+    void visit(const IfThenElse *op) {}
+
+    void visit(const ProducerConsumer *op) {
+        op->consume.accept(this);
+    }
+};
+
 class InjectProfiling : public IRMutator {
 public:
     map<string, int> indices;   // maps from func name -> index in buffer.
@@ -26,17 +103,122 @@ public:
 
     string pipeline_name;
 
-    InjectProfiling(const string &pipeline_name) : pipeline_name(pipeline_name) {
+    bool use_counters;
+
+    bool count_ops;
+
+    InjectProfiling(const string &pipeline_name, bool use_counters, bool count_ops) :
+        pipeline_name(pipeline_name), use_counters(use_counters), count_ops(count_ops) {
         indices["overhead"] = 0;
         stack.push_back(0);
     }
 
+    // Make a call that records the given func id in the slot of the
+    // current thread.
+    Expr set_current_func(int idx) {
+        Expr profiler_token = Variable::make(Int(32), "profiler_token");
+        Expr profiler_slot = Variable::make(Handle(), "profiler_slot");
+        if (use_counters) {
+            // Reading the counters needs a system call, so this one
+            // is a real call.
+            Expr profiler_pipeline_state = Variable::make(Handle(), "profiler_pipeline_state");
+            return Call::make(Int(32), "halide_profiler_set_current_func_counted",
+                              {profiler_pipeline_state, profiler_slot, profiler_token, idx}, Call::Extern);
+        }
+        // This call gets inlined and becomes a single store instruction.
+        return Call::make(Int(32), "halide_profiler_set_current_func",
+                          {profiler_slot, profiler_token, idx}, Call::Extern);
+    }
+
     map<int, int> func_stack_current; // map from func id -> current stack allocation
     map<int, int> func_stack_peak; // map from func id -> peak stack allocation
 
+    // The bytes and ops counted so far that haven't been billed yet,
+    // per func id. Rather than billing them on every iteration of a
+    // loop, they are multiplied by its extent and carried out of it, up
+    // to the point where something they depend on is defined.
+    struct OpCount {
+        Expr bytes, ops;
+    };
+    map<int, OpCount> pending_counts;
+
+    // Prepend calls that bill the pending counts that use the given
+    // variable, or all of them if it is empty, and stop carrying them.
+    Stmt bill_op_counts(Stmt s, const string &var = "") {
+        Expr profiler_pipeline_state = Variable::make(Handle(), "profiler_pipeline_state");
+        for (auto iter = pending_counts.begin(); iter != pending_counts.end(); ) {
+            const OpCount &c = iter->second;
+            if (!var.empty() && !expr_uses_var(c.bytes, var) && !expr_uses_var(c.ops, var)) {
+                ++iter;
+                continue;
+            }
+            Expr count = Call::make(Int(32), "halide_profiler_count_ops",
+                                    {profiler_pipeline_state, iter->first, simplify(c.bytes), simplify(c.ops)},
+                                    Call::Extern);
+            s = Block::make(Evaluate::make(count), s);
+            iter = pending_counts.erase(iter);
+        }
+        return s;
+    }
+
 private:
     using IRMutator::visit;
 
+    // Add the bytes and ops counted does itself to the current func.
+    void add_op_count(Stmt counted) {
+        if (!count_ops) return;
+        CountOps counter;
+        counted.accept(&counter);
+        if (counter.bytes == 0 && counter.ops == 0) return;
+        add_op_count(pending_counts, stack.back(),
+                     make_const(UInt(64), counter.bytes), make_const(UInt(64), counter.ops));
+    }
+
+    void add_op_count(map<int, OpCount> &counts, int idx, Expr bytes, Expr ops) {
+        auto iter = counts.find(idx);
+        if (iter == counts.end()) {
+            counts[idx] = {bytes, ops};
+        } else {
+            iter->second.bytes += bytes;
+            iter->second.ops += ops;
+        }
+    }
+
+    void visit(const LetStmt *op) {
+        map<int, OpCount> outer;
+        outer.swap(pending_counts);
+        IRMutator::visit(op);
+        op = stmt.as<LetStmt>();
+        internal_assert(op);
+        Stmt body = bill_op_counts(op->body, op->name);
+        if (!body.same_as(op->body)) {
+            stmt = LetStmt::make(op->name, op->value, body);
+        }
+        for (const auto &c : pending_counts) {
+            add_op_count(outer, c.first, c.second.bytes, c.second.ops);
+        }
+        pending_counts.swap(outer);
+    }
+
+    // We don't know which way a condition will go, so each side of it
+    // is billed within that side.
+    void visit(const IfThenElse *op) {
+        map<int, OpCount> outer;
+        outer.swap(pending_counts);
+        Expr condition = mutate(op->condition);
+        Stmt then_case = mutate(op->then_case);
+        add_op_count(op->then_case);
+        then_case = bill_op_counts(then_case);
+        Stmt else_case;
+        if (op->else_case.defined()) {
+            else_case = mutate(op->else_case);
+            add_op_count(op->else_case);
+            else_case = bill_op_counts(else_case);
+        }
+        pending_counts.swap(outer);
+        stmt = IfThenElse::make(condition, then_case, else_case);
+    }
+
     struct AllocSize {
         bool on_stack;
         Expr size;
@@ -182,21 +364,19 @@ private:
         stack.push_back(idx);
         Stmt produce = mutate(op->produce);
         Stmt update = op->update.defined() ? mutate(op->update) : Stmt();
+        add_op_count(op->produce);
+        if (update.defined()) {
+            add_op_count(op->update);
+        }
         stack.pop_back();
 
         Stmt consume = mutate(op->consume);
 
-        Expr profiler_token = Variable::make(Int(32), "profiler_token");
-        Expr profiler_state = Variable::make(Handle(), "profiler_state");
-
-        // This call gets inlined and becomes a single store instruction.
-        Expr set_task = Call::make(Int(32), "halide_profiler_set_current_func",
-                                   {profiler_state, profiler_token, idx}, Call::Extern);
+        Expr set_task = set_current_func(idx);
 
         // At the beginning of the consume step, set the current task
         // back to the outer one.
-        Expr set_outer_task = Call::make(Int(32), "halide_profiler_set_current_func",
-                                         {profiler_state, profiler_token, stack.back()}, Call::Extern);
+        Expr set_outer_task = set_current_func(stack.back());
 
         produce = Block::make(Evaluate::make(set_task), produce);
         consume = Block::make(Evaluate::make(set_outer_task), consume);
@@ -206,18 +386,60 @@ private:
 
     void visit(const For *op) {
         // We profile by storing a token to global memory, so don't enter GPU loops
-        if (op->device_api == DeviceAPI::Parent ||
-            op->device_api == DeviceAPI::Host) {
-            IRMutator::visit(op);
-        } else {
+        if (op->device_api != DeviceAPI::Parent &&
+            op->device_api != DeviceAPI::Host) {
             stmt = op;
+            return;
         }
+
+        map<int, OpCount> outer;
+        outer.swap(pending_counts);
+        IRMutator::visit(op);
+        add_op_count(op->body);
+
+        // Counts that depend on the loop variable are billed on each
+        // iteration, and the rest once for the whole loop.
+        Expr extent = cast<uint64_t>(op->extent);
+        op = stmt.as<For>();
+        internal_assert(op);
+        Stmt body = bill_op_counts(op->body, op->name);
+        for (const auto &c : pending_counts) {
+            add_op_count(outer, c.first, c.second.bytes * extent, c.second.ops * extent);
+        }
+        pending_counts.swap(outer);
+
+        if (op->for_type != ForType::Parallel) {
+            if (!body.same_as(op->body)) {
+                stmt = For::make(op->name, op->min, op->extent, op->for_type, op->device_api, body);
+            }
+            return;
+        }
+
+        // Each task of a parallel loop may run on a different thread,
+        // so it claims a slot of its own for the duration of the task
+        // and releases it when the task exits.
+        Expr profiler_state = Variable::make(Handle(), "profiler_state");
+        Expr profiler_slot = Variable::make(Handle(), "profiler_slot");
+        Expr claim_slot = Call::make(Handle(), "halide_profiler_claim_slot",
+                                     {profiler_state}, Call::Extern);
+        Expr release_slot = Call::make(Int(32), Call::register_destructor,
+                                       {Expr("halide_profiler_release_slot"), profiler_slot}, Call::Intrinsic);
+        body = Block::make(Evaluate::make(set_current_func(stack.back())), body);
+        body = Block::make(Evaluate::make(release_slot), body);
+        body = LetStmt::make("profiler_slot", claim_slot, body);
+        stmt = For::make(op->name, op->min, op->extent, op->for_type, op->device_api, body);
+
+        // While the thread that launched the loop waits for the tasks
+        // to finish, it isn't running anything itself.
+        stmt = Block::make(Evaluate::make(set_current_func(halide_profiler_outside_of_halide)), stmt);
+        stmt = Block::make(stmt, Evaluate::make(set_current_func(stack.back())));
     }
 };
 
-Stmt inject_profiling(Stmt s, string pipeline_name) {
-    InjectProfiling profiling(pipeline_name);
+Stmt inject_profiling(Stmt s, string pipeline_name, bool use_counters, bool count_ops) {
+    InjectProfiling profiling(pipeline_name, use_counters, count_ops);
     s = profiling.mutate(s);
+    s = profiling.bill_op_counts(s);
 
     int num_funcs = (int)(profiling.indices.size());
 
@@ -233,8 +455,14 @@ Stmt inject_profiling(Stmt s, string pipeline_name) {
 
     Expr profiler_token = Variable::make(Int(32), "profiler_token");
 
+    Expr profiler_state = Variable::make(Handle(), "profiler_state");
+
+    Expr claim_slot = Call::make(Handle(), "halide_profiler_claim_slot", {profiler_state}, Call::Extern);
+
+    Expr profiler_slot = Variable::make(Handle(), "profiler_slot");
+
     Expr stop_profiler = Call::make(Int(32), Call::register_destructor,
-                                    {Expr("halide_profiler_pipeline_end"), get_state}, Call::Intrinsic);
+                                    {Expr("halide_profiler_pipeline_end"), profiler_slot}, Call::Intrinsic);
 
     bool no_stack_alloc = profiling.func_stack_peak.empty();
     if (!no_stack_alloc) {
@@ -247,6 +475,9 @@ Stmt inject_profiling(Stmt s, string pipeline_name) {
         s = Block::make(update_stack, s);
     }
 
+    s = Block::make(Evaluate::make(profiling.set_current_func(0)), s);
+    s = Block::make(Evaluate::make(stop_profiler), s);
+    s = LetStmt::make("profiler_slot", claim_slot, s);
     s = LetStmt::make("profiler_pipeline_state", get_pipeline_state, s);
     s = LetStmt::make("profiler_state", get_state, s);
     // If there was a problem starting the profiler, it will call an
@@ -269,7 +500,6 @@ Stmt inject_profiling(Stmt s, string pipeline_name) {
 
     s = Block::make(s, Free::make("profiling_func_names"));
     s = Allocate::make("profiling_func_names", Handle(), {num_funcs}, const_true(), s);
-    s = Block::make(Evaluate::make(stop_profiler), s);
 
     return s;
 }
@@ -10,18 +10,42 @@
  * Output format:
  * <pipeline_name>
  *  <total time spent in this pipeline> <# of samples taken> <# of runs> <avg time/run>
+ *  <total time summed over threads> <avg per run> <average # of threads busy>
  *  <# of heap allocations> <peak heap allocation>
+ *  (<heap allocation of each func at the peak>)?
  *   <func_name> <total time spent in this func> <percentage of time spent>
+ *     <time summed over threads> <average # of threads running this func>
  *     (<peak heap alloc by this func> <num of allocs> <average alloc size> |
  *      <worst-case peak stack alloc by this func>)?
  *
  * Sample output:
  * memory_profiler_mandelbrot
  *  total time: 59.832336 ms   samples: 43   runs: 1000   time/run: 0.059832 ms
+ *  total cpu time: 59.832336 ms   cpu time/run: 0.059832 ms   average threads: 1.000000
  *  heap allocations: 104000   peak heap usage: 505344 bytes
- *   f0:          0.025673ms (42%)
- *   mandelbrot:  0.006444ms (10%)   peak: 505344   num: 104000   avg: 5376
- *   argmin:      0.027715ms (46%)   stack: 20
+ *  live at peak: mandelbrot (505344 bytes)
+ *   f0:          0.025673ms (42%)   cpu: 0.025673ms   threads: 1.000000
+ *   mandelbrot:  0.006444ms (10%)   cpu: 0.006444ms   threads: 1.000000   peak: 505344   num: 104000   avg: 5376
+ *   argmin:      0.027715ms (46%)   cpu: 0.027715ms   threads: 1.000000   stack: 20
+ *
+ * The "live at peak" line lists the funcs whose heap allocations were
+ * live when the pipeline reached its peak heap usage. Stack allocations
+ * are only reported as the static per-func peak. If the environment
+ * variable HL_MEMORY_TIMELINE names a file, every heap allocation and
+ * free is also written there as csv, with the time, pipeline, func,
+ * change in bytes, and the heap usage of the pipeline afterwards.
+ *
+ * With the profile_counters target feature, each func also gets a
+ * line of hardware event counts, with the instructions per cycle and
+ * an estimate of memory traffic in bytes per cycle derived from them.
+ *
+ * With the profile_roofline target feature, each func also gets a line
+ * with the bytes it loaded and stored and the arithmetic operations
+ * it did, and the GB/s and GOPS it achieved. If the environment
+ * variables HL_ROOFLINE_PEAK_GBPS and HL_ROOFLINE_PEAK_GOPS give the
+ * peaks of the machine, the line also says whether the func is memory
+ * or compute bound at its arithmetic intensity, and what percentage of
+ * that bound it achieved.
  */
 
 #include "IR.h"
@@ -33,10 +57,15 @@ namespace Internal {
  * high-resolution timing into the generated code (via spawning a
  * thread that acts as a sampling profiler); summaries of execution
  * times and counts will be logged at the end. Should be done before
- * storage flattening, but after all bounds inference.
+ * storage flattening, but after all bounds inference. If use_counters
+ * is true, hardware performance counters are also read whenever a
+ * thread switches between Funcs. If count_ops is true, the bytes and
+ * ops of each loop are counted from the code of its body, multiplied
+ * by the extents of the loops around it, and billed to its Func as
+ * far outside those loops as their extents allow.
  *
  */
-Stmt inject_profiling(Stmt, std::string);
+Stmt inject_profiling(Stmt, std::string, bool use_counters = false, bool count_ops = false);
 
 }
 }
@@ -17,7 +17,7 @@ class RemoveDeadAllocations : public IRMutator {
             for (size_t i = 0; i < op->args.size(); i++) {
                 const Variable *var = op->args[i].as<Variable>();
                 if (var && ends_with(var->name, ".buffer")) {
-                    std::string func = var->name.substr(0, var->name.find_first_of('.'));
+                    std::string func = var->name.str().substr(0, var->name.str().find_first_of('.'));
                     if (allocs.contains(func)) {
                         allocs.pop(func);
                     }
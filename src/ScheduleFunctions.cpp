@@ -826,11 +826,11 @@ private:
     void visit(const For *f) {
         f->min.accept(this);
         f->extent.accept(this);
-        size_t first_dot = f->name.find('.');
-        size_t last_dot = f->name.rfind('.');
+        size_t first_dot = f->name.str().find('.');
+        size_t last_dot = f->name.str().rfind('.');
         internal_assert(first_dot != string::npos && last_dot != string::npos);
-        string func = f->name.substr(0, first_dot);
-        string var = f->name.substr(last_dot + 1);
+        string func = f->name.str().substr(0, first_dot);
+        string var = f->name.str().substr(last_dot + 1);
         Site s = {f->for_type == ForType::Parallel ||
                   f->for_type == ForType::Vectorized,
                   LoopLevel(func, var)};
@@ -1174,7 +1174,8 @@ Stmt schedule_functions(const vector<Function> &outputs,
                         const vector<string> &order,
                         const map<string, Function> &env,
                         const Target &target,
-                        bool &any_memoized) {
+                        bool &any_memoized,
+                        map<string, vector<Expr>> *inlined_values) {
 
     string root_var = LoopLevel::root().func + "." + LoopLevel::root().var;
     Stmt s = For::make(root_var, 0, 1, ForType::Serial, DeviceAPI::Host, Evaluate::make(0));
@@ -1195,7 +1196,15 @@ Stmt schedule_functions(const vector<Function> &outputs,
             !f.has_update_definition() &&
             f.schedule().compute_level().is_inline()) {
             debug(1) << "Inlining " << order[i-1] << '\n';
-            s = inline_function(s, f);
+            if (inlined_values) {
+                map<string, vector<Expr>>::iterator iter = inlined_values->find(f.name());
+                if (iter == inlined_values->end()) {
+                    iter = inlined_values->emplace(f.name(), qualified_values(f)).first;
+                }
+                s = inline_function(s, f, iter->second);
+            } else {
+                s = inline_function(s, f);
+            }
         } else {
             debug(1) << "Injecting realization of " << order[i-1] << '\n';
             InjectRealization injector(f, is_output, target);
@@ -21,12 +21,16 @@ class Function;
 
 /** Build loop nests and inject Function realizations at the
  * appropriate places using the schedule. Returns a flag indicating
- * whether memoization passes need to be run. */
+ * whether memoization passes need to be run. If inlined_values is
+ * given, it is used to look up and remember the qualified values of
+ * inlined functions, so that they are only computed once per
+ * function. */
 Stmt schedule_functions(const std::vector<Function> &outputs,
                         const std::vector<std::string> &order,
                         const std::map<std::string, Function> &env,
                         const Target &target,
-                        bool &any_memoized);
+                        bool &any_memoized,
+                        std::map<std::string, std::vector<Expr>> *inlined_values = nullptr);
 
 
 }
@@ -1,8 +1,11 @@
 #ifndef HALIDE_SCOPE_H
 #define HALIDE_SCOPE_H
 
+#include <algorithm>
+#include <memory>
 #include <string>
 #include <map>
+#include <unordered_map>
 #include <stack>
 #include <utility>
 #include <iostream>
@@ -10,6 +13,7 @@
 #include "Util.h"
 #include "Debug.h"
 #include "Error.h"
+#include "Name.h"
 
 /** \file
  * Defines the Scope class, which is used for keeping track of names in a scope while traversing IR
@@ -66,14 +70,74 @@ public:
     }
 };
 
+/** A name to look up in a \ref Scope. Either an interned Name, which
+ * is matched by identity, or a plain string, which is matched by
+ * spelling without being interned. Lowering passes mostly look names
+ * up with strings they have just built, and interning those would
+ * take the lock on the global name table every time. */
+class ScopeKey {
+    const Name *name;
+    const std::string *str;
+    std::string storage;
+
+public:
+    ScopeKey(const Name &n) : name(&n), str(nullptr) {}
+    ScopeKey(const std::string &s) : name(nullptr), str(&s) {}
+    ScopeKey(const char *s) : name(nullptr), str(nullptr), storage(s) {
+        str = &storage;
+    }
+    ScopeKey(const ScopeKey &other) :
+        name(other.name), str(other.str), storage(other.storage) {
+        if (str == &other.storage) {
+            str = &storage;
+        }
+    }
+    ScopeKey &operator=(const ScopeKey &) = delete;
+
+    /** The hash of the spelling. Matches \ref Name::hash. */
+    size_t hash() const {
+        if (name) {
+            return name->hash();
+        } else {
+            return str->empty() ? 0 : Name::hash_of(*str);
+        }
+    }
+
+    bool matches(const Name &n) const {
+        return name ? name->same_as(n) : (n == *str);
+    }
+
+    /** The key as a Name. Only interns if it was given as a string. */
+    Name to_name() const {
+        return name ? *name : Name(*str);
+    }
+
+    const std::string &spelling() const {
+        return name ? name->str() : *str;
+    }
+};
+
 /** A common pattern when traversing Halide IR is that you need to
  * keep track of stuff when you find a Let or a LetStmt, and that it
  * should hide previous values with the same name until you leave the
- * Let or LetStmt nodes This class helps with that. */
+ * Let or LetStmt nodes This class helps with that.
+ *
+ * Scopes are hash tables keyed on the hash of the spelling of a
+ * name, which \ref Name computes once when it is interned. Looking up
+ * a Name compares table entries by identity. Looking up a plain
+ * std::string hashes it and compares spellings, but doesn't intern
+ * it, so it doesn't touch the global name table. Only pushing a
+ * string that isn't already in the scope interns it. Iteration is in
+ * sorted order. */
 template<typename T>
 class Scope {
 private:
-    std::map<std::string, SmallStack<T>> table;
+    struct Entry {
+        Name name;
+        SmallStack<T> stack;
+    };
+    typedef std::unordered_multimap<size_t, Entry> Table;
+    Table table;
 
     // Copying a scope object copies a large table full of strings and
     // stacks. Bad idea.
@@ -82,6 +146,39 @@ private:
 
     const Scope<T> *containing_scope;
 
+    // The entries of a table, sorted by the spelling of their names.
+    template<typename Iter, typename TableT>
+    static std::shared_ptr<std::vector<Iter>> sorted_entries(TableT &t) {
+        std::shared_ptr<std::vector<Iter>> entries = std::make_shared<std::vector<Iter>>();
+        entries->reserve(t.size());
+        for (Iter i = t.begin(); i != t.end(); ++i) {
+            entries->push_back(i);
+        }
+        std::sort(entries->begin(), entries->end(), [](const Iter &a, const Iter &b) {
+                return a->second.name < b->second.name;
+            });
+        return entries;
+    }
+
+    typename Table::const_iterator find(const ScopeKey &key) const {
+        auto range = table.equal_range(key.hash());
+        for (auto iter = range.first; iter != range.second; ++iter) {
+            if (key.matches(iter->second.name)) {
+                return iter;
+            }
+        }
+        return table.end();
+    }
+
+    typename Table::iterator find(const ScopeKey &key) {
+        auto range = table.equal_range(key.hash());
+        for (auto iter = range.first; iter != range.second; ++iter) {
+            if (key.matches(iter->second.name)) {
+                return iter;
+            }
+        }
+        return table.end();
+    }
 
 public:
     Scope() : containing_scope(nullptr) {}
@@ -102,31 +199,31 @@ public:
     }
 
     /** Retrieve the value referred to by a name */
-    T get(const std::string &name) const {
-        typename std::map<std::string, SmallStack<T>>::const_iterator iter = table.find(name);
-        if (iter == table.end() || iter->second.empty()) {
+    T get(const ScopeKey &name) const {
+        typename Table::const_iterator iter = find(name);
+        if (iter == table.end() || iter->second.stack.empty()) {
             if (containing_scope) {
                 return containing_scope->get(name);
             } else {
-                internal_error << "Symbol '" << name << "' not found\n";
+                internal_error << "Symbol '" << name.spelling() << "' not found\n";
             }
         }
-        return iter->second.top();
+        return iter->second.stack.top();
     }
 
     /** Return a reference to an entry. Does not consider the containing scope. */
-    T &ref(const std::string &name) {
-        typename std::map<std::string, SmallStack<T>>::iterator iter = table.find(name);
-        if (iter == table.end() || iter->second.empty()) {
-            internal_error << "Symbol '" << name << "' not found\n";
+    T &ref(const ScopeKey &name) {
+        typename Table::iterator iter = find(name);
+        if (iter == table.end() || iter->second.stack.empty()) {
+            internal_error << "Symbol '" << name.spelling() << "' not found\n";
         }
-        return iter->second.top_ref();
+        return iter->second.stack.top_ref();
     }
 
     /** Tests if a name is in scope */
-    bool contains(const std::string &name) const {
-        typename std::map<std::string, SmallStack<T>>::const_iterator iter = table.find(name);
-        if (iter == table.end() || iter->second.empty()) {
+    bool contains(const ScopeKey &name) const {
+        typename Table::const_iterator iter = find(name);
+        if (iter == table.end() || iter->second.stack.empty()) {
             if (containing_scope) {
                 return containing_scope->contains(name);
             } else {
@@ -139,97 +236,110 @@ public:
     /** Add a new (name, value) pair to the current scope. Hide old
      * values that have this name until we pop this name.
      */
-    void push(const std::string &name, const T &value) {
-        table[name].push(value);
+    void push(const ScopeKey &name, const T &value) {
+        typename Table::iterator iter = find(name);
+        if (iter == table.end()) {
+            iter = table.insert(std::make_pair(name.hash(), Entry{name.to_name(), SmallStack<T>()}));
+        }
+        iter->second.stack.push(value);
     }
 
     /** A name goes out of scope. Restore whatever its old value
      * was (or remove it entirely if there was nothing else of the
      * same name in an outer scope) */
-    void pop(const std::string &name) {
-        typename std::map<std::string, SmallStack<T>>::iterator iter = table.find(name);
-        internal_assert(iter != table.end()) << "Name not in symbol table: " << name << "\n";
-        iter->second.pop();
-        if (iter->second.empty()) {
+    void pop(const ScopeKey &name) {
+        typename Table::iterator iter = find(name);
+        internal_assert(iter != table.end()) << "Name not in symbol table: " << name.spelling() << "\n";
+        iter->second.stack.pop();
+        if (iter->second.stack.empty()) {
             table.erase(iter);
         }
     }
 
-    /** Iterate through the scope. Does not capture any containing scope. */
+    /** Iterate through the scope, in order of the spelling of the
+     * names, as when scopes were sorted maps. Lowering passes that
+     * build IR from the contents of a scope rely on the order being
+     * the same on every platform. Beginning an iteration sorts the
+     * entries, so it costs O(n log n). Does not capture any
+     * containing scope. */
     class const_iterator {
-        typename std::map<std::string, SmallStack<T>>::const_iterator iter;
+        typedef std::vector<typename Table::const_iterator> Entries;
+        std::shared_ptr<Entries> entries;
+        size_t index;
     public:
-        explicit const_iterator(const typename std::map<std::string, SmallStack<T>>::const_iterator &i) :
-            iter(i) {
+        const_iterator(std::shared_ptr<Entries> e, size_t i) :
+            entries(e), index(i) {
         }
 
-        const_iterator() {}
+        const_iterator() : index(0) {}
 
         bool operator!=(const const_iterator &other) {
-            return iter != other.iter;
+            return index != other.index;
         }
 
         void operator++() {
-            ++iter;
+            ++index;
         }
 
         const std::string &name() {
-            return iter->first;
+            return (*entries)[index]->second.name.str();
         }
 
         const SmallStack<T> &stack() {
-            return iter->second;
+            return (*entries)[index]->second.stack;
         }
 
         const T &value() {
-            return iter->second.top_ref();
+            return (*entries)[index]->second.stack.top_ref();
         }
     };
 
     const_iterator cbegin() const {
-        return const_iterator(table.begin());
+        return const_iterator(sorted_entries<typename Table::const_iterator>(table), 0);
     }
 
     const_iterator cend() const {
-        return const_iterator(table.end());
+        return const_iterator(nullptr, table.size());
     }
 
     class iterator {
-        typename std::map<std::string, SmallStack<T>>::iterator iter;
+        typedef std::vector<typename Table::iterator> Entries;
+        std::shared_ptr<Entries> entries;
+        size_t index;
     public:
-        explicit iterator(typename std::map<std::string, SmallStack<T>>::iterator i) :
-            iter(i) {
+        iterator(std::shared_ptr<Entries> e, size_t i) :
+            entries(e), index(i) {
         }
 
-        iterator() {}
+        iterator() : index(0) {}
 
         bool operator!=(const iterator &other) {
-            return iter != other.iter;
+            return index != other.index;
         }
 
         void operator++() {
-            ++iter;
+            ++index;
         }
 
         const std::string &name() {
-            return iter->first;
+            return (*entries)[index]->second.name.str();
         }
 
         SmallStack<T> &stack() {
-            return iter->second;
+            return (*entries)[index]->second.stack;
         }
 
         T &value() {
-            return iter->second.top_ref();
+            return (*entries)[index]->second.stack.top_ref();
         }
     };
 
     iterator begin() {
-        return iterator(table.begin());
+        return iterator(sorted_entries<typename Table::iterator>(table), 0);
     }
 
     iterator end() {
-        return iterator(table.end());
+        return iterator(nullptr, table.size());
     }
 
     void swap(Scope<T> &other) {
@@ -0,0 +1,93 @@
+#include "ScratchArenas.h"
+#include "CodeGen_Internal.h"
+#include "IRMutator.h"
+#include "IROperator.h"
+
+namespace Halide {
+namespace Internal {
+
+using std::string;
+
+class UseScratchArenas : public IRMutator {
+    using IRMutator::visit;
+
+    // The arena of the innermost enclosing parallel loop, or the
+    // empty string if we're not in one.
+    string arena;
+
+    // Whether anything has been allocated from it.
+    bool arena_used = false;
+
+    void visit(const For *op) {
+        if (op->device_api != DeviceAPI::Host &&
+            op->device_api != DeviceAPI::Parent) {
+            // Allocations in gpu loops aren't on the heap.
+            stmt = op;
+            return;
+        }
+
+        if (op->for_type != ForType::Parallel) {
+            IRMutator::visit(op);
+            return;
+        }
+
+        string old_arena = arena;
+        bool old_arena_used = arena_used;
+        arena = op->name + ".scratch_arena";
+        arena_used = false;
+
+        Stmt body = mutate(op->body);
+        if (arena_used) {
+            // Acquire an arena at the start of each task, and release
+            // it at the end. Wrapping it in an Allocate node means it
+            // also gets released if the task fails.
+            Expr acquire = Call::make(type_of<uint8_t *>(), "halide_scratch_arena_acquire",
+                                      {}, Call::Extern);
+            body = Block::make(body, Free::make(arena));
+            body = Allocate::make(arena, UInt(8), {}, const_true(), body,
+                                  acquire, "halide_scratch_arena_release");
+        }
+
+        arena = old_arena;
+        arena_used = old_arena_used;
+
+        if (body.same_as(op->body)) {
+            stmt = op;
+        } else {
+            stmt = For::make(op->name, op->min, op->extent, op->for_type, op->device_api, body);
+        }
+    }
+
+    void visit(const Allocate *op) {
+        IRMutator::visit(op);
+
+        if (arena.empty() || op->new_expr.defined()) {
+            return;
+        }
+
+        const Allocate *alloc = stmt.as<Allocate>();
+        internal_assert(alloc);
+
+        // Leave the allocations that will go on the stack alone.
+        Expr size = heap_allocation_bytes(alloc);
+        if (!size.defined()) {
+            return;
+        }
+
+        Expr arena_ptr = Call::make(Handle(), Call::address_of,
+                                    {Load::make(UInt(8), arena, 0, Buffer(), Parameter())},
+                                    Call::Intrinsic);
+        Expr new_expr = Call::make(type_of<uint8_t *>(), "halide_scratch_arena_malloc",
+                                   {arena_ptr, size}, Call::Extern);
+        stmt = Allocate::make(alloc->name, alloc->type, alloc->extents, alloc->condition,
+                              alloc->body, new_expr, "halide_scratch_arena_free");
+        arena_used = true;
+    }
+};
+
+Stmt use_scratch_arenas(Stmt s) {
+    return UseScratchArenas().mutate(s);
+}
+
+}
+}
@@ -0,0 +1,26 @@
+#ifndef HALIDE_SCRATCH_ARENAS_H
+#define HALIDE_SCRATCH_ARENAS_H
+
+/** \file
+ * Defines the lowering pass that moves heap allocations inside
+ * parallel loops into per-task scratch arenas.
+ */
+
+#include "IR.h"
+
+namespace Halide {
+namespace Internal {
+
+/** Find heap allocations made inside the body of a parallel for loop,
+ * and allocate them from a scratch arena acquired at the start of
+ * each task instead of calling halide_malloc and halide_free. The
+ * runtime keeps the arenas around between pipeline calls, so
+ * allocation becomes a pointer bump into warm memory. Allocations
+ * small enough to go on the stack are left alone. Must be called
+ * after inject_early_frees and remove_dead_allocations. */
+Stmt use_scratch_arenas(Stmt s);
+
+}
+}
+
+#endif
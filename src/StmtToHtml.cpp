@@ -3,9 +3,11 @@
 #include "IROperator.h"
 #include "Scope.h"
 
+#include <algorithm>
 #include <iterator>
 #include <iostream>
 #include <fstream>
+#include <map>
 #include <sstream>
 #include <stdio.h>
 
@@ -37,7 +39,7 @@ private:
     // All spans and divs will have an id of the form "x-y", where x
     // is shared among all spans/divs in the same context, and y is unique.
     std::vector<int> context_stack;
-    string open_tag(const string &tag, const string &cls, int id = -1) {
+    string open_tag(const string &tag, const string &cls, int id = -1, const string &style = "") {
         std::stringstream s;
         s << "<" << tag << " class='" << cls << "' id='";
         if (id == -1) {
@@ -46,7 +48,11 @@ private:
         } else {
             s << id;
         }
-        s << "'>";
+        s << "'";
+        if (!style.empty()) {
+            s << " style='" << style << "'";
+        }
+        s << ">";
         context_stack.push_back(unique_id());
         return s.str();
     }
@@ -78,8 +84,8 @@ private:
         return span("Matched", body);
     }
 
-    string open_div(const string &cls, int id = -1) {
-        return open_tag("div", cls, id) + "\n";
+    string open_div(const string &cls, int id = -1, const string &style = "") {
+        return open_tag("div", cls, id, style) + "\n";
     }
     string close_div() {
         return close_tag("div") + "\n";
@@ -92,6 +98,53 @@ private:
     string type(const string &x) { return span("Type", x); }
     string symbol(const string &x) { return span("Symbol", x); }
 
+    // What the profiler measured for a run of the pipeline being
+    // printed, if anything, by Func name.
+    const halide_profiler_pipeline_stats *profile;
+    std::map<string, const halide_profiler_func_stats *> func_profiles;
+
+    // The Func a produce, loop, or allocation name refers to, as the
+    // profiler names it, e.g. f.s0.x to f.
+    const halide_profiler_func_stats *find_profile(const string &name) {
+        auto iter = func_profiles.find(name.substr(0, name.find('.')));
+        return iter == func_profiles.end() ? nullptr : iter->second;
+    }
+
+    // The percentage of the pipeline's time spent in a Func.
+    int percent_of_time(const halide_profiler_func_stats *f) {
+        return profile->time ? (int)(f->time * 100 / profile->time) : 0;
+    }
+
+    // A background color from white to red by the fraction of the
+    // pipeline's time spent in a Func.
+    string heat_style(const string &name) {
+        const halide_profiler_func_stats *p = find_profile(name);
+        if (!p) return "";
+        int percent = std::max(0, std::min(100, percent_of_time(p)));
+        return "background-color: hsl(0, 100%, " + to_string(97 - percent * 2 / 5) + "%);";
+    }
+
+    string profile_comment(const string &name, bool all_stats) {
+        const halide_profiler_func_stats *p = find_profile(name);
+        if (!p) return "";
+        int runs = std::max(1, profile->runs);
+        std::stringstream s;
+        s << "// " << percent_of_time(p) << "% " << p->time / (runs * 1e6) << "ms";
+        if (all_stats) {
+            s << " threads: " << (p->time ? (float)p->cpu_time / p->time : 0.0f);
+            if (p->memory_peak) s << " peak: " << p->memory_peak << " bytes";
+            if (p->stack_peak) s << " stack: " << p->stack_peak << " bytes";
+            if (p->cycles) {
+                s << " ipc: " << (float)p->instructions / p->cycles
+                  << " cache misses: " << p->cache_misses;
+            }
+            if (p->bytes || p->ops) {
+                s << " bytes: " << p->bytes << " ops: " << p->ops;
+            }
+        }
+        return " " + span("Profile", s.str());
+    }
+
     Scope<int> scope;
     string var(const string &x) {
         int id;
@@ -347,7 +400,7 @@ private:
     }
     void visit(const ProducerConsumer *op) {
         scope.push(op->name, unique_id());
-        stream << open_div("Produce");
+        stream << open_div("Produce", -1, heat_style(op->name));
         int produce_id = unique_id();
         stream << open_span("Matched");
         stream << open_expand_button(produce_id);
@@ -355,13 +408,14 @@ private:
         stream << var(op->name);
         stream << close_expand_button() << " {";
         stream << close_span();;
+        stream << profile_comment(op->name, true);
         stream << open_div("ProduceBody Indent", produce_id);
         print(op->produce);
         stream << close_div();
         stream << matched("}");
         stream << close_div();
         if (op->update.defined()) {
-            stream << open_div("Update");
+            stream << open_div("Update", -1, heat_style(op->name));
             int update_id = unique_id();
             stream << open_span("Matched");
             stream << open_expand_button(update_id);
@@ -381,7 +435,7 @@ private:
     }
     void visit(const For *op) {
         scope.push(op->name, unique_id());
-        stream << open_div("For");
+        stream << open_div("For", -1, heat_style(op->name));
 
         int id = unique_id();
         stream << open_expand_button(id);
@@ -403,6 +457,7 @@ private:
         stream << matched(")");
         stream << close_expand_button();
         stream << " " << matched("{");
+        stream << profile_comment(op->name, false);
         stream << open_div("ForBody Indent", id);
         print(op->body);
         stream << close_div();
@@ -471,6 +526,10 @@ private:
             stream << keyword("custom_delete") << "{ " << op->free_function << "(); ";
             stream << matched("}");
         }
+        const halide_profiler_func_stats *p = find_profile(op->name);
+        if (p && p->memory_peak) {
+            stream << " " << span("Profile", "// peak: " + to_string(p->memory_peak) + " bytes");
+        }
 
         stream << open_div("AllocateBody");
         print(op->body);
@@ -623,7 +682,13 @@ public:
         stream << close_div();
     }
 
-    StmtToHtml(string filename) : id_count(0), context_stack(1, 0) {
+    StmtToHtml(string filename, const halide_profiler_pipeline_stats *profile = nullptr) :
+        id_count(0), context_stack(1, 0), profile(profile) {
+        for (int i = 0; profile && i < profile->num_funcs; i++) {
+            if (profile->funcs[i].name) {
+                func_profiles[profile->funcs[i].name] = &profile->funcs[i];
+            }
+        }
         stream.open(filename.c_str());
         stream << "<head>";
         stream << "<style type='text/css'>" << css << "</style>\n";
@@ -662,6 +727,7 @@ span.Type { color: #445588; font-weight: bold; }\n \
 span.StringImm { color: #d14; }\n \
 span.IntImm { color: #099; }\n \
 span.FloatImm { color: #099; }\n \
+span.Profile { color: #a00; font-style: italic; }\n \
 b.Highlight { font-weight: bold; background-color: #DDD; }\n \
 span.Highlight { font-weight: bold; background-color: #FF0; }\n \
 ";
@@ -689,8 +755,8 @@ void print_to_html(string filename, Stmt s) {
     sth.print(s);
 }
 
-void print_to_html(string filename, const Module &m) {
-    StmtToHtml sth(filename);
+void print_to_html(string filename, const Module &m, const halide_profiler_pipeline_stats *profile) {
+    StmtToHtml sth(filename, profile);
     for (size_t i = 0; i < m.buffers.size(); i++) {
         sth.print(m.buffers[i]);
     }
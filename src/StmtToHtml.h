@@ -15,8 +15,12 @@ namespace Internal {
  */
 EXPORT void print_to_html(std::string filename, Stmt s);
 
-/** Dump an HTML-formatted print of a Module to filename. */
-EXPORT void print_to_html(std::string filename, const Module &m);
+/** Dump an HTML-formatted print of a Module to filename. If given
+ * what the profiler measured for a run of the Module, each produce,
+ * loop, and allocation is annotated with the numbers for its Func,
+ * and colored by the fraction of the time spent in that Func. */
+EXPORT void print_to_html(std::string filename, const Module &m,
+                          const halide_profiler_pipeline_stats *profile = nullptr);
 
 }}
 
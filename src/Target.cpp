@@ -232,6 +232,9 @@ const std::map<std::string, Target::Feature> feature_name_map = {
     {"metal", Target::Metal},
     {"mingw", Target::MinGW},
     {"c_plus_plus_name_mangling", Target::CPlusPlusMangling},
+    {"profile_counters", Target::ProfileCounters},
+    {"profile_roofline", Target::ProfileRoofline},
+    {"persistent_allocations", Target::PersistentAllocations},
 };
 
 bool lookup_feature(const std::string &tok, Target::Feature &result) {
@@ -82,6 +82,11 @@ struct Target {
 
         CPlusPlusMangling, ///< Generate C++ mangled names for result function, et al
 
+        ProfileCounters, ///< Like Profile, but also count hardware events (cycles, instructions, cache and branch misses) for each Func. x86-64 Linux only.
+        ProfileRoofline, ///< Like Profile, but also count the bytes loaded and stored and the arithmetic operations done by each Func, to compare against machine peaks.
+
+        PersistentAllocations, ///< Keep heap allocations alive between calls made with a user_context attached with halide_persistent_allocations_attach.
+
         FeatureEnd ///< A sentinel. Every target is considered to have this feature, and setting this feature does nothing.
     };
 
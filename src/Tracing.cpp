@@ -110,10 +110,8 @@ private:
         map<string, Function>::const_iterator iter = env.find(op->name);
         if (iter == env.end()) return;
         Function f = iter->second;
-        bool inlined = f.schedule().compute_level().is_inline();
-        if (f.has_update_definition()) inlined = false;
 
-        if (f.is_tracing_stores() || (global_level > 1 && !inlined)) {
+        if (tracing_stores(f)) {
             // Wrap each expr in a tracing call
 
             const vector<Expr> &values = op->values;
@@ -130,10 +128,29 @@ private:
                 traces[i] = Call::make(values[i].type(), Call::trace_expr, args, Call::Intrinsic);
             }
 
-            stmt = Provide::make(op->name, traces, op->args);
+            // Only take the traced path if the run-time filters
+            // might let the stores through.
+            Expr enabled = Variable::make(Bool(), op->name + ".trace_enabled");
+            stmt = IfThenElse::make(enabled, Provide::make(op->name, traces, op->args), op);
         }
     }
 
+    bool tracing_stores(Function f) {
+        bool inlined = f.schedule().compute_level().is_inline();
+        if (f.has_update_definition()) inlined = false;
+        return f.is_tracing_stores() || (global_level > 1 && !inlined);
+    }
+
+    // Ask the runtime once per realization whether the stores to f
+    // can be traced, so that the stores don't pay for tracing that
+    // has been turned off at run time.
+    Stmt define_trace_enabled(Function f, Stmt body) {
+        if (!tracing_stores(f)) return body;
+        Expr enabled = Call::make(Int(32), "halide_trace_func_enabled",
+                                  {f.name()}, Call::Extern);
+        return LetStmt::make(f.name() + ".trace_enabled", enabled != 0, body);
+    }
+
     void visit(const Realize *op) {
         IRMutator::visit(op);
         op = stmt.as<Realize>();
@@ -146,7 +163,7 @@ private:
 
             // Throw a tracing call before and after the realize body
             vector<Expr> args;
-            args.push_back(op->name);
+            args.push_back(op->name.str());
             args.push_back(halide_trace_begin_realization); // event type for begin realization
             args.push_back(Variable::make(Int(32), "pipeline.trace_id")); // pipeline id
             args.push_back(0); // value index
@@ -166,11 +183,13 @@ private:
             Stmt new_body = op->body;
             new_body = Block::make(new_body, Evaluate::make(call_after));
             new_body = LetStmt::make(op->name + ".trace_id", call_before, new_body);
+            new_body = define_trace_enabled(f, new_body);
             stmt = Realize::make(op->name, op->types, op->bounds, op->condition, new_body);
         } else if (f.is_tracing_stores() || f.is_tracing_loads()) {
             // We need a trace id defined to pass to the loads and stores
             Stmt new_body = op->body;
             new_body = LetStmt::make(op->name + ".trace_id", 0, new_body);
+            new_body = define_trace_enabled(f, new_body);
             stmt = Realize::make(op->name, op->types, op->bounds, op->condition, new_body);
         }
 
@@ -227,6 +246,38 @@ private:
         }
 
     }
+
+    void visit(const For *op) {
+        IRMutator::visit(op);
+        op = stmt.as<For>();
+        internal_assert(op);
+        if (op->for_type != ForType::Parallel) return;
+
+        // Parallel loops are named after the Func they compute.
+        string func_name = op->name.str();
+        func_name = func_name.substr(0, func_name.find('.'));
+        map<string, Function>::const_iterator iter = env.find(func_name);
+        if (iter == env.end()) return;
+        Function f = iter->second;
+        if (f.is_tracing_realizations() || global_level > 0) {
+            // Throw a tracing call around each task, so that the
+            // trace shows which thread ran which part of the loop.
+            vector<Expr> args;
+            args.push_back(op->name.str());
+            args.push_back(halide_trace_begin_parallel_task);
+            args.push_back(Variable::make(Int(32), f.name() + ".trace_id"));
+            args.push_back(0); // value index
+            args.push_back(0); // value
+            args.push_back(Variable::make(Int(32), op->name));
+
+            Expr call_before = Call::make(Int(32), Call::trace, args, Call::Intrinsic);
+            args[1] = halide_trace_end_parallel_task;
+            Expr call_after = Call::make(Int(32), Call::trace, args, Call::Intrinsic);
+            Stmt new_body = Block::make(Evaluate::make(call_before), op->body);
+            new_body = Block::make(new_body, Evaluate::make(call_after));
+            stmt = For::make(op->name, op->min, op->extent, op->for_type, op->device_api, new_body);
+        }
+    }
 };
 
 class RemoveRealizeOverOutput : public IRMutator {
@@ -521,7 +521,12 @@ class VectorizeLoops : public IRMutator {
                 Stmt new_stmt = s;
 
                 // Hide all the vectors in scope with a scalar version
-                // in the appropriate lane.
+                // in the appropriate lane. The scope iterates in sorted
+                // order, but any order works: the value of a lane can
+                // refer to the vector lets, which are still defined
+                // outside, and if it refers to one handled later,
+                // that substitution points it at the lane let
+                // wrapped around it instead.
                 for (Scope<Expr>::iterator iter = scope.begin(); iter != scope.end(); ++iter) {
                     string name = iter.name() + ".lane." + std::to_string(i);
                     Expr lane = extract_lane(iter.value(), i);
@@ -569,7 +574,7 @@ class VectorizeLoops : public IRMutator {
                 Expr new_expr = e;
 
                 // Hide all the vector let values in scope with a scalar version
-                // in the appropriate lane.
+                // in the appropriate lane. As above, the order doesn't matter.
                 for (Scope<Expr>::iterator iter = scope.begin(); iter != scope.end(); ++iter) {
                     string name = iter.name() + ".lane." + std::to_string(i);
                     Expr lane = extract_lane(iter.value(), i);
@@ -129,6 +129,27 @@ extern void halide_spawn_thread(void *user_context, void (*f)(void *), void *clo
  * routine, shuts down and then reinitializes the thread pool. */
 extern void halide_set_num_threads(int n);
 
+/** The x86 instruction set extensions that the runtime can detect on
+ * the host CPU. Used by halide_can_use_cpu_features. */
+typedef enum halide_cpu_feature_t {
+    halide_cpu_feature_sse41 = 1 << 0,
+    halide_cpu_feature_avx = 1 << 1,
+    halide_cpu_feature_avx2 = 1 << 2,
+    halide_cpu_feature_fma = 1 << 3,
+    halide_cpu_feature_fma4 = 1 << 4,
+    halide_cpu_feature_f16c = 1 << 5
+} halide_cpu_feature_t;
+
+/** Return the set of halide_cpu_feature_t flags that the host CPU
+ * and operating system support. The detection is done once, on the
+ * first call. Only available in the x86 runtime. Objects compiled for
+ * several targets use this to pick the variant of the pipeline to
+ * run. */
+// @{
+extern uint64_t halide_get_cpu_features();
+extern int halide_can_use_cpu_features(uint64_t features);
+// @}
+
 /** Halide calls these functions to allocate and free memory. To
  * replace in AOT code, use the halide_set_custom_malloc and
  * halide_set_custom_free, or (on platforms that support weak
@@ -151,6 +172,98 @@ extern halide_malloc_t halide_set_custom_malloc(halide_malloc_t user_malloc);
 extern halide_free_t halide_set_custom_free(halide_free_t user_free);
 //@}
 
+/** How the default halide_malloc allocates large blocks of host
+ * memory. Large intermediate buffers suffer from TLB misses, and on
+ * machines with several NUMA nodes from pages that were placed on the
+ * wrong node by whichever thread touched them first. Blocks of at
+ * least large_allocation_size bytes are mapped directly from the OS,
+ * so that they start out untouched, and the options below apply to
+ * them. With none of the options set, the pages are placed by the
+ * first thread to write to each of them, so a pipeline that computes
+ * a Func in parallel over its outermost dimension spreads it across
+ * the nodes that consume it. The options only have an effect on
+ * Linux. */
+struct halide_allocation_policy_t {
+    /** The smallest block that is mapped from the OS. Zero (the
+     * default) disables the policy, and all blocks come from malloc. */
+    size_t large_allocation_size;
+
+    /** Ask for transparent huge pages with madvise(MADV_HUGEPAGE). */
+    bool transparent_huge_pages;
+
+    /** Map explicit huge pages from the hugetlbfs pool with
+     * MAP_HUGETLB. Falls back to normal pages if the pool doesn't
+     * have enough free. */
+    bool explicit_huge_pages;
+
+    /** Touch the pages right away on the thread pool, one contiguous
+     * slab per thread, so that they are spread across the NUMA nodes
+     * in the same way as by a parallel loop over the outermost
+     * dimension. Useful when the block is first written by code that
+     * doesn't run in parallel. */
+    bool parallel_first_touch;
+};
+
+/** Set or get the policy the default halide_malloc uses for large
+ * blocks. To set it for JIT-compiled pipelines, use
+ * Halide::set_allocation_policy. */
+//@{
+extern void halide_set_allocation_policy(const struct halide_allocation_policy_t *policy);
+extern void halide_get_allocation_policy(struct halide_allocation_policy_t *policy);
+//@}
+
+/** Heap allocations made inside the tasks of a parallel loop come
+ * from a scratch arena instead of halide_malloc. Each task that
+ * allocates acquires an arena at its start and releases it at its
+ * end, and the arenas are kept between pipeline calls, so an
+ * allocation is usually just a pointer bump into memory the
+ * previous call already touched. Allocations that don't fit fall
+ * back to halide_malloc, and the arena grows to fit them the next
+ * time it's acquired. The arenas outlive any one pipeline call, so
+ * their own memory comes from halide_malloc with a NULL
+ * user_context. These are called by generated code. */
+//@{
+extern void *halide_scratch_arena_acquire(void *user_context);
+extern void halide_scratch_arena_release(void *user_context, void *arena);
+extern void *halide_scratch_arena_malloc(void *user_context, void *arena, int64_t size);
+extern void halide_scratch_arena_free(void *user_context, void *ptr);
+//@}
+
+/** Free the memory of all the scratch arenas not currently in use by
+ * a running pipeline. Also called when the runtime is unloaded.
+ *
+ * The arenas are a pool shared by every pipeline in the process, not
+ * tied to any one pipeline or call. The pool holds up to as many
+ * arenas as tasks have ever run at once, and each arena stays as big
+ * as the most memory a task ever allocated from it at once. Neither
+ * ever shrinks on its own, so a process that once ran a pipeline with
+ * big per-task buffers keeps that memory until it calls this. */
+extern void halide_scratch_arena_cleanup();
+
+/** Keep the heap allocations of pipelines compiled with the
+ * persistent_allocations target feature alive between calls made
+ * with this user_context, so that a pipeline called over and over
+ * with the same sizes (e.g. once per video frame) doesn't have to
+ * allocate and fault in fresh memory each time. An allocation is
+ * reused when the same allocation site asks for the same number of
+ * bytes, and replaced when its size changes. The user_context is
+ * the caller's own object (or NULL for pipelines compiled without
+ * the user_context feature). Call halide_persistent_allocations_release
+ * when it is destroyed to free the memory. Calls with a user_context
+ * that isn't attached allocate and free as usual. */
+//@{
+extern int halide_persistent_allocations_attach(void *user_context);
+extern void halide_persistent_allocations_release(void *user_context);
+//@}
+
+/** Used by generated code compiled with the persistent_allocations
+ * target feature in place of halide_malloc and halide_free. The
+ * site names the allocation within the pipeline. */
+//@{
+extern void *halide_persistent_malloc(void *user_context, const char *site, int64_t size);
+extern void halide_persistent_free(void *user_context, void *ptr);
+//@}
+
 /** Called when debug_to_file is used inside %Halide code.  See
  * Func::debug_to_file for how this is called
  *
@@ -170,7 +283,9 @@ enum halide_trace_event_code {halide_trace_load = 0,
                               halide_trace_consume = 6,
                               halide_trace_end_consume = 7,
                               halide_trace_begin_pipeline = 8,
-                              halide_trace_end_pipeline = 9};
+                              halide_trace_end_pipeline = 9,
+                              halide_trace_begin_parallel_task = 10,
+                              halide_trace_end_parallel_task = 11};
 
 // TODO: Update to use halide_type_t
 // Tracking issue filed here: https://github.com/halide/Halide/issues/980
@@ -192,11 +307,26 @@ struct halide_trace_event {
 /** Called when Funcs are marked as trace_load, trace_store, or
  * trace_realization. See Func::set_custom_trace. The default
  * implementation either prints events via halide_printf, or if
- * HL_TRACE_FILE is defined, dumps the trace to that file in a
- * yet-to-be-documented binary format (see src/runtime/tracing.cpp to
- * reverse engineer the format). If the trace is going to be large,
+ * HL_TRACE_FILE is defined, dumps the trace to that file in a binary
+ * format. Each event is a packet with a 48-byte header: the event id
+ * and parent id (int32 each), then one byte each of the event code,
+ * type code, bits, vector width, value index and number of
+ * coordinates, then the Func name, zero-terminated and truncated to
+ * 33 characters. The values and then the int32 coordinates follow
+ * the header. If HL_TRACE_TIMESTAMPS is set to a nonzero value, the
+ * top bit of the event code byte is set, and the header is 16 bytes
+ * longer: the time of the event in nanoseconds (int64) and the id of
+ * the thread that traced it (uint64) follow the name. Events are
+ * buffered in memory and written to the file in large batches, at
+ * the latest when each pipeline returns. If the trace is going to be large,
  * you may want to make the file a named pipe, and then read from that
- * pipe into gzip.
+ * pipe into gzip. If HL_TRACE_FORMAT is also set to "chrome", the
+ * file instead gets one JSON object per line in the Chrome trace event
+ * format, with a span on each thread for every realization,
+ * production, consumption, and parallel task. This can be loaded into
+ * chrome://tracing or Perfetto, or turned into a flame graph with
+ * util/HalideTraceFlameGraph. Loads and stores are not written in this
+ * format.
  *
  * halide_trace returns a unique ID which will be passed to future
  * events that "belong" to the earlier event as the parent id. The
@@ -212,6 +342,11 @@ struct halide_trace_event {
  *      end_consume
  *    end_realization
  *
+ * begin_parallel_task and end_parallel_task bracket each iteration of
+ * a parallel loop over a Func whose realizations are traced. Their
+ * parent is the production, and their only coordinate is the loop
+ * index.
+ *
  * Threading means that ownership cannot be inferred from the ordering
  * of events. There can be many active realizations of a given
  * function, or many active productions for a single
@@ -245,6 +380,44 @@ extern int halide_get_trace_file(void *user_context);
  * (flushing the trace). Returns zero on success. */
 extern int halide_shutdown_trace();
 
+/** Control at run time which of the trace events compiled into a
+ * pipeline get passed to the trace handler. These apply to custom
+ * trace handlers as well as the default one. Events that are filtered
+ * out cost very little, so a pipeline compiled with HL_TRACE=1 (which
+ * traces only realizations, not loads and stores) can be shipped with
+ * tracing disabled, and then enabled when a timeline of its schedule
+ * is wanted. Change the filters between pipeline runs, not during
+ * them. */
+// @{
+
+/** Turn all tracing on or off. On by default. */
+extern void halide_set_trace_enabled(bool enabled);
+
+/** Only trace the Funcs in the given comma-separated list. Pass NULL
+ * or an empty string to trace all of them. Pipeline begin and end
+ * events are always traced. Defaults to the value of the environment
+ * variable HL_TRACE_FUNCS. */
+extern void halide_set_trace_funcs(const char *funcs);
+
+/** Only trace loads and stores that touch the given region. Vector
+ * loads and stores are traced if any lane is inside the region. Pass
+ * zero dimensions to trace them everywhere. Defaults to the value of
+ * the environment variable HL_TRACE_REGION, which is a comma-separated
+ * list of a min and an extent for each dimension. */
+extern void halide_set_trace_region(int dimensions, const int32_t *min, const int32_t *extent);
+
+/** Only trace one in every n loads and stores. Pass zero to trace
+ * none of them, which leaves only the realization events. Defaults to
+ * the value of the environment variable HL_TRACE_SAMPLING, or 1. */
+extern void halide_set_trace_sampling(int n);
+
+/** Returns whether the loads and stores of the given Func might be
+ * traced at all under the current settings. Pipelines call this once
+ * per realization of a Func whose stores are traced, and skip
+ * straight to the untraced stores if it returns zero. */
+extern int halide_trace_func_enabled(void *user_context, const char *func);
+// @}
+
 /** All Halide GPU or device backend implementations much provide an interface
  * to be used with halide_device_malloc, etc.
  */
@@ -634,6 +807,34 @@ typedef struct buffer_t {
 
 #endif
 
+/** The largest number of dimensions a buffer may have. */
+#define HALIDE_BUFFER_MAX_DIMENSIONS 8
+
+#ifndef HALIDE_BUFFER_ND_T_DEFINED
+#define HALIDE_BUFFER_ND_T_DEFINED
+
+/**
+ * A buffer_t with room for more than four dimensions. Pipeline
+ * arguments with more than four dimensions take a pointer to one of
+ * these in place of a buffer_t. Everything but the fifth and later
+ * dimensions stays in the buffer_t at the start, so a pointer to one
+ * of these can be passed to runtime functions that take a buffer_t
+ * and only need the first four dimensions. As with buffer_t, the
+ * dimensions end at the first zero extent. Arguments with up to four
+ * dimensions are passed as a plain buffer_t, as before. */
+typedef struct halide_buffer_nd_t {
+    /** The first four dimensions, and everything else. */
+    buffer_t buf;
+
+    /** The extent, stride, and min of dimension 4 + i, with the same
+     * meaning as the fields of buffer_t. */
+    int32_t extent[HALIDE_BUFFER_MAX_DIMENSIONS - 4];
+    int32_t stride[HALIDE_BUFFER_MAX_DIMENSIONS - 4];
+    int32_t min[HALIDE_BUFFER_MAX_DIMENSIONS - 4];
+} halide_buffer_nd_t;
+
+#endif
+
 /** halide_scalar_value_t is a simple union able to represent all the well-known
  * scalar values in a filter argument. Note that it isn't tagged with a type;
  * you must ensure you know the proper type before accessing. Most user
@@ -746,9 +947,15 @@ extern int halide_enumerate_registered_filters(void *user_context, void* enumera
 
 /** Per-Func state tracked by the sampling profiler. */
 struct halide_profiler_func_stats {
-    /** Total time taken evaluating this Func (in nanoseconds). */
+    /** Total wall-clock time during which at least one thread was
+     * evaluating this Func (in nanoseconds). */
     uint64_t time;
 
+    /** Total time taken evaluating this Func summed over all threads
+     * (in nanoseconds). Divide by time to get the average number of
+     * threads working on this Func while it was running. */
+    uint64_t cpu_time;
+
     /** The name of this Func. A global constant string. */
     const char *name;
 
@@ -766,14 +973,42 @@ struct halide_profiler_func_stats {
 
     /** The peak stack allocation of this Func threads. */
     int stack_peak;
+
+    /** The heap memory allocated by this Func at the moment its
+     * pipeline reached its peak heap usage. Across the Funcs of a
+     * pipeline, this is the set of buffers live at the peak. */
+    int memory_at_peak;
+
+    /** Hardware events counted while evaluating this Func, summed
+     * over all threads. Only gathered by pipelines compiled with the
+     * profile_counters target feature. */
+    // @{
+    uint64_t cycles;
+    uint64_t instructions;
+    uint64_t cache_misses;
+    uint64_t branch_misses;
+    // @}
+
+    /** The bytes loaded and stored and the arithmetic operations
+     * done by this Func, estimated from the code of each loop and
+     * the number of times it ran. Only gathered by pipelines compiled
+     * with the profile_roofline target feature. */
+    // @{
+    uint64_t bytes;
+    uint64_t ops;
+    // @}
 };
 
 /** Per-pipeline state tracked by the sampling profiler. These exist
  * in a linked list. */
 struct halide_profiler_pipeline_stats {
-    /** Total time spent inside this pipeline (in nanoseconds) */
+    /** Total wall-clock time spent inside this pipeline (in nanoseconds) */
     uint64_t time;
 
+    /** Total time spent inside this pipeline summed over all threads
+     * (in nanoseconds) */
+    uint64_t cpu_time;
+
     /** The name of this pipeline. A global constant string. */
     const char *name;
 
@@ -809,6 +1044,13 @@ struct halide_profiler_pipeline_stats {
     int num_allocs;
 };
 
+/** The maximum number of threads the profiler can track at once. The
+ * time spent by any further threads is not sampled, and the report
+ * says how many there were. */
+enum {
+    halide_profiler_max_threads = 256
+};
+
 /** The global state of the profiler. */
 struct halide_profiler_state {
     /** Guards access to the fields below. If not locked, the sampling
@@ -826,18 +1068,38 @@ struct halide_profiler_state {
     /** An internal id used for bookkeeping. */
     int first_free_id;
 
-    /** The id of the current running Func. Set by the pipeline, read
-     * periodically by the profiler thread. */
+    /** Set to halide_profiler_please_stop to tell the profiler thread
+     * to halt. */
     int current_func;
 
     /** Is the profiler thread running. */
     bool started;
+
+    /** The id of the Func being run by each thread currently inside a
+     * pipeline. A thread claims a slot when it starts running a
+     * pipeline or a task of a parallel loop, and resets it to
+     * halide_profiler_unused_slot when it is done. Read periodically
+     * by the profiler thread. */
+    int thread_funcs[halide_profiler_max_threads];
+
+    /** Threads that find no free slot write their Func ids here
+     * instead. It is never sampled. */
+    int overflow_slot;
+
+    /** The number of times a thread found no free slot, since the
+     * last reset. */
+    int overflowed_threads;
 };
 
 /** Profiler func ids with special meanings. */
 enum {
-    /// current_func takes on this value when not inside Halide code
+    /// A thread's slot takes on this value when the thread is not
+    /// running any Func, e.g. while it waits for the tasks of a
+    /// parallel loop to complete.
     halide_profiler_outside_of_halide = -1,
+    /// Slots that no thread has claimed hold this value. Real func ids
+    /// are always greater than it.
+    halide_profiler_unused_slot = 0,
     /// Set current_func to this value to tell the profiling thread to
     /// halt. It will start up again next time you run a pipeline with
     /// profiling enabled.
@@ -35,6 +35,11 @@ WEAK void halide_spawn_thread(void *user_context, void (*f)(void *), void *closu
     halide_error(user_context, "halide_spawn_thread not implemented on this platform.");
 }
 
+WEAK uint64_t halide_current_thread_id() {
+    // There's only ever one thread.
+    return 0;
+}
+
 WEAK void halide_mutex_cleanup(halide_mutex *mutex_arg) {
 }
 
@@ -24,6 +24,9 @@ extern long dispatch_semaphore_wait(dispatch_semaphore_t dsema, dispatch_time_t
 extern long dispatch_semaphore_signal(dispatch_semaphore_t dsema);
 extern void dispatch_release(void *object);
 
+typedef long pthread_t;
+extern pthread_t pthread_self();
+
 
 WEAK int halide_do_task(void *user_context, halide_task_t f, int idx,
                         uint8_t *closure);
@@ -34,6 +37,10 @@ WEAK void halide_spawn_thread(void *user_context, void (*f)(void *), void *closu
     dispatch_async_f(dispatch_get_global_queue(0, 0), closure, f);
 }
 
+WEAK uint64_t halide_current_thread_id() {
+    return (uint64_t)pthread_self();
+}
+
 namespace Halide { namespace Runtime { namespace Internal {
 
 struct gcd_mutex {
@@ -0,0 +1,216 @@
+#include "HalideRuntime.h"
+
+// Reads hardware performance counters for each thread via
+// perf_event_open, and bills them to the Func each thread is
+// running. Used by pipelines compiled with the profile_counters
+// target feature.
+
+// Only linked into x86-64 Linux runtimes (see LLVM_Runtime_Linker.cpp),
+// and lowering rejects the feature elsewhere. The syscall numbers are
+// the x86-64 ones, so there is nothing here for 32-bit runtimes.
+#ifdef BITS_64
+
+extern "C" {
+
+#define SYS_PERF_EVENT_OPEN 298
+#define SYS_GETTID 186
+
+extern int syscall(int num, ...);
+extern ssize_t read(int fd, void *buf, size_t count);
+
+}
+
+namespace Halide { namespace Runtime { namespace Internal {
+
+// The first part of struct perf_event_attr. Passing its size tells
+// the kernel that the rest is zero.
+struct perf_event_attr {
+    uint32_t type;
+    uint32_t size;
+    uint64_t config;
+    uint64_t sample_period;
+    uint64_t sample_type;
+    uint64_t read_format;
+    uint64_t flags;
+    uint32_t wakeup_events;
+    uint32_t bp_type;
+    uint64_t config1;
+};
+
+#define PERF_TYPE_HARDWARE 0
+#define PERF_FORMAT_GROUP (1 << 3)
+#define PERF_ATTR_FLAG_EXCLUDE_KERNEL (1 << 5)
+#define PERF_ATTR_FLAG_EXCLUDE_HV (1 << 6)
+
+// In the same order as the counter fields of halide_profiler_func_stats.
+enum {
+    PERF_COUNT_HW_CPU_CYCLES = 0,
+    PERF_COUNT_HW_INSTRUCTIONS = 1,
+    PERF_COUNT_HW_CACHE_MISSES = 3,
+    PERF_COUNT_HW_BRANCH_MISSES = 5
+};
+const int num_perf_counters = 4;
+
+struct thread_perf_counters {
+    // The thread these counters were opened for, or zero if this
+    // entry is unused.
+    int tid;
+    // The file descriptors of the counters. The first leads the
+    // group. Negative if the counters could not be opened.
+    int fds[num_perf_counters];
+    // The values read at the thread's last Func transition.
+    uint64_t last[num_perf_counters];
+    bool have_last;
+};
+
+WEAK thread_perf_counters perf_counters[halide_profiler_max_threads];
+WEAK bool perf_counters_warned = false;
+
+// The counters of the thread that holds each profiler slot, as of the
+// last time it entered Halide code through that slot.
+WEAK thread_perf_counters *slot_perf_counters[halide_profiler_max_threads];
+
+WEAK void open_perf_counters(thread_perf_counters *c) {
+    const uint64_t configs[num_perf_counters] = {
+        PERF_COUNT_HW_CPU_CYCLES,
+        PERF_COUNT_HW_INSTRUCTIONS,
+        PERF_COUNT_HW_CACHE_MISSES,
+        PERF_COUNT_HW_BRANCH_MISSES
+    };
+    for (int i = 0; i < num_perf_counters; i++) {
+        perf_event_attr attr;
+        memset(&attr, 0, sizeof(attr));
+        attr.type = PERF_TYPE_HARDWARE;
+        attr.size = sizeof(attr);
+        attr.config = configs[i];
+        attr.read_format = PERF_FORMAT_GROUP;
+        // Only count user space, which unprivileged processes are
+        // usually allowed to do.
+        attr.flags = PERF_ATTR_FLAG_EXCLUDE_KERNEL | PERF_ATTR_FLAG_EXCLUDE_HV;
+        int group_fd = (i == 0) ? -1 : c->fds[0];
+        c->fds[i] = syscall(SYS_PERF_EVENT_OPEN, &attr, 0, -1, group_fd, 0);
+        if (c->fds[i] < 0) {
+            // It's all or nothing.
+            for (int j = 0; j < i; j++) {
+                close(c->fds[j]);
+            }
+            c->fds[0] = -1;
+            if (!perf_counters_warned) {
+                perf_counters_warned = true;
+                halide_print(NULL, "Could not open hardware performance counters. "
+                             "Check /proc/sys/kernel/perf_event_paranoid.\n");
+            }
+            return;
+        }
+    }
+    c->have_last = false;
+}
+
+// Find the counters of the current thread, opening them the first
+// time the thread gets here. Returns NULL if they aren't available.
+WEAK thread_perf_counters *perf_counters_for_current_thread() {
+    int tid = syscall(SYS_GETTID);
+    // Probe from a slot picked by the tid, so that a thread usually
+    // finds its entry on the first try.
+    for (int n = 0; n < halide_profiler_max_threads; n++) {
+        thread_perf_counters *c = perf_counters + (tid + n) % halide_profiler_max_threads;
+        if (c->tid == tid) {
+            return c->fds[0] >= 0 ? c : NULL;
+        }
+        // Only the thread itself ever looks at an entry with its tid,
+        // so there's nothing to race with once the entry is claimed.
+        if (c->tid == 0 && __sync_bool_compare_and_swap(&c->tid, 0, tid)) {
+            open_perf_counters(c);
+            return c->fds[0] >= 0 ? c : NULL;
+        }
+    }
+    return NULL;
+}
+
+// Find the counters of the thread holding a profiler slot. A slot
+// changes hands only while it's outside of Halide code (it is claimed
+// in that state), so the thread is only looked up then, and the answer
+// is cached for the Func transitions that follow.
+WEAK thread_perf_counters *perf_counters_for_slot(int *slot) {
+    halide_profiler_state *s = halide_profiler_get_state();
+    int i = (int)(slot - s->thread_funcs);
+    if (i < 0 || i >= halide_profiler_max_threads) {
+        // The thread didn't get a slot of its own, so it isn't being
+        // sampled.
+        return NULL;
+    }
+    if (*slot <= halide_profiler_outside_of_halide) {
+        slot_perf_counters[i] = perf_counters_for_current_thread();
+    }
+    return slot_perf_counters[i];
+}
+
+WEAK bool read_perf_counters(thread_perf_counters *c, uint64_t *values) {
+    // With PERF_FORMAT_GROUP the leader reads the number of counters
+    // followed by their values.
+    uint64_t buf[num_perf_counters + 1];
+    if (read(c->fds[0], buf, sizeof(buf)) != (ssize_t)sizeof(buf) ||
+        buf[0] != num_perf_counters) {
+        return false;
+    }
+    for (int i = 0; i < num_perf_counters; i++) {
+        values[i] = buf[i + 1];
+    }
+    return true;
+}
+
+WEAK void close_perf_counters() {
+    for (int i = 0; i < halide_profiler_max_threads; i++) {
+        thread_perf_counters *c = perf_counters + i;
+        if (c->tid != 0 && c->fds[0] >= 0) {
+            for (int j = 0; j < num_perf_counters; j++) {
+                close(c->fds[j]);
+            }
+        }
+        c->fds[0] = -1;
+        c->tid = 0;
+        slot_perf_counters[i] = NULL;
+    }
+}
+
+}}} // namespace Halide::Runtime::Internal
+
+extern "C" {
+
+// Used in place of halide_profiler_set_current_func when counting
+// events. Bills the events since this thread's last transition to the
+// Func the slot was running, then records the new Func.
+WEAK int halide_profiler_set_current_func_counted(void *pipeline_state, int *slot, int tok, int t) {
+    thread_perf_counters *c = perf_counters_for_slot(slot);
+    uint64_t values[num_perf_counters];
+    if (c && read_perf_counters(c, values)) {
+        halide_profiler_pipeline_stats *p = (halide_profiler_pipeline_stats *)pipeline_state;
+        int func = *slot - tok;
+        if (c->have_last && p &&
+            *slot > halide_profiler_unused_slot &&
+            func >= 0 && func < p->num_funcs) {
+            halide_profiler_func_stats *fs = p->funcs + func;
+            __sync_add_and_fetch(&fs->cycles, values[0] - c->last[0]);
+            __sync_add_and_fetch(&fs->instructions, values[1] - c->last[1]);
+            __sync_add_and_fetch(&fs->cache_misses, values[2] - c->last[2]);
+            __sync_add_and_fetch(&fs->branch_misses, values[3] - c->last[3]);
+        }
+        for (int i = 0; i < num_perf_counters; i++) {
+            c->last[i] = values[i];
+        }
+        c->have_last = true;
+    }
+    *slot = (t < 0) ? t : tok + t;
+    return 0;
+}
+
+}
+
+namespace {
+__attribute__((destructor))
+WEAK void halide_perf_counters_shutdown() {
+    close_perf_counters();
+}
+}
+
+#endif  // BITS_64
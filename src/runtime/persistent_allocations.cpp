@@ -0,0 +1,189 @@
+#include "HalideRuntime.h"
+#include "scoped_mutex_lock.h"
+
+// Heap allocations that persist between calls to a pipeline compiled
+// with the persistent_allocations target feature. The caller opts in
+// by attaching a user_context. Each allocation made with that
+// user_context is kept when the pipeline frees it, and handed back
+// the next time the same allocation site asks for the same number of
+// bytes. Calls with a user_context that isn't attached just use
+// halide_malloc and halide_free.
+
+namespace Halide { namespace Runtime { namespace Internal {
+
+const size_t persistent_alignment = 128;
+
+struct persistent_context;
+
+// Every block handed out has one of these just before it.
+struct persistent_block {
+    // The context that owns the block, or NULL if it should be freed
+    // with the allocation it lives in.
+    persistent_context *context;
+    persistent_block *next;
+
+    // The memory from halide_malloc that the block lives in.
+    void *allocation;
+
+    // A copy of the name of the allocation site, and the size it
+    // asked for.
+    char *site;
+    size_t size;
+
+    bool in_use;
+};
+
+struct persistent_context {
+    void *user_context;
+    persistent_block *blocks;
+    persistent_context *next;
+};
+
+WEAK halide_mutex persistent_lock;
+WEAK persistent_context *persistent_contexts = NULL;
+
+WEAK persistent_context *find_persistent_context(void *user_context) {
+    persistent_context *c = persistent_contexts;
+    while (c && c->user_context != user_context) {
+        c = c->next;
+    }
+    return c;
+}
+
+// Allocate a block with its header, and room after the data for a
+// copy of the site name if there is one.
+WEAK persistent_block *new_persistent_block(void *user_context, const char *site, size_t size) {
+    size_t site_bytes = site ? strlen(site) + 1 : 0;
+    size_t total = sizeof(persistent_block) + persistent_alignment + size + site_bytes;
+    void *allocation = halide_malloc(user_context, total);
+    if (!allocation) {
+        return NULL;
+    }
+    uintptr_t p = ((uintptr_t)allocation + sizeof(persistent_block) + persistent_alignment - 1) &
+        ~(uintptr_t)(persistent_alignment - 1);
+    persistent_block *block = (persistent_block *)p - 1;
+    block->context = NULL;
+    block->next = NULL;
+    block->allocation = allocation;
+    block->site = NULL;
+    if (site) {
+        block->site = (char *)p + size;
+        memcpy(block->site, site, site_bytes);
+    }
+    block->size = size;
+    block->in_use = true;
+    return block;
+}
+
+WEAK void *persistent_block_data(persistent_block *block) {
+    return block + 1;
+}
+
+}}} // namespace Halide::Runtime::Internal
+
+using namespace Halide::Runtime::Internal;
+
+extern "C" {
+
+WEAK int halide_persistent_allocations_attach(void *user_context) {
+    ScopedMutexLock lock(&persistent_lock);
+    if (find_persistent_context(user_context)) {
+        return 0;
+    }
+    persistent_context *c = (persistent_context *)halide_malloc(user_context, sizeof(persistent_context));
+    if (!c) {
+        return halide_error_code_out_of_memory;
+    }
+    c->user_context = user_context;
+    c->blocks = NULL;
+    c->next = persistent_contexts;
+    persistent_contexts = c;
+    return 0;
+}
+
+WEAK void halide_persistent_allocations_release(void *user_context) {
+    {
+        // Hold the lock for the whole walk, because a pipeline still
+        // running with this user_context may free its blocks at any
+        // time.
+        ScopedMutexLock lock(&persistent_lock);
+        persistent_context **link = &persistent_contexts;
+        while (*link && (*link)->user_context != user_context) {
+            link = &(*link)->next;
+        }
+        persistent_context *c = *link;
+        if (!c) {
+            return;
+        }
+        *link = c->next;
+
+        persistent_block *block = c->blocks;
+        while (block) {
+            persistent_block *next = block->next;
+            if (block->in_use) {
+                // The pipeline is still running. It will free the
+                // block itself.
+                block->context = NULL;
+            } else {
+                halide_free(user_context, block->allocation);
+            }
+            block = next;
+        }
+        halide_free(user_context, c);
+    }
+}
+
+WEAK void *halide_persistent_malloc(void *user_context, const char *site, int64_t size) {
+    if (size <= 0) {
+        return NULL;
+    }
+    size_t bytes = (size_t)size;
+
+    ScopedMutexLock lock(&persistent_lock);
+    persistent_context *c = find_persistent_context(user_context);
+    if (!c) {
+        persistent_block *block = new_persistent_block(user_context, NULL, bytes);
+        return block ? persistent_block_data(block) : NULL;
+    }
+
+    // Reuse the block this site had last time if it's the same
+    // size. If the bounds changed, free it and make a new one.
+    persistent_block **link = &c->blocks;
+    while (*link) {
+        persistent_block *block = *link;
+        if (!block->in_use && strcmp(block->site, site) == 0) {
+            if (block->size == bytes) {
+                block->in_use = true;
+                return persistent_block_data(block);
+            }
+            *link = block->next;
+            halide_free(user_context, block->allocation);
+        } else {
+            link = &block->next;
+        }
+    }
+
+    persistent_block *block = new_persistent_block(user_context, site, bytes);
+    if (!block) {
+        return NULL;
+    }
+    block->context = c;
+    block->next = c->blocks;
+    c->blocks = block;
+    return persistent_block_data(block);
+}
+
+WEAK void halide_persistent_free(void *user_context, void *ptr) {
+    if (!ptr) {
+        return;
+    }
+    persistent_block *block = (persistent_block *)ptr - 1;
+    ScopedMutexLock lock(&persistent_lock);
+    if (block->context) {
+        block->in_use = false;
+    } else {
+        halide_free(user_context, block->allocation);
+    }
+}
+
+}
@@ -5,25 +5,120 @@ extern "C" {
 extern void *malloc(size_t);
 extern void free(void *);
 
+#ifdef LINUX
+extern void *mmap(void *addr, size_t length, int prot, int flags, int fd, long offset);
+extern int munmap(void *addr, size_t length);
+extern int madvise(void *addr, size_t length, int advice);
+extern int halide_host_cpu_count();
+
+#define PROT_READ 0x1
+#define PROT_WRITE 0x2
+#define MAP_PRIVATE 0x02
+#define MAP_ANONYMOUS 0x20
+#define MAP_HUGETLB 0x40000
+#define MAP_FAILED ((void *)-1)
+#define MADV_HUGEPAGE 14
+#endif
+
 }
 
 namespace Halide { namespace Runtime { namespace Internal {
 
+WEAK halide_allocation_policy_t allocation_policy = {0, false, false, false};
+
+// Every block has two words before the pointer we return. The first
+// is the address to free or unmap, and the second is the size of the
+// mapping, or zero if the block came from malloc.
+const size_t alignment = 128;
+
+#ifdef LINUX
+
+const size_t page_size = 4096;
+const size_t huge_page_size = 2 * 1024 * 1024;
+
+struct first_touch_closure {
+    uint8_t *start;
+    size_t size;
+    int slabs;
+};
+
+WEAK int first_touch_task(void *user_context, int idx, uint8_t *c) {
+    first_touch_closure *closure = (first_touch_closure *)c;
+    size_t slab = (closure->size / closure->slabs + page_size - 1) & ~(page_size - 1);
+    size_t begin = idx * slab;
+    size_t end = begin + slab < closure->size ? begin + slab : closure->size;
+    for (size_t i = begin; i < end; i += page_size) {
+        ((volatile uint8_t *)closure->start)[i] = 0;
+    }
+    return 0;
+}
+
+WEAK void *large_malloc(void *user_context, size_t x) {
+    // Leave room before the block for the header, and after it so
+    // that reading a little past the end is safe.
+    size_t size = x + 2 * alignment;
+    void *base = MAP_FAILED;
+    if (allocation_policy.explicit_huge_pages) {
+        size = (size + huge_page_size - 1) & ~(huge_page_size - 1);
+        base = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+    }
+    if (base == MAP_FAILED) {
+        size = (x + 2 * alignment + page_size - 1) & ~(page_size - 1);
+        base = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (base == MAP_FAILED) {
+            return NULL;
+        }
+        if (allocation_policy.transparent_huge_pages) {
+            // Failure just means the kernel doesn't support them.
+            madvise(base, size, MADV_HUGEPAGE);
+        }
+    }
+
+    if (allocation_policy.parallel_first_touch) {
+        first_touch_closure closure = {(uint8_t *)base, size, halide_host_cpu_count()};
+        if (closure.slabs < 1) closure.slabs = 1;
+        halide_do_par_for(user_context, first_touch_task, 0, closure.slabs, (uint8_t *)&closure);
+    }
+
+    void *ptr = (uint8_t *)base + alignment;
+    ((void **)ptr)[-1] = base;
+    ((size_t *)ptr)[-2] = size;
+    return ptr;
+}
+
+#endif
+
 WEAK void *default_malloc(void *user_context, size_t x) {
+#ifdef LINUX
+    if (allocation_policy.large_allocation_size && x >= allocation_policy.large_allocation_size) {
+        void *ptr = large_malloc(user_context, x);
+        if (ptr) {
+            return ptr;
+        }
+    }
+#endif
+
     // Allocate enough space for aligning the pointer we return.
-    const size_t alignment = 128;
-    void *orig = malloc(x + alignment);
+    void *orig = malloc(x + alignment + 2 * sizeof(void *));
     if (orig == NULL) {
         // Will result in a failed assertion and a call to halide_error
         return NULL;
     }
     // We want to store the original pointer prior to the pointer we return.
-    void *ptr = (void *)(((size_t)orig + alignment + sizeof(void*) - 1) & ~(alignment - 1));
+    void *ptr = (void *)(((size_t)orig + alignment + 2 * sizeof(void *) - 1) & ~(alignment - 1));
     ((void **)ptr)[-1] = orig;
+    ((size_t *)ptr)[-2] = 0;
     return ptr;
 }
 
 WEAK void default_free(void *user_context, void *ptr) {
+#ifdef LINUX
+    size_t mapped_size = ((size_t *)ptr)[-2];
+    if (mapped_size) {
+        munmap(((void **)ptr)[-1], mapped_size);
+        return;
+    }
+#endif
     free(((void**)ptr)[-1]);
 }
 
@@ -54,4 +149,12 @@ WEAK void halide_free(void *user_context, void *ptr) {
     custom_free(user_context, ptr);
 }
 
+WEAK void halide_set_allocation_policy(const halide_allocation_policy_t *policy) {
+    allocation_policy = *policy;
+}
+
+WEAK void halide_get_allocation_policy(halide_allocation_policy_t *policy) {
+    *policy = allocation_policy;
+}
+
 }
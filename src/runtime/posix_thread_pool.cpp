@@ -35,6 +35,7 @@ typedef long pthread_mutexattr_t;
 extern int pthread_create(pthread_t *thread, pthread_attr_t const * attr,
                           void *(*start_routine)(void *), void * arg);
 extern int pthread_join(pthread_t thread, void **retval);
+extern pthread_t pthread_self();
 extern int pthread_cond_init(pthread_cond_t *cond, const pthread_condattr_t *attr);
 extern int pthread_cond_wait(pthread_cond_t *cond, pthread_mutex_t *mutex);
 extern int pthread_cond_broadcast(pthread_cond_t *cond);
@@ -310,6 +311,10 @@ WEAK void halide_spawn_thread(void *user_context, void (*f)(void *), void *closu
     pthread_create(&thread, NULL, spawn_thread_helper, t);
 }
 
+WEAK uint64_t halide_current_thread_id() {
+    return (uint64_t)pthread_self();
+}
+
 WEAK void halide_mutex_cleanup(halide_mutex *mutex_arg) {
     pthread_mutex_t *mutex = (pthread_mutex_t *)mutex_arg;
     pthread_mutex_destroy(mutex);
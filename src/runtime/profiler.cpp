@@ -1,6 +1,7 @@
 #include "HalideRuntime.h"
 #include "printer.h"
 #include "scoped_mutex_lock.h"
+#include "scoped_spin_lock.h"
 
 // Note: The profiler thread may out-live any valid user_context, or
 // be used across many different user_contexts, so nothing it calls
@@ -9,7 +10,9 @@
 extern "C" {
 // Returns the address of the global halide_profiler state
 WEAK halide_profiler_state *halide_profiler_get_state() {
-    static halide_profiler_state s = {{{0}}, NULL, 1, 0, 0, false};
+    // Func ids start above halide_profiler_unused_slot, which is
+    // zero, so the thread slots all start out unused.
+    static halide_profiler_state s = {{{0}}, NULL, 1, 1, halide_profiler_outside_of_halide, false, {0}, 0, 0};
     return &s;
 }
 }
@@ -38,6 +41,7 @@ WEAK halide_profiler_pipeline_stats *find_or_create_pipeline(const char *pipelin
     p->num_funcs = num_funcs;
     p->runs = 0;
     p->time = 0;
+    p->cpu_time = 0;
     p->samples = 0;
     p->memory_current = 0;
     p->memory_peak = 0;
@@ -50,19 +54,31 @@ WEAK halide_profiler_pipeline_stats *find_or_create_pipeline(const char *pipelin
     }
     for (int i = 0; i < num_funcs; i++) {
         p->funcs[i].time = 0;
+        p->funcs[i].cpu_time = 0;
         p->funcs[i].name = (const char *)(func_names[i]);
         p->funcs[i].memory_current = 0;
         p->funcs[i].memory_peak = 0;
         p->funcs[i].memory_total = 0;
         p->funcs[i].num_allocs = 0;
         p->funcs[i].stack_peak = 0;
+        p->funcs[i].memory_at_peak = 0;
+        p->funcs[i].cycles = 0;
+        p->funcs[i].instructions = 0;
+        p->funcs[i].cache_misses = 0;
+        p->funcs[i].branch_misses = 0;
+        p->funcs[i].bytes = 0;
+        p->funcs[i].ops = 0;
     }
     s->first_free_id += num_funcs;
     s->pipelines = p;
     return p;
 }
 
-WEAK void bill_func(halide_profiler_state *s, int func_id, uint64_t time) {
+// Bill a func for the wall-clock time it was running, and for the time
+// taken summed over the threads running it. Returns the pipeline the
+// func belongs to.
+WEAK halide_profiler_pipeline_stats *bill_func(halide_profiler_state *s, int func_id,
+                                               uint64_t time, uint64_t cpu_time) {
     halide_profiler_pipeline_stats *p_prev = NULL;
     for (halide_profiler_pipeline_stats *p = s->pipelines; p;
          p = (halide_profiler_pipeline_stats *)(p->next)) {
@@ -74,13 +90,51 @@ WEAK void bill_func(halide_profiler_state *s, int func_id, uint64_t time) {
                 s->pipelines = p;
             }
             p->funcs[func_id - p->first_func_id].time += time;
-            p->time += time;
-            p->samples++;
-            return;
+            p->funcs[func_id - p->first_func_id].cpu_time += cpu_time;
+            p->cpu_time += cpu_time;
+            return p;
         }
         p_prev = p;
     }
     // Someone must have called reset_state while a kernel was running. Do nothing.
+    return NULL;
+}
+
+// Bill the time since the last sample to whatever each thread is
+// currently running.
+WEAK void take_sample(halide_profiler_state *s, uint64_t time) {
+    // Gather the ids of the running funcs, sorted so that threads
+    // running the same func are adjacent. The ids of the funcs of a
+    // pipeline are contiguous, so the funcs of each pipeline end up
+    // adjacent too.
+    int funcs[halide_profiler_max_threads];
+    int num_funcs = 0;
+    for (int i = 0; i < halide_profiler_max_threads; i++) {
+        int func = s->thread_funcs[i];
+        if (func > halide_profiler_unused_slot) {
+            int j = num_funcs++;
+            while (j > 0 && funcs[j - 1] > func) {
+                funcs[j] = funcs[j - 1];
+                j--;
+            }
+            funcs[j] = func;
+        }
+    }
+
+    halide_profiler_pipeline_stats *last_pipeline = NULL;
+    for (int i = 0; i < num_funcs; ) {
+        int threads = 1;
+        while (i + threads < num_funcs && funcs[i + threads] == funcs[i]) {
+            threads++;
+        }
+        halide_profiler_pipeline_stats *p = bill_func(s, funcs[i], time, time * threads);
+        if (p && p != last_pipeline) {
+            p->time += time;
+            p->samples++;
+            last_pipeline = p;
+        }
+        i += threads;
+    }
 }
 
 WEAK void sampling_profiler_thread(void *) {
@@ -95,14 +149,12 @@ WEAK void sampling_profiler_thread(void *) {
         uint64_t t = t1;
         while (1) {
             uint64_t t_now = halide_current_time_ns(NULL);
-            int func = s->current_func;
-            if (func == halide_profiler_please_stop) {
+            if (s->current_func == halide_profiler_please_stop) {
                 break;
-            } else if (func >= 0) {
-                // Assume all time since I was last awake is due to
-                // the currently running func.
-                bill_func(s, func, t_now - t);
             }
+            // Assume all time since I was last awake is due to the
+            // funcs the threads are currently running.
+            take_sample(s, t_now - t);
             t = t_now;
 
             // Release the lock, sleep, reacquire.
@@ -136,6 +188,106 @@ void sync_compare_max_and_swap(T *ptr, T val) {
 
 }
 
+namespace Halide { namespace Runtime { namespace Internal {
+
+// An allocation or free, for the allocation timeline.
+struct memory_event {
+    int64_t time;
+    halide_profiler_pipeline_stats *pipeline;
+    int func_id;
+    // Positive for allocations and negative for frees.
+    int bytes;
+    // The heap memory of the pipeline after the event.
+    int pipeline_current;
+};
+
+const int max_memory_events = 4096;
+
+// If the environment variable HL_MEMORY_TIMELINE names a file, every
+// heap allocation and free is recorded here, and then written to that
+// file as csv when this fills up or when the profiler reports.
+WEAK bool memory_timeline_initialized = false;
+WEAK const char *memory_timeline_filename = NULL;
+WEAK int memory_timeline_fd = -1;
+WEAK memory_event memory_events[max_memory_events];
+WEAK int num_memory_events = 0;
+WEAK int memory_timeline_lock = 0;
+
+// Guards the snapshot of what's live when a pipeline reaches a new
+// peak.
+WEAK int memory_peak_lock = 0;
+
+#define O_CREAT 64
+#define O_TRUNC 512
+#define O_WRONLY 1
+
+// Write out the recorded events. Must hold memory_timeline_lock.
+WEAK void flush_memory_timeline(void *user_context) {
+    if (!num_memory_events) return;
+    char line_buf[512];
+    Printer<StringStreamPrinter, sizeof(line_buf)> sstr(user_context, line_buf);
+    if (memory_timeline_fd < 0) {
+        memory_timeline_fd = open(memory_timeline_filename, O_CREAT | O_TRUNC | O_WRONLY, 0644);
+        if (memory_timeline_fd < 0) {
+            halide_print(user_context, "Could not open the file named by HL_MEMORY_TIMELINE\n");
+            memory_timeline_filename = NULL;
+            num_memory_events = 0;
+            return;
+        }
+        sstr << "time_ns,pipeline,func,bytes,pipeline_bytes\n";
+        write(memory_timeline_fd, sstr.str(), sstr.size());
+    }
+    for (int i = 0; i < num_memory_events; i++) {
+        const memory_event &e = memory_events[i];
+        sstr.clear();
+        sstr << e.time << ","
+             << e.pipeline->name << ","
+             << e.pipeline->funcs[e.func_id].name << ","
+             << e.bytes << ","
+             << e.pipeline_current << "\n";
+        write(memory_timeline_fd, sstr.str(), sstr.size());
+    }
+    num_memory_events = 0;
+}
+
+// Write out the recorded events and close the file. Called at
+// shutdown, when no more events can arrive.
+WEAK void close_memory_timeline(void *user_context) {
+    flush_memory_timeline(user_context);
+    if (memory_timeline_fd >= 0) {
+        close(memory_timeline_fd);
+        memory_timeline_fd = -1;
+    }
+    memory_timeline_filename = NULL;
+}
+
+WEAK void record_memory_event(void *user_context, halide_profiler_pipeline_stats *p,
+                              int func_id, int bytes, int pipeline_current) {
+    if (!memory_timeline_initialized) {
+        ScopedSpinLock lock(&memory_timeline_lock);
+        if (!memory_timeline_initialized) {
+            memory_timeline_filename = getenv("HL_MEMORY_TIMELINE");
+            __sync_synchronize();
+            memory_timeline_initialized = true;
+        }
+    }
+    if (!memory_timeline_filename) return;
+
+    int64_t t = halide_current_time_ns(user_context);
+    ScopedSpinLock lock(&memory_timeline_lock);
+    if (num_memory_events == max_memory_events) {
+        flush_memory_timeline(user_context);
+    }
+    memory_event &e = memory_events[num_memory_events++];
+    e.time = t;
+    e.pipeline = p;
+    e.func_id = func_id;
+    e.bytes = bytes;
+    e.pipeline_current = pipeline_current;
+}
+
+}}} // namespace Halide::Runtime::Internal
+
 extern "C" {
 // Returns the address of the pipeline state associated with pipeline_name.
 WEAK halide_profiler_pipeline_stats *halide_profiler_get_pipeline_state(const char *pipeline_name) {
@@ -180,6 +332,27 @@ WEAK int halide_profiler_pipeline_start(void *user_context,
     return p->first_func_id;
 }
 
+WEAK int *halide_profiler_claim_slot(void *state) {
+    halide_profiler_state *s = (halide_profiler_state *)state;
+    for (int i = 0; i < halide_profiler_max_threads; i++) {
+        if (s->thread_funcs[i] == halide_profiler_unused_slot &&
+            __sync_bool_compare_and_swap(&s->thread_funcs[i],
+                                         halide_profiler_unused_slot,
+                                         halide_profiler_outside_of_halide)) {
+            return &s->thread_funcs[i];
+        }
+    }
+    // Sharing a slot would bill one thread's time to whatever another
+    // happens to be running, so the thread goes unsampled instead, and
+    // the report says so.
+    __sync_fetch_and_add(&s->overflowed_threads, 1);
+    return &s->overflow_slot;
+}
+
+WEAK void halide_profiler_release_slot(void *user_context, void *slot) {
+    *((volatile int *)slot) = halide_profiler_unused_slot;
+}
+
 WEAK void halide_profiler_stack_peak_update(void *user_context,
                                             void *pipeline_state,
                                             int *f_values) {
@@ -223,17 +396,44 @@ WEAK void halide_profiler_memory_allocate(void *user_context,
     // current desctructor (called on profiler shutdown) does not free the structs
     // unless user specifically calls halide_profiler_reset().
 
-    // Update per-pipeline memory stats
-    __sync_add_and_fetch(&p_stats->num_allocs, 1);
-    __sync_add_and_fetch(&p_stats->memory_total, incr);
-    int p_mem_current = __sync_add_and_fetch(&p_stats->memory_current, incr);
-    sync_compare_max_and_swap(&p_stats->memory_peak, p_mem_current);
-
     // Update per-func memory stats
     __sync_add_and_fetch(&f_stats->num_allocs, 1);
     __sync_add_and_fetch(&f_stats->memory_total, incr);
     int f_mem_current = __sync_add_and_fetch(&f_stats->memory_current, incr);
     sync_compare_max_and_swap(&f_stats->memory_peak, f_mem_current);
+
+    // Update per-pipeline memory stats
+    __sync_add_and_fetch(&p_stats->num_allocs, 1);
+    __sync_add_and_fetch(&p_stats->memory_total, incr);
+    int p_mem_current = __sync_add_and_fetch(&p_stats->memory_current, incr);
+    if (p_mem_current > p_stats->memory_peak) {
+        // A new peak. Remember what each func had allocated at the
+        // time. Other threads may be allocating and freeing at the
+        // same time, so this is only a consistent snapshot if the
+        // pipeline allocates from one thread at a time.
+        ScopedSpinLock lock(&memory_peak_lock);
+        if (p_mem_current > p_stats->memory_peak) {
+            p_stats->memory_peak = p_mem_current;
+            for (int i = 0; i < p_stats->num_funcs; i++) {
+                p_stats->funcs[i].memory_at_peak = p_stats->funcs[i].memory_current;
+            }
+        }
+    }
+
+    record_memory_event(user_context, p_stats, func_id, incr, p_mem_current);
+}
+
+// Called before each loop by pipelines compiled with the
+// profile_roofline feature, with the bytes and ops the loop will do.
+WEAK void halide_profiler_count_ops(void *pipeline_state, int func_id,
+                                    uint64_t bytes, uint64_t ops) {
+    halide_profiler_pipeline_stats *p_stats = (halide_profiler_pipeline_stats *) pipeline_state;
+    if (!p_stats || func_id < 0 || func_id >= p_stats->num_funcs) {
+        return;
+    }
+    halide_profiler_func_stats *f_stats = &p_stats->funcs[func_id];
+    __sync_add_and_fetch(&f_stats->bytes, bytes);
+    __sync_add_and_fetch(&f_stats->ops, ops);
 }
 
 WEAK void halide_profiler_memory_free(void *user_context,
@@ -259,21 +459,31 @@ WEAK void halide_profiler_memory_free(void *user_context,
     // current desctructor (called on profiler shutdown) does not free the structs
     // unless user specifically calls halide_profiler_reset().
 
-    // Update per-pipeline memory stats
-    __sync_sub_and_fetch(&p_stats->memory_current, decr);
-
     // Update per-func memory stats
     __sync_sub_and_fetch(&f_stats->memory_current, decr);
+
+    // Update per-pipeline memory stats
+    int p_mem_current = __sync_sub_and_fetch(&p_stats->memory_current, decr);
+
+    record_memory_event(user_context, p_stats, func_id, -decr, p_mem_current);
 }
 
 WEAK void halide_profiler_report_unlocked(void *user_context, halide_profiler_state *s) {
 
+    // The peak memory bandwidth and arithmetic throughput of the
+    // machine, for the roofline of each func, if known.
+    const char *peak_gbps_str = getenv("HL_ROOFLINE_PEAK_GBPS");
+    const char *peak_gops_str = getenv("HL_ROOFLINE_PEAK_GOPS");
+    int peak_gbps = peak_gbps_str ? atoi(peak_gbps_str) : 0;
+    int peak_gops = peak_gops_str ? atoi(peak_gops_str) : 0;
+
     char line_buf[1024];
     Printer<StringStreamPrinter, sizeof(line_buf)> sstr(user_context, line_buf);
 
     for (halide_profiler_pipeline_stats *p = s->pipelines; p;
          p = (halide_profiler_pipeline_stats *)(p->next)) {
         float t = p->time / 1000000.0f;
+        float cpu_t = p->cpu_time / 1000000.0f;
         if (!p->runs) continue;
         sstr.clear();
         int alloc_avg = 0;
@@ -285,8 +495,23 @@ WEAK void halide_profiler_report_unlocked(void *user_context, halide_profiler_st
              << "  samples: " << p->samples
              << "  runs: " << p->runs
              << "  time/run: " << t / p->runs << " ms\n"
+             << " total cpu time: " << cpu_t << " ms"
+             << "  cpu time/run: " << cpu_t / p->runs << " ms"
+             << "  average threads: " << (p->time ? (float)p->cpu_time / p->time : 0.0f) << "\n"
              << " heap allocations: " << p->num_allocs
              << "  peak heap usage: " << p->memory_peak << " bytes\n";
+        if (p->memory_peak) {
+            // The buffers that were live at the peak, which are the
+            // ones to fold, fuse, or recompute to bring it down.
+            sstr << " live at peak:";
+            for (int i = 0; i < p->num_funcs; i++) {
+                halide_profiler_func_stats *fs = p->funcs + i;
+                if (fs->memory_at_peak) {
+                    sstr << " " << fs->name << " (" << fs->memory_at_peak << " bytes)";
+                }
+            }
+            sstr << "\n";
+        }
         halide_print(user_context, sstr.str());
 
         bool print_f_states = p->time || p->memory_total;
@@ -323,6 +548,15 @@ WEAK void halide_profiler_report_unlocked(void *user_context, halide_profiler_st
                 sstr << "(" << percent << "%)";
                 while (sstr.size() < 50) sstr << " ";
 
+                // The average number of threads that were working on
+                // this func while it was running.
+                float cpu_ft = fs->cpu_time / (p->runs * 1000000.0f);
+                float threads = fs->time ? (float)fs->cpu_time / fs->time : 0.0f;
+                sstr << " cpu: " << cpu_ft << "ms";
+                while (sstr.size() < 70) sstr << " ";
+                sstr << " threads: " << threads;
+                while (sstr.size() < 90) sstr << " ";
+
                 int alloc_avg = 0;
                 if (fs->num_allocs != 0) {
                     alloc_avg = fs->memory_total/fs->num_allocs;
@@ -330,9 +564,9 @@ WEAK void halide_profiler_report_unlocked(void *user_context, halide_profiler_st
 
                 if (fs->memory_peak) {
                     sstr << " peak: " << fs->memory_peak;
-                    while (sstr.size() < 65) sstr << " ";
+                    while (sstr.size() < 105) sstr << " ";
                     sstr << " num: " << fs->num_allocs;
-                    while (sstr.size() < 80) sstr << " ";
+                    while (sstr.size() < 120) sstr << " ";
                     sstr << " avg: " << alloc_avg;
                 }
                 if (fs->stack_peak > 0) {
@@ -340,16 +574,64 @@ WEAK void halide_profiler_report_unlocked(void *user_context, halide_profiler_st
                 }
                 sstr << "\n";
 
+                if (fs->cycles) {
+                    // Each cache miss is assumed to move one 64-byte
+                    // line to or from memory.
+                    float ipc = (float)fs->instructions / fs->cycles;
+                    float bytes_per_cycle = (float)(fs->cache_misses * 64) / fs->cycles;
+                    sstr << "    cycles: " << fs->cycles
+                         << "  instructions: " << fs->instructions
+                         << "  ipc: " << ipc
+                         << "  cache misses: " << fs->cache_misses
+                         << "  bytes/cycle: " << bytes_per_cycle
+                         << "  branch misses: " << fs->branch_misses << "\n";
+                }
+
+                if (fs->time && (fs->bytes || fs->ops)) {
+                    // Bytes or ops per nanosecond are GB/s or GOPS.
+                    float gbps = (float)fs->bytes / fs->time;
+                    float gops = (float)fs->ops / fs->time;
+                    float intensity = fs->bytes ? (float)fs->ops / fs->bytes : 0.0f;
+                    sstr << "    bytes: " << fs->bytes
+                         << "  ops: " << fs->ops
+                         << "  ops/byte: " << intensity
+                         << "  GB/s: " << gbps
+                         << "  GOPS: " << gops;
+                    if (peak_gbps > 0 && peak_gops > 0) {
+                        // The roofline: the best this func could do
+                        // at its arithmetic intensity.
+                        float attainable = intensity * peak_gbps;
+                        const char *bound = "memory";
+                        if (attainable > peak_gops || !fs->bytes) {
+                            attainable = peak_gops;
+                            bound = "compute";
+                        }
+                        int percent = (int)(100 * gops / attainable);
+                        sstr << "  " << bound << " bound, " << percent << "% of peak";
+                    }
+                    sstr << "\n";
+                }
+
                 halide_print(user_context, sstr.str());
             }
         }
     }
+
+    if (s->overflowed_threads) {
+        sstr.clear();
+        sstr << "Warning: " << s->overflowed_threads << " threads ran while "
+             << (int)halide_profiler_max_threads << " others were already being sampled. "
+             << "The time they spent is missing from the report.\n";
+        halide_print(user_context, sstr.str());
+    }
 }
 
 WEAK void halide_profiler_report(void *user_context) {
     halide_profiler_state *s = halide_profiler_get_state();
     ScopedMutexLock lock(&s->lock);
     halide_profiler_report_unlocked(user_context, s);
+    ScopedSpinLock timeline_lock(&memory_timeline_lock);
+    flush_memory_timeline(user_context);
 }
 
 
@@ -362,13 +644,21 @@ WEAK void halide_profiler_reset() {
 
     ScopedMutexLock lock(&s->lock);
 
+    // The recorded allocations refer to the pipelines about to be
+    // freed.
+    {
+        ScopedSpinLock timeline_lock(&memory_timeline_lock);
+        flush_memory_timeline(NULL);
+    }
+
     while (s->pipelines) {
         halide_profiler_pipeline_stats *p = s->pipelines;
         s->pipelines = (halide_profiler_pipeline_stats *)(p->next);
         free(p->funcs);
         free(p);
     }
-    s->first_free_id = 0;
+    s->first_free_id = 1;
+    s->overflowed_threads = 0;
 }
 
 namespace {
@@ -387,6 +677,7 @@ WEAK void halide_profiler_shutdown() {
     // Print results. No need to lock anything because we just shut
     // down the thread.
     halide_profiler_report_unlocked(NULL, s);
+    close_memory_timeline(NULL);
 
     // Leak the memory. Not all implementations of ScopedMutexLock may
     // be safe to use at static destruction time (windows).
@@ -394,8 +685,8 @@ WEAK void halide_profiler_shutdown() {
 }
 }
 
-WEAK void halide_profiler_pipeline_end(void *user_context, void *state) {
-    ((halide_profiler_state *)state)->current_func = halide_profiler_outside_of_halide;
+WEAK void halide_profiler_pipeline_end(void *user_context, void *slot) {
+    halide_profiler_release_slot(user_context, slot);
 }
 
 }
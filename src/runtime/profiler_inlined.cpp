@@ -2,12 +2,13 @@
 
 extern "C" {
 
-WEAK __attribute__((always_inline)) int halide_profiler_set_current_func(halide_profiler_state *state, int tok, int t) {
+WEAK __attribute__((always_inline)) int halide_profiler_set_current_func(int *slot, int tok, int t) {
     // Use empty volatile asm blocks to prevent code motion. Otherwise
     // llvm reorders or elides the stores.
-    volatile int *ptr = &(state->current_func);
+    volatile int *ptr = slot;
     asm volatile ("":::);
-    *ptr = tok + t;
+    // t is a constant at every call site, so this select folds away.
+    *ptr = (t < 0) ? t : tok + t;
     asm volatile ("":::);
     return 0;
 }
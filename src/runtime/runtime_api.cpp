@@ -14,6 +14,7 @@
 // cat src/runtime/runtime_internal.h src/runtime/HalideRuntime*.h | grep "^[^ ][^(]*halide_[^ ]*(" | grep -v '#define' | sed "s/[^(]*halide/halide/" | sed "s/(.*//" | sed "s/^h/    \(void *)\&h/" | sed "s/$/,/" | sort | uniq
 
 extern "C" __attribute__((used)) void *halide_runtime_api_functions[] = {
+    (void *)&halide_can_use_cpu_features,
     (void *)&halide_copy_to_device,
     (void *)&halide_copy_to_host,
     (void *)&halide_cuda_detach_device_ptr,
@@ -55,6 +56,8 @@ extern "C" __attribute__((used)) void *halide_runtime_api_functions[] = {
     (void *)&halide_float16_bits_to_double,
     (void *)&halide_float16_bits_to_float,
     (void *)&halide_free,
+    (void *)&halide_get_allocation_policy,
+    (void *)&halide_get_cpu_features,
     (void *)&halide_get_gpu_device,
     (void *)&halide_get_library_symbol,
     (void *)&halide_get_symbol,
@@ -103,12 +106,19 @@ extern "C" __attribute__((used)) void *halide_runtime_api_functions[] = {
     (void *)&halide_openglcompute_initialize_kernels,
     (void *)&halide_openglcompute_run,
     (void *)&halide_pointer_to_string,
+    (void *)&halide_persistent_allocations_attach,
+    (void *)&halide_persistent_allocations_release,
+    (void *)&halide_persistent_free,
+    (void *)&halide_persistent_malloc,
     (void *)&halide_print,
+    (void *)&halide_profiler_claim_slot,
+    (void *)&halide_profiler_count_ops,
     (void *)&halide_profiler_get_state,
     (void *)&halide_profiler_get_pipeline_state,
     (void *)&halide_profiler_memory_allocate,
     (void *)&halide_profiler_memory_free,
     (void *)&halide_profiler_pipeline_start,
+    (void *)&halide_profiler_release_slot,
     (void *)&halide_profiler_report,
     (void *)&halide_profiler_reset,
     (void *)&halide_profiler_stack_peak_update,
@@ -117,9 +127,19 @@ extern "C" __attribute__((used)) void *halide_runtime_api_functions[] = {
     (void *)&halide_renderscript_initialize_kernels,
     (void *)&halide_renderscript_run,
     (void *)&halide_runtime_internal_register_metadata,
+    (void *)&halide_scratch_arena_acquire,
+    (void *)&halide_scratch_arena_cleanup,
+    (void *)&halide_scratch_arena_free,
+    (void *)&halide_scratch_arena_malloc,
+    (void *)&halide_scratch_arena_release,
+    (void *)&halide_set_allocation_policy,
     (void *)&halide_set_gpu_device,
     (void *)&halide_set_num_threads,
+    (void *)&halide_set_trace_enabled,
     (void *)&halide_set_trace_file,
+    (void *)&halide_set_trace_funcs,
+    (void *)&halide_set_trace_region,
+    (void *)&halide_set_trace_sampling,
     (void *)&halide_shutdown_thread_pool,
     (void *)&halide_shutdown_trace,
     (void *)&halide_sleep_ms,
@@ -127,6 +147,7 @@ extern "C" __attribute__((used)) void *halide_runtime_api_functions[] = {
     (void *)&halide_start_clock,
     (void *)&halide_string_to_string,
     (void *)&halide_trace,
+    (void *)&halide_trace_func_enabled,
     (void *)&halide_uint64_to_string,
     (void *)&halide_use_jit_module,
 };
@@ -101,6 +101,9 @@ WEAK void *halide_get_library_symbol(void *lib, const char *name);
 WEAK int halide_start_clock(void *user_context);
 WEAK int64_t halide_current_time_ns(void *user_context);
 WEAK void halide_sleep_ms(void *user_context, int ms);
+// An identifier for the calling thread, unique among the running
+// threads. Implemented by the thread pool.
+WEAK uint64_t halide_current_thread_id();
 WEAK void halide_device_free_as_destructor(void *user_context, void *obj);
 
 // The pipeline_state is declared as void* type since halide_profiler_pipeline_stats
@@ -120,6 +123,10 @@ WEAK int halide_profiler_pipeline_start(void *user_context,
                                         const char *pipeline_name,
                                         int num_funcs,
                                         const uint64_t *func_names);
+WEAK int *halide_profiler_claim_slot(void *state);
+WEAK void halide_profiler_count_ops(void *pipeline_state, int func_id,
+                                    uint64_t bytes, uint64_t ops);
+WEAK void halide_profiler_release_slot(void *user_context, void *slot);
 
 struct halide_filter_metadata_t;
 struct _halide_runtime_internal_registered_filter_t {
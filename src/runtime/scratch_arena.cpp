@@ -0,0 +1,204 @@
+#include "HalideRuntime.h"
+
+// Scratch arenas for allocations made inside parallel loops. Each
+// task of a parallel loop that allocates acquires an arena from a
+// shared pool, bumps a pointer into it for each allocation, and
+// returns it to the pool when the task ends. The arenas are kept
+// between pipeline calls, and grow to the most memory a task has
+// needed from them at once, so after the first call allocation
+// doesn't touch the system allocator at all.
+//
+// The pool is a table of slots holding the idle arenas. Acquiring an
+// arena takes it out of its slot with a compare-and-swap, and
+// releasing it puts it in an empty slot the same way, so tasks never
+// wait on each other for a lock. A slot only ever goes from an arena
+// to empty by being claimed, so a claim that succeeds always gets an
+// arena nobody else is using.
+
+namespace Halide { namespace Runtime { namespace Internal {
+
+const size_t scratch_alignment = 128;
+
+struct scratch_arena;
+
+// Every block handed out has one of these just before it.
+struct scratch_block {
+    scratch_arena *arena;
+
+    // If the block didn't fit in the arena, the memory from
+    // halide_malloc that it lives in. Otherwise NULL.
+    void *allocation;
+
+    // The previous live block in the arena.
+    scratch_block *prev;
+
+    // The top of the arena before this block was allocated, and the
+    // size of the block.
+    size_t old_top, size;
+
+    bool freed;
+};
+
+struct scratch_arena {
+    uint8_t *memory;
+    size_t capacity;
+
+    // The offset of the first free byte, and the most recently
+    // allocated block that hasn't been popped off yet.
+    size_t top;
+    scratch_block *last;
+
+    // The memory the live blocks would need if they all came from
+    // the arena, and the most it has ever been. The arena grows to
+    // the high water mark whenever it is acquired.
+    size_t demand, high_water;
+};
+
+// Enough for a thread pool on any machine we run on. If more arenas
+// than this are released at once, the extra ones are freed.
+const int max_idle_scratch_arenas = 256;
+WEAK scratch_arena *idle_scratch_arenas[max_idle_scratch_arenas];
+
+WEAK void free_scratch_arena(scratch_arena *arena) {
+    halide_free(NULL, arena->memory);
+    halide_free(NULL, arena);
+}
+
+WEAK size_t scratch_block_footprint(size_t size) {
+    return size + sizeof(scratch_block) + scratch_alignment;
+}
+
+// The aligned address of a block starting at or after p, leaving room
+// for the header.
+WEAK uintptr_t scratch_block_address(uintptr_t p) {
+    return (p + sizeof(scratch_block) + scratch_alignment - 1) & ~(uintptr_t)(scratch_alignment - 1);
+}
+
+}}} // namespace Halide::Runtime::Internal
+
+using namespace Halide::Runtime::Internal;
+
+extern "C" {
+
+WEAK void *halide_scratch_arena_acquire(void *user_context) {
+    scratch_arena *arena = NULL;
+    for (int i = 0; i < max_idle_scratch_arenas && !arena; i++) {
+        scratch_arena *idle = idle_scratch_arenas[i];
+        if (idle && __sync_bool_compare_and_swap(&idle_scratch_arenas[i], idle, NULL)) {
+            arena = idle;
+        }
+    }
+    if (!arena) {
+        // The arenas outlive the pipeline call, so they don't use the
+        // user_context's allocator.
+        arena = (scratch_arena *)halide_malloc(NULL, sizeof(scratch_arena));
+        if (!arena) {
+            return NULL;
+        }
+        memset(arena, 0, sizeof(scratch_arena));
+    }
+
+    if (arena->high_water > arena->capacity) {
+        halide_free(NULL, arena->memory);
+        arena->memory = (uint8_t *)halide_malloc(NULL, arena->high_water);
+        arena->capacity = arena->memory ? arena->high_water : 0;
+    }
+    arena->top = 0;
+    arena->last = NULL;
+    arena->demand = 0;
+    return arena;
+}
+
+WEAK void halide_scratch_arena_release(void *user_context, void *a) {
+    for (int i = 0; i < max_idle_scratch_arenas; i++) {
+        if (!idle_scratch_arenas[i] &&
+            __sync_bool_compare_and_swap(&idle_scratch_arenas[i], NULL, (scratch_arena *)a)) {
+            return;
+        }
+    }
+    free_scratch_arena((scratch_arena *)a);
+}
+
+WEAK void *halide_scratch_arena_malloc(void *user_context, void *a, int64_t size) {
+    if (size <= 0) {
+        return NULL;
+    }
+    scratch_arena *arena = (scratch_arena *)a;
+    size_t bytes = (size_t)size;
+
+    arena->demand += scratch_block_footprint(bytes);
+    if (arena->demand > arena->high_water) {
+        arena->high_water = arena->demand;
+    }
+
+    uintptr_t base = (uintptr_t)arena->memory;
+    uintptr_t p = scratch_block_address(base + arena->top);
+    scratch_block *block;
+    if (arena->memory && p + bytes <= base + arena->capacity) {
+        block = (scratch_block *)p - 1;
+        block->allocation = NULL;
+        block->prev = arena->last;
+        block->old_top = arena->top;
+        arena->last = block;
+        arena->top = p + bytes - base;
+    } else {
+        // It doesn't fit. Fall back to halide_malloc this time. The
+        // arena will be big enough the next time it's acquired.
+        void *allocation = halide_malloc(user_context, scratch_block_footprint(bytes));
+        if (!allocation) {
+            arena->demand -= scratch_block_footprint(bytes);
+            return NULL;
+        }
+        p = scratch_block_address((uintptr_t)allocation);
+        block = (scratch_block *)p - 1;
+        block->allocation = allocation;
+        block->prev = NULL;
+        block->old_top = 0;
+    }
+    block->arena = arena;
+    block->size = bytes;
+    block->freed = false;
+    return (void *)p;
+}
+
+WEAK void halide_scratch_arena_free(void *user_context, void *ptr) {
+    if (!ptr) {
+        return;
+    }
+    scratch_block *block = (scratch_block *)ptr - 1;
+    scratch_arena *arena = block->arena;
+    arena->demand -= scratch_block_footprint(block->size);
+
+    if (block->allocation) {
+        halide_free(user_context, block->allocation);
+        return;
+    }
+
+    // Pop freed blocks off the top of the arena. A block freed out of
+    // order is reclaimed once the blocks above it are freed too.
+    block->freed = true;
+    while (arena->last && arena->last->freed) {
+        arena->top = arena->last->old_top;
+        arena->last = arena->last->prev;
+    }
+}
+
+WEAK void halide_scratch_arena_cleanup() {
+    for (int i = 0; i < max_idle_scratch_arenas; i++) {
+        scratch_arena *arena = __sync_lock_test_and_set(&idle_scratch_arenas[i], NULL);
+        if (arena) {
+            free_scratch_arena(arena);
+        }
+    }
+}
+
+namespace {
+
+__attribute__((destructor))
+WEAK void halide_scratch_arena_shutdown() {
+    halide_scratch_arena_cleanup();
+}
+
+}
+
+}
@@ -14,6 +14,218 @@ WEAK int halide_trace_file = 0;
 WEAK int halide_trace_file_lock = 0;
 WEAK bool halide_trace_file_initialized = false;
 WEAK bool halide_trace_file_internally_opened = false;
+// Whether to write the trace file in the Chrome trace event format
+// instead of the binary format.
+WEAK bool halide_trace_file_chrome_format = false;
+// Whether binary packets record the time and thread of each event.
+WEAK bool halide_trace_file_timestamps = false;
+
+// Set in the event byte of binary packets that record the time and
+// thread.
+const static uint8_t trace_packet_has_time = 0x80;
+
+// A spin lock that many threads can hold at once, or one thread can
+// hold exclusively.
+class SharedExclusiveSpinLock {
+    volatile uint32_t lock;
+
+    // The top bit indicates that someone holds the lock
+    // exclusively. The next bit indicates that someone is waiting to
+    // hold it exclusively, which stops new shared holders. The rest
+    // count the shared holders.
+    const static uint32_t exclusive_held_mask = 0x80000000;
+    const static uint32_t exclusive_waiting_mask = 0x40000000;
+    const static uint32_t shared_mask = 0x3fffffff;
+
+public:
+    __attribute__((always_inline)) void acquire_shared() {
+        while (1) {
+            uint32_t x = lock & shared_mask;
+            if (__sync_bool_compare_and_swap(&lock, x, x + 1)) {
+                return;
+            }
+        }
+    }
+
+    __attribute__((always_inline)) void release_shared() {
+        __sync_fetch_and_sub(&lock, 1);
+    }
+
+    __attribute__((always_inline)) void acquire_exclusive() {
+        while (1) {
+            __sync_fetch_and_or(&lock, exclusive_waiting_mask);
+            if (__sync_bool_compare_and_swap(&lock, exclusive_waiting_mask, exclusive_held_mask)) {
+                return;
+            }
+        }
+    }
+
+    __attribute__((always_inline)) void release_exclusive() {
+        __sync_fetch_and_and(&lock, ~exclusive_held_mask);
+    }
+};
+
+const static uint32_t trace_buffer_size = 1024 * 1024;
+
+// Trace events are written to a large in-memory buffer, which is
+// written to the trace file in one go when it fills up or a pipeline
+// ends. Threads reserve space in it with an atomic add, so writing an
+// event does not serialize with the other threads unless the buffer
+// needs flushing.
+class TraceBuffer {
+    SharedExclusiveSpinLock lock;
+    uint32_t cursor, overage;
+    uint8_t buf[trace_buffer_size];
+
+    // Reserve space for a packet. Returns NULL if it doesn't fit. Must
+    // hold the lock shared.
+    __attribute__((always_inline)) uint8_t *try_acquire_packet(uint32_t size) {
+        uint32_t my_cursor = __sync_fetch_and_add(&cursor, size);
+        if (my_cursor + size > sizeof(buf)) {
+            // Don't try to back out the cursor, because other threads
+            // may have moved it further since. Just count how much
+            // space was claimed but not used.
+            __sync_fetch_and_add(&overage, size);
+            return NULL;
+        } else {
+            return buf + my_cursor;
+        }
+    }
+
+public:
+    // Write the buffered packets to the file and empty the buffer.
+    void flush(void *user_context, int fd) {
+        lock.acquire_exclusive();
+        bool success = true;
+        if (cursor) {
+            // The packets that fit are contiguous from the start of
+            // the buffer, because the cursor only moves forwards.
+            cursor -= overage;
+            success = (uint32_t)write(fd, buf, cursor) == cursor;
+            cursor = 0;
+            overage = 0;
+        }
+        lock.release_exclusive();
+        halide_assert(user_context, success && "Could not write to trace file");
+    }
+
+    // Reserve space for a packet, flushing the buffer if it's full.
+    // The caller must call release_packet once the packet is written.
+    __attribute__((always_inline)) uint8_t *acquire_packet(void *user_context, int fd, uint32_t size) {
+        halide_assert(user_context, size <= sizeof(buf) && "Tracing packet too large");
+        lock.acquire_shared();
+        uint8_t *packet;
+        while (!(packet = try_acquire_packet(size))) {
+            // Out of space. Let go of the lock and flush, then try
+            // again. Another thread may have got there first.
+            lock.release_shared();
+            flush(user_context, fd);
+            lock.acquire_shared();
+        }
+        return packet;
+    }
+
+    __attribute__((always_inline)) void release_packet() {
+        lock.release_shared();
+    }
+};
+
+WEAK TraceBuffer *halide_trace_buffer = NULL;
+
+// Copy a string into dst as the contents of a JSON string, escaping
+// quotes, backslashes and control characters. Returns a pointer to the
+// terminating null, like the halide_*_to_string functions.
+WEAK char *json_escape_string(char *dst, char *end, const char *src) {
+    const char *hex = "0123456789abcdef";
+    for (; *src && dst < end; src++) {
+        unsigned char c = (unsigned char)*src;
+        if (c == '"' || c == '\\') {
+            if (end - dst < 2) break;
+            *dst++ = '\\';
+            *dst++ = c;
+        } else if (c < 0x20) {
+            if (end - dst < 6) break;
+            *dst++ = '\\';
+            *dst++ = 'u';
+            *dst++ = '0';
+            *dst++ = '0';
+            *dst++ = hex[c >> 4];
+            *dst++ = hex[c & 15];
+        } else {
+            *dst++ = c;
+        }
+    }
+    *dst = 0;
+    return dst;
+}
+
+// Write a trace event as a span in the Chrome trace event format
+// (one JSON object per line), which chrome://tracing and Perfetto can
+// display as a timeline with a row per thread. Each realization,
+// production, consumption, and parallel task becomes a span.
+WEAK void write_chrome_trace_event(void *user_context, int fd, const halide_trace_event *e) {
+    const char *begin = NULL;
+    bool end = false;
+    switch (e->event) {
+    case halide_trace_begin_pipeline:
+        begin = "pipeline";
+        break;
+    case halide_trace_begin_realization:
+        begin = "realize";
+        break;
+    case halide_trace_produce:
+        begin = "produce";
+        break;
+    case halide_trace_update:
+        // The update ends the pure step and the consume ends the
+        // last update.
+        end = true;
+        begin = "update";
+        break;
+    case halide_trace_consume:
+        end = true;
+        begin = "consume";
+        break;
+    case halide_trace_begin_parallel_task:
+        begin = "task";
+        break;
+    case halide_trace_end_pipeline:
+    case halide_trace_end_realization:
+    case halide_trace_end_consume:
+    case halide_trace_end_parallel_task:
+        end = true;
+        break;
+    default:
+        // Loads and stores are too fine-grained to show as spans.
+        return;
+    }
+
+    int64_t t = halide_current_time_ns(user_context);
+    uint64_t tid = halide_current_thread_id();
+
+    char buf[512];
+    Printer<StringStreamPrinter, sizeof(buf)> ss(user_context, buf);
+    if (end) {
+        ss << "{\"ph\":\"E\",\"ts\":" << t / 1000 << ".";
+        ss.dst = halide_int64_to_string(ss.dst, ss.end, t % 1000, 3);
+        ss << ",\"pid\":1,\"tid\":" << tid << "},\n";
+    }
+    if (begin) {
+        ss << "{\"ph\":\"B\",\"ts\":" << t / 1000 << ".";
+        ss.dst = halide_int64_to_string(ss.dst, ss.end, t % 1000, 3);
+        ss << ",\"pid\":1,\"tid\":" << tid
+           << ",\"cat\":\"" << begin << "\",\"name\":\"" << begin << " ";
+        ss.dst = json_escape_string(ss.dst, ss.end, e->func);
+        if (e->event == halide_trace_begin_parallel_task && e->dimensions > 0) {
+            ss << "[" << e->coordinates[0] << "]";
+        }
+        ss << "\"},\n";
+    }
+
+    uint8_t *packet = halide_trace_buffer->acquire_packet(user_context, fd, ss.size());
+    memcpy(packet, ss.str(), ss.size());
+    halide_trace_buffer->release_packet();
+}
 
 WEAK int32_t default_trace(void *user_context, const halide_trace_event *e) {
     static int32_t ids = 1;
@@ -22,8 +234,14 @@ WEAK int32_t default_trace(void *user_context, const halide_trace_event *e) {
 
     // If we're dumping to a file, use a binary format
     int fd = halide_get_trace_file(user_context);
-    if (fd > 0) {
-        // A 48-byte header. The first 6 bytes are metadata, then the rest is a zero-terminated string.
+    if (fd > 0 && halide_trace_file_chrome_format) {
+        write_chrome_trace_event(user_context, fd, e);
+    } else if (fd > 0) {
+        // A 48-byte header. The first 14 bytes are metadata, then
+        // comes a zero-terminated string. If timestamps are on, the
+        // header is 16 bytes longer: the time in nanoseconds and the
+        // id of the thread that traced the event follow the string,
+        // and the top bit of the event byte says so.
         uint8_t clamped_width = e->vector_width < 256 ? e->vector_width : 255;
         uint8_t clamped_dimensions = e->dimensions < 256 ? e->dimensions : 255;
 
@@ -33,16 +251,17 @@ WEAK int32_t default_trace(void *user_context, const halide_trace_event *e) {
         while (bytes*8 < e->bits) bytes <<= 1;
 
         // Compute the size of each portion of the tracing packet
-        size_t header_bytes = 48;
+        size_t name_bytes = 48;
+        size_t header_bytes = halide_trace_file_timestamps ? 64 : 48;
         size_t value_bytes = clamped_width * bytes;
         size_t int_arg_bytes = clamped_dimensions * sizeof(int32_t);
         size_t total_bytes = header_bytes + value_bytes + int_arg_bytes;
-        uint8_t buffer[4096];
         halide_assert(user_context, total_bytes <= 4096 && "Tracing packet too large");
+        uint8_t *buffer = halide_trace_buffer->acquire_packet(user_context, fd, total_bytes);
 
         ((int32_t *)buffer)[0] = my_id;
         ((int32_t *)buffer)[1] = e->parent_id;
-        buffer[8] = e->event;
+        buffer[8] = e->event | (halide_trace_file_timestamps ? trace_packet_has_time : 0);
         buffer[9] = e->type_code;
         buffer[10] = e->bits;
         buffer[11] = clamped_width;
@@ -51,15 +270,23 @@ WEAK int32_t default_trace(void *user_context, const halide_trace_event *e) {
 
         // Use up to 33 bytes for the function name
         size_t i = 14;
-        for (; i < header_bytes-1; i++) {
+        for (; i < name_bytes-1; i++) {
             buffer[i] = e->func[i-14];
             if (buffer[i] == 0) break;
         }
         // Fill the rest with zeros
-        for (; i < header_bytes; i++) {
+        for (; i < name_bytes; i++) {
             buffer[i] = 0;
         }
 
+        if (halide_trace_file_timestamps) {
+            // The packet may not be aligned, so copy these bytewise.
+            int64_t t = halide_current_time_ns(user_context);
+            uint64_t tid = halide_current_thread_id();
+            memcpy(buffer + name_bytes, &t, sizeof(t));
+            memcpy(buffer + name_bytes + 8, &tid, sizeof(tid));
+        }
+
         // Next comes the value
         for (size_t i = 0; i < value_bytes; i++) {
             buffer[header_bytes + i] = ((uint8_t *)(e->value))[i];
@@ -70,12 +297,7 @@ WEAK int32_t default_trace(void *user_context, const halide_trace_event *e) {
             buffer[header_bytes + value_bytes + i] = ((uint8_t *)(e->coordinates))[i];
         }
 
-        {
-            ScopedSpinLock lock(&halide_trace_file_lock);
-            size_t written = write(fd, &buffer[0], total_bytes);
-            halide_assert(user_context, written == total_bytes && "Can't write to trace file");
-        }
-
+        halide_trace_buffer->release_packet();
     } else {
         stringstream ss(user_context);
 
@@ -94,7 +316,9 @@ WEAK int32_t default_trace(void *user_context, const halide_trace_event *e) {
                                      "Consume",
                                      "End consume",
                                      "Begin pipeline",
-                                     "End pipeline"};
+                                     "End pipeline",
+                                     "Begin parallel task",
+                                     "End parallel task"};
 
         // Only print out the value on stores and loads.
         bool print_value = (e->event < 2);
@@ -174,11 +398,139 @@ WEAK int32_t default_trace(void *user_context, const halide_trace_event *e) {
         }
     }
 
+    // Make sure the trace file is complete whenever a pipeline
+    // returns.
+    if (fd > 0 && e->event == halide_trace_end_pipeline) {
+        halide_trace_buffer->flush(user_context, fd);
+    }
+
     return my_id;
 }
 
 WEAK trace_fn halide_custom_trace = default_trace;
 
+// The run-time filters on which events get traced.
+const int max_trace_region_dimensions = 16;
+WEAK bool halide_trace_filter_initialized = false;
+WEAK int halide_trace_filter_lock = 0;
+WEAK bool halide_trace_is_enabled = true;
+// A comma-separated list. Empty means all Funcs.
+WEAK char halide_trace_func_list[1024];
+WEAK int halide_trace_region_dimensions = 0;
+WEAK int32_t halide_trace_region_min[max_trace_region_dimensions];
+WEAK int32_t halide_trace_region_extent[max_trace_region_dimensions];
+WEAK int halide_trace_sampling = 1;
+WEAK uint32_t halide_trace_sample_counter = 0;
+
+WEAK void set_trace_func_list(const char *funcs) {
+    size_t len = funcs ? strlen(funcs) : 0;
+    if (len >= sizeof(halide_trace_func_list)) {
+        halide_print(NULL, "List of Funcs to trace is too long. Tracing all of them.\n");
+        len = 0;
+    }
+    memcpy(halide_trace_func_list, funcs, len);
+    halide_trace_func_list[len] = 0;
+}
+
+// Read the default filters from the environment, the first time
+// anything needs them.
+WEAK void init_trace_filter() {
+    if (halide_trace_filter_initialized) return;
+    ScopedSpinLock lock(&halide_trace_filter_lock);
+    if (halide_trace_filter_initialized) return;
+
+    set_trace_func_list(getenv("HL_TRACE_FUNCS"));
+
+    const char *sampling = getenv("HL_TRACE_SAMPLING");
+    if (sampling) {
+        halide_trace_sampling = atoi(sampling);
+    }
+
+    const char *region = getenv("HL_TRACE_REGION");
+    int dims = 0;
+    while (region && *region && dims < max_trace_region_dimensions) {
+        halide_trace_region_min[dims] = atoi(region);
+        region = strchr(region, ',');
+        if (!region) break;
+        halide_trace_region_extent[dims++] = atoi(++region);
+        region = strchr(region, ',');
+        if (region) region++;
+    }
+    halide_trace_region_dimensions = dims;
+
+    __sync_synchronize();
+    halide_trace_filter_initialized = true;
+}
+
+// Check whether the Func name of length len is in the list of Funcs
+// to trace.
+WEAK bool trace_func_in_list(const char *func, size_t len) {
+    const char *f = halide_trace_func_list;
+    if (!*f) return true;
+    while (1) {
+        const char *end = strchr(f, ',');
+        size_t l = end ? (size_t)(end - f) : strlen(f);
+        if (l == len && strncmp(f, func, len) == 0) {
+            return true;
+        }
+        if (!end) return false;
+        f = end + 1;
+    }
+}
+
+WEAK bool trace_coordinates_in_region(const halide_trace_event *e) {
+    int lanes = e->vector_width;
+    int dims = e->dimensions / lanes;
+    if (dims > halide_trace_region_dimensions) {
+        dims = halide_trace_region_dimensions;
+    }
+    for (int lane = 0; lane < lanes; lane++) {
+        bool inside = true;
+        for (int d = 0; d < dims && inside; d++) {
+            int32_t c = e->coordinates[d * lanes + lane];
+            inside = (c >= halide_trace_region_min[d] &&
+                      c - halide_trace_region_min[d] < halide_trace_region_extent[d]);
+        }
+        if (inside) return true;
+    }
+    return false;
+}
+
+WEAK bool trace_event_passes_filter(const halide_trace_event *e) {
+    if (!halide_trace_is_enabled) return false;
+
+    if (e->event == halide_trace_begin_pipeline ||
+        e->event == halide_trace_end_pipeline) {
+        return true;
+    }
+
+    if (halide_trace_func_list[0]) {
+        // Parallel tasks are named after the loop, which is named
+        // after the Func.
+        size_t len = 0;
+        if (e->event == halide_trace_begin_parallel_task ||
+            e->event == halide_trace_end_parallel_task) {
+            while (e->func[len] && e->func[len] != '.') len++;
+        } else {
+            len = strlen(e->func);
+        }
+        if (!trace_func_in_list(e->func, len)) return false;
+    }
+
+    if (e->event == halide_trace_load || e->event == halide_trace_store) {
+        if (halide_trace_region_dimensions && !trace_coordinates_in_region(e)) {
+            return false;
+        }
+        if (halide_trace_sampling != 1) {
+            if (halide_trace_sampling <= 0) return false;
+            uint32_t count = __sync_fetch_and_add(&halide_trace_sample_counter, 1);
+            if (count % halide_trace_sampling) return false;
+        }
+    }
+
+    return true;
+}
+
 }}} // namespace Halide::Runtime::Internal
 
 extern "C" {
@@ -190,7 +542,31 @@ WEAK trace_fn halide_set_custom_trace(trace_fn t) {
 }
 
 WEAK void halide_set_trace_file(int fd) {
+    // Anything buffered belongs to the old file.
+    if (halide_trace_buffer && halide_trace_file > 0) {
+        halide_trace_buffer->flush(NULL, halide_trace_file);
+    }
     halide_trace_file = fd;
+    const char *format = getenv("HL_TRACE_FORMAT");
+    halide_trace_file_chrome_format = format && strcmp(format, "chrome") == 0;
+    const char *timestamps = getenv("HL_TRACE_TIMESTAMPS");
+    halide_trace_file_timestamps = timestamps && atoi(timestamps);
+    if (fd > 0) {
+        // Events are timestamped.
+        halide_start_clock(NULL);
+        if (!halide_trace_buffer) {
+            halide_trace_buffer = (TraceBuffer *)malloc(sizeof(TraceBuffer));
+            halide_assert(NULL, halide_trace_buffer && "Could not allocate trace buffer");
+            // All zeros is an empty, unlocked buffer.
+            memset(halide_trace_buffer, 0, sizeof(TraceBuffer));
+        }
+        if (halide_trace_file_chrome_format) {
+            // The closing bracket is optional, which is what lets us
+            // write the trace as we go.
+            write(fd, "[\n", 2);
+        }
+    }
+    __sync_synchronize();
     halide_trace_file_initialized = true;
 }
 
@@ -200,6 +576,9 @@ extern int errno;
 #define O_CREAT 64
 #define O_WRONLY 1
 WEAK int halide_get_trace_file(void *user_context) {
+    if (halide_trace_file_initialized) {
+        return halide_trace_file;
+    }
     // Prevent multiple threads both trying to initialize the trace
     // file at the same time.
     ScopedSpinLock lock(&halide_trace_file_lock);
@@ -218,15 +597,56 @@ WEAK int halide_get_trace_file(void *user_context) {
 }
 
 WEAK int32_t halide_trace(void *user_context, const halide_trace_event *e) {
+    init_trace_filter();
+    if (!trace_event_passes_filter(e)) {
+        return 0;
+    }
     return (*halide_custom_trace)(user_context, e);
 }
 
+WEAK void halide_set_trace_enabled(bool enabled) {
+    halide_trace_is_enabled = enabled;
+}
+
+WEAK void halide_set_trace_funcs(const char *funcs) {
+    init_trace_filter();
+    set_trace_func_list(funcs);
+}
+
+WEAK void halide_set_trace_region(int dimensions, const int32_t *min, const int32_t *extent) {
+    init_trace_filter();
+    if (dimensions > max_trace_region_dimensions) {
+        dimensions = max_trace_region_dimensions;
+    }
+    for (int i = 0; i < dimensions; i++) {
+        halide_trace_region_min[i] = min[i];
+        halide_trace_region_extent[i] = extent[i];
+    }
+    halide_trace_region_dimensions = dimensions;
+}
+
+WEAK void halide_set_trace_sampling(int n) {
+    init_trace_filter();
+    halide_trace_sampling = n;
+}
+
+WEAK int halide_trace_func_enabled(void *user_context, const char *func) {
+    init_trace_filter();
+    return (halide_trace_is_enabled &&
+            halide_trace_sampling > 0 &&
+            trace_func_in_list(func, strlen(func))) ? 1 : 0;
+}
+
 WEAK int halide_shutdown_trace() {
+    if (halide_trace_buffer && halide_trace_file > 0) {
+        halide_trace_buffer->flush(NULL, halide_trace_file);
+    }
     if (halide_trace_file_internally_opened) {
         int ret = close(halide_trace_file);
         halide_trace_file = 0;
         halide_trace_file_initialized = false;
         halide_trace_file_internally_opened = false;
+        halide_trace_file_chrome_format = false;
         return ret;
     } else {
         return 0;
@@ -32,6 +32,7 @@ extern WIN32API void DeleteCriticalSection(CriticalSection *);
 extern WIN32API void EnterCriticalSection(CriticalSection *);
 extern WIN32API void LeaveCriticalSection(CriticalSection *);
 extern WIN32API int32_t WaitForSingleObject(Thread, int32_t timeout);
+extern WIN32API uint32_t GetCurrentThreadId();
 extern WIN32API bool InitOnceExecuteOnce(InitOnce *, bool WIN32API (*f)(InitOnce *, void *, void **), void *, void **);
 
 WEAK int halide_do_task(void *user_context, halide_task_t f, int idx,
@@ -318,6 +319,10 @@ WEAK void halide_spawn_thread(void *user_context, void(*f)(void *), void *closur
         CreateThread(NULL, 0, spawn_thread_helper, t, 0, NULL);
 }
 
+WEAK uint64_t halide_current_thread_id() {
+    return GetCurrentThreadId();
+}
+
 WEAK void halide_mutex_cleanup(halide_mutex *mutex_arg) {
     windows_mutex *mutex = (windows_mutex *)mutex_arg;
     if (mutex->once != 0) {
@@ -0,0 +1,85 @@
+#include "HalideRuntime.h"
+#include "runtime_internal.h"
+
+extern "C" {
+
+// Defined in x86_cpu_features.ll
+void x86_cpuid_halide(int32_t leaf, int32_t subleaf, int32_t *eax, int32_t *ebx, int32_t *ecx, int32_t *edx);
+int32_t x86_xgetbv_halide(int32_t xcr);
+
+}
+
+namespace Halide { namespace Runtime { namespace Internal {
+
+// Racing threads can both run the detection, but they'll compute
+// and store the same values, so no lock is needed.
+WEAK uint64_t cpu_features = 0;
+WEAK bool cpu_features_initialized = false;
+
+WEAK uint64_t detect_cpu_features() {
+    int32_t info[4];
+    uint64_t features = 0;
+
+    x86_cpuid_halide(0, 0, &info[0], &info[1], &info[2], &info[3]);
+    int32_t max_leaf = info[0];
+
+    x86_cpuid_halide(1, 0, &info[0], &info[1], &info[2], &info[3]);
+    bool have_sse41 = info[2] & (1 << 19);
+    bool have_fma = info[2] & (1 << 12);
+    bool have_osxsave = info[2] & (1 << 27);
+    bool have_avx = info[2] & (1 << 28);
+    bool have_f16c = info[2] & (1 << 29);
+
+    if (have_sse41) features |= halide_cpu_feature_sse41;
+
+    // The AVX family of extensions are only usable if the OS saves
+    // the ymm registers on a context switch.
+    bool os_saves_ymm = have_osxsave && ((x86_xgetbv_halide(0) & 6) == 6);
+    if (!os_saves_ymm) {
+        return features;
+    }
+
+    if (have_avx) features |= halide_cpu_feature_avx;
+    if (have_f16c) features |= halide_cpu_feature_f16c;
+    if (have_fma) features |= halide_cpu_feature_fma;
+
+    if (max_leaf >= 7) {
+        x86_cpuid_halide(7, 0, &info[0], &info[1], &info[2], &info[3]);
+        bool have_avx2 = info[1] & (1 << 5);
+        if (have_avx2) features |= halide_cpu_feature_avx2;
+    }
+
+    x86_cpuid_halide((int32_t)0x80000000, 0, &info[0], &info[1], &info[2], &info[3]);
+    if ((uint32_t)info[0] >= 0x80000001) {
+        x86_cpuid_halide((int32_t)0x80000001, 0, &info[0], &info[1], &info[2], &info[3]);
+        bool have_fma4 = info[2] & (1 << 16);
+        if (have_fma4) features |= halide_cpu_feature_fma4;
+    }
+
+    return features;
+}
+
+}}} // namespace Halide::Runtime::Internal
+
+extern "C" {
+
+WEAK uint64_t halide_get_cpu_features() {
+    // Racing first calls all detect the same features. The barriers
+    // make sure no caller sees the flag set before the features it
+    // guards.
+    if (!cpu_features_initialized) {
+        uint64_t features = detect_cpu_features();
+        cpu_features = features;
+        __sync_synchronize();
+        cpu_features_initialized = true;
+        return features;
+    }
+    __sync_synchronize();
+    return cpu_features;
+}
+
+WEAK int halide_can_use_cpu_features(uint64_t features) {
+    return (halide_get_cpu_features() & features) == features;
+}
+
+}
@@ -0,0 +1,23 @@
+; The C++ runtime modules are compiled for a generic target, so they
+; can't use x86 inline assembly directly. x86_cpu_features.cpp calls
+; these instead.
+
+define weak_odr void @x86_cpuid_halide(i32 %leaf, i32 %subleaf, i32* %eax, i32* %ebx, i32* %ecx, i32* %edx) nounwind {
+  %1 = tail call { i32, i32, i32, i32 } asm sideeffect "cpuid", "={ax},={bx},={cx},={dx},{ax},{cx},~{dirflag},~{fpsr},~{flags}"(i32 %leaf, i32 %subleaf) nounwind
+  %2 = extractvalue { i32, i32, i32, i32 } %1, 0
+  %3 = extractvalue { i32, i32, i32, i32 } %1, 1
+  %4 = extractvalue { i32, i32, i32, i32 } %1, 2
+  %5 = extractvalue { i32, i32, i32, i32 } %1, 3
+  store i32 %2, i32* %eax
+  store i32 %3, i32* %ebx
+  store i32 %4, i32* %ecx
+  store i32 %5, i32* %edx
+  ret void
+}
+
+; Returns the low 32 bits of the given extended control register.
+define weak_odr i32 @x86_xgetbv_halide(i32 %xcr) nounwind {
+  %1 = tail call { i32, i32 } asm sideeffect "xgetbv", "={ax},={dx},{cx},~{dirflag},~{fpsr},~{flags}"(i32 %xcr) nounwind
+  %2 = extractvalue { i32, i32 } %1, 0
+  ret i32 %2
+}
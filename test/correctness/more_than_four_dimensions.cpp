@@ -0,0 +1,70 @@
+#include "Halide.h"
+#include <stdio.h>
+
+using namespace Halide;
+
+int main(int argc, char **argv) {
+    // A five-dimensional input.
+    Image<int> input({3, 4, 5, 6, 7});
+    for (int v = 0; v < 7; v++) {
+        for (int w = 0; w < 6; w++) {
+            for (int z = 0; z < 5; z++) {
+                for (int y = 0; y < 4; y++) {
+                    for (int x = 0; x < 3; x++) {
+                        input(x, y, z, w, v) = x + 10*y + 100*z + 1000*w + 10000*v;
+                    }
+                }
+            }
+        }
+    }
+
+    ImageParam param(Int(32), 5);
+    param.set(input);
+
+    // A five-dimensional output that reads the input with the last
+    // dimension reversed, and adds the one in between.
+    Var x, y, z, w, v;
+    Func f;
+    f(x, y, z, w, v) = param(x, y, z, w, 6 - v) + input(x, y, z, w, v);
+    f.compute_root();
+    Func g;
+    g(x, y, z, w, v) = f(x, y, z, w, v) * 2;
+    g.vectorize(x, 4).parallel(v);
+
+    Image<int> out = g.realize(std::vector<int32_t>{3, 4, 5, 6, 7});
+    if (out.dimensions() != 5 || out.extent(4) != 7) {
+        printf("The output should be five-dimensional with an extent of 7 in the last dimension\n");
+        return -1;
+    }
+
+    for (int v = 0; v < 7; v++) {
+        for (int w = 0; w < 6; w++) {
+            for (int z = 0; z < 5; z++) {
+                for (int y = 0; y < 4; y++) {
+                    for (int x = 0; x < 3; x++) {
+                        int correct = 2 * (input(x, y, z, w, 6 - v) + input(x, y, z, w, v));
+                        if (out(x, y, z, w, v) != correct) {
+                            printf("out(%d, %d, %d, %d, %d) = %d instead of %d\n",
+                                   x, y, z, w, v, out(x, y, z, w, v), correct);
+                            return -1;
+                        }
+                    }
+                }
+            }
+        }
+    }
+
+    // Bounds inference should work on the extra dimensions too.
+    ImageParam unbound(Int(32), 5);
+    Func h;
+    h(x, y, z, w, v) = unbound(x, y, z, w, v + 1);
+    h.infer_input_bounds(Buffer(Int(32), std::vector<int32_t>{2, 2, 2, 2, 3}));
+    Image<int> inferred = unbound.get();
+    if (inferred.dimensions() != 5 || inferred.min(4) != 1 || inferred.extent(4) != 3) {
+        printf("Inferred bounds of the fifth dimension were wrong\n");
+        return -1;
+    }
+
+    printf("Success!\n");
+    return 0;
+}
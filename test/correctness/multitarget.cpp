@@ -0,0 +1,69 @@
+#include "Halide.h"
+#include <stdio.h>
+#include <fstream>
+#include <sstream>
+
+using namespace Halide;
+
+std::string variant_name(const std::string &fn_name, const Target &t) {
+    std::string suffix = t.to_string();
+    for (char &c : suffix) {
+        if (c == '-') c = '_';
+    }
+    return fn_name + "_" + suffix;
+}
+
+int main(int argc, char **argv) {
+    Target host = get_host_target();
+    if (host.arch != Target::X86) {
+        printf("Skipping test because multi-target compilation is only supported on x86\n");
+        return 0;
+    }
+
+    Func f;
+    Var x;
+    ImageParam in(Float(32), 1);
+    f(x) = sqrt(in(x)) * 3.0f + in(x + 1);
+    f.vectorize(x, 8);
+
+    // Preferred targets first. The last one is the fallback.
+    std::vector<Target> targets = {
+        Target(host.os, Target::X86, host.bits, {Target::SSE41, Target::AVX, Target::AVX2, Target::F16C, Target::FMA}),
+        Target(host.os, Target::X86, host.bits, {Target::SSE41}),
+        Target(host.os, Target::X86, host.bits)
+    };
+
+    const char *assembly_name = "multitarget.s";
+    f.compile_to(Outputs().assembly(assembly_name), {in}, "multitarget", targets);
+
+    std::ifstream file(assembly_name);
+    std::stringstream contents;
+    contents << file.rdbuf();
+    std::string assembly = contents.str();
+
+    // There should be the dispatcher and its wrappers...
+    for (const char *name : {"multitarget:", "multitarget_argv:", "multitarget_metadata:"}) {
+        if (assembly.find(name) == std::string::npos) {
+            printf("Did not find %s in the assembly\n", name);
+            return -1;
+        }
+    }
+
+    // ...plus an entry point for each variant.
+    for (const Target &t : targets) {
+        std::string name = variant_name("multitarget", t);
+        if (assembly.find(name + ":") == std::string::npos) {
+            printf("Did not find %s in the assembly\n", name.c_str());
+            return -1;
+        }
+    }
+
+    // Only the avx variant can have used the 256-bit registers.
+    if (assembly.find("%ymm") == std::string::npos) {
+        printf("The avx variant was not compiled with avx enabled\n");
+        return -1;
+    }
+
+    printf("Success!\n");
+    return 0;
+}
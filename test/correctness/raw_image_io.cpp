@@ -0,0 +1,341 @@
+#include "Halide.h"
+#include "halide_image_io.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <string>
+#include <vector>
+
+using namespace Halide;
+using namespace Halide::Tools;
+
+// Tests the raw image format of tools/halide_image_io.h.
+
+template<typename T>
+T value_at(int x, int y, int c) {
+    return (T)(x * 3 + y * 101 + c * 17 + 1);
+}
+
+template<typename T>
+void fill(Image<T> &im) {
+    for (int c = im.min(2); c < im.min(2) + im.channels(); c++) {
+        for (int y = im.min(1); y < im.min(1) + im.height(); y++) {
+            for (int x = im.min(0); x < im.min(0) + im.width(); x++) {
+                im(x, y, c) = value_at<T>(x, y, c);
+            }
+        }
+    }
+}
+
+// Check the shape and contents of an image made by fill.
+template<typename T>
+bool check_contents(const Image<T> &im, int min_x, int min_y, int w, int h, int channels) {
+    if (im.dimensions() != 3 ||
+        im.min(0) != min_x || im.min(1) != min_y || im.min(2) != 0 ||
+        im.extent(0) != w || im.extent(1) != h || im.extent(2) != channels) {
+        printf("Image has the wrong shape: [%d, %d] x [%d, %d] x [%d, %d]\n",
+               im.min(0), im.extent(0), im.min(1), im.extent(1), im.min(2), im.extent(2));
+        return false;
+    }
+    for (int c = 0; c < channels; c++) {
+        for (int y = min_y; y < min_y + h; y++) {
+            for (int x = min_x; x < min_x + w; x++) {
+                if (im(x, y, c) != value_at<T>(x, y, c)) {
+                    printf("im(%d, %d, %d) = %f instead of %f\n", x, y, c,
+                           (double)im(x, y, c), (double)value_at<T>(x, y, c));
+                    return false;
+                }
+            }
+        }
+    }
+    return true;
+}
+
+long file_size(const std::string &filename) {
+    FILE *f = fopen(filename.c_str(), "rb");
+    if (!f) return -1;
+    fseek(f, 0, SEEK_END);
+    long size = ftell(f);
+    fclose(f);
+    return size;
+}
+
+std::vector<char> read_file(const std::string &filename) {
+    std::vector<char> data(file_size(filename));
+    FILE *f = fopen(filename.c_str(), "rb");
+    size_t read = fread(data.data(), 1, data.size(), f);
+    fclose(f);
+    data.resize(read);
+    return data;
+}
+
+void write_file(const std::string &filename, const char *data, size_t size) {
+    FILE *f = fopen(filename.c_str(), "wb");
+    fwrite(data, 1, size, f);
+    fclose(f);
+}
+
+// A dense planar image, with a nonzero min, survives a round trip.
+bool test_planar_round_trip() {
+    const std::string filename = "raw_image_io_planar.hraw";
+    Image<uint16_t> im(17, 9, 3);
+    im.set_min(-3, 5);
+    fill(im);
+    if (!save_raw(im, filename)) {
+        printf("Could not save %s\n", filename.c_str());
+        return false;
+    }
+
+    const long expected_size = Tools::Internal::raw_data_alignment + 17 * 9 * 3 * sizeof(uint16_t);
+    if (file_size(filename) != expected_size) {
+        printf("%s is %ld bytes instead of %ld\n", filename.c_str(), file_size(filename), expected_size);
+        return false;
+    }
+
+    Image<uint16_t> loaded;
+    if (!load_raw(filename, &loaded)) {
+        printf("Could not load %s\n", filename.c_str());
+        return false;
+    }
+    return check_contents(loaded, -3, 5, 17, 9, 3);
+}
+
+// An interleaved image is saved interleaved, so mapping it gives back
+// the same layout, and loading it gives a planar copy.
+bool test_interleaved_round_trip() {
+    const std::string filename = "raw_image_io_interleaved.hraw";
+    std::vector<float> storage(13 * 7 * 3);
+    buffer_t buf = {0};
+    buf.host = (uint8_t *)storage.data();
+    buf.extent[0] = 13;
+    buf.extent[1] = 7;
+    buf.extent[2] = 3;
+    buf.stride[0] = 3;
+    buf.stride[1] = 13 * 3;
+    buf.stride[2] = 1;
+    buf.elem_size = sizeof(float);
+    Image<float> im(&buf);
+    fill(im);
+    if (!save_raw(im, filename)) {
+        printf("Could not save %s\n", filename.c_str());
+        return false;
+    }
+
+    {
+        MappedRawFile file;
+        Image<float> mapped;
+        if (!map_raw(filename, &file, &mapped)) {
+            printf("Could not map %s\n", filename.c_str());
+            return false;
+        }
+        if (mapped.stride(0) != 3 || mapped.stride(1) != 13 * 3 || mapped.stride(2) != 1) {
+            printf("Mapped interleaved image has strides %d %d %d\n",
+                   mapped.stride(0), mapped.stride(1), mapped.stride(2));
+            return false;
+        }
+        if (!check_contents(mapped, 0, 0, 13, 7, 3)) return false;
+    }
+
+    Image<float> loaded;
+    if (!load_raw(filename, &loaded)) {
+        printf("Could not load %s\n", filename.c_str());
+        return false;
+    }
+    if (loaded.stride(0) != 1) {
+        printf("Loaded image is not planar\n");
+        return false;
+    }
+    return check_contents(loaded, 0, 0, 13, 7, 3);
+}
+
+// An image that isn't dense, e.g. a crop of a larger one, is packed
+// before it's written.
+bool test_cropped_round_trip() {
+    const std::string filename = "raw_image_io_cropped.hraw";
+    Image<int32_t> big(20, 20, 2);
+    fill(big);
+
+    buffer_t crop = *big.raw_buffer();
+    crop.host = (uint8_t *)&big(4, 6, 0);
+    crop.min[0] = 4;
+    crop.min[1] = 6;
+    crop.extent[0] = 10;
+    crop.extent[1] = 5;
+    Image<int32_t> cropped(&crop);
+    if (!save_raw(cropped, filename)) {
+        printf("Could not save %s\n", filename.c_str());
+        return false;
+    }
+
+    const long expected_size = Tools::Internal::raw_data_alignment + 10 * 5 * 2 * sizeof(int32_t);
+    if (file_size(filename) != expected_size) {
+        printf("%s is %ld bytes instead of %ld\n", filename.c_str(), file_size(filename), expected_size);
+        return false;
+    }
+
+    Image<int32_t> loaded;
+    if (!load_raw(filename, &loaded)) {
+        printf("Could not load %s\n", filename.c_str());
+        return false;
+    }
+    return check_contents(loaded, 4, 6, 10, 5, 2);
+}
+
+// Writes through a writable mapping reach the file. Writes through a
+// read-only one don't.
+bool test_writable_map() {
+    const std::string filename = "raw_image_io_writable.hraw";
+    Image<uint8_t> im(32, 16, 1);
+    fill(im);
+    if (!save_raw(im, filename)) {
+        printf("Could not save %s\n", filename.c_str());
+        return false;
+    }
+
+    {
+        MappedRawFile file;
+        Image<uint8_t> mapped;
+        if (!map_raw(filename, &file, &mapped, false)) {
+            printf("Could not map %s\n", filename.c_str());
+            return false;
+        }
+        mapped(3, 4, 0) = 200;
+    }
+
+    {
+        MappedRawFile file;
+        Image<uint8_t> mapped;
+        if (!map_raw(filename, &file, &mapped, true)) {
+            printf("Could not map %s writable\n", filename.c_str());
+            return false;
+        }
+        if (mapped(3, 4, 0) != value_at<uint8_t>(3, 4, 0)) {
+            printf("A write through a read-only mapping reached the file\n");
+            return false;
+        }
+        mapped(5, 6, 0) = 201;
+        if (!file.sync()) {
+            printf("Could not sync %s\n", filename.c_str());
+            return false;
+        }
+    }
+
+    Image<uint8_t> loaded;
+    if (!load_raw(filename, &loaded)) {
+        printf("Could not load %s\n", filename.c_str());
+        return false;
+    }
+    if (loaded(5, 6, 0) != 201) {
+        printf("A write through a writable mapping did not reach the file\n");
+        return false;
+    }
+    loaded(5, 6, 0) = value_at<uint8_t>(5, 6, 0);
+    return check_contents(loaded, 0, 0, 32, 16, 1);
+}
+
+// create_raw makes a file just big enough for a dense planar image of
+// the given size, and anything written to the image ends up in it.
+bool test_create() {
+    const std::string filename = "raw_image_io_created.hraw";
+    {
+        MappedRawFile file;
+        Image<int16_t> im;
+        if (!create_raw(filename, &file, &im, 11, 6, 4)) {
+            printf("Could not create %s\n", filename.c_str());
+            return false;
+        }
+        if (im.dimensions() != 3 || im.width() != 11 || im.height() != 6 || im.channels() != 4 ||
+            im.stride(0) != 1 || im.stride(1) != 11 || im.stride(2) != 11 * 6) {
+            printf("Created image has the wrong shape\n");
+            return false;
+        }
+        fill(im);
+    }
+
+    const long expected_size = Tools::Internal::raw_data_alignment + 11 * 6 * 4 * sizeof(int16_t);
+    if (file_size(filename) != expected_size) {
+        printf("%s is %ld bytes instead of %ld\n", filename.c_str(), file_size(filename), expected_size);
+        return false;
+    }
+
+    Image<int16_t> loaded;
+    if (!load_raw(filename, &loaded)) {
+        printf("Could not load %s\n", filename.c_str());
+        return false;
+    }
+    return check_contents(loaded, 0, 0, 11, 6, 4);
+}
+
+// Files that are truncated, aren't raw images, or hold a different
+// element type are rejected.
+bool test_bad_files() {
+    const std::string good = "raw_image_io_good.hraw";
+    const std::string bad = "raw_image_io_bad.hraw";
+    Image<float> im(8, 8, 2);
+    fill(im);
+    if (!save_raw(im, good)) {
+        printf("Could not save %s\n", good.c_str());
+        return false;
+    }
+    std::vector<char> data = read_file(good);
+
+    Image<float> loaded;
+    MappedRawFile file;
+
+    // Missing the last element.
+    write_file(bad, data.data(), data.size() - sizeof(float));
+    if (load_raw(bad, &loaded) || map_raw(bad, &file, &loaded)) {
+        printf("Loaded a truncated file\n");
+        return false;
+    }
+
+    // Shorter than the header.
+    write_file(bad, data.data(), 20);
+    if (load_raw(bad, &loaded)) {
+        printf("Loaded a file shorter than the header\n");
+        return false;
+    }
+
+    // Bad magic.
+    std::vector<char> corrupt = data;
+    corrupt[0] ^= 0xff;
+    write_file(bad, corrupt.data(), corrupt.size());
+    if (load_raw(bad, &loaded)) {
+        printf("Loaded a file with bad magic\n");
+        return false;
+    }
+
+    // The wrong element type.
+    Image<int32_t> wrong_type;
+    if (load_raw(good, &wrong_type)) {
+        printf("Loaded a float file into an int image\n");
+        return false;
+    }
+
+    // A file that doesn't exist.
+    if (load_raw("raw_image_io_does_not_exist.hraw", &loaded)) {
+        printf("Loaded a file that does not exist\n");
+        return false;
+    }
+
+    // The good one still loads.
+    if (!load_raw(good, &loaded)) {
+        printf("Could not load %s\n", good.c_str());
+        return false;
+    }
+    return check_contents(loaded, 0, 0, 8, 8, 2);
+}
+
+int main(int argc, char **argv) {
+    if (!test_planar_round_trip() ||
+        !test_interleaved_round_trip() ||
+        !test_cropped_round_trip() ||
+        !test_writable_map() ||
+        !test_create() ||
+        !test_bad_files()) {
+        return -1;
+    }
+
+    printf("Success!\n");
+    return 0;
+}
@@ -0,0 +1,73 @@
+#include "Halide.h"
+#include <stdio.h>
+#include <atomic>
+
+using namespace Halide;
+
+int input_value(int x, int y) {
+    return x * 3 + y * 7;
+}
+
+int main(int argc, char **argv) {
+    ImageParam input(Int(32), 2, "input");
+    Var x, y;
+    Func f;
+    f(x, y) = input(x - 1, y) + input(x + 1, y) + input(x, y + 2);
+
+    const int width = 100, height = 70;
+    const int tile_width = 32, tile_height = 16;
+
+    Image<int> result(width, height);
+    std::atomic<int> reads(0);
+    int writes = 0;
+    bool ok = true;
+
+    f.realize_tiled({width, height}, {tile_width, tile_height},
+        [&](const std::string &name, Buffer region) {
+            // Only the tile and its halo should be read.
+            Image<int> in(region);
+            if (name != "input" ||
+                in.width() > tile_width + 2 ||
+                in.height() > tile_height + 2) {
+                printf("Read an unexpected region of %s: %d x %d\n",
+                       name.c_str(), in.width(), in.height());
+                ok = false;
+            }
+            for (int y = in.min(1); y < in.min(1) + in.height(); y++) {
+                for (int x = in.min(0); x < in.min(0) + in.width(); x++) {
+                    in(x, y) = input_value(x, y);
+                }
+            }
+            reads++;
+        },
+        [&](Realization tile) {
+            Image<int> out(tile[0]);
+            for (int y = out.min(1); y < out.min(1) + out.height(); y++) {
+                for (int x = out.min(0); x < out.min(0) + out.width(); x++) {
+                    result(x, y) = out(x, y);
+                }
+            }
+            writes++;
+        });
+
+    if (!ok) return -1;
+
+    const int tiles = ((width + tile_width - 1) / tile_width) * ((height + tile_height - 1) / tile_height);
+    if (reads != tiles || writes != tiles) {
+        printf("Expected %d tiles. Read %d and wrote %d\n", tiles, (int)reads, writes);
+        return -1;
+    }
+
+    for (int y = 0; y < height; y++) {
+        for (int x = 0; x < width; x++) {
+            int correct = input_value(x - 1, y) + input_value(x + 1, y) + input_value(x, y + 2);
+            if (result(x, y) != correct) {
+                printf("result(%d, %d) = %d instead of %d\n", x, y, result(x, y), correct);
+                return -1;
+            }
+        }
+    }
+
+    printf("Success!\n");
+    return 0;
+}
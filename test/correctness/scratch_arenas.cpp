@@ -0,0 +1,87 @@
+#include "Halide.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <atomic>
+
+using namespace Halide;
+
+// Allocations inside a parallel loop come from per-task scratch
+// arenas. Blocks that don't fit in an arena yet come from the custom
+// allocator, and the arenas grow so that later calls don't need it.
+
+std::atomic<int> malloc_count;
+std::atomic<int> free_count;
+
+void *my_malloc(void *user_context, size_t x) {
+    malloc_count++;
+    void *orig = malloc(x+32);
+    void *ptr = (void *)((((size_t)orig + 32) >> 5) << 5);
+    ((void **)ptr)[-1] = orig;
+    return ptr;
+}
+
+void my_free(void *user_context, void *ptr) {
+    free_count++;
+    free(((void**)ptr)[-1]);
+}
+
+int main(int argc, char **argv) {
+#ifdef _WIN32
+    printf("Skipping test because it uses setenv\n");
+    return 0;
+#else
+    // Run all the tasks on one thread, so that they all use the same
+    // arena.
+    setenv("HL_NUM_THREADS", "1", 1);
+
+    // f and h are too large for the stack, and are allocated once
+    // per task. h is freed before f, and is reallocated for each
+    // iteration of the serial loop over c.
+    Func f, h, g;
+    Var x, y, c;
+    f(x, y) = x + y;
+    h(x, y, c) = f(x - 1, y) + f(x + 1, y) + c;
+    g(x, y, c) = h(x, y, c) * 2;
+    f.compute_at(g, y);
+    h.compute_at(g, c);
+    g.reorder(x, c, y).parallel(y);
+
+    g.set_custom_allocator(my_malloc, my_free);
+
+    const int W = 10000, H = 16, C = 3;
+    for (int i = 0; i < 3; i++) {
+        malloc_count = 0;
+        free_count = 0;
+        Image<int> out = g.realize(W, H, C);
+        for (int c = 0; c < C; c++) {
+            for (int y = 0; y < H; y++) {
+                for (int x = 0; x < W; x++) {
+                    int correct = ((x - 1 + y) + (x + 1 + y) + c) * 2;
+                    if (out(x, y, c) != correct) {
+                        printf("out(%d, %d, %d) = %d instead of %d\n",
+                               x, y, c, out(x, y, c), correct);
+                        return -1;
+                    }
+                }
+            }
+        }
+
+        printf("Realization %d: %d mallocs, %d frees\n", i, (int)malloc_count, (int)free_count);
+        if (malloc_count != free_count) {
+            printf("Each malloc should be matched by a free\n");
+            return -1;
+        }
+        if (i == 0 && malloc_count == 0) {
+            printf("The first task should have fallen back to the custom allocator\n");
+            return -1;
+        }
+        if (i > 0 && malloc_count != 0) {
+            printf("Later realizations should only use the scratch arena\n");
+            return -1;
+        }
+    }
+
+    printf("Success!\n");
+    return 0;
+#endif
+}
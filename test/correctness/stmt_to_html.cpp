@@ -1,11 +1,33 @@
 #include "Halide.h"
 #include <stdio.h>
+#include <stdlib.h>
+#include <fstream>
+#include <sstream>
+#include <string>
 #ifndef _MSC_VER
 #include <unistd.h>
 #endif
 
 using namespace Halide;
 
+// The lightness of the background of the produce node of the given
+// Func, which is lower the more time was spent in it, or -1 if it
+// isn't colored.
+int produce_lightness(const std::string &html, const std::string &func) {
+    const std::string produce = "class='Produce'";
+    const std::string style = "style='background-color: hsl(0, 100%, ";
+    const std::string name = ">" + func + "</b>";
+    for (size_t i = html.find(produce); i != std::string::npos; i = html.find(produce, i + 1)) {
+        size_t end = html.find("{", i);
+        size_t n = html.find(name, i);
+        if (n == std::string::npos || n > end) continue;
+        size_t s = html.find(style, i);
+        if (s == std::string::npos || s > n) return -1;
+        return atoi(html.c_str() + s + style.size());
+    }
+    return -1;
+}
+
 int main() {
     Var x, y;
 
@@ -52,6 +74,42 @@ int main() {
     assert(access(result_file_2, F_OK) == 0 && "Output file not created.");
     #endif
 
+    // Check annotating the html with a profile of a run.
+    Func hot("hot"), cold("cold");
+    Expr e = cast<float>(x + y);
+    for (int i = 0; i < 20; i++) {
+        e = sqrt(e * e + 1.0f);
+    }
+    hot(x, y) = e;
+    cold(x, y) = hot(x, y) + 1;
+    hot.compute_root();
+    Pipeline p(cold);
+    Target t = get_jit_target_from_environment().with_feature(Target::Profile);
+    p.realize(1000, 1000, t);
+    if (!p.last_profile()) {
+        printf("The pipeline didn't keep its profile\n");
+        return -1;
+    }
+
+    const char *result_file_4 = "stmt_to_html_dump_4.html";
+    p.compile_to_lowered_stmt(result_file_4, {}, Halide::HTML, t, p.last_profile());
+
+    std::ifstream html(result_file_4);
+    std::stringstream contents;
+    contents << html.rdbuf();
+    if (contents.str().find("class='Profile'") == std::string::npos) {
+        printf("The html was not annotated with the profile\n");
+        return -1;
+    }
+
+    int hot_lightness = produce_lightness(contents.str(), "hot");
+    int cold_lightness = produce_lightness(contents.str(), "cold");
+    if (hot_lightness < 0 || cold_lightness < 0 || hot_lightness >= cold_lightness) {
+        printf("hot should be colored hotter than cold. Their lightnesses were %d and %d\n",
+               hot_lightness, cold_lightness);
+        return -1;
+    }
+
     printf("Success!\n");
     return 0;
 }
@@ -0,0 +1,122 @@
+#include "Halide.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+
+using namespace Halide;
+
+// The recompute ratio HalideTraceStats reported for a Func, or -1 if
+// it didn't report one. The stats of each Func are on the indented
+// lines after its name.
+float recompute_ratio(const std::string &report, const std::string &func) {
+    size_t line = report.find("\n" + func + ":\n");
+    if (line == std::string::npos) return -1;
+    line = report.find('\n', line + 1) + 1;
+    while (report.compare(line, 2, "  ") == 0) {
+        size_t end = report.find('\n', line);
+        size_t r = report.find("recompute: ", line);
+        if (r < end) {
+            return (float)atof(report.c_str() + r + strlen("recompute: "));
+        }
+        line = end + 1;
+    }
+    return -1;
+}
+
+int main(int argc, char **argv) {
+#ifdef _WIN32
+    printf("Skipping test because it uses setenv and popen\n");
+    return 0;
+#else
+    // HalideTraceStats is built next to the tests.
+    std::string dir = argv[0];
+    dir = dir.substr(0, dir.rfind('/') + 1);
+    std::string tool = dir + "HalideTraceStats";
+    FILE *exists = fopen(tool.c_str(), "rb");
+    if (!exists) {
+        printf("Skipping test because %s was not built\n", tool.c_str());
+        return 0;
+    }
+    fclose(exists);
+
+    // The runtime reads this the first time it traces something.
+    const char *filename = "trace_stats.bin";
+    remove(filename);
+    setenv("HL_TRACE_FILE", filename, 1);
+
+    const int W = 16, H = 16;
+    Var x, y;
+    Func input;
+    input(x, y) = x + y;
+
+    // A 3x3 blur with the horizontal pass computed once per row of the
+    // vertical pass, so that it computes each of its rows three
+    // times, apart from the ones at the edges.
+    {
+        Func blur_x("blur_x_at"), blur_y;
+        blur_x(x, y) = input(x - 1, y) + input(x, y) + input(x + 1, y);
+        blur_y(x, y) = blur_x(x, y - 1) + blur_x(x, y) + blur_x(x, y + 1);
+        blur_x.compute_at(blur_y, y).trace_stores();
+        blur_y.realize(W, H);
+    }
+
+    // The same blur with the horizontal pass computed once.
+    {
+        Func blur_x("blur_x_root"), blur_y;
+        blur_x(x, y) = input(x - 1, y) + input(x, y) + input(x + 1, y);
+        blur_y(x, y) = blur_x(x, y - 1) + blur_x(x, y) + blur_x(x, y + 1);
+        blur_x.compute_root().trace_stores();
+        blur_y.realize(W, H);
+    }
+
+    // Update definitions store to points the pure definition already
+    // stored to, but that isn't recompute.
+    {
+        Func f("updated"), g;
+        f(x, y) = x;
+        f(x, y) += y;
+        f(x, y) *= 2;
+        g(x, y) = f(x, y);
+        f.compute_root().trace_stores().trace_realizations();
+        g.realize(W, H);
+    }
+
+    // The trace file is flushed at the end of each pipeline.
+    std::string command = tool + " < " + filename;
+    FILE *output = popen(command.c_str(), "r");
+    if (!output) {
+        printf("Could not run %s\n", command.c_str());
+        return -1;
+    }
+    std::string report = "\n";
+    char buf[1024];
+    while (fgets(buf, sizeof(buf), output)) {
+        report += buf;
+    }
+    if (pclose(output) != 0) {
+        printf("%s failed:%s", command.c_str(), report.c_str());
+        return -1;
+    }
+
+    struct {
+        const char *func;
+        float expected;
+    } checks[] = {
+        {"blur_x_at", 3.0f * H / (H + 2)},
+        {"blur_x_root", 1.0f},
+        {"updated", 1.0f},
+    };
+    for (auto c : checks) {
+        float ratio = recompute_ratio(report, c.func);
+        if (ratio < c.expected - 0.001f || ratio > c.expected + 0.001f) {
+            printf("Recompute ratio of %s was %f instead of %f:%s",
+                   c.func, ratio, c.expected, report.c_str());
+            return -1;
+        }
+    }
+
+    printf("Success!\n");
+    return 0;
+#endif
+}
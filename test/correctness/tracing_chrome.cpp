@@ -0,0 +1,90 @@
+#include "Halide.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <map>
+#include <string>
+
+using namespace Halide;
+
+int main(int argc, char **argv) {
+#ifdef _WIN32
+    printf("Skipping test because it uses setenv\n");
+    return 0;
+#else
+    // The runtime reads these the first time it traces something.
+    const char *filename = "tracing_chrome.json";
+    remove(filename);
+    setenv("HL_TRACE_FILE", filename, 1);
+    setenv("HL_TRACE_FORMAT", "chrome", 1);
+
+    Func f("f"), g("g"), h("h \"quoted\" \\ name");
+    Var x, y;
+    f(x, y) = x + y;
+    g(x, y) = f(x, y) * 2;
+    f.compute_root().parallel(y);
+    f.trace_realizations();
+    g.trace_realizations();
+    g.realize(16, 8);
+
+    // Names are escaped so that the file is still valid JSON.
+    h(x) = x;
+    h.trace_realizations();
+    h.realize(4);
+
+    // Every span should end on the thread it began on, and there
+    // should be one task per row of f.
+    FILE *file = fopen(filename, "r");
+    if (!file) {
+        printf("Trace file was not written\n");
+        return -1;
+    }
+    std::map<std::string, int> depth;
+    int tasks = 0, realizations = 0, escaped = 0;
+    char line[1024];
+    if (!fgets(line, sizeof(line), file) || strcmp(line, "[\n") != 0) {
+        printf("Trace file should begin with an open bracket\n");
+        return -1;
+    }
+    while (fgets(line, sizeof(line), file)) {
+        const char *tid = strstr(line, "\"tid\":");
+        if (!tid || line[0] != '{') {
+            printf("Bad line in trace file: %s", line);
+            return -1;
+        }
+        std::string thread(tid + 6, strcspn(tid + 6, ",}"));
+        if (strstr(line, "\"ph\":\"B\"")) {
+            depth[thread]++;
+            if (strstr(line, "\"name\":\"task f.s0.y[")) tasks++;
+            if (strstr(line, "\"name\":\"realize f\"")) realizations++;
+            if (strstr(line, "\"name\":\"produce h \\\"quoted\\\" \\\\ name\"")) escaped++;
+        } else if (strstr(line, "\"ph\":\"E\"")) {
+            if (--depth[thread] < 0) {
+                printf("Span ended on thread %s without beginning there\n", thread.c_str());
+                return -1;
+            }
+        }
+    }
+    fclose(file);
+
+    for (auto d : depth) {
+        if (d.second != 0) {
+            printf("%d spans on thread %s never ended\n", d.second, d.first.c_str());
+            return -1;
+        }
+    }
+
+    if (tasks != 8 || realizations != 1) {
+        printf("Expected 8 tasks and 1 realization of f. Got %d and %d\n", tasks, realizations);
+        return -1;
+    }
+
+    if (escaped != 1) {
+        printf("Expected h to be produced once, with its name escaped. Got %d\n", escaped);
+        return -1;
+    }
+
+    printf("Success!\n");
+    return 0;
+#endif
+}
@@ -0,0 +1,64 @@
+#include "Halide.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <map>
+#include <string>
+
+using namespace Halide;
+
+std::map<std::string, int> stores, realizations;
+
+int my_trace(void *user_context, const halide_trace_event *e) {
+    if (e->event == halide_trace_store) {
+        int x = e->coordinates[0], y = e->coordinates[1];
+        if (x < 2 || x >= 6 || y < 1 || y >= 4) {
+            printf("Store to %s(%d, %d) is outside the region of interest\n", e->func, x, y);
+            exit(-1);
+        }
+        stores[e->func]++;
+    } else if (e->event == halide_trace_begin_realization) {
+        realizations[e->func]++;
+    }
+    return 0;
+}
+
+int main(int argc, char **argv) {
+#ifdef _WIN32
+    printf("Skipping test because it uses setenv\n");
+    return 0;
+#else
+    // The runtime reads these the first time it traces something.
+    setenv("HL_TRACE_FUNCS", "f,h", 1);
+    setenv("HL_TRACE_REGION", "2,4,1,3", 1);
+    setenv("HL_TRACE_SAMPLING", "2", 1);
+
+    Func f("f"), g("g"), h("h");
+    Var x, y;
+    f(x, y) = x + y;
+    g(x, y) = f(x, y) * 2;
+    h(x, y) = g(x, y) + 1;
+    f.compute_root().trace_stores().trace_realizations();
+    g.compute_root().trace_stores().trace_realizations();
+    h.trace_stores().trace_realizations();
+
+    h.set_custom_trace(&my_trace);
+    h.realize(16, 16);
+
+    // g isn't in the list of Funcs, and only half of the 12 stores to
+    // f and h in the region should have been sampled.
+    if (stores["f"] != 6 || stores["g"] != 0 || stores["h"] != 6) {
+        printf("Wrong number of stores traced: f: %d g: %d h: %d\n",
+               stores["f"], stores["g"], stores["h"]);
+        return -1;
+    }
+
+    if (realizations["f"] != 1 || realizations["g"] != 0 || realizations["h"] != 1) {
+        printf("Wrong number of realizations traced: f: %d g: %d h: %d\n",
+               realizations["f"], realizations["g"], realizations["h"]);
+        return -1;
+    }
+
+    printf("Success!\n");
+    return 0;
+#endif
+}
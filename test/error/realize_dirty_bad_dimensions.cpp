@@ -0,0 +1,21 @@
+#include "Halide.h"
+#include <stdio.h>
+
+using namespace Halide;
+
+int main(int argc, char **argv) {
+    ImageParam input(Int(32), 2, "input");
+    Func f;
+    Var x, y;
+    f(x, y) = input(x, y) * 2;
+
+    Image<int> in(10, 10);
+    input.set(in);
+    Image<int> out = f.realize(10, 10);
+
+    // The dirty region of a two-dimensional input with one dimension.
+    f.realize_dirty(out, {{"input", {{2, 3}}}});
+
+    printf("There should have been an error\n");
+    return 0;
+}
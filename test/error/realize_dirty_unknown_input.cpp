@@ -0,0 +1,21 @@
+#include "Halide.h"
+#include <stdio.h>
+
+using namespace Halide;
+
+int main(int argc, char **argv) {
+    ImageParam input(Int(32), 2, "input");
+    Func f;
+    Var x, y;
+    f(x, y) = input(x, y) * 2;
+
+    Image<int> in(10, 10);
+    input.set(in);
+    Image<int> out = f.realize(10, 10);
+
+    // A dirty region of something the pipeline doesn't read.
+    f.realize_dirty(out, {{"inptu", {{2, 3}, {4, 5}}}});
+
+    printf("There should have been an error\n");
+    return 0;
+}
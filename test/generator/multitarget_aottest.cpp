@@ -0,0 +1,174 @@
+#include "HalideRuntime.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+#include <vector>
+
+#ifndef _WIN32
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
+
+#include "multitarget.h"
+#include "halide_image.h"
+
+using namespace Halide::Tools;
+
+// The object holds these variants, in order of preference. They are
+// all compiled with the profiler on, which names each pipeline after
+// the variant that ran.
+enum Variant {
+    AVX2,
+    SSE41,
+    Fallback,
+    Unknown
+};
+
+const char *variant_names[] = {"avx2", "sse41", "fallback", "unknown"};
+
+const uint64_t avx2_features =
+    halide_cpu_feature_sse41 | halide_cpu_feature_avx | halide_cpu_feature_avx2 |
+    halide_cpu_feature_f16c | halide_cpu_feature_fma;
+const uint64_t sse41_features = halide_cpu_feature_sse41;
+
+// The features the dispatcher is allowed to see, and every set of
+// features it asked about.
+uint64_t feature_mask = ~(uint64_t)0;
+std::vector<uint64_t> queries;
+
+// Replaces the runtime's version, which is weak.
+extern "C" int halide_can_use_cpu_features(uint64_t features) {
+    queries.push_back(features);
+    return (halide_get_cpu_features() & feature_mask & features) == features;
+}
+
+Variant expected_variant() {
+    uint64_t available = halide_get_cpu_features() & feature_mask;
+    if ((available & avx2_features) == avx2_features) {
+        return AVX2;
+    } else if ((available & sse41_features) == sse41_features) {
+        return SSE41;
+    } else {
+        return Fallback;
+    }
+}
+
+// Work out which variant ran from the name the profiler knows it by.
+Variant variant_that_ran() {
+    Variant result = Unknown;
+    halide_profiler_state *s = halide_profiler_get_state();
+    for (halide_profiler_pipeline_stats *p = s->pipelines; p;
+         p = (halide_profiler_pipeline_stats *)(p->next)) {
+        if (p->runs == 0) {
+            continue;
+        }
+        if (result != Unknown) {
+            printf("More than one variant ran\n");
+            return Unknown;
+        }
+        if (strstr(p->name, "avx2")) {
+            result = AVX2;
+        } else if (strstr(p->name, "sse41")) {
+            result = SSE41;
+        } else {
+            result = Fallback;
+        }
+    }
+    return result;
+}
+
+bool run() {
+    const int W = 64, H = 16;
+    Image<float> input(W, H);
+    for (int y = 0; y < H; y++) {
+        for (int x = 0; x < W; x++) {
+            input(x, y) = (float)(x + y * W);
+        }
+    }
+    Image<float> output(W, H);
+
+    int result = multitarget(input, output);
+    if (result != 0) {
+        printf("The pipeline failed with %d\n", result);
+        return false;
+    }
+
+    for (int y = 0; y < H; y++) {
+        for (int x = 0; x < W; x++) {
+            float in = input(x, y);
+            float correct = sqrtf(in) * 3.0f + in * in;
+            if (fabs(output(x, y) - correct) > 1e-3f * correct + 1e-3f) {
+                printf("output(%d, %d) = %f instead of %f\n", x, y, output(x, y), correct);
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+// Run the pipeline twice with the given features visible, and check
+// that the dispatcher picked the best variant they allow, asked about
+// the variants in order of preference, and only asked once.
+bool check(uint64_t mask) {
+    feature_mask = mask;
+    queries.clear();
+
+    if (!run()) return false;
+
+    Variant expected = expected_variant();
+    Variant actual = variant_that_ran();
+    if (actual != expected) {
+        printf("With features 0x%llx visible, the %s variant ran instead of the %s variant\n",
+               (unsigned long long)(halide_get_cpu_features() & mask),
+               variant_names[actual], variant_names[expected]);
+        return false;
+    }
+
+    std::vector<uint64_t> expected_queries = {avx2_features, sse41_features};
+    expected_queries.resize(expected == Fallback ? 2 : (size_t)expected + 1);
+    if (queries != expected_queries) {
+        printf("The dispatcher asked about %d sets of features instead of %d\n",
+               (int)queries.size(), (int)expected_queries.size());
+        return false;
+    }
+
+    // The choice is cached, so the next call doesn't ask again.
+    if (!run()) return false;
+    if (queries.size() != expected_queries.size()) {
+        printf("The dispatcher asked about the features again on the second call\n");
+        return false;
+    }
+    return true;
+}
+
+int main(int argc, char **argv) {
+#ifdef _WIN32
+    printf("Skipping test because it needs fork()\n");
+    return 0;
+#else
+    // The dispatcher only chooses once per process, so each masked
+    // run happens in a child process.
+    for (uint64_t mask : {(uint64_t)0, sse41_features}) {
+        pid_t pid = fork();
+        if (pid == 0) {
+            bool ok = check(mask);
+            fflush(stdout);
+            _exit(ok ? 0 : 1);
+        }
+        int status = 0;
+        if (pid < 0 || waitpid(pid, &status, 0) != pid ||
+            !WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+            return -1;
+        }
+    }
+
+    // With everything the host has visible.
+    if (!check(~(uint64_t)0)) {
+        return -1;
+    }
+
+    printf("Success!\n");
+    return 0;
+#endif
+}
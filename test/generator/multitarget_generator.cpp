@@ -0,0 +1,25 @@
+#include "Halide.h"
+
+namespace {
+
+// This generator is built for several x86 targets at once (see the
+// Makefile and test/CMakeLists.txt), so the object contains a variant
+// for each plus a dispatcher that picks one at runtime.
+class Multitarget : public Halide::Generator<Multitarget> {
+public:
+    ImageParam input{ Float(32), 2, "input" };
+
+    Func build() {
+        Var x, y;
+
+        Func out;
+        out(x, y) = sqrt(input(x, y)) * 3.0f + input(x, y) * input(x, y);
+        out.vectorize(x, 8);
+
+        return out;
+    }
+};
+
+Halide::RegisterGenerator<Multitarget> register_my_gen{"multitarget"};
+
+}  // namespace
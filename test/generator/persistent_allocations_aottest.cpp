@@ -0,0 +1,157 @@
+#include "HalideRuntime.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "persistent_allocations.h"
+#include "persistent_allocations_ucon.h"
+#include "halide_image.h"
+
+using namespace Halide::Tools;
+
+int mallocs = 0, frees = 0;
+
+void *my_halide_malloc(void *user_context, size_t x) {
+    mallocs++;
+    void *orig = malloc(x+40);
+    void *ptr = (void *)((((size_t)orig + 32) >> 5) << 5);
+    ((void **)ptr)[-1] = orig;
+    return ptr;
+}
+
+void my_halide_free(void *user_context, void *ptr) {
+    frees++;
+    free(((void**)ptr)[-1]);
+}
+
+// Run the pipeline, check the output, and return how many mallocs
+// and frees it did. With a user_context, run the version of the
+// pipeline that takes one.
+bool run(int size, int *m, int *f, void *user_context = NULL) {
+    Image<int32_t> input(size + 1, size + 1);
+    for (int y = 0; y < size + 1; y++) {
+        for (int x = 0; x < size + 1; x++) {
+            input(x, y) = x + y * 3;
+        }
+    }
+    Image<int32_t> output(size - 1, size - 1);
+
+    mallocs = frees = 0;
+    int result = user_context ?
+        persistent_allocations_ucon(user_context, input, output) :
+        persistent_allocations(input, output);
+    *m = mallocs;
+    *f = frees;
+    if (result != 0) {
+        printf("The pipeline failed with %d\n", result);
+        return false;
+    }
+
+    for (int y = 0; y < size - 1; y++) {
+        for (int x = 0; x < size - 1; x++) {
+            int correct = 0;
+            for (int dy = 0; dy < 2; dy++) {
+                for (int dx = 0; dx < 2; dx++) {
+                    correct += input(x + dx, y + dy) * 2;
+                }
+            }
+            if (output(x, y) != correct) {
+                printf("output(%d, %d) = %d instead of %d\n", x, y, output(x, y), correct);
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+int main(int argc, char **argv) {
+    halide_set_custom_malloc(&my_halide_malloc);
+    halide_set_custom_free(&my_halide_free);
+
+    int m, f;
+
+    // Without a context attached, every call allocates and frees.
+    if (!run(100, &m, &f)) return -1;
+    if (m != 2 || f != 2) {
+        printf("Expected 2 mallocs and frees without a context. Got %d and %d\n", m, f);
+        return -1;
+    }
+
+    // This pipeline wasn't compiled with user_context, so it calls
+    // the runtime with a NULL one.
+    if (halide_persistent_allocations_attach(NULL) != 0) {
+        printf("Attaching the context failed\n");
+        return -1;
+    }
+
+    // The first call allocates, and keeps the memory.
+    if (!run(100, &m, &f)) return -1;
+    if (m != 2 || f != 0) {
+        printf("Expected 2 mallocs and no frees on the first call. Got %d and %d\n", m, f);
+        return -1;
+    }
+
+    // Calls with the same sizes reuse it.
+    for (int i = 0; i < 3; i++) {
+        if (!run(100, &m, &f)) return -1;
+        if (m != 0 || f != 0) {
+            printf("Expected no mallocs or frees with the same sizes. Got %d and %d\n", m, f);
+            return -1;
+        }
+    }
+
+    // A call with different sizes replaces it.
+    if (!run(50, &m, &f)) return -1;
+    if (m != 2 || f != 2) {
+        printf("Expected 2 mallocs and frees when the sizes change. Got %d and %d\n", m, f);
+        return -1;
+    }
+
+    // Releasing the context frees the memory, and the context itself.
+    mallocs = frees = 0;
+    halide_persistent_allocations_release(NULL);
+    if (frees != 3) {
+        printf("Expected 3 frees when releasing the context. Got %d\n", frees);
+        return -1;
+    }
+
+    // Pipelines compiled with user_context keep their allocations
+    // with the user_context they're called with.
+    int context, other_context;
+    if (halide_persistent_allocations_attach(&context) != 0) {
+        printf("Attaching the user_context failed\n");
+        return -1;
+    }
+    for (int i = 0; i < 3; i++) {
+        if (!run(100, &m, &f, &context)) return -1;
+        int expected = i == 0 ? 2 : 0;
+        if (m != expected || f != 0) {
+            printf("Expected %d mallocs and no frees on call %d with the user_context. Got %d and %d\n",
+                   expected, i, m, f);
+            return -1;
+        }
+    }
+
+    // Other user_contexts, and NULL, aren't attached any more, so
+    // they allocate and free as usual.
+    if (!run(100, &m, &f, &other_context)) return -1;
+    if (m != 2 || f != 2) {
+        printf("Expected 2 mallocs and frees with an unattached user_context. Got %d and %d\n", m, f);
+        return -1;
+    }
+    if (!run(100, &m, &f)) return -1;
+    if (m != 2 || f != 2) {
+        printf("Expected 2 mallocs and frees after releasing NULL. Got %d and %d\n", m, f);
+        return -1;
+    }
+
+    mallocs = frees = 0;
+    halide_persistent_allocations_release(&context);
+    if (frees != 3) {
+        printf("Expected 3 frees when releasing the user_context. Got %d\n", frees);
+        return -1;
+    }
+
+    printf("Success!\n");
+    return 0;
+}
@@ -0,0 +1,31 @@
+#include "Halide.h"
+
+namespace {
+
+class PersistentAllocations : public Halide::Generator<PersistentAllocations> {
+public:
+    ImageParam input{ Int(32), 2, "input" };
+
+    Func build() {
+        Var x, y;
+
+        // Two intermediates on the heap, with sizes that depend on
+        // the size of the output.
+        Func f, g;
+        f(x, y) = input(x, y) * 2;
+        g(x, y) = f(x, y) + f(x + 1, y);
+        f.compute_root();
+        g.compute_root();
+
+        Func out;
+        out(x, y) = g(x, y) + g(x, y + 1);
+
+        target.set(get_target().with_feature(Target::PersistentAllocations));
+
+        return out;
+    }
+};
+
+Halide::RegisterGenerator<PersistentAllocations> register_my_gen{"persistent_allocations"};
+
+}  // namespace
@@ -13,6 +13,7 @@
 #include "IREquality.h"
 #include "Solve.h"
 #include "Monotonic.h"
+#include "Name.h"
 
 using namespace Halide;
 using namespace Halide::Internal;
@@ -31,6 +32,7 @@ int main(int argc, const char **argv) {
     target_test();
     cplusplus_mangle_test();
     is_monotonic_test();
+    name_test();
 
     return 0;
 }
@@ -0,0 +1,72 @@
+#include "Halide.h"
+#include <stdio.h>
+#include "benchmark.h"
+
+using namespace Halide;
+
+int main(int argc, char **argv) {
+    // A blur of many thumbnails, with an intermediate that's
+    // allocated on the heap for each one.
+    const int size = 64, items = 1000;
+
+    ImageParam input(UInt(8), 2, "input");
+    Var x, y;
+    Func blur_x, blur_y;
+    blur_x(x, y) = (cast<uint16_t>(input(x, y)) + input(x + 1, y) + input(x + 2, y)) / 3;
+    blur_y(x, y) = cast<uint8_t>((blur_x(x, y) + blur_x(x, y + 1) + blur_x(x, y + 2)) / 3);
+    blur_x.compute_root().vectorize(x, 16);
+    blur_y.vectorize(x, 16);
+    blur_y.compile_jit();
+
+    std::vector<Image<uint8_t>> inputs, loop_outputs, batch_outputs;
+    std::vector<BatchItem> batch(items);
+    for (int i = 0; i < items; i++) {
+        Image<uint8_t> in(size, size);
+        for (int yy = 0; yy < size; yy++) {
+            for (int xx = 0; xx < size; xx++) {
+                in(xx, yy) = (uint8_t)(rand() & 0xff);
+            }
+        }
+        inputs.push_back(in);
+        loop_outputs.push_back(Image<uint8_t>(size - 2, size - 2));
+        batch_outputs.push_back(Image<uint8_t>(size - 2, size - 2));
+        batch[i].inputs["input"] = inputs[i];
+        batch[i].outputs = {batch_outputs[i]};
+    }
+
+    BenchmarkResult loop = benchmark([&]() {
+        for (int i = 0; i < items; i++) {
+            input.set(inputs[i]);
+            blur_y.realize(loop_outputs[i]);
+        }
+    });
+    input.set(Buffer());
+
+    BenchmarkResult batched = benchmark([&]() {
+        blur_y.realize_batch(batch);
+    });
+
+    for (int i = 0; i < items; i++) {
+        for (int yy = 0; yy < size - 2; yy++) {
+            for (int xx = 0; xx < size - 2; xx++) {
+                if (loop_outputs[i](xx, yy) != batch_outputs[i](xx, yy)) {
+                    printf("Item %d differs at (%d, %d): %d vs %d\n", i, xx, yy,
+                           loop_outputs[i](xx, yy), batch_outputs[i](xx, yy));
+                    return -1;
+                }
+            }
+        }
+    }
+
+    const double pixels = (double)items * (size - 2) * (size - 2);
+    benchmark_report("batched_realize_loop", loop, pixels, "pixels");
+    benchmark_report("batched_realize_batch", batched, pixels, "pixels");
+
+    if (batched.median > loop.median) {
+        printf("A batch was slower than a loop of realize calls\n");
+        return -1;
+    }
+
+    printf("Success!\n");
+    return 0;
+}
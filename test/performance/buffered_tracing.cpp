@@ -0,0 +1,103 @@
+#include "Halide.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <map>
+#include "benchmark.h"
+
+using namespace Halide;
+
+int main(int argc, char **argv) {
+#ifdef _WIN32
+    printf("Skipping test because it uses setenv\n");
+    return 0;
+#else
+    // The runtime reads this the first time it traces something.
+    const char *filename = "buffered_tracing.bin";
+    remove(filename);
+    setenv("HL_TRACE_FILE", filename, 1);
+    setenv("HL_TRACE_TIMESTAMPS", "1", 1);
+
+    // Many threads storing to a traced Func at once.
+    const int width = 256, height = 256;
+    Func f[2], g[2];
+    Var x, y;
+    for (int i = 0; i < 2; i++) {
+        f[i](x, y) = x + y;
+        g[i](x, y) = f[i](x, y);
+        f[i].compute_root().parallel(y);
+    }
+    f[1].trace_stores();
+
+    BenchmarkConfig config;
+    config.min_sample_time = 0;
+    config.min_samples = 3;
+    config.max_samples = 3;
+    config.min_time = 0;
+
+    Image<int> out(width, height);
+    BenchmarkResult untraced = benchmark([&]() { g[0].realize(out); }, config);
+
+    int traced_runs = 0;
+    BenchmarkResult traced = benchmark([&]() {
+        g[1].realize(out);
+        traced_runs++;
+    }, config);
+
+    benchmark_report("buffered_tracing_untraced", untraced, width * height, "pixels");
+    benchmark_report("buffered_tracing_traced", traced, width * height, "pixels");
+    printf("%f ns per traced store\n", (traced.min - untraced.min) * 1e9 / (width * height));
+
+    // The trace file should hold every store, each in one whole
+    // packet, with the packets from each thread in order.
+    FILE *file = fopen(filename, "rb");
+    if (!file) {
+        printf("Trace file was not written\n");
+        return -1;
+    }
+    std::map<uint64_t, int64_t> last_time;
+    int stores = 0;
+    uint8_t header[64];
+    while (fread(header, 1, 48, file) == 48) {
+        // With timestamps on, every packet has the flag for them in
+        // the event byte, and a longer header.
+        if (!(header[8] & 0x80) || fread(header + 48, 1, 16, file) != 16) {
+            printf("Packet without a time and thread\n");
+            return -1;
+        }
+        int event = header[8] & 0x7f;
+        int bits = header[10], lanes = header[11], dims = header[13];
+        int bytes = 1;
+        while (bytes * 8 < bits) bytes <<= 1;
+        uint8_t payload[4096];
+        size_t payload_bytes = lanes * bytes + dims * sizeof(int32_t);
+        if (fread(payload, 1, payload_bytes, file) != payload_bytes) {
+            printf("Truncated packet\n");
+            return -1;
+        }
+        int64_t time;
+        uint64_t thread;
+        memcpy(&time, header + 48, sizeof(time));
+        memcpy(&thread, header + 56, sizeof(thread));
+        if (time < last_time[thread]) {
+            printf("Packets from thread %llu are out of order\n", (unsigned long long)thread);
+            return -1;
+        }
+        last_time[thread] = time;
+        if (event == halide_trace_store) {
+            stores += lanes;
+        }
+    }
+    fclose(file);
+
+    // Every traced realization, including the warm-up, stored every
+    // pixel.
+    if (stores != traced_runs * width * height) {
+        printf("Trace file has %d stores instead of %d\n", stores, traced_runs * width * height);
+        return -1;
+    }
+
+    printf("Success!\n");
+    return 0;
+#endif
+}
@@ -0,0 +1,59 @@
+#include "Halide.h"
+
+#include <cstdio>
+#include "benchmark.h"
+
+using namespace Halide;
+
+// Measures the fixed cost of compiling a trivial pipeline, which is
+// dominated by assembling the runtime modules rather than by
+// anything the pipeline itself does.
+int main(int argc, char **argv) {
+    Var x;
+    Target target = get_target_from_environment();
+
+    // The first AOT compile for a target assembles its runtime from
+    // scratch, so it must be the only run of its benchmark. Later
+    // ones reuse the assembled module.
+    BenchmarkConfig first;
+    first.warmup = 0;
+    first.min_sample_time = 0;
+    first.min_samples = 1;
+    first.max_samples = 1;
+    BenchmarkResult first_aot = benchmark([&]() {
+        Func f;
+        f(x) = x;
+        f.compile_to_object("compile_latency.o", {}, "compile_latency", target);
+    }, first);
+
+    BenchmarkConfig config;
+    config.min_sample_time = 0;
+    config.min_samples = 10;
+    config.max_samples = 30;
+    config.min_time = 0.5;
+    BenchmarkResult aot = benchmark([&]() {
+        Func f;
+        f(x) = x;
+        f.compile_to_object("compile_latency.o", {}, "compile_latency", target);
+    }, config);
+
+    Image<int> out(1);
+    bool correct = true;
+    BenchmarkResult jit = benchmark([&]() {
+        Func f;
+        f(x) = x + 17;
+        f.realize(out);
+        correct = correct && out(0) == 17;
+    }, config);
+    if (!correct) {
+        printf("out(0) = %d instead of 17\n", out(0));
+        return -1;
+    }
+
+    benchmark_report("compile_latency_first_aot", first_aot, 1, "compiles");
+    benchmark_report("compile_latency_aot", aot, 1, "compiles");
+    benchmark_report("compile_latency_jit", jit, 1, "compiles");
+
+    printf("Success!\n");
+    return 0;
+}
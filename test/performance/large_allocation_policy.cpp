@@ -0,0 +1,190 @@
+#include "Halide.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <stdint.h>
+#include <vector>
+#include "benchmark.h"
+
+using namespace Halide;
+
+#ifdef __linux__
+
+// A mapping from /proc/self/smaps, and whether it was advised to use
+// transparent huge pages (the "hg" flag).
+struct Mapping {
+    uintptr_t begin, end;
+    bool huge_pages_advised;
+    long anon_huge_pages_kb;
+};
+
+std::vector<Mapping> read_mappings() {
+    std::vector<Mapping> mappings;
+    FILE *f = fopen("/proc/self/smaps", "r");
+    if (!f) return mappings;
+    char line[1024];
+    while (fgets(line, sizeof(line), f)) {
+        unsigned long begin, end;
+        long kb;
+        if (sscanf(line, "%lx-%lx ", &begin, &end) == 2) {
+            Mapping m = {(uintptr_t)begin, (uintptr_t)end, false, 0};
+            mappings.push_back(m);
+        } else if (mappings.empty()) {
+            continue;
+        } else if (sscanf(line, "AnonHugePages: %ld kB", &kb) == 1) {
+            mappings.back().anon_huge_pages_kb = kb;
+        } else if (strncmp(line, "VmFlags:", 8) == 0) {
+            mappings.back().huge_pages_advised = strstr(line, " hg") != nullptr;
+        }
+    }
+    fclose(f);
+    return mappings;
+}
+
+// The number of bytes of the address range [begin, end) covered by
+// mappings advised to use huge pages. The kernel merges adjacent
+// mappings with the same flags, so this counts coverage rather than
+// mappings.
+size_t huge_page_bytes(uintptr_t begin = 0, uintptr_t end = UINTPTR_MAX) {
+    size_t bytes = 0;
+    for (const Mapping &m : read_mappings()) {
+        uintptr_t b = std::max(begin, m.begin), e = std::min(end, m.end);
+        if (m.huge_pages_advised && b < e) {
+            bytes += e - b;
+        }
+    }
+    return bytes;
+}
+
+// The bytes advised to use huge pages while the pipeline below was
+// consuming f, i.e. while f was allocated.
+size_t huge_page_bytes_during_consume = 0;
+
+int measure_during_consume(void *user_context, const halide_trace_event *e) {
+    if (e->event == halide_trace_consume && strcmp(e->func, "f") == 0) {
+        huge_page_bytes_during_consume = huge_page_bytes();
+    }
+    return 0;
+}
+
+#endif
+
+int main(int argc, char **argv) {
+#ifndef __linux__
+    printf("Skipping test because the allocation policy is only used on linux\n");
+    return 0;
+#else
+    const int W = 4096, H = 4096;
+    const size_t size = W * H * sizeof(int);
+
+    // A compute_root stage much larger than the threshold below,
+    // written and then read in parallel.
+    Var x, y;
+    Func f("f"), g;
+    f(x, y) = x + y;
+    g(x, y) = f(x, y) + f(W - 1 - x, y);
+    f.compute_root().parallel(y).vectorize(x, 8);
+    g.parallel(y).vectorize(x, 8);
+    g.compile_jit();
+
+    // The same pipeline, traced so that we can see what f was
+    // allocated with.
+    Func f_traced("f"), g_traced;
+    f_traced(x, y) = x + y;
+    g_traced(x, y) = f_traced(x, y) + f_traced(W - 1 - x, y);
+    f_traced.compute_root().parallel(y).vectorize(x, 8).trace_realizations();
+    g_traced.parallel(y).vectorize(x, 8);
+    g_traced.set_custom_trace(measure_during_consume);
+    g_traced.compile_jit();
+
+    BenchmarkConfig config;
+    config.min_samples = 3;
+    config.max_samples = 20;
+    config.min_time = 1;
+
+    Image<int> out(W, H);
+    BenchmarkResult default_result = benchmark([&]() { g.realize(out); }, config);
+    benchmark_report("large_allocation_policy_default", default_result, W * H, "pixels");
+
+    // Transparent huge pages may be compiled out of the kernel, in
+    // which case madvise fails and nothing is marked.
+    FILE *thp = fopen("/sys/kernel/mm/transparent_hugepage/enabled", "r");
+    const bool have_thp = thp != nullptr;
+    if (thp) fclose(thp);
+
+    // f isn't marked before the policy is set, so freeing it doesn't
+    // uncover a buffer's worth of huge pages.
+    g_traced.realize(out);
+    if (huge_page_bytes_during_consume >= huge_page_bytes() + size) {
+        printf("f was advised to use huge pages before the policy was set\n");
+        return -1;
+    }
+
+    halide_allocation_policy_t policy = {0};
+    policy.large_allocation_size = 1 << 20;
+    policy.transparent_huge_pages = true;
+    set_allocation_policy(policy);
+
+    // Buffers over the threshold are now mapped from the OS, and
+    // zeroed.
+    Image<int> big(W, H);
+    for (int y = 0; y < H; y++) {
+        for (int x = 0; x < W; x++) {
+            if (big(x, y) != 0) {
+                printf("big(%d, %d) = %d instead of zero\n", x, y, big(x, y));
+                return -1;
+            }
+        }
+    }
+
+    if (have_thp) {
+        // The whole image is advised to use huge pages.
+        uintptr_t host = (uintptr_t)big.data();
+        if (huge_page_bytes(host, host + size) != size) {
+            printf("The image was not mapped with huge pages\n");
+            return -1;
+        }
+
+        // And so was f, which the JIT runtime allocates, so there
+        // was at least a buffer's worth more while it was allocated.
+        g_traced.realize(big);
+        if (huge_page_bytes_during_consume < huge_page_bytes() + size) {
+            printf("f was not mapped with huge pages\n");
+            return -1;
+        }
+    } else {
+        printf("Not checking the mappings because transparent huge pages are not supported\n");
+    }
+
+    BenchmarkResult policy_result = benchmark([&]() { g.realize(big); }, config);
+    benchmark_report("large_allocation_policy_huge_pages", policy_result, W * H, "pixels");
+
+    if (have_thp) {
+        long kb = 0;
+        uintptr_t host = (uintptr_t)big.data();
+        for (const Mapping &m : read_mappings()) {
+            if (m.begin <= host && host < m.end) {
+                kb = m.anon_huge_pages_kb;
+            }
+        }
+        printf("The image is backed by %ld kB of huge pages\n", kb);
+    }
+
+    for (int y = 0; y < H; y++) {
+        for (int x = 0; x < W; x++) {
+            int correct = W - 1 + 2 * y;
+            if (big(x, y) != correct || out(x, y) != correct) {
+                printf("out(%d, %d) = %d, %d instead of %d\n",
+                       x, y, out(x, y), big(x, y), correct);
+                return -1;
+            }
+        }
+    }
+
+    halide_allocation_policy_t defaults = {0};
+    set_allocation_policy(defaults);
+
+    printf("Success!\n");
+    return 0;
+#endif
+}
@@ -0,0 +1,60 @@
+#include "Halide.h"
+#include <cstdio>
+#include <thread>
+#include <vector>
+#include "benchmark.h"
+
+using namespace Halide;
+
+// Lower a chain of stencils with some splits and inlining, which
+// makes lowering consult its symbol tables a lot. A fresh pipeline is
+// built every time, so nothing is reused from a previous lowering.
+void lower_pipeline(int stages) {
+    ImageParam input(Float(32), 2);
+    Var x("x"), y("y"), xi("xi"), yi("yi");
+    std::vector<Func> fs;
+    Func prev = BoundaryConditions::repeat_edge(input);
+    for (int i = 0; i < stages; i++) {
+        Func f("stage_" + std::to_string(i));
+        f(x, y) = (prev(x - 1, y) + prev(x, y) + prev(x + 1, y) +
+                   prev(x, y - 1) + prev(x, y + 1)) * 0.2f;
+        if (i % 3 == 0) {
+            f.compute_root().tile(x, y, xi, yi, 32, 8).vectorize(xi, 8).parallel(y);
+        }
+        fs.push_back(f);
+        prev = f;
+    }
+    prev.compile_to_module({input}, "lowering_time");
+}
+
+int main(int argc, char **argv) {
+    const int stages = 24;
+    BenchmarkConfig config;
+    config.min_samples = 3;
+    config.max_samples = 20;
+    config.min_time = 1;
+
+    BenchmarkResult one = benchmark([&]() {
+        lower_pipeline(stages);
+    }, config);
+    benchmark_report("lowering_time", one, stages, "stages");
+
+    // Several pipelines lowering at once, as when llvm modules are
+    // optimized in parallel or a generator host compiles several
+    // targets. Shared state like the name table shouldn't serialize
+    // them.
+    const int threads = 4;
+    BenchmarkResult many = benchmark([&]() {
+        std::vector<std::thread> ts;
+        for (int i = 0; i < threads; i++) {
+            ts.emplace_back(lower_pipeline, stages);
+        }
+        for (std::thread &t : ts) {
+            t.join();
+        }
+    }, config);
+    benchmark_report("lowering_time_4_threads", many, stages * threads, "stages");
+
+    printf("Success!\n");
+    return 0;
+}
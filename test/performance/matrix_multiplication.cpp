@@ -48,8 +48,6 @@ int main(int argc, char **argv) {
 
     matrix_mul.compile_jit();
 
-    const int iterations = 50;
-
     Image<float> mat_A(matrix_size, matrix_size);
     Image<float> mat_B(matrix_size, matrix_size);
     Image<float> output(matrix_size, matrix_size);
@@ -65,9 +63,7 @@ int main(int argc, char **argv) {
     A.set(mat_A);
     B.set(mat_B);
 
-    matrix_mul.realize(output);
-
-    double t = benchmark(1, iterations, [&]() {
+    BenchmarkResult t = benchmark([&]() {
         matrix_mul.realize(output);
     });
 
@@ -101,9 +97,8 @@ int main(int argc, char **argv) {
     }
     */
 
-    float gflops = 2.0f * matrix_size * matrix_size * matrix_size / 1e6;
-
-    printf("Halide: %fms, %f GFLOP/s\n\n", t * 1e3, (gflops / t));
+    double flops = 2.0 * matrix_size * matrix_size * matrix_size;
+    benchmark_report("matrix_multiplication", t, flops, "flop");
 
     printf("Success!\n");
     return 0;
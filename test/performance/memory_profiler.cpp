@@ -16,24 +16,24 @@ void reset_stats() {
 }
 
 void my_print(void *, const char *msg) {
-    float this_ms;
+    float this_ms, this_cpu_ms, this_threads;
     int idx, this_percentage, this_heap_peak;
     int this_num_mallocs, this_malloc_avg, this_stack_peak;
     int val;
 
     printf("%s\n", msg);
-    val = sscanf(msg, " g_%d: %fms (%d%%) peak: %d num: %d avg: %d",
-        &idx, &this_ms, &this_percentage, &this_heap_peak,
-        &this_num_mallocs, &this_malloc_avg);
-    if (val == 6) {
+    val = sscanf(msg, " g_%d: %fms (%d%%) cpu: %fms threads: %f peak: %d num: %d avg: %d",
+        &idx, &this_ms, &this_percentage, &this_cpu_ms, &this_threads,
+        &this_heap_peak, &this_num_mallocs, &this_malloc_avg);
+    if (val == 8) {
         heap_peak = this_heap_peak;
         num_mallocs = this_num_mallocs;
         malloc_avg = this_malloc_avg;
     }
 
-    val = sscanf(msg, " g_%d: %fms (%d%%) stack: %d",
-        &idx, &this_ms, &this_percentage, &this_stack_peak);
-    if (val == 4) {
+    val = sscanf(msg, " g_%d: %fms (%d%%) cpu: %fms threads: %f stack: %d",
+        &idx, &this_ms, &this_percentage, &this_cpu_ms, &this_threads, &this_stack_peak);
+    if (val == 6) {
         stack_peak = this_stack_peak;
     }
 }
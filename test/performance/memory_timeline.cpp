@@ -0,0 +1,100 @@
+#include "Halide.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+using namespace Halide;
+
+char live_at_peak[1024];
+
+void my_print(void *, const char *msg) {
+    printf("%s", msg);
+    const char *live = strstr(msg, "live at peak:");
+    if (live) {
+        strncpy(live_at_peak, live, sizeof(live_at_peak) - 1);
+    }
+}
+
+int main(int argc, char **argv) {
+#ifdef _WIN32
+    printf("Skipping test because it uses setenv\n");
+    return 0;
+#else
+    // The profiler reads this the first time something is allocated.
+    const char *filename = "memory_timeline.csv";
+    remove(filename);
+    setenv("HL_MEMORY_TIMELINE", filename, 1);
+
+    // f1 is still live while f2 is computed, but f3 can reuse the
+    // space f1 was using.
+    Func f1("f1"), f2("f2"), f3("f3"), out("out");
+    Var x, y;
+    f1(x, y) = x + y;
+    f2(x, y) = f1(x, y) + 1;
+    f3(x, y) = f2(x, y) * 2;
+    out(x, y) = f3(x, y);
+    f1.compute_root();
+    f2.compute_root();
+    f3.compute_root();
+
+    out.set_custom_print(&my_print);
+    Target t = get_jit_target_from_environment().with_feature(Target::Profile);
+    out.realize(1000, 1000, t);
+
+    const int bytes = 1000 * 1000 * 4;
+    char expected[1024];
+    snprintf(expected, sizeof(expected), "live at peak: f1 (%d bytes) f2 (%d bytes)", bytes, bytes);
+    if (strncmp(live_at_peak, expected, strlen(expected)) != 0) {
+        printf("The live buffers at the peak were \"%s\" instead of \"%s\"\n", live_at_peak, expected);
+        return -1;
+    }
+
+    // The timeline should have each allocation and free, in an
+    // order consistent with the peak.
+    FILE *file = fopen(filename, "r");
+    if (!file) {
+        printf("The allocation timeline was not written\n");
+        return -1;
+    }
+    char line[1024];
+    if (!fgets(line, sizeof(line), file) ||
+        strcmp(line, "time_ns,pipeline,func,bytes,pipeline_bytes\n") != 0) {
+        printf("Bad header in the allocation timeline\n");
+        return -1;
+    }
+    int events = 0, live = 0, peak = 0;
+    long long last_time = 0;
+    while (fgets(line, sizeof(line), file)) {
+        long long time;
+        char pipeline[256], func[256];
+        int b, pipeline_bytes;
+        if (sscanf(line, "%lld,%255[^,],%255[^,],%d,%d", &time, pipeline, func, &b, &pipeline_bytes) != 5) {
+            printf("Bad line in the allocation timeline: %s", line);
+            return -1;
+        }
+        if (time < last_time) {
+            printf("The allocation timeline is out of order\n");
+            return -1;
+        }
+        last_time = time;
+        live += b;
+        if (live != pipeline_bytes) {
+            printf("Live bytes were %d instead of %d\n", pipeline_bytes, live);
+            return -1;
+        }
+        if (live > peak) peak = live;
+        events++;
+    }
+    fclose(file);
+
+    if (events != 6 || live != 0 || peak != 2 * bytes) {
+        printf("Expected 6 events returning to zero with a peak of %d bytes. "
+               "Got %d events, %d bytes at the end, and a peak of %d bytes\n",
+               2 * bytes, events, live, peak);
+        return -1;
+    }
+
+    printf("Success!\n");
+    return 0;
+#endif
+}
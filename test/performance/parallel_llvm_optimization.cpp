@@ -0,0 +1,102 @@
+#include "Halide.h"
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include "benchmark.h"
+
+using namespace Halide;
+
+void set_llvm_threads(int t) {
+    static char buf[32];
+    snprintf(buf, sizeof(buf), "HL_LLVM_THREADS=%d", t);
+    putenv(buf);
+}
+
+std::string read_file(const char *filename) {
+    std::ifstream file(filename);
+    std::stringstream contents;
+    contents << file.rdbuf();
+    return contents.str();
+}
+
+// A pipeline with many stages, each with its own parallel loop
+// closure, so that the llvm module has plenty of functions to spread
+// across threads.
+Func make_pipeline() {
+    Var x("x"), y("y");
+    std::vector<Func> stages;
+    for (int i = 0; i < 24; i++) {
+        stages.push_back(Func("stage_" + std::to_string(i)));
+    }
+    stages[0](x, y) = cast<float>(x + y);
+    for (int i = 1; i < 24; i++) {
+        Func prev = stages[i - 1];
+        stages[i](x, y) = (prev(x - 1, y) + prev(x + 1, y) + prev(x, y - 1) + prev(x, y + 1)) * 0.25f + i;
+        stages[i - 1].compute_root().parallel(y).vectorize(x, 8);
+    }
+    return stages[23];
+}
+
+int main(int argc, char **argv) {
+    Target target = get_target_from_environment();
+
+    BenchmarkConfig config;
+    config.warmup = 0;
+    config.min_sample_time = 0;
+    config.min_samples = 1;
+    config.max_samples = 1;
+    config.min_time = 0;
+
+    // Bitcode is written straight after the llvm optimizations, so
+    // comparing it with the time to produce assembly separates the
+    // optimizations, which are split across threads, from machine code
+    // generation, which is not.
+    for (int t : {1, 8}) {
+        set_llvm_threads(t);
+        Func f = make_pipeline();
+        std::string suffix = "_" + std::to_string(t) + "_threads";
+        BenchmarkResult optimize = benchmark([&]() {
+            f.compile_to_bitcode("parallel_llvm_optimization" + suffix + ".bc", {}, "parallel_llvm_optimization", target);
+        }, config);
+        BenchmarkResult total = benchmark([&]() {
+            f.compile_to_assembly("parallel_llvm_optimization" + suffix + ".s", {}, "parallel_llvm_optimization", target);
+        }, config);
+        benchmark_report("parallel_llvm_optimization_ir" + suffix, optimize, 1, "compiles");
+        benchmark_report("parallel_llvm_optimization_total" + suffix, total, 1, "compiles");
+        printf("%g ms of machine code generation on %d threads\n",
+               (total.min - optimize.min) * 1e3, t);
+    }
+
+    // The split doesn't depend on the number of threads, so any
+    // thread count should produce the same code.
+    if (read_file("parallel_llvm_optimization_1_threads.s") != read_file("parallel_llvm_optimization_8_threads.s")) {
+        printf("Output depends on the number of threads used to optimize it\n");
+        return -1;
+    }
+    Func f = make_pipeline();
+    set_llvm_threads(3);
+    f.compile_to_assembly("parallel_llvm_optimization_3_threads.s", {}, "parallel_llvm_optimization", target);
+    if (read_file("parallel_llvm_optimization_3_threads.s") != read_file("parallel_llvm_optimization_8_threads.s")) {
+        printf("Output depends on the number of threads used to optimize it\n");
+        return -1;
+    }
+
+    // The code optimized in pieces should compute the same thing as
+    // the code optimized as a whole.
+    set_llvm_threads(0);
+    Image<float> correct = make_pipeline().realize(256, 256);
+    set_llvm_threads(8);
+    Image<float> result = make_pipeline().realize(256, 256);
+    for (int y = 0; y < 256; y++) {
+        for (int x = 0; x < 256; x++) {
+            if (result(x, y) != correct(x, y)) {
+                printf("result(%d, %d) = %f instead of %f\n", x, y, result(x, y), correct(x, y));
+                return -1;
+            }
+        }
+    }
+
+    printf("Success!\n");
+    return 0;
+}
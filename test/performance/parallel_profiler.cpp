@@ -0,0 +1,76 @@
+#include "Halide.h"
+#include <stdio.h>
+#include <thread>
+
+using namespace Halide;
+
+float serial_ms = 0, parallel_ms = 0;
+float serial_threads = 0, parallel_threads = 0;
+void my_print(void *, const char *msg) {
+    float this_ms, this_cpu_ms, this_threads;
+    int this_percentage;
+    char name[32];
+    int val = sscanf(msg, " %31[^:]: %fms (%d%%) cpu: %fms threads: %f",
+                     name, &this_ms, &this_percentage, &this_cpu_ms, &this_threads);
+    if (val == 5) {
+        if (std::string(name) == "serial") {
+            serial_ms = this_ms;
+            serial_threads = this_threads;
+        } else if (std::string(name) == "parallel") {
+            parallel_ms = this_ms;
+            parallel_threads = this_threads;
+        }
+    }
+}
+
+int main(int argc, char **argv) {
+    int cores = std::thread::hardware_concurrency();
+    if (cores < 4) {
+        printf("Skipping test because it needs at least four cores\n");
+        return 0;
+    }
+
+    // Two stages doing the same amount of work, one of them on many
+    // threads at once.
+    Func serial("serial"), parallel("parallel"), out("out");
+    Var x, y;
+
+    Expr e = cast<float>(x + y);
+    for (int i = 0; i < 100; i++) {
+        e = sin(e);
+    }
+    serial(x, y) = e;
+    parallel(x, y) = e;
+    out(x, y) = serial(x, y) + parallel(x, y);
+
+    serial.compute_root();
+    parallel.compute_root().parallel(y);
+
+    out.set_custom_print(&my_print);
+    Target t = get_jit_target_from_environment().with_feature(Target::Profile);
+    out.realize(1000, 1000, t);
+
+    printf("serial: %fms on %f threads\n", serial_ms, serial_threads);
+    printf("parallel: %fms on %f threads\n", parallel_ms, parallel_threads);
+
+    // The serial stage should be billed to one thread at a time, and
+    // the parallel one to several.
+    if (serial_threads < 0.9f || serial_threads > 1.1f) {
+        printf("The serial stage should have run on one thread\n");
+        return -1;
+    }
+
+    if (parallel_threads < 2.0f) {
+        printf("The parallel stage should have run on several threads\n");
+        return -1;
+    }
+
+    // It should also have taken less wall-clock time.
+    if (parallel_ms > serial_ms) {
+        printf("The parallel stage should have been faster\n");
+        return -1;
+    }
+
+    printf("Success!\n");
+    return 0;
+}
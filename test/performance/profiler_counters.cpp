@@ -0,0 +1,79 @@
+#include "Halide.h"
+#include <stdio.h>
+#include <string.h>
+
+using namespace Halide;
+
+struct Counts {
+    float ipc = 0, bytes_per_cycle = 0;
+    bool found = false;
+};
+Counts compute_counts, memory_counts;
+
+void my_print(void *, const char *msg) {
+    char name[32];
+    if (sscanf(msg, " %31[^:]:", name) != 1) return;
+    const char *counts = strstr(msg, "cycles:");
+    if (!counts) return;
+    unsigned long long cycles, instructions, cache_misses;
+    Counts c;
+    if (sscanf(counts, "cycles: %llu instructions: %llu ipc: %f cache misses: %llu bytes/cycle: %f",
+               &cycles, &instructions, &c.ipc, &cache_misses, &c.bytes_per_cycle) == 5) {
+        c.found = true;
+        if (std::string(name) == "compute") {
+            compute_counts = c;
+        } else if (std::string(name) == "memory") {
+            memory_counts = c;
+        }
+    }
+}
+
+int main(int argc, char **argv) {
+    Target t = get_jit_target_from_environment();
+    if (t.os != Target::Linux || t.arch != Target::X86 || t.bits != 64) {
+        printf("Skipping test because hardware counters are only supported on x86-64 Linux\n");
+        return 0;
+    }
+    t.set_feature(Target::ProfileCounters);
+
+    // One stage that does lots of arithmetic on few values, and one
+    // that touches lots of memory to do very little arithmetic.
+    const int size = 1 << 24;
+    Image<float> input(size);
+    for (int i = 0; i < size; i++) {
+        input(i) = (float)i;
+    }
+
+    Func compute("compute"), memory("memory"), out("out");
+    Var x;
+    Expr e = cast<float>(x);
+    for (int i = 0; i < 50; i++) {
+        e = e * e + 0.5f;
+    }
+    compute(x) = e;
+    // Large prime stride, so that almost every load misses in cache.
+    memory(x) = input((x * 7919) % size);
+    out(x) = compute(x % 1024) + memory(x);
+
+    compute.compute_root();
+    memory.compute_root();
+
+    out.set_custom_print(&my_print);
+    out.realize(size, t);
+
+    if (!compute_counts.found && !memory_counts.found) {
+        printf("Skipping test because hardware counters are not available\n");
+        return 0;
+    }
+
+    printf("compute: ipc %f, bytes/cycle %f\n", compute_counts.ipc, compute_counts.bytes_per_cycle);
+    printf("memory: ipc %f, bytes/cycle %f\n", memory_counts.ipc, memory_counts.bytes_per_cycle);
+
+    if (memory_counts.bytes_per_cycle <= compute_counts.bytes_per_cycle) {
+        printf("The memory-bound stage should have moved more bytes per cycle\n");
+        return -1;
+    }
+
+    printf("Success!\n");
+    return 0;
+}
@@ -0,0 +1,89 @@
+#include "Halide.h"
+#include <stdio.h>
+#include <string.h>
+
+using namespace Halide;
+
+struct Roofline {
+    unsigned long long bytes = 0, ops = 0;
+    float intensity = 0, gbps = 0, gops = 0;
+    bool found = false;
+};
+Roofline compute_roofline, memory_roofline;
+
+void my_print(void *, const char *msg) {
+    char name[32];
+    if (sscanf(msg, " %31[^:]:", name) != 1) return;
+    const char *counts = strstr(msg, "bytes:");
+    if (!counts) return;
+    Roofline r;
+    if (sscanf(counts, "bytes: %llu ops: %llu ops/byte: %f GB/s: %f GOPS: %f",
+               &r.bytes, &r.ops, &r.intensity, &r.gbps, &r.gops) == 5) {
+        r.found = true;
+        if (std::string(name) == "compute") {
+            compute_roofline = r;
+        } else if (std::string(name) == "memory") {
+            memory_roofline = r;
+        }
+    }
+}
+
+int main(int argc, char **argv) {
+    // One stage that does lots of arithmetic per value it loads and
+    // stores, and one that just copies memory around.
+    const int size = 1 << 24;
+    Image<float> input(size);
+    for (int i = 0; i < size; i++) {
+        input(i) = (float)i;
+    }
+
+    Func compute("compute"), memory("memory"), out("out");
+    Var x;
+    Expr e = input(x);
+    for (int i = 0; i < 50; i++) {
+        e = e * e + 0.5f;
+    }
+    compute(x) = e;
+    memory(x) = input(x);
+    out(x) = compute(x) + memory(x);
+
+    compute.compute_root().vectorize(x, 8);
+    memory.compute_root().vectorize(x, 8);
+
+    out.set_custom_print(&my_print);
+    Target t = get_jit_target_from_environment().with_feature(Target::ProfileRoofline);
+    out.realize(size, t);
+
+    if (!compute_roofline.found || !memory_roofline.found) {
+        printf("The profiler report didn't include the bytes and ops of each stage\n");
+        return -1;
+    }
+
+    printf("compute: %f ops/byte, %f GB/s, %f GOPS\n",
+           compute_roofline.intensity, compute_roofline.gbps, compute_roofline.gops);
+    printf("memory: %f ops/byte, %f GB/s, %f GOPS\n",
+           memory_roofline.intensity, memory_roofline.gbps, memory_roofline.gops);
+
+    // Each element of both stages loads and stores four bytes. The
+    // compute-bound stage also does a multiply and an add per
+    // iteration above, and the index arithmetic doesn't count.
+    if (compute_roofline.bytes != 8ULL * size || compute_roofline.ops != 100ULL * size) {
+        printf("compute counted %llu bytes and %llu ops instead of %llu and %llu\n",
+               compute_roofline.bytes, compute_roofline.ops, 8ULL * size, 100ULL * size);
+        return -1;
+    }
+
+    if (memory_roofline.bytes != 8ULL * size || memory_roofline.ops != 0) {
+        printf("memory counted %llu bytes and %llu ops instead of %llu and 0\n",
+               memory_roofline.bytes, memory_roofline.ops, 8ULL * size);
+        return -1;
+    }
+
+    if (memory_roofline.gbps <= compute_roofline.gbps) {
+        printf("The memory-bound stage should move more bytes per second\n");
+        return -1;
+    }
+
+    printf("Success!\n");
+    return 0;
+}
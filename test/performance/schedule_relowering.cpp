@@ -0,0 +1,78 @@
+#include "Halide.h"
+#include <cstdio>
+#include "benchmark.h"
+
+using namespace Halide;
+
+// A chain of stages with wide stencils, most of which are inlined, so
+// that the schedule-independent parts of lowering (value bounds and
+// the inlined definitions) are a large part of the lowering time.
+Func make_pipeline(std::vector<Func> &stages) {
+    Var x("x"), y("y");
+    for (int i = 0; i < 16; i++) {
+        stages.push_back(Func("stage_" + std::to_string(i)));
+    }
+    stages[0](x, y) = cast<float>(x * y) / 16.0f;
+    for (int i = 1; i < 16; i++) {
+        Func prev = stages[i - 1];
+        stages[i](x, y) = max(prev(x - 1, y), prev(x + 1, y)) * 0.5f + min(prev(x, y - 1), prev(x, y + 1)) * 0.5f;
+    }
+    for (int i = 3; i < 16; i += 4) {
+        stages[i].compute_root();
+    }
+    return stages[15];
+}
+
+int main(int argc, char **argv) {
+    Target target = get_target_from_environment();
+
+    std::vector<Func> stages;
+    Func out = make_pipeline(stages);
+    Pipeline p(out);
+
+    BenchmarkConfig config;
+    config.min_samples = 10;
+    config.max_samples = 10;
+    config.min_time = 0;
+
+    // A schedule search changes the schedule and lowers again. The
+    // pipeline holds on to its analyses of the definitions, but the
+    // loop nest is still built again from the schedule, so this only
+    // saves the part of lowering spent on those analyses.
+    int iteration = 0;
+    BenchmarkResult cached = benchmark([&]() {
+        Var y("y");
+        Func f = stages[(iteration % 3) * 4 + 3];
+        if ((iteration++ / 3) % 2) {
+            f.serial(y);
+        } else {
+            f.parallel(y);
+        }
+        p.invalidate_cache();
+        p.compile_to_module(p.infer_arguments(), "schedule_relowering", target);
+    }, config);
+
+    // A fresh pipeline has to redo the analyses too.
+    BenchmarkResult uncached = benchmark([&]() {
+        Pipeline fresh(out);
+        fresh.compile_to_module(fresh.infer_arguments(), "schedule_relowering", target);
+    }, config);
+
+    benchmark_report("schedule_relowering_with_cached_analyses", cached, 1, "lowerings");
+    benchmark_report("schedule_relowering_from_scratch", uncached, 1, "lowerings");
+
+    // The cached results must not change what gets computed.
+    Image<float> correct = p.realize(64, 64);
+    Image<float> result = Pipeline(out).realize(64, 64);
+    for (int y = 0; y < 64; y++) {
+        for (int x = 0; x < 64; x++) {
+            if (result(x, y) != correct(x, y)) {
+                printf("result(%d, %d) = %f instead of %f\n", x, y, result(x, y), correct(x, y));
+                return -1;
+            }
+        }
+    }
+
+    printf("Success!\n");
+    return 0;
+}
@@ -52,10 +52,10 @@ bool test(int vec_width) {
     Image<A> outputg = g.realize(W, H);
     Image<A> outputf = f.realize(W, H);
 
-    double t_g = benchmark(1, 10, [&]() {
+    BenchmarkResult t_g = benchmark([&]() {
         g.realize(outputg);
     });
-    double t_f = benchmark(1, 10, [&]() {
+    BenchmarkResult t_f = benchmark([&]() {
         f.realize(outputf);
     });
 
@@ -73,10 +73,13 @@ bool test(int vec_width) {
         }
     }
 
-    printf("Vectorized vs scalar (%s x %d): %1.3gms %1.3gms. Speedup = %1.3f\n",
-           string_of_type<A>(), vec_width, t_f * 1e3, t_g * 1e3, t_g / t_f);
+    std::string name = std::string("vectorize_") + string_of_type<A>() + "x" + std::to_string(vec_width);
+    benchmark_report(name, t_f, W * H, "pixels");
+    benchmark_report(name + "_scalar", t_g, W * H, "pixels");
+    printf("Vectorized vs scalar (%s x %d): Speedup = %1.3f\n",
+           string_of_type<A>(), vec_width, t_g.median / t_f.median);
 
-    if (t_f > t_g) {
+    if (t_f.median > t_g.median) {
         return false;
     }
 
@@ -20,10 +20,14 @@ namespace Tools {
 template<typename T>
 class Image {
     struct Contents {
-        Contents(const buffer_t &b, uint8_t *a) : buf(b), ref_count(1), alloc(a) {}
+        Contents(const buffer_t &b, uint8_t *a, bool from_halide_malloc = false) :
+            buf(b), ref_count(1), alloc(a), halide_allocated(from_halide_malloc) {}
         buffer_t buf;
         int ref_count;
         uint8_t *alloc;
+        // Large images are allocated with halide_malloc, so that they
+        // follow the runtime's allocation policy.
+        bool halide_allocated;
 
         void dev_free() {
             halide_device_free(NULL, &buf);
@@ -33,7 +37,11 @@ class Image {
             if (buf.dev) {
                 dev_free();
             }
-            delete[] alloc;
+            if (halide_allocated) {
+                halide_free(NULL, alloc);
+            } else {
+                delete[] alloc;
+            }
         }
     };
 
@@ -68,12 +76,24 @@ class Image {
         // alignment for all the platforms we might use.
         const size_t alignment = 128;
         size = (size + alignment - 1) & ~(alignment - 1);
-        uint8_t *ptr = new uint8_t[sizeof(T)*size + alignment - 1];
-        buf.host = (uint8_t *)((uintptr_t)(ptr + alignment - 1) & ~(alignment - 1));
+
+        halide_allocation_policy_t policy;
+        halide_get_allocation_policy(&policy);
+        bool large = (policy.large_allocation_size &&
+                      sizeof(T)*size >= policy.large_allocation_size);
+        uint8_t *ptr;
+        if (large) {
+            // halide_malloc aligns to at least 128 bytes already.
+            ptr = (uint8_t *)halide_malloc(NULL, sizeof(T)*size);
+            buf.host = ptr;
+        } else {
+            ptr = new uint8_t[sizeof(T)*size + alignment - 1];
+            buf.host = (uint8_t *)((uintptr_t)(ptr + alignment - 1) & ~(alignment - 1));
+        }
         buf.host_dirty = false;
         buf.dev_dirty = false;
         buf.dev = 0;
-        contents = new Contents(buf, ptr);
+        contents = new Contents(buf, ptr, large);
     }
 
 public:
@@ -86,6 +106,12 @@ public:
         initialize(x, y, z, w, interleaved);
     }
 
+    // Wrap an existing buffer_t, e.g. one mapped from a file. The
+    // image does not own the memory, which must outlive it.
+    Image(const buffer_t *b) {
+        contents = new Contents(*b, NULL);
+    }
+
     Image(const Image &other) : contents(other.contents) {
         if (contents) {
             contents->ref_count++;
@@ -1,5 +1,6 @@
 // This simple PNG IO library works with *both* the Halide::Image<T> type *and*
-// the simple halide_image.h version. Also now includes PPM support for faster load/save.
+// the simple halide_image.h version. Also now includes PPM support for faster load/save,
+// and a raw format that can be memory-mapped directly into an image with no copy.
 
 #ifndef HALIDE_IMAGE_IO_H
 #define HALIDE_IMAGE_IO_H
@@ -8,11 +9,22 @@
 #include <cstdarg>
 #include <cstdio>
 #include <cstdlib>
+#include <cstring>
+#include <stdint.h>
 #include <string>
 #include <vector>
 
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
 #include "png.h"
 
+#include "HalideRuntime.h"
+
 namespace Halide {
 namespace Tools {
 
@@ -125,6 +137,72 @@ struct PngRowPointers {
     int const height;
 };
 
+// The header of a file in the raw format. It's followed by padding
+// up to data_offset, and then data_size bytes of elements laid out
+// as described by the strides, which are in elements. All fields are
+// in the byte order of the machine that wrote the file.
+struct RawHeader {
+    char magic[8];
+    uint32_t byte_order;
+    uint32_t data_offset;
+    uint8_t type_code;
+    uint8_t bits;
+    uint16_t dimensions;
+    int32_t min[4], extent[4], stride[4];
+    uint64_t data_size;
+};
+
+const char raw_magic[8] = "HLRAW01";
+const uint32_t raw_byte_order = 0x01020304;
+
+// The data starts on a page boundary, so that mapped images are
+// aligned enough for any vector loads and stores.
+const uint32_t raw_data_alignment = 4096;
+
+template<typename T> struct RawType;
+template<> struct RawType<uint8_t> { enum { code = halide_type_uint, bits = 8 }; };
+template<> struct RawType<uint16_t> { enum { code = halide_type_uint, bits = 16 }; };
+template<> struct RawType<uint32_t> { enum { code = halide_type_uint, bits = 32 }; };
+template<> struct RawType<uint64_t> { enum { code = halide_type_uint, bits = 64 }; };
+template<> struct RawType<int8_t> { enum { code = halide_type_int, bits = 8 }; };
+template<> struct RawType<int16_t> { enum { code = halide_type_int, bits = 16 }; };
+template<> struct RawType<int32_t> { enum { code = halide_type_int, bits = 32 }; };
+template<> struct RawType<int64_t> { enum { code = halide_type_int, bits = 64 }; };
+template<> struct RawType<float> { enum { code = halide_type_float, bits = 32 }; };
+template<> struct RawType<double> { enum { code = halide_type_float, bits = 64 }; };
+
+// The number of bytes spanned by a buffer with non-negative strides.
+inline uint64_t raw_data_size(int dims, const int32_t *extent, const int32_t *stride, int elem_size) {
+    uint64_t last = 0;
+    for (int i = 0; i < dims; i++) {
+        if (extent[i] <= 0) return 0;
+        last += (uint64_t)(extent[i] - 1) * stride[i];
+    }
+    return (last + 1) * elem_size;
+}
+
+// Copy the elements of a buffer of up to four dimensions between two
+// layouts. Unused dimensions have an extent of zero.
+template<typename T>
+void copy_raw_elements(const T *src, const int32_t *src_stride,
+                       T *dst, const int32_t *dst_stride, const int32_t *extent) {
+    int e[4];
+    for (int i = 0; i < 4; i++) {
+        e[i] = extent[i] ? extent[i] : 1;
+    }
+    for (int w = 0; w < e[3]; w++) {
+        for (int z = 0; z < e[2]; z++) {
+            for (int y = 0; y < e[1]; y++) {
+                const T *s = src + (ptrdiff_t)w*src_stride[3] + (ptrdiff_t)z*src_stride[2] + (ptrdiff_t)y*src_stride[1];
+                T *d = dst + (ptrdiff_t)w*dst_stride[3] + (ptrdiff_t)z*dst_stride[2] + (ptrdiff_t)y*dst_stride[1];
+                for (int x = 0; x < e[0]; x++) {
+                    d[(ptrdiff_t)x*dst_stride[0]] = s[(ptrdiff_t)x*src_stride[0]];
+                }
+            }
+        }
+    }
+}
+
 }  // namespace Internal
 
 
@@ -413,6 +491,322 @@ bool save_ppm(ImageType &im, const std::string &filename) {
     return true;
 }
 
+// A file in the raw format, mapped into memory. Images made from it
+// with map_raw or create_raw point directly into the mapping, so they
+// must not be used after it's closed. Where mmap isn't available the
+// file is read into memory instead, and writable files are written
+// back by sync() and close().
+class MappedRawFile {
+public:
+    MappedRawFile() : base(nullptr), size(0), writable(false) {
+        memset(&header, 0, sizeof(header));
+        memset(&buf, 0, sizeof(buf));
+    }
+
+    ~MappedRawFile() {
+        close();
+    }
+
+    bool is_open() const {
+        return base != nullptr;
+    }
+
+    // The buffer_t describing the data in the file. Its host pointer
+    // points into the mapping.
+    buffer_t *buffer() {
+        return &buf;
+    }
+
+    halide_type_code_t type_code() const {
+        return (halide_type_code_t) header.type_code;
+    }
+
+    int bits() const {
+        return header.bits;
+    }
+
+    // Map an existing file. If it's not writable, writes to the
+    // mapping are private to this process and are not saved.
+    template<Internal::CheckFunc check = Internal::CheckReturn>
+    bool open(const std::string &filename, bool writable = false) {
+        close();
+        if (!map<check>(filename, writable, nullptr)) return false;
+
+        Internal::RawHeader h;
+        memset(&h, 0, sizeof(h));
+        if (size >= sizeof(h)) {
+            memcpy(&h, base, sizeof(h));
+        }
+        if (!check(memcmp(h.magic, Internal::raw_magic, sizeof(h.magic)) == 0,
+                   "File %s is not a raw image\n", filename.c_str()) ||
+            !check(h.byte_order == Internal::raw_byte_order,
+                   "Raw image %s was written by a machine with the other byte order\n", filename.c_str()) ||
+            !check(h.dimensions <= 4, "Raw image %s has %d dimensions; at most 4 are supported\n",
+                   filename.c_str(), h.dimensions)) {
+            close();
+            return false;
+        }
+        for (int i = 0; i < h.dimensions; i++) {
+            if (!check(h.extent[i] > 0 && h.stride[i] >= 0, "Raw image %s has a bad extent or stride\n",
+                       filename.c_str())) {
+                close();
+                return false;
+            }
+        }
+        uint64_t data_size = Internal::raw_data_size(h.dimensions, h.extent, h.stride, (h.bits + 7) / 8);
+        if (!check(h.data_size >= data_size && h.data_offset + h.data_size <= size,
+                   "Raw image %s is truncated\n", filename.c_str())) {
+            close();
+            return false;
+        }
+        set_header(h);
+        return true;
+    }
+
+    // Make a new file big enough for the data described by the
+    // header, write the header to it, and map it writable.
+    template<Internal::CheckFunc check = Internal::CheckReturn>
+    bool create(const std::string &filename, const Internal::RawHeader &h) {
+        close();
+        if (!map<check>(filename, true, &h)) return false;
+        memcpy(base, &h, sizeof(h));
+        set_header(h);
+        return true;
+    }
+
+    // Write any changes to a writable file back to disk.
+    template<Internal::CheckFunc check = Internal::CheckReturn>
+    bool sync() {
+        if (!base || !writable) return true;
+#ifdef _WIN32
+        Internal::FileOpener f(filename.c_str(), "wb");
+        return check(f.f != nullptr && fwrite(base, 1, size, f.f) == size,
+                     "Could not write raw image %s\n", filename.c_str());
+#else
+        return check(msync(base, size, MS_SYNC) == 0, "Could not sync raw image %s\n", filename.c_str());
+#endif
+    }
+
+    void close() {
+        if (!base) return;
+#ifdef _WIN32
+        sync();
+        delete[] base;
+#else
+        munmap(base, size);
+#endif
+        base = nullptr;
+        size = 0;
+        writable = false;
+        memset(&header, 0, sizeof(header));
+        memset(&buf, 0, sizeof(buf));
+    }
+
+private:
+    MappedRawFile(const MappedRawFile &);
+    MappedRawFile &operator=(const MappedRawFile &);
+
+    // Map the whole file, or if creating it, make it the size given
+    // by the header first.
+    template<Internal::CheckFunc check>
+    bool map(const std::string &name, bool w, const Internal::RawHeader *create_header) {
+        filename = name;
+        writable = w;
+#ifdef _WIN32
+        if (create_header) {
+            size = create_header->data_offset + create_header->data_size;
+            base = new uint8_t[size]();
+        } else {
+            Internal::FileOpener f(name.c_str(), "rb");
+            if (!check(f.f != nullptr, "File %s could not be opened for reading\n", name.c_str())) return false;
+            fseek(f.f, 0, SEEK_END);
+            size = ftell(f.f);
+            fseek(f.f, 0, SEEK_SET);
+            base = new uint8_t[size];
+            if (!check(fread(base, 1, size, f.f) == size, "Could not read raw image %s\n", name.c_str())) {
+                delete[] base;
+                base = nullptr;
+                return false;
+            }
+        }
+        return true;
+#else
+        int fd = create_header ? ::open(name.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644) :
+            ::open(name.c_str(), w ? O_RDWR : O_RDONLY);
+        if (!check(fd >= 0, "File %s could not be opened\n", name.c_str())) return false;
+        if (create_header) {
+            size = create_header->data_offset + create_header->data_size;
+            if (!check(ftruncate(fd, size) == 0, "Could not resize %s\n", name.c_str())) {
+                ::close(fd);
+                return false;
+            }
+        } else {
+            struct stat st;
+            if (!check(fstat(fd, &st) == 0, "Could not stat %s\n", name.c_str())) {
+                ::close(fd);
+                return false;
+            }
+            size = st.st_size;
+        }
+        // Read-only files are mapped copy-on-write, so that pipelines
+        // may still scribble on their inputs.
+        void *p = mmap(nullptr, size, PROT_READ | PROT_WRITE, w ? MAP_SHARED : MAP_PRIVATE, fd, 0);
+        ::close(fd);
+        if (!check(p != MAP_FAILED, "Could not map %s\n", name.c_str())) {
+            size = 0;
+            return false;
+        }
+        base = (uint8_t *) p;
+        return true;
+#endif
+    }
+
+    void set_header(const Internal::RawHeader &h) {
+        header = h;
+        memset(&buf, 0, sizeof(buf));
+        for (int i = 0; i < h.dimensions; i++) {
+            buf.min[i] = h.min[i];
+            buf.extent[i] = h.extent[i];
+            buf.stride[i] = h.stride[i];
+        }
+        buf.elem_size = (h.bits + 7) / 8;
+        buf.host = base + h.data_offset;
+    }
+
+    uint8_t *base;
+    size_t size;
+    bool writable;
+    std::string filename;
+    Internal::RawHeader header;
+    buffer_t buf;
+};
+
+namespace Internal {
+
+template<typename ImageType>
+RawHeader make_raw_header(int dims, const int32_t *min, const int32_t *extent, const int32_t *stride) {
+    typedef typename ImageType::ElemType T;
+    RawHeader h;
+    memset(&h, 0, sizeof(h));
+    memcpy(h.magic, raw_magic, sizeof(h.magic));
+    h.byte_order = raw_byte_order;
+    h.data_offset = raw_data_alignment;
+    h.type_code = RawType<T>::code;
+    h.bits = RawType<T>::bits;
+    h.dimensions = dims;
+    for (int i = 0; i < dims; i++) {
+        h.min[i] = min[i];
+        h.extent[i] = extent[i];
+        h.stride[i] = stride[i];
+    }
+    h.data_size = raw_data_size(dims, extent, stride, sizeof(T));
+    return h;
+}
+
+}  // namespace Internal
+
+// Map a raw image file directly into an image, with no copy. The
+// element type must match the file exactly. The image points into
+// the mapping, so it must not be used after the file is closed. If
+// writable is true, writes to the image are saved to the file.
+template<typename ImageType, Internal::CheckFunc check = Internal::CheckReturn>
+bool map_raw(const std::string &filename, MappedRawFile *file, ImageType *im, bool writable = false) {
+    typedef typename ImageType::ElemType T;
+    if (!file->open<check>(filename, writable)) return false;
+    if (!check(file->type_code() == (halide_type_code_t) Internal::RawType<T>::code &&
+               file->bits() == Internal::RawType<T>::bits,
+               "Raw image %s does not have the element type of the image\n", filename.c_str())) {
+        file->close();
+        return false;
+    }
+    *im = ImageType(file->buffer());
+    return true;
+}
+
+// Make a new raw image file with the given size, and map it into an
+// image with a dense planar layout. Anything written to the image,
+// e.g. by realizing a pipeline into it, ends up in the file.
+template<typename ImageType, Internal::CheckFunc check = Internal::CheckReturn>
+bool create_raw(const std::string &filename, MappedRawFile *file, ImageType *im,
+                int x, int y = 0, int z = 0, int w = 0) {
+    int32_t min[4] = {0, 0, 0, 0};
+    int32_t extent[4] = {x, y, z, w};
+    int32_t stride[4] = {1, x, x*y, x*y*z};
+    int dims = 0;
+    while (dims < 4 && extent[dims]) dims++;
+    Internal::RawHeader h = Internal::make_raw_header<ImageType>(dims, min, extent, stride);
+    if (!file->create<check>(filename, h)) return false;
+    *im = ImageType(file->buffer());
+    return true;
+}
+
+// Load a raw image file into a newly allocated image. Use map_raw to
+// avoid the copy.
+template<typename ImageType, Internal::CheckFunc check = Internal::CheckReturn>
+bool load_raw(const std::string &filename, ImageType *im) {
+    typedef typename ImageType::ElemType T;
+    MappedRawFile file;
+    ImageType mapped;
+    if (!map_raw<ImageType, check>(filename, &file, &mapped)) return false;
+
+    const buffer_t *b = file.buffer();
+    *im = ImageType(b->extent[0], b->extent[1], b->extent[2], b->extent[3]);
+    int32_t dst_stride[4] = {0, 0, 0, 0};
+    for (int i = 0; i < im->dimensions(); i++) {
+        dst_stride[i] = im->stride(i);
+    }
+    Internal::copy_raw_elements((const T *) b->host, b->stride, im->data(), dst_stride, b->extent);
+    im->set_min(b->min[0], b->min[1], b->min[2], b->min[3]);
+    im->set_host_dirty();
+    return true;
+}
+
+// Save an image in the raw format. Dense images are written with their
+// own layout, e.g. interleaved images stay interleaved; anything else
+// is packed into a planar layout first.
+// "im" is not const-ref because copy_to_host() is not const.
+template<typename ImageType, Internal::CheckFunc check = Internal::CheckReturn>
+bool save_raw(ImageType &im, const std::string &filename) {
+    typedef typename ImageType::ElemType T;
+    im.copy_to_host();
+
+    int dims = im.dimensions();
+    int32_t min[4] = {0, 0, 0, 0}, extent[4] = {0, 0, 0, 0}, stride[4] = {0, 0, 0, 0};
+    uint64_t elems = 1;
+    bool positive = true;
+    for (int i = 0; i < dims; i++) {
+        min[i] = im.min(i);
+        extent[i] = im.extent(i);
+        stride[i] = im.stride(i);
+        elems *= extent[i];
+        positive = positive && stride[i] > 0;
+    }
+    bool dense = positive && Internal::raw_data_size(dims, extent, stride, sizeof(T)) == elems * sizeof(T);
+    int32_t planar[4] = {0, 0, 0, 0};
+    if (!dense) {
+        int32_t s = 1;
+        for (int i = 0; i < dims; i++) {
+            planar[i] = s;
+            s *= extent[i];
+        }
+    }
+
+    Internal::RawHeader h = Internal::make_raw_header<ImageType>(dims, min, extent, dense ? stride : planar);
+    Internal::FileOpener f(filename.c_str(), "wb");
+    if (!check(f.f != nullptr, "File %s could not be opened for writing\n", filename.c_str())) return false;
+    std::vector<uint8_t> padded_header(h.data_offset, 0);
+    memcpy(padded_header.data(), &h, sizeof(h));
+    if (!check(fwrite(padded_header.data(), 1, padded_header.size(), f.f) == padded_header.size(),
+               "Could not write raw image header\n")) return false;
+
+    if (dense) {
+        return check(fwrite(im.data(), 1, h.data_size, f.f) == h.data_size, "Could not write raw image data\n");
+    }
+    std::vector<T> data(elems);
+    Internal::copy_raw_elements((const T *) im.data(), stride, data.data(), planar, extent);
+    return check(fwrite(data.data(), sizeof(T), elems, f.f) == elems, "Could not write raw image data\n");
+}
+
 // Returns false upon failure.
 template<typename ImageType, Internal::CheckFunc check = Internal::CheckReturn>
 bool load(const std::string &filename, ImageType *im) {
@@ -420,8 +814,10 @@ bool load(const std::string &filename, ImageType *im) {
         return load_png<ImageType, check>(filename, im);
     } else if (Internal::ends_with_ignore_case(filename, ".ppm")) {
         return load_ppm<ImageType, check>(filename, im);
+    } else if (Internal::ends_with_ignore_case(filename, ".hraw")) {
+        return load_raw<ImageType, check>(filename, im);
     } else {
-        return check(false, "[load] unsupported file extension (png|ppm supported)");
+        return check(false, "[load] unsupported file extension (png|ppm|hraw supported)");
     }
 }
 
@@ -432,8 +828,10 @@ bool save(ImageType &im, const std::string &filename) {
         return save_png<ImageType, check>(im, filename);
     } else if (Internal::ends_with_ignore_case(filename, ".ppm")) {
         return save_ppm<ImageType, check>(im, filename);
+    } else if (Internal::ends_with_ignore_case(filename, ".hraw")) {
+        return save_raw<ImageType, check>(im, filename);
     } else {
-        return check(false, "[save] unsupported file extension (png|ppm supported)");
+        return check(false, "[save] unsupported file extension (png|ppm|hraw supported)");
     }
 }
 
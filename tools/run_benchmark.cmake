@@ -0,0 +1,13 @@
+# Runs one benchmark executable with HL_BENCHMARK_JSON set, so that the
+# results it reports with benchmark_report are appended to RESULTS.
+#
+# Usage: cmake -DBENCHMARK=<executable> -DRESULTS=<file> -P run_benchmark.cmake
+
+set(ENV{HL_BENCHMARK_JSON} "${RESULTS}")
+get_filename_component(BENCHMARK_DIR "${BENCHMARK}" DIRECTORY)
+execute_process(COMMAND "${BENCHMARK}"
+                WORKING_DIRECTORY "${BENCHMARK_DIR}"
+                RESULT_VARIABLE BENCHMARK_RESULT)
+if (NOT BENCHMARK_RESULT EQUAL 0)
+  message(WARNING "${BENCHMARK} failed: ${BENCHMARK_RESULT}")
+endif()
@@ -0,0 +1,123 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <map>
+#include <string>
+
+namespace {
+
+using std::map;
+using std::string;
+
+struct Result {
+    double median;
+    // The allowed slowdown relative to this result before it counts
+    // as a regression, or negative to use the default.
+    double tolerance;
+};
+
+void usage() {
+    fprintf(stderr,
+            "\n"
+            "HalideBenchmarkCompare compares two files of benchmark results,\n"
+            "as written by benchmark_report in apps/support/benchmark.h when\n"
+            "HL_BENCHMARK_JSON is set, and fails if any benchmark in both got\n"
+            "slower by more than the tolerance.\n"
+            "\n"
+            "Usage: HalideBenchmarkCompare baseline.json results.json [tolerance]\n"
+            "\n"
+            "The tolerance is the allowed fractional slowdown of the median\n"
+            "time, and defaults to 0.1. A line of the baseline may override it\n"
+            "for that benchmark with a \"tolerance\" field. To make a baseline,\n"
+            "copy a results file.\n"
+            "\n");
+}
+
+// Find the value of a field in a line of json written by
+// benchmark_report. Returns NULL if it's not there.
+const char *find_field(const char *line, const char *field) {
+    const char *f = strstr(line, field);
+    return f ? f + strlen(field) : NULL;
+}
+
+// Read the contents of a json string, up to the closing quote, undoing
+// the escapes benchmark_report writes.
+string parse_string(const char *s) {
+    string result;
+    for (; *s && *s != '"'; s++) {
+        if (*s != '\\' || !s[1]) {
+            result += *s;
+        } else if (s[1] == 'u' && strlen(s) >= 6) {
+            result += (char)strtol(string(s + 2, 4).c_str(), NULL, 16);
+            s += 5;
+        } else {
+            result += *++s;
+        }
+    }
+    return result;
+}
+
+bool load(const char *filename, map<string, Result> *results) {
+    FILE *f = fopen(filename, "r");
+    if (!f) {
+        fprintf(stderr, "Could not open %s\n", filename);
+        return false;
+    }
+    char line[4096];
+    while (fgets(line, sizeof(line), f)) {
+        const char *name = find_field(line, "\"name\": \"");
+        const char *median = find_field(line, "\"median\": ");
+        if (!name || !median) continue;
+        const char *tolerance = find_field(line, "\"tolerance\": ");
+        Result r = {atof(median), tolerance ? atof(tolerance) : -1.0};
+        // Benchmarks that ran more than once keep their best result.
+        string key = parse_string(name);
+        if (!results->count(key) || r.median < (*results)[key].median) {
+            (*results)[key] = r;
+        }
+    }
+    fclose(f);
+    return true;
+}
+
+}
+
+int main(int argc, char **argv) {
+    if (argc < 3 || argc > 4) {
+        usage();
+        return -1;
+    }
+
+    double default_tolerance = argc == 4 ? atof(argv[3]) : 0.1;
+
+    map<string, Result> baseline, results;
+    if (!load(argv[1], &baseline) || !load(argv[2], &results)) {
+        return -1;
+    }
+
+    int regressions = 0, compared = 0;
+    for (auto r : results) {
+        auto b = baseline.find(r.first);
+        if (b == baseline.end()) {
+            printf("%-40s %12.4g ms (no baseline)\n", r.first.c_str(), r.second.median * 1e3);
+            continue;
+        }
+        compared++;
+        double tolerance = b->second.tolerance >= 0 ? b->second.tolerance : default_tolerance;
+        double ratio = r.second.median / b->second.median;
+        bool regressed = ratio > 1 + tolerance;
+        printf("%-40s %12.4g ms %12.4g ms %+7.1f%%%s\n",
+               r.first.c_str(), b->second.median * 1e3, r.second.median * 1e3,
+               (ratio - 1) * 100, regressed ? "  REGRESSION" : "");
+        if (regressed) regressions++;
+    }
+    for (auto b : baseline) {
+        if (!results.count(b.first)) {
+            printf("%-40s missing from the results\n", b.first.c_str());
+        }
+    }
+
+    printf("%d benchmarks compared, %d regressions\n", compared, regressions);
+    return regressions ? 1 : 0;
+}
@@ -0,0 +1,132 @@
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <map>
+#include <vector>
+#include <string>
+
+namespace {
+
+using std::map;
+using std::vector;
+using std::string;
+
+// A span that has begun but not yet ended on some thread.
+struct OpenSpan {
+    string name;
+    double begin;
+    // Time spent in spans nested inside this one.
+    double children;
+};
+
+void usage() {
+    fprintf(stderr,
+            "\n"
+            "HalideTraceFlameGraph reads a Halide trace in the Chrome trace\n"
+            "event format from stdin, and writes the time spent in each stack\n"
+            "of realizations, productions, consumptions, and parallel tasks to\n"
+            "stdout in the collapsed stack format used by flame graph tools.\n"
+            "\n"
+            "E.g. to make a flame graph:\n"
+            " HL_TRACE=1 <command to make pipeline> && \\\n"
+            " HL_TRACE_FILE=trace.json HL_TRACE_FORMAT=chrome <command to run pipeline> && \\\n"
+            " HalideTraceFlameGraph < trace.json | flamegraph.pl > flamegraph.svg\n"
+            "\n"
+            "The same trace.json can be loaded directly into chrome://tracing\n"
+            "or Perfetto to see what each thread was doing over time.\n"
+            "\n"
+            "The arguments to HalideTraceFlameGraph are: \n"
+            " -t: Keep the index of each parallel task in its name, instead of\n"
+            "    merging all the tasks of a loop together.\n"
+            "\n");
+}
+
+// Find the value of a field in a line of json written by the Halide
+// runtime. Returns NULL if it's not there.
+const char *find_field(const char *line, const char *field) {
+    const char *f = strstr(line, field);
+    return f ? f + strlen(field) : NULL;
+}
+
+// Read the contents of a JSON string, up to the closing quote, undoing
+// the escapes the runtime writes.
+string parse_string(const char *s) {
+    string result;
+    for (; *s && *s != '"'; s++) {
+        if (*s != '\\' || !s[1]) {
+            result += *s;
+        } else if (s[1] == 'u' && strlen(s) >= 6) {
+            result += (char)strtol(string(s + 2, 4).c_str(), NULL, 16);
+            s += 5;
+        } else {
+            result += *++s;
+        }
+    }
+    return result;
+}
+
+}
+
+int main(int argc, char **argv) {
+    bool keep_task_indices = false;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-t") == 0) {
+            keep_task_indices = true;
+        } else {
+            usage();
+            return -1;
+        }
+    }
+
+    map<string, vector<OpenSpan>> stacks;
+    map<string, double> self_time;
+
+    char line[4096];
+    while (fgets(line, sizeof(line), stdin)) {
+        const char *ph = find_field(line, "\"ph\":\"");
+        const char *ts = find_field(line, "\"ts\":");
+        const char *tid = find_field(line, "\"tid\":");
+        if (!ph || !ts || !tid) continue;
+
+        double t = atof(ts);
+        string thread(tid, strcspn(tid, ",}"));
+        vector<OpenSpan> &stack = stacks[thread];
+
+        if (*ph == 'B') {
+            const char *name = find_field(line, "\"name\":\"");
+            string n = name ? parse_string(name) : "unknown";
+            if (!keep_task_indices) {
+                n = n.substr(0, n.find('['));
+            }
+            stack.push_back({n, t, 0});
+        } else if (*ph == 'E') {
+            if (stack.empty()) {
+                fprintf(stderr, "Unmatched end event on thread %s\n", thread.c_str());
+                continue;
+            }
+            string path;
+            for (const OpenSpan &s : stack) {
+                if (!path.empty()) path += ";";
+                path += s.name;
+            }
+            double duration = t - stack.back().begin;
+            self_time[path] += duration - stack.back().children;
+            stack.pop_back();
+            if (!stack.empty()) {
+                stack.back().children += duration;
+            }
+        }
+    }
+
+    // Flame graph tools want integer counts, so report microseconds.
+    for (const auto &i : self_time) {
+        long long us = (long long)(i.second + 0.5);
+        if (us > 0) {
+            printf("%s %lld\n", i.first.c_str(), us);
+        }
+    }
+
+    return 0;
+}
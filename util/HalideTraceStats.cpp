@@ -0,0 +1,359 @@
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <map>
+#include <vector>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#ifdef _MSC_VER
+#include <io.h>
+typedef int64_t ssize_t;
+#else
+#include <unistd.h>
+#endif
+
+namespace {
+
+using std::map;
+using std::vector;
+using std::string;
+using std::unordered_map;
+using std::unordered_set;
+
+// The first 48 bytes of a tracing packet are metadata
+const int packet_header_size = 48;
+
+// If the top bit of the event is set, the metadata is followed by the
+// time and thread of the event (see halide_trace in HalideRuntime.h).
+const uint8_t packet_has_time_flag = 0x80;
+const int packet_time_size = 16;
+
+// A single Halide tracing packet, as written by the default trace
+// handler in the runtime.
+struct Packet {
+    uint32_t id, parent;
+    uint8_t event, type, bits, width, value_idx, num_int_args;
+    char name[packet_header_size - 14];
+    int64_t time;
+    uint64_t thread;
+    uint8_t payload[4096 - packet_header_size];
+
+    size_t value_bytes() const {
+        size_t bytes_per_elem = 1;
+        while (bytes_per_elem*8 < bits) bytes_per_elem <<= 1;
+        return bytes_per_elem * width;
+    }
+
+    size_t payload_bytes() const {
+        return value_bytes() + sizeof(int) * num_int_args;
+    }
+
+    int get_int_arg(int idx) const {
+        return ((const int *)(payload + value_bytes()))[idx];
+    }
+
+    // Grab a packet from stdin. Returns false when stdin closes.
+    bool read_from_stdin() {
+        if (!read_stdin(this, packet_header_size)) {
+            return false;
+        }
+        if (event & packet_has_time_flag) {
+            event &= ~packet_has_time_flag;
+            if (!read_stdin(&time, packet_time_size)) {
+                fprintf(stderr, "Unexpected EOF mid-packet");
+            }
+        } else {
+            time = 0;
+            thread = 0;
+        }
+        if (!read_stdin(payload, payload_bytes())) {
+            fprintf(stderr, "Unexpected EOF mid-packet");
+        }
+        name[sizeof(name)-1] = 0;
+        return true;
+    }
+
+private:
+    // Do a blocking read of some number of bytes from stdin.
+    bool read_stdin(void *d, ssize_t size) {
+        uint8_t *dst = (uint8_t *)d;
+        if (!size) return true;
+        for (;;) {
+            ssize_t s = read(0, dst, size);
+            if (s == 0) {
+                // EOF
+                return false;
+            } else if (s < 0) {
+                perror("Failed during read");
+                exit(-1);
+                return 0;
+            } else if (s == size) {
+                return true;
+            }
+            size -= s;
+            dst += s;
+        }
+    }
+};
+
+// The number of distinct points accessed since some earlier time,
+// tracked with a Fenwick tree over access times, with a one at the
+// last time each point was accessed.
+class LastAccessTimes {
+    vector<int> marks, tree;
+
+    void rebuild() {
+        tree.assign(marks.size() + 1, 0);
+        for (size_t i = 0; i < marks.size(); i++) {
+            for (size_t j = i + 1; j < tree.size(); j += j & (0 - j)) {
+                tree[j] += marks[i];
+            }
+        }
+    }
+
+public:
+    LastAccessTimes() : marks(1024, 0) {
+        rebuild();
+    }
+
+    void set(int64_t t, int value) {
+        while ((size_t)t >= marks.size()) {
+            marks.resize(marks.size() * 2, 0);
+            rebuild();
+        }
+        int delta = value - marks[t];
+        marks[t] = value;
+        for (size_t j = t + 1; j < tree.size(); j += j & (0 - j)) {
+            tree[j] += delta;
+        }
+    }
+
+    // The number of ones at times before t.
+    int64_t count_before(int64_t t) const {
+        int64_t sum = 0;
+        for (size_t j = t; j > 0; j -= j & (0 - j)) {
+            sum += tree[j];
+        }
+        return sum;
+    }
+};
+
+// Loads are bucketed by reuse distance in powers of two: 0, 1, 2-3,
+// 4-7, etc.
+const int num_distance_buckets = 33;
+
+struct FuncStats {
+    int64_t loads = 0, stores = 0, update_stores = 0, realizations = 0;
+
+    // Distinct points stored to by the pure definition, and distinct
+    // points loaded from. Stores by update definitions are left out
+    // of the recompute ratio, because the trace doesn't say which
+    // update definition did each one, and several of them may store
+    // to the same point.
+    unordered_set<uint32_t> stored;
+    unordered_set<uint32_t> loaded;
+
+    // Whether the update definitions are running, rather than the
+    // pure one.
+    bool in_update = false;
+
+    // The total number of points in all the realizations, and the
+    // total number of distinct points loaded from each.
+    int64_t footprint = 0, used = 0;
+    unordered_set<uint32_t> used_in_realization;
+    bool in_realization = false;
+
+    // Loads that were the first access to their point, and
+    // histogram of the reuse distance of the rest.
+    int64_t cold_loads = 0;
+    int64_t reuse_distance[num_distance_buckets] = {0};
+};
+
+void usage() {
+    fprintf(stderr,
+            "\n"
+            "HalideTraceStats reads a binary Halide trace from stdin, and\n"
+            "writes statistics about the loads, stores, and realizations of\n"
+            "each Func to stdout.\n"
+            "\n"
+            "E.g.:\n"
+            " HL_TRACE=3 <command to make pipeline> && \\\n"
+            " HL_TRACE_FILE=trace.bin <command to run pipeline> && \\\n"
+            " HalideTraceStats < trace.bin\n"
+            "\n"
+            "For each Func it reports:\n"
+            " - The number of loads and stores.\n"
+            " - The recompute ratio: stores by the pure definition per distinct\n"
+            "   point it stored to. A ratio above one means the schedule\n"
+            "   computes some points more than once, e.g. in the overlap\n"
+            "   between tiles. Stores by update definitions are counted but\n"
+            "   left out of the ratio.\n"
+            " - The footprint: the total size of all the realizations, and\n"
+            "   how much of it was loaded from before the realization ended.\n"
+            " - A histogram of the reuse distance of the loads: the number of\n"
+            "   distinct points of any Func accessed since the last access to\n"
+            "   the same point. Multiply by the size of the type to compare\n"
+            "   with the size of a cache.\n"
+            "\n"
+            "The loads and stores need to have been traced, with HL_TRACE=3 or\n"
+            "Func::trace_loads and Func::trace_stores, and the realizations\n"
+            "with HL_TRACE=1 or Func::trace_realizations. If a Func is\n"
+            "realized on several threads at once, loads are attributed to its\n"
+            "most recent realization.\n"
+            "\n");
+}
+
+void print_stats(const string &name, const FuncStats &fs) {
+    printf("%s:\n", name.c_str());
+    printf("  loads: %lld  distinct points loaded: %lld\n",
+           (long long)fs.loads, (long long)fs.loaded.size());
+    if (fs.stores) {
+        printf("  stores: %lld  by updates: %lld  distinct points stored: %lld",
+               (long long)fs.stores, (long long)fs.update_stores, (long long)fs.stored.size());
+        if (!fs.stored.empty()) {
+            printf("  recompute: %.3fx", (double)(fs.stores - fs.update_stores) / fs.stored.size());
+        }
+        printf("\n");
+    }
+    if (fs.realizations) {
+        printf("  realizations: %lld  footprint: %lld points  used: %lld points",
+               (long long)fs.realizations, (long long)fs.footprint, (long long)fs.used);
+        if (fs.footprint) {
+            printf(" (%.1f%%)", 100.0 * fs.used / fs.footprint);
+        }
+        printf("\n");
+    }
+    if (fs.loads) {
+        printf("  load reuse distance (points): cold: %lld", (long long)fs.cold_loads);
+        for (int i = 0; i < num_distance_buckets; i++) {
+            if (!fs.reuse_distance[i]) continue;
+            if (i < 2) {
+                printf("  %d: %lld", i, (long long)fs.reuse_distance[i]);
+            } else {
+                printf("  %lld-%lld: %lld", 1LL << (i - 1), (1LL << i) - 1,
+                       (long long)fs.reuse_distance[i]);
+            }
+        }
+        printf("\n");
+    }
+}
+
+}
+
+int main(int argc, char **argv) {
+    if (argc != 1) {
+        usage();
+        return -1;
+    }
+
+    map<string, FuncStats> funcs;
+
+    // Every point ever accessed, keyed by its Func and coordinates,
+    // and the time it was last accessed.
+    unordered_map<string, uint32_t> point_ids;
+    vector<int64_t> last_access;
+    LastAccessTimes access_times;
+    int64_t now = 0;
+
+    Packet p;
+    string key;
+    while (p.read_from_stdin()) {
+        FuncStats &fs = funcs[p.name];
+        switch (p.event) {
+        case 0:   // load
+        case 1: { // store
+            // Count each tuple element once.
+            if (p.value_idx != 0 || !p.width) break;
+            int dims = p.num_int_args / p.width;
+            for (int lane = 0; lane < p.width; lane++) {
+                key.assign(p.name);
+                key.push_back(0);
+                for (int d = 0; d < dims; d++) {
+                    int c = p.get_int_arg(d * p.width + lane);
+                    key.append((const char *)&c, sizeof(c));
+                }
+                auto inserted = point_ids.insert({key, (uint32_t)point_ids.size()});
+                uint32_t id = inserted.first->second;
+                bool first_access = inserted.second;
+                if (first_access) {
+                    last_access.push_back(0);
+                }
+
+                if (p.event == 0) {
+                    fs.loads++;
+                    fs.loaded.insert(id);
+                    if (fs.in_realization) {
+                        fs.used_in_realization.insert(id);
+                    }
+                    if (first_access) {
+                        fs.cold_loads++;
+                    } else {
+                        // The distinct points accessed since this one.
+                        int64_t distance = (access_times.count_before(now) -
+                                            access_times.count_before(last_access[id] + 1));
+                        int bucket = 0;
+                        while (bucket < num_distance_buckets - 1 && distance >= (1LL << bucket)) {
+                            bucket++;
+                        }
+                        fs.reuse_distance[bucket]++;
+                    }
+                } else {
+                    fs.stores++;
+                    if (fs.in_update) {
+                        fs.update_stores++;
+                    } else {
+                        fs.stored.insert(id);
+                    }
+                }
+
+                if (!first_access) {
+                    access_times.set(last_access[id], 0);
+                }
+                access_times.set(now, 1);
+                last_access[id] = now;
+                now++;
+            }
+            break;
+        }
+        case 2: { // begin realization
+            fs.realizations++;
+            int64_t size = 1;
+            for (int d = 0; d + 1 < p.num_int_args; d += 2) {
+                size *= p.get_int_arg(d + 1);
+            }
+            fs.footprint += size;
+            fs.used += fs.used_in_realization.size();
+            fs.used_in_realization.clear();
+            fs.in_realization = true;
+            break;
+        }
+        case 3: // end realization
+            fs.used += fs.used_in_realization.size();
+            fs.used_in_realization.clear();
+            fs.in_realization = false;
+            break;
+        case 4: // produce
+            fs.in_update = false;
+            break;
+        case 5: // update
+            fs.in_update = true;
+            break;
+        default:
+            // Consumes, pipelines, and parallel tasks don't affect
+            // the statistics.
+            break;
+        }
+    }
+
+    for (auto &f : funcs) {
+        const FuncStats &fs = f.second;
+        if (fs.loads || fs.stores || fs.realizations) {
+            print_stats(f.first, fs);
+        }
+    }
+
+    return 0;
+}
@@ -32,11 +32,20 @@ using std::array;
 // The first 48 bytes of a tracing packet are metadata
 const int packet_header_size = 48;
 
+// If the top bit of the event is set, the metadata is followed by the
+// time and thread of the event (see halide_trace in HalideRuntime.h).
+const uint8_t packet_has_time_flag = 0x80;
+const int packet_time_size = 16;
+
 // A struct representing a single Halide tracing packet.
 struct Packet {
     uint32_t id, parent;
     uint8_t event, type, bits, width, value_idx, num_int_args;
     char name[packet_header_size - 14];
+    // When the event happened in nanoseconds, and the thread it
+    // happened on. Zero if the trace doesn't record them.
+    int64_t time;
+    uint64_t thread;
     uint8_t payload[4096 - packet_header_size]; // Not all of this will be used, but this is the max possible packet size.
 
     size_t value_bytes() const {
@@ -109,6 +118,15 @@ struct Packet {
         if (!read_stdin(this, packet_header_size)) {
             return false;
         }
+        if (event & packet_has_time_flag) {
+            event &= ~packet_has_time_flag;
+            if (!read_stdin(&time, packet_time_size)) {
+                fprintf(stderr, "Unexpected EOF mid-packet");
+            }
+        } else {
+            time = 0;
+            thread = 0;
+        }
         if (!read_stdin(payload, payload_bytes())) {
             fprintf(stderr, "Unexpected EOF mid-packet");
         }
@@ -382,7 +400,7 @@ void usage() {
 }
 
 int run(int argc, char **argv) {
-    static_assert(sizeof(Packet) == 4096, "");
+    static_assert(sizeof(Packet) == 4096 + packet_time_size, "");
 
     // State that determines how different funcs get drawn
     int frame_width = 1920, frame_height = 1080;
@@ -551,6 +569,9 @@ int run(int argc, char **argv) {
         } else if (p.event == 9) {
             pipeline_info.erase(p.id);
             continue;
+        } else if (p.event == 10 || p.event == 11) {
+            // Parallel task begin/end events don't draw anything.
+            continue;
         }
 
         PipelineInfo pipeline = pipeline_info[p.parent];